@@ -3,6 +3,7 @@
 #include "driver_max30102_fifo.h"
 
 static max30102_handle_t gs_handle;        /**< max30102 handle */
+static max30102_poll_t gs_poll;            /**< max30102 poller */
 
 /**
  * @brief  fifo example irq handler
@@ -280,6 +281,9 @@ uint8_t max30102_fifo_deinit(void)
 {
     uint8_t res;
     
+    /* drop the poller */
+    gs_poll.handle = NULL;
+    
     res = max30102_deinit(&gs_handle);
     if (res != 0)
     {
@@ -315,3 +319,41 @@ uint8_t max30102_fifo_read(uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len)
         return 0;
     }
 }
+
+/**
+ * @brief         wait for the next poll and read the data
+ * @param[out]    *raw_red pointer to a read raw data buffer
+ * @param[out]    *raw_ir pointer to a ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ * @note          for boards without the int pin, the period adapts so every
+ *                call returns just below the fifo almost full watermark
+ */
+uint8_t max30102_fifo_poll(uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len)
+{
+    uint8_t res;
+    
+    /* init the poller on the first call */
+    if (gs_poll.handle == NULL)
+    {
+        res = max30102_poll_init(&gs_poll, &gs_handle);
+        if (res != 0)
+        {
+            max30102_interface_debug_print("max30102: poll init failed.\n");
+            
+            return 1;
+        }
+    }
+    
+    res = max30102_poll_read(&gs_poll, raw_red, raw_ir, len);
+    if ((res != 0) && (res != 4))
+    {
+        return 1;
+    }
+    else
+    {
+        return 0;
+    }
+}
@@ -3,6 +3,7 @@
 #define DRIVER_MAX30102_FIFO_H
 
 #include "driver_max30102_interface.h"
+#include "driver_max30102_poll.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -76,6 +77,19 @@ uint8_t max30102_fifo_deinit(void);
  */
 uint8_t max30102_fifo_read(uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len);
 
+/**
+ * @brief         wait for the next poll and read the data
+ * @param[out]    *raw_red pointer to a read raw data buffer
+ * @param[out]    *raw_ir pointer to a ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ * @note          for boards without the int pin, the period adapts so every
+ *                call returns just below the fifo almost full watermark
+ */
+uint8_t max30102_fifo_poll(uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len);
+
 /**
  * @}
  */
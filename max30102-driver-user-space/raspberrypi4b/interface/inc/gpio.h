@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "driver_max30102_rt.h"
 
 #ifdef __cplusplus
  extern "C" {
@@ -26,6 +27,16 @@
  */
 uint8_t gpio_interrupt_init(void);
 
+/**
+ * @brief     set the real-time settings of the interrupt thread
+ * @param[in] *config pointer to a max30102 rt config structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 config is invalid
+ * @note      call before gpio_interrupt_init, the thread applies them when it starts
+ */
+uint8_t gpio_interrupt_set_rt(const max30102_rt_config_t *config);
+
 /**
  * @brief  gpio interrupt deinit
  * @return status code
@@ -20,6 +20,12 @@
 static struct gpiod_chip *gs_chip;        /**< gpio chip handle */
 static struct gpiod_line *gs_line;        /**< gpio line handle */
 static pthread_t gs_pid;                  /**< gpio pthread pid */
+static max30102_rt_config_t gs_rt =       /**< gpio pthread real-time settings */
+{
+    .priority = 0,
+    .cpu = -1,
+    .lock_memory = 0,
+};
 extern uint8_t (*g_gpio_irq)(void);       /**< gpio irq */
 
 /**
@@ -39,6 +45,12 @@ static void *a_gpio_interrupt_pthread(void *p)
     /* cancel the pthread at once */
     pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 
+    /* the fifo is drained from this thread, so it gets the real-time settings */
+    if (max30102_rt_apply(&gs_rt, NULL) != 0)
+    {
+        fprintf(stderr, "gpio: real-time settings not applied.\n");
+    }
+
     /* loop */
     while (1)
     {
@@ -118,6 +130,27 @@ uint8_t gpio_interrupt_init(void)
     return 0;
 }
 
+/**
+ * @brief     set the real-time settings of the interrupt thread
+ * @param[in] *config pointer to a max30102 rt config structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 config is invalid
+ * @note      call before gpio_interrupt_init, the thread applies them when it starts
+ */
+uint8_t gpio_interrupt_set_rt(const max30102_rt_config_t *config)
+{
+    if ((config == NULL) || (config->priority < 0) || (config->priority > 99) || (config->cpu < -1))
+    {
+        return 1;
+    }
+    
+    /* save the settings */
+    gs_rt = *config;
+    
+    return 0;
+}
+
 /**
  * @brief  gpio interrupt deinit
  * @return status code
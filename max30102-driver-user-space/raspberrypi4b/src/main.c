@@ -3,6 +3,15 @@
 #include "driver_max30102_fifo.h"
 #include "driver_max30102_register_test.h"
 #include "driver_max30102_fifo_test.h"
+#include "driver_max30102_record_test.h"
+#include "driver_max30102_codec_test.h"
+#include "driver_max30102_replay_test.h"
+#include "driver_max30102_arrow_test.h"
+#include "driver_max30102_analysis_test.h"
+#include "driver_max30102_stats_test.h"
+#include "driver_max30102_poll_test.h"
+#include "driver_max30102_rt_test.h"
+#include "driver_max30102_channel_test.h"
 #include "gpio.h"
 #include <getopt.h>
 #include <stdlib.h>
@@ -81,6 +90,7 @@ void max30102_receive_callback(uint8_t type)
  * @return    status code
  *            - 0 success
  *            - 1 run failed
+ *            - 2 test skipped
  *            - 5 param is invalid
  * @note      none
  */
@@ -97,10 +107,18 @@ uint8_t max30102(uint8_t argc, char **argv)
         {"example", required_argument, NULL, 'e'},
         {"test", required_argument, NULL, 't'},
         {"times", required_argument, NULL, 1},
+        {"file", required_argument, NULL, 2},
+        {"poll", no_argument, NULL, 3},
+        {"priority", required_argument, NULL, 4},
+        {"cpu", required_argument, NULL, 5},
+        {"mlock", no_argument, NULL, 6},
         {NULL, 0, NULL, 0},
     };
     char type[33] = "unknown";
     uint32_t times = 3;
+    char file[257] = {0};
+    uint8_t poll = 0;
+    max30102_rt_config_t rt = {0, -1, 0};
     
     /* if no params */
     if (argc == 1)
@@ -180,6 +198,60 @@ uint8_t max30102(uint8_t argc, char **argv)
                 break;
             } 
             
+            /* recording file */
+            case 2 :
+            {
+                /* set the file */
+                memset(file, 0, sizeof(char) * 257);
+                snprintf(file, 256, "%s", optarg);
+                
+                break;
+            }
+            
+            /* poll without the int pin */
+            case 3 :
+            {
+                /* set the poll */
+                poll = 1;
+                
+                break;
+            }
+            
+            /* acquisition thread priority */
+            case 4 :
+            {
+                /* set the priority */
+                rt.priority = atol(optarg);
+                if ((rt.priority < 1) || (rt.priority > 99))
+                {
+                    return 5;
+                }
+                
+                break;
+            }
+            
+            /* acquisition thread cpu */
+            case 5 :
+            {
+                /* set the cpu */
+                rt.cpu = atol(optarg);
+                if (rt.cpu < 0)
+                {
+                    return 5;
+                }
+                
+                break;
+            }
+            
+            /* lock the memory */
+            case 6 :
+            {
+                /* set the mlock */
+                rt.lock_memory = 1;
+                
+                break;
+            }
+            
             /* the end */
             case -1 :
             {
@@ -218,6 +290,7 @@ uint8_t max30102(uint8_t argc, char **argv)
         g_gpio_irq = max30102_fifo_test_irq_handler;
         
         /* gpio init */
+        (void)gpio_interrupt_set_rt(&rt);
         res = gpio_interrupt_init();
         if (res != 0)
         {
@@ -242,6 +315,145 @@ uint8_t max30102(uint8_t argc, char **argv)
         
         return 0;
     }
+    else if (strcmp("t_record", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run record test */
+        res = max30102_record_test("/tmp/max30102_record_test.m3r");
+        if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (strcmp("t_codec", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run codec test */
+        res = max30102_codec_test((file[0] != 0) ? file : NULL);
+        if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (strcmp("t_replay", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run replay test */
+        res = max30102_replay_test("/tmp/max30102_replay_test.m3r");
+        if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (strcmp("t_arrow", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run arrow test */
+        res = max30102_arrow_test("/tmp/max30102_arrow_test.arrow");
+        if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (strcmp("t_analysis", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run analysis test */
+        res = max30102_analysis_test("/tmp/max30102_analysis_test");
+        if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (strcmp("t_stats", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run stats test */
+        res = max30102_stats_test("/tmp/max30102_stats_test");
+        if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (strcmp("t_poll", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run poll test */
+        res = max30102_poll_test("/tmp/max30102_poll_test");
+        if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (strcmp("t_rt", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run rt test */
+        res = max30102_rt_test();
+        if (res == 2)
+        {
+            return 2;
+        }
+        else if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    else if (strcmp("t_channel", type) == 0)
+    {
+        uint8_t res;
+        
+        /* run channel test */
+        res = max30102_channel_test("/tmp/max30102_channel_test");
+        if (res != 0)
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
     else if (strcmp("e_fifo", type) == 0)
     {
         uint8_t res;
@@ -251,10 +463,56 @@ uint8_t max30102(uint8_t argc, char **argv)
         /* get times */
         cnt = times;
         
+        /* poll without the int pin */
+        if (poll != 0)
+        {
+            uint8_t len;
+            
+            /* the fifo is drained from this thread */
+            if (max30102_rt_apply(&rt, NULL) != 0)
+            {
+                max30102_interface_debug_print("max30102: real-time settings not applied.\n");
+            }
+            
+            /* fifo init */
+            res = max30102_fifo_init(max30102_receive_callback);
+            if (res != 0)
+            {
+                return 1;
+            }
+            
+            /* loop */
+            while (times != 0)
+            {
+                /* read data */
+                len = 32;
+                res = max30102_fifo_poll((uint32_t *)gs_raw_red, (uint32_t *)gs_raw_ir, (uint8_t *)&len);
+                if (res != 0)
+                {
+                    max30102_interface_debug_print("max30102: read failed.\n");
+                    (void)max30102_fifo_deinit();
+                    
+                    return 1;
+                }
+                if (len != 0)
+                {
+                    max30102_interface_debug_print("max30102: poll fifo with %d.\n", len);
+                    max30102_interface_debug_print("max30102: %d/%d.\n", cnt - times + 1, cnt);
+                    times--;
+                }
+            }
+            
+            /* deinit */
+            (void)max30102_fifo_deinit();
+            
+            return 0;
+        }
+        
         /* set gpio irq */
         g_gpio_irq = max30102_fifo_irq_handler;
         
         /* gpio init */
+        (void)gpio_interrupt_set_rt(&rt);
         res = gpio_interrupt_init();
         if (res != 0)
         {
@@ -326,17 +584,31 @@ uint8_t max30102(uint8_t argc, char **argv)
         max30102_interface_debug_print("  max30102 (-h | --help)\n");
         max30102_interface_debug_print("  max30102 (-p | --port)\n");
         max30102_interface_debug_print("  max30102 (-t reg | --test=reg)\n");
-        max30102_interface_debug_print("  max30102 (-t fifo | --test=fifo) [--times=<num>]\n");
-        max30102_interface_debug_print("  max30102 (-e fifo | --example=fifo) [--times=<num>]\n");
+        max30102_interface_debug_print("  max30102 (-t fifo | --test=fifo) [--times=<num>] [--priority=<num>] [--cpu=<num>] [--mlock]\n");
+        max30102_interface_debug_print("  max30102 (-t record | --test=record)\n");
+        max30102_interface_debug_print("  max30102 (-t codec | --test=codec) [--file=<path>]\n");
+        max30102_interface_debug_print("  max30102 (-t replay | --test=replay)\n");
+        max30102_interface_debug_print("  max30102 (-t arrow | --test=arrow)\n");
+        max30102_interface_debug_print("  max30102 (-t analysis | --test=analysis)\n");
+        max30102_interface_debug_print("  max30102 (-t stats | --test=stats)\n");
+        max30102_interface_debug_print("  max30102 (-t poll | --test=poll)\n");
+        max30102_interface_debug_print("  max30102 (-t rt | --test=rt)\n");
+        max30102_interface_debug_print("  max30102 (-t channel | --test=channel)\n");
+        max30102_interface_debug_print("  max30102 (-e fifo | --example=fifo) [--times=<num>] [--poll] [--priority=<num>] [--cpu=<num>] [--mlock]\n");
         max30102_interface_debug_print("\n");
         max30102_interface_debug_print("Options:\n");
         max30102_interface_debug_print("  -e <fifo>, --example=<fifo>    Run the driver example.\n");
         max30102_interface_debug_print("  -h, --help                     Show the help.\n");
         max30102_interface_debug_print("  -i, --information              Show the chip information.\n");
         max30102_interface_debug_print("  -p, --port                     Display the pin connections of the current board.\n");
-        max30102_interface_debug_print("  -t <reg | fifo>, --test=<reg | fifo>\n");
+        max30102_interface_debug_print("  -t <reg | fifo | record | codec | replay | arrow | analysis | stats | poll | rt | channel>, --test=<reg | fifo | record | codec | replay | arrow | analysis | stats | poll | rt | channel>\n");
         max30102_interface_debug_print("                                 Run the driver test.\n");
         max30102_interface_debug_print("      --times=<num>              Set the running times.([default: 3])\n");
+        max30102_interface_debug_print("      --file=<path>              Set the recording benchmarked by the codec test.\n");
+        max30102_interface_debug_print("      --poll                     Poll the fifo on a timer instead of the INT pin.\n");
+        max30102_interface_debug_print("      --priority=<num>           Run the acquisition thread as SCHED_FIFO with this priority.(1 - 99)\n");
+        max30102_interface_debug_print("      --cpu=<num>                Pin the acquisition thread to this cpu.\n");
+        max30102_interface_debug_print("      --mlock                    Lock the process memory and prefault the acquisition stack.\n");
         
         return 0;
     }
@@ -394,6 +666,10 @@ int main(uint8_t argc, char **argv)
     {
         max30102_interface_debug_print("max30102: run failed.\n");
     }
+    else if (res == 2)
+    {
+        max30102_interface_debug_print("max30102: test skipped.\n");
+    }
     else if (res == 5)
     {
         max30102_interface_debug_print("max30102: param is invalid.\n");
@@ -43,6 +43,66 @@
 #define MAX30102_REG_REVISION_ID                 0xFE        /**< revision id register */
 #define MAX30102_REG_PART_ID                     0xFF        /**< part id register */
 
+/**
+ * @brief interrupt status 1 bits that mean unread samples, cleared by a fifo data read
+ */
+#define MAX30102_STATUS_FIFO_MASK    ((1 << MAX30102_INTERRUPT_STATUS_FIFO_FULL) | \
+                                      (1 << MAX30102_INTERRUPT_STATUS_PPG_RDY))        /**< a_full and ppg_rdy */
+
+/**
+ * @brief      iic read with statistics
+ * @param[in]  *handle pointer to a max30102 handle structure
+ * @param[in]  reg iic register address
+ * @param[out] *buf pointer to a data buffer
+ * @param[in]  len data length
+ * @return     status code
+ *             - 0 success
+ *             - 1 read failed
+ * @note       none
+ */
+static uint8_t a_max30102_iic_read(max30102_handle_t *handle, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    uint8_t res;
+    uint64_t start;
+    
+    if (handle->stats == NULL)                                                                     /* check stats */
+    {
+        return handle->iic_read(MAX30102_ADDRESS, reg, buf, len);                                  /* read data */
+    }
+    start = handle->stats->clock_ns();                                                             /* get start time */
+    res = handle->iic_read(MAX30102_ADDRESS, reg, buf, len);                                       /* read data */
+    handle->stats->record(handle->stats, MAX30102_STATS_EVENT_IIC_READ, start, res, len);          /* record */
+    
+    return res;                                                                                    /* return result */
+}
+
+/**
+ * @brief     iic write with statistics
+ * @param[in] *handle pointer to a max30102 handle structure
+ * @param[in] reg iic register address
+ * @param[in] *buf pointer to a data buffer
+ * @param[in] len data length
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ * @note      none
+ */
+static uint8_t a_max30102_iic_write(max30102_handle_t *handle, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    uint8_t res;
+    uint64_t start;
+    
+    if (handle->stats == NULL)                                                                     /* check stats */
+    {
+        return handle->iic_write(MAX30102_ADDRESS, reg, buf, len);                                 /* write data */
+    }
+    start = handle->stats->clock_ns();                                                             /* get start time */
+    res = handle->iic_write(MAX30102_ADDRESS, reg, buf, len);                                      /* write data */
+    handle->stats->record(handle->stats, MAX30102_STATS_EVENT_IIC_WRITE, start, res, len);         /* record */
+    
+    return res;                                                                                    /* return result */
+}
+
 /**
  * @brief     initialize the chip
  * @param[in] *handle pointer to a max30102 handle structure
@@ -113,7 +173,7 @@ uint8_t max30102_init(max30102_handle_t *handle)
         
         return 1;                                                                                           /* return error */
     }
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_PART_ID, (uint8_t *)&part_id, 1);                 /* read part id */
+    res = a_max30102_iic_read(handle, MAX30102_REG_PART_ID, (uint8_t *)&part_id, 1);                        /* read part id */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: read part id failed.\n");                                            /* read part id failed */
@@ -128,7 +188,7 @@ uint8_t max30102_init(max30102_handle_t *handle)
         
         return 4;                                                                                           /* return error */
     }
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                /* read mode config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                       /* read mode config */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                        /* read mode config failed */
@@ -138,7 +198,7 @@ uint8_t max30102_init(max30102_handle_t *handle)
     }
     prev &= ~(1 << 6);                                                                                      /* clear config */
     prev |= 1 << 6;                                                                                         /* set 1 */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);               /* write mode config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                      /* write mode config */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: write mode config failed.\n");                                       /* write mode config failed */
@@ -147,7 +207,7 @@ uint8_t max30102_init(max30102_handle_t *handle)
         return 5;                                                                                           /* return error */
     }
     handle->delay_ms(10);                                                                                   /* delay 10 ms */
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                /* read mode config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                       /* read mode config */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                        /* read mode config failed */
@@ -163,7 +223,7 @@ uint8_t max30102_init(max30102_handle_t *handle)
         return 5;                                                                                           /* return error */
     }
     prev = 0;                                                                                               /* set zero */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_READ_POINTER, (uint8_t *)&prev, 1);         /* write fifo read pointer */
+    res = a_max30102_iic_write(handle, MAX30102_REG_FIFO_READ_POINTER, (uint8_t *)&prev, 1);                /* write fifo read pointer */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: write fifo read pointer failed.\n");                                 /* write fifo read pointer failed */
@@ -171,7 +231,7 @@ uint8_t max30102_init(max30102_handle_t *handle)
         
         return 6;                                                                                           /* return error */
     }
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_WRITE_POINTER, (uint8_t *)&prev, 1);        /* write fifo write pointer */
+    res = a_max30102_iic_write(handle, MAX30102_REG_FIFO_WRITE_POINTER, (uint8_t *)&prev, 1);               /* write fifo write pointer */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: write fifo write pointer failed.\n");                                /* write fifo write pointer failed */
@@ -179,7 +239,7 @@ uint8_t max30102_init(max30102_handle_t *handle)
         
         return 6;                                                                                           /* return error */
     }
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_OVERFLOW_COUNTER, (uint8_t *)&prev, 1);          /* write overflow counter */
+    res = a_max30102_iic_write(handle, MAX30102_REG_OVERFLOW_COUNTER, (uint8_t *)&prev, 1);                 /* write overflow counter */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: write overflow counter failed.\n");                                  /* write overflow counter failed */
@@ -217,7 +277,7 @@ uint8_t max30102_deinit(max30102_handle_t *handle)
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);         /* read mode config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                /* read mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                 /* read mode config failed */
@@ -226,7 +286,7 @@ uint8_t max30102_deinit(max30102_handle_t *handle)
     }
     prev &= ~(1 << 7);                                                                               /* clear config */
     prev |= 1 << 7;                                                                                  /* set bool */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);        /* write mode config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);               /* write mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write mode config failed.\n");                                /* write mode config failed */
@@ -246,36 +306,29 @@ uint8_t max30102_deinit(max30102_handle_t *handle)
 }
 
 /**
- * @brief     irq handler
+ * @brief     irq handler body
  * @param[in] *handle pointer to a max30102 handle structure
  * @return    status code
  *            - 0 success
  *            - 1 run failed
- *            - 2 handle is NULL
- *            - 3 handle is not initialized
  * @note      none
  */
-uint8_t max30102_irq_handler(max30102_handle_t *handle)
+static uint8_t a_max30102_irq_handler(max30102_handle_t *handle)
 {
     uint8_t res;
     uint8_t prev;
+    uint8_t pending;
     
-    if (handle == NULL)                                                                                            /* check handle */
-    {
-        return 2;                                                                                                  /* return error */
-    }
-    if (handle->inited != 1)                                                                                       /* check handle initialization */
-    {
-        return 3;                                                                                                  /* return error */
-    }
-    
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_STATUS_1, (uint8_t *)&prev, 1);                /* read interrupt status1 */
+    res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_STATUS_1, (uint8_t *)&prev, 1);                       /* read interrupt status1 */
     if (res != 0)                                                                                                  /* check result */
     {
         handle->debug_print("max30102: read interrupt status1 failed.\n");                                         /* read interrupt status1 failed */
        
         return 1;                                                                                                  /* return error */
     }
+    pending = handle->status;                                                                                      /* bits a fifo read took */
+    handle->status = (uint8_t)((pending | prev) & MAX30102_STATUS_FIFO_MASK);                                      /* keep the fifo bits for the next read */
+    prev = (uint8_t)(prev | (pending & ~MAX30102_STATUS_FIFO_MASK));                                               /* handle the others now */
     if ((prev & (1 << MAX30102_INTERRUPT_STATUS_FIFO_FULL)) != 0)                                                  /* check fifo full */
     {
         if (handle->receive_callback != NULL)                                                                      /* if receive callback */
@@ -304,7 +357,7 @@ uint8_t max30102_irq_handler(max30102_handle_t *handle)
             handle->receive_callback(MAX30102_INTERRUPT_STATUS_PWR_RDY);                                           /* run callback */
         }
     }
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_STATUS_2, (uint8_t *)&prev, 1);                /* read interrupt status2 */
+    res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_STATUS_2, (uint8_t *)&prev, 1);                       /* read interrupt status2 */
     if (res != 0)                                                                                                  /* check result */
     {
         handle->debug_print("max30102: read interrupt status2 failed.\n");                                         /* read interrupt status2 failed */
@@ -315,7 +368,7 @@ uint8_t max30102_irq_handler(max30102_handle_t *handle)
     {
         uint8_t prev1;
         
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_DIE_TEMP_INTEGER, (uint8_t *)&prev, 1);              /* read die temp integer */
+        res = a_max30102_iic_read(handle, MAX30102_REG_DIE_TEMP_INTEGER, (uint8_t *)&prev, 1);                     /* read die temp integer */
         if (res != 0)                                                                                              /* check result */
         {
             handle->debug_print("max30102: read die temp integer failed.\n");                                      /* read die temp integer failed */
@@ -323,7 +376,7 @@ uint8_t max30102_irq_handler(max30102_handle_t *handle)
             return 1;                                                                                              /* return error */
         }
         handle->raw = (uint16_t)prev << 4;                                                                         /* set integer part */
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_DIE_TEMP_FRACTION, (uint8_t *)&prev1, 1);            /* read die temp fraction */
+        res = a_max30102_iic_read(handle, MAX30102_REG_DIE_TEMP_FRACTION, (uint8_t *)&prev1, 1);                   /* read die temp fraction */
         if (res != 0)                                                                                              /* check result */
         {
             handle->debug_print("max30102: read die temp fraction failed.\n");                                     /* read die temp fraction failed */
@@ -344,81 +397,124 @@ uint8_t max30102_irq_handler(max30102_handle_t *handle)
 }
 
 /**
- * @brief         read the data
- * @param[in]     *handle pointer to a max30102 handle structure
- * @param[out]    *raw_red pointer to a red raw data buffer
- * @param[out]    *raw_ir pointer to an ir raw data buffer
- * @param[in,out] *len pointer to a length buffer
- * @return        status code
- *                - 0 success
- *                - 1 read failed
- *                - 2 handle is NULL
- *                - 3 handle is not initialized
- *                - 4 fifo overrun
- *                - 5 mode is invalid
- * @note          none
+ * @brief     irq handler
+ * @param[in] *handle pointer to a max30102 handle structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 run failed
+ *            - 2 handle is NULL
+ *            - 3 handle is not initialized
+ * @note      none
  */
-uint8_t max30102_read(max30102_handle_t *handle, uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len)
+uint8_t max30102_irq_handler(max30102_handle_t *handle)
 {
     uint8_t res;
-    uint8_t prev;
-    uint8_t mode;
-    uint8_t k;
-    uint8_t read_point;
-    uint8_t write_point;
-    uint8_t l;
-    uint8_t bit;
-    uint8_t i;
-    uint8_t r;
+    uint64_t start;
     
-    if (handle == NULL)                                                                                           /* check handle */
+    if (handle == NULL)                                                                                   /* check handle */
     {
-        return 2;                                                                                                 /* return error */
+        return 2;                                                                                         /* return error */
     }
-    if (handle->inited != 1)                                                                                      /* check handle initialization */
+    if (handle->inited != 1)                                                                              /* check handle initialization */
     {
-        return 3;                                                                                                 /* return error */
+        return 3;                                                                                         /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_OVERFLOW_COUNTER, (uint8_t *)&prev, 1);                 /* read overflow counter */
-    if (res != 0)                                                                                                 /* check result */
+    if (handle->stats == NULL)                                                                            /* check stats */
     {
-        handle->debug_print("max30102: read overflow counter failed.\n");                                         /* read overflow counter failed */
-       
-        return 1;                                                                                                 /* return error */
-    }
-    r = 0;                                                                                                        /* set 0 */
-    if (prev != 0)                                                                                                /* check overflow */
-    {
-        r = 4;                                                                                                    /* set 4 */
-        
-        handle->debug_print("max30102: fifo overrun.\n");                                                         /* fifo overrun*/
+        return a_max30102_irq_handler(handle);                                                            /* run irq handler */
     }
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_READ_POINTER, (uint8_t *)&read_point, 1);          /* read fifo read point */
+    start = handle->stats->clock_ns();                                                                    /* get start time */
+    res = a_max30102_irq_handler(handle);                                                                 /* run irq handler */
+    handle->stats->record(handle->stats, MAX30102_STATS_EVENT_IRQ, start, res, 0);                        /* record */
+    
+    return res;                                                                                           /* return result */
+}
+
+/**
+ * @brief         read the fifo level
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[in,out] *len pointer to a length buffer, the capacity in and the samples to read out
+ * @param[out]    *r pointer to the read result, 4 after a fifo overrun
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ * @note          equal pointers are an empty or a full fifo, it is full when
+ *                samples were lost or a_full or ppg_rdy is latched, because
+ *                a fifo data read clears both; the status comes from the last
+ *                irq handler run, whose fifo bits stay until the next fifo
+ *                data read, or is read here only when the pointers cannot
+ *                tell, and the bits that are not the fifo's are kept for the
+ *                irq handler
+ */
+static uint8_t a_max30102_fifo_level(max30102_handle_t *handle, uint8_t *len, uint8_t *r)
+{
+    uint8_t res;
+    uint8_t ptr[3];
+    uint8_t status;
+    uint8_t l;
+    
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_WRITE_POINTER, (uint8_t *)ptr, 3);                        /* read write point, overflow counter and read point */
     if (res != 0)                                                                                                 /* check result */
     {
-        handle->debug_print("max30102: read fifo read point failed.\n");                                          /* read fifo read point failed */
+        handle->debug_print("max30102: read fifo pointers failed.\n");                                            /* read fifo pointers failed */
        
         return 1;                                                                                                 /* return error */
     }
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_WRITE_POINTER, (uint8_t *)&write_point, 1);        /* read fifo write point */
-    if (res != 0)                                                                                                 /* check result */
+    status = handle->status;                                                                                      /* status of the last irq, taken after the pointers */
+    *r = 0;                                                                                                       /* set 0 */
+    if (ptr[1] != 0)                                                                                              /* check overflow */
     {
-        handle->debug_print("max30102: read fifo write point failed.\n");                                         /* read fifo write point failed */
-       
-        return 1;                                                                                                 /* return error */
+        *r = 4;                                                                                                   /* set 4 */
+        
+        handle->debug_print("max30102: fifo overrun.\n");                                                         /* fifo overrun*/
+        if (handle->stats != NULL)                                                                                /* check stats */
+        {
+            handle->stats->record(handle->stats, MAX30102_STATS_EVENT_OVERRUN, 0, 4, ptr[1]);                     /* record overflow counter */
+        }
     }
     
-    if (write_point > read_point)                                                                                 /* check point */
+    l = (uint8_t)((ptr[0] - ptr[2]) & 0x1F);                                                                      /* unread samples, 0 when empty or full */
+    if ((l == 0) && (ptr[1] == 0) && ((status & MAX30102_STATUS_FIFO_MASK) == 0))                                 /* pointers cannot tell */
     {
-        l = write_point - read_point;                                                                             /* get length */
+        res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_STATUS_1, (uint8_t *)&status, 1);                /* read interrupt status1 */
+        if (res != 0)                                                                                             /* check result */
+        {
+            handle->debug_print("max30102: read interrupt status1 failed.\n");                                    /* read interrupt status1 failed */
+           
+            return 1;                                                                                             /* return error */
+        }
+        handle->status = (uint8_t)(handle->status | (status & ~MAX30102_STATUS_FIFO_MASK));                       /* keep the others for the irq handler */
     }
-    else
+    if ((l == 0) && ((ptr[1] != 0) || ((status & MAX30102_STATUS_FIFO_MASK) != 0)))                              /* check full */
     {
-        l = 32 + write_point - read_point;                                                                        /* get length */
+        l = 32;                                                                                                   /* full fifo */
     }
     *len = ((*len) > l) ? l : (*len);                                                                             /* set read length */
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                      /* read mode config */
+    
+    return 0;                                                                                                     /* success return 0 */
+}
+
+/**
+ * @brief      get the channel layout body
+ * @param[in]  *handle pointer to a max30102 handle structure
+ * @param[out] *layout pointer to a max30102 channel layout structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 get channel layout failed
+ *             - 5 mode is invalid or no slot is active
+ * @note       none
+ */
+static uint8_t a_max30102_get_channel_layout(max30102_handle_t *handle, max30102_channel_layout_t *layout)
+{
+    uint8_t res;
+    uint8_t prev;
+    uint8_t mode;
+    uint8_t slot[2];
+    uint8_t led;
+    uint8_t i;
+    
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                             /* read mode config */
     if (res != 0)                                                                                                 /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                              /* read mode config failed */
@@ -426,82 +522,428 @@ uint8_t max30102_read(max30102_handle_t *handle, uint32_t *raw_red, uint32_t *ra
         return 1;                                                                                                 /* return error */
     }
     mode = (max30102_mode_t)(prev & 0x7);                                                                         /* get mode */
+    layout->channels = 0;                                                                                         /* no channel */
+    layout->mask = 0;                                                                                             /* no slot */
     if (mode == MAX30102_MODE_HEART_RATE)                                                                         /* check heart rate mode */
     {
-        k = 3;                                                                                                    /* 3 */
+        layout->led[0] = MAX30102_LED_RED;                                                                        /* red */
+        layout->channels = 1;                                                                                     /* 1 channel */
+        layout->mask = 0x1;                                                                                       /* slot 1 */
     }
     else if (mode == MAX30102_MODE_SPO2)                                                                          /* check spo2 mode*/
     {
-        k = 6;                                                                                                    /* 6 */
+        layout->led[0] = MAX30102_LED_RED;                                                                        /* red */
+        layout->led[1] = MAX30102_LED_IR;                                                                         /* ir */
+        layout->channels = 2;                                                                                     /* 2 channels */
+        layout->mask = 0x3;                                                                                       /* slot 1 and 2 */
     }
     else if (mode == MAX30102_MODE_MULTI_LED)                                                                     /* check multi led mode */
     {
-        k = 6;                                                                                                    /* 6 */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)slot, 2);             /* read led slots */
+        if (res != 0)                                                                                             /* check result */
+        {
+            handle->debug_print("max30102: read led slot failed.\n");                                             /* read led slot failed */
+           
+            return 1;                                                                                             /* return error */
+        }
+        for (i = 0; i < 4; i++)                                                                                   /* check each slot */
+        {
+            led = (slot[i / 2] >> ((i % 2) * 4)) & 0x7;                                                           /* get slot led */
+            if ((led == MAX30102_LED_RED) || (led == MAX30102_LED_IR))                                            /* a disabled slot writes nothing */
+            {
+                layout->led[layout->channels] = (max30102_led_t)led;                                              /* set led */
+                layout->channels++;                                                                               /* one more channel */
+                layout->mask |= (uint8_t)(1 << i);                                                                /* set slot */
+            }
+        }
     }
     else
     {
-        handle->debug_print("max30105: mode is invalid.\n");                                                      /* mode is invalid */
+        handle->debug_print("max30102: mode is invalid.\n");                                                      /* mode is invalid */
        
         return 5;                                                                                                 /* return error */
     }
+    if (layout->channels == 0)                                                                                    /* check channels */
+    {
+        handle->debug_print("max30102: no slot is active.\n");                                                    /* no slot is active */
+       
+        return 5;                                                                                                 /* return error */
+    }
+    for (i = layout->channels; i < 4; i++)                                                                        /* clear the rest */
+    {
+        layout->led[i] = MAX30102_LED_NONE;                                                                       /* none */
+    }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_DATA_REGISTER, handle->buf, (*len) * k);           /* read fifo read point */
+    res = a_max30102_iic_read(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);                             /* read spo2 config */
     if (res != 0)                                                                                                 /* check result */
     {
-        handle->debug_print("max30102: read fifo data register failed.\n");                                       /* read fifo data register failed */
+        handle->debug_print("max30102: read spo2 config failed.\n");                                              /* read spo2 config failed */
        
         return 1;                                                                                                 /* return error */
     }
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);                      /* read spo2 config */
+    layout->shift = 3 - (prev & 0x3);                                                                             /* 15 bits shift 3, 18 bits shift 0 */
+    
+    return 0;                                                                                                     /* success return 0 */
+}
+
+/**
+ * @brief         read the fifo data register
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[in]     *layout pointer to a max30102 channel layout structure
+ * @param[in]     len samples to read
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ * @note          only the active channels are on the bus, 3 bytes each
+ */
+static uint8_t a_max30102_fifo_read(max30102_handle_t *handle, const max30102_channel_layout_t *layout, uint8_t len)
+{
+    uint8_t res;
+    
+    if (len == 0)                                                                                                 /* check length */
+    {
+        return 0;                                                                                                 /* nothing to read */
+    }
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_DATA_REGISTER, handle->buf,
+                              (uint16_t)(len * layout->channels * 3));                                            /* read fifo data register */
     if (res != 0)                                                                                                 /* check result */
     {
-        handle->debug_print("max30102: read spo2 config failed.\n");                                              /* read spo2 config failed */
+        handle->debug_print("max30102: read fifo data register failed.\n");                                       /* read fifo data register failed */
        
         return 1;                                                                                                 /* return error */
     }
-    prev = prev & 0x3;                                                                                            /* get config */
-    if (prev == 0)                                                                                                /* if 0 */
+    handle->status = (uint8_t)(handle->status & ~MAX30102_STATUS_FIFO_MASK);                                      /* the read cleared the fifo bits */
+    
+    return 0;                                                                                                     /* success return 0 */
+}
+
+/**
+ * @brief         read the data body
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[out]    *raw_red pointer to a red raw data buffer
+ * @param[out]    *raw_ir pointer to an ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 4 fifo overrun
+ *                - 5 mode is invalid
+ * @note          none
+ */
+static uint8_t a_max30102_read(max30102_handle_t *handle, uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len)
+{
+    max30102_channel_layout_t layout;
+    uint8_t res;
+    uint8_t red;
+    uint8_t ir;
+    uint8_t k;
+    uint8_t i;
+    uint8_t *p;
+    uint8_t r;
+    
+    res = a_max30102_fifo_level(handle, len, &r);                                                                 /* read fifo level */
+    if (res != 0)                                                                                                 /* check result */
     {
-        bit = 3;                                                                                                  /* 15 bits */
+        return 1;                                                                                                 /* return error */
     }
-    else if (prev == 1)                                                                                           /* if 1 */
+    if ((*len) == 0)                                                                                              /* check empty */
     {
-        bit = 2;                                                                                                  /* 16 bits */
+        return r;                                                                                                 /* nothing to read, skip the config */
     }
-    else if (prev == 2)                                                                                           /* if 2 */
+    res = a_max30102_get_channel_layout(handle, &layout);                                                         /* get channel layout */
+    if (res != 0)                                                                                                 /* check result */
     {
-        bit = 1;                                                                                                  /* 17 bits */
+        return res;                                                                                               /* return error */
     }
-    else                                                                                                          /* if 3 */
+    res = a_max30102_fifo_read(handle, &layout, *len);                                                            /* read fifo */
+    if (res != 0)                                                                                                 /* check result */
     {
-        bit = 0;                                                                                                  /* 18 bits */
+        return 1;                                                                                                 /* return error */
     }
     
-    for (i = 0; i < (*len); i++)                                                                                  /* copy data */
+    red = 4;                                                                                                      /* no red channel */
+    ir = 4;                                                                                                       /* no ir channel */
+    for (i = layout.channels; i > 0; i--)                                                                         /* find the first of each led */
     {
-        if (mode == MAX30102_MODE_HEART_RATE)                                                                     /* check red mode */
+        if (layout.led[i - 1] == MAX30102_LED_RED)                                                                /* check red */
         {
-            raw_red[i] = ((uint32_t)handle->buf[i * 3 + 0] << 16) |                                               /* get raw red data */
-                         ((uint32_t)handle->buf[i * 3 + 1] << 8) |                                                /* get raw red data */
-                         ((uint32_t)handle->buf[i * 3 + 2] << 0);                                                 /* get raw red data */
-            raw_red[i] = raw_red[i] >> bit;                                                                       /* right shift bit */
+            red = i - 1;                                                                                          /* set red channel */
         }
         else
         {
-            raw_red[i] = ((uint32_t)handle->buf[i * 6 + 0] << 16) |                                               /* get raw red data */
-                         ((uint32_t)handle->buf[i * 6 + 1] << 8) |                                                /* get raw red data */
-                         ((uint32_t)handle->buf[i * 6 + 2] << 0);                                                 /* get raw red data */
-            raw_red[i] = raw_red[i] >> bit;                                                                       /* right shift bit */
-            raw_ir[i] = ((uint32_t)handle->buf[i * 6 + 3] << 16) |                                                /* get raw ir data */
-                        ((uint32_t)handle->buf[i * 6 + 4] << 8) |                                                 /* get raw ir data */
-                        ((uint32_t)handle->buf[i * 6 + 5] << 0);                                                  /* get raw ir data */
-            raw_ir[i] = raw_ir[i] >> bit;                                                                         /* right shift bit */
+            ir = i - 1;                                                                                           /* set ir channel */
+        }
+    }
+    k = layout.channels * 3;                                                                                      /* bytes per sample */
+    for (i = 0; i < (*len); i++)                                                                                  /* copy data */
+    {
+        if (red < 4)                                                                                              /* check red channel */
+        {
+            p = &handle->buf[i * k + red * 3];                                                                    /* red bytes */
+            raw_red[i] = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 0);                  /* get raw red data */
+            raw_red[i] = raw_red[i] >> layout.shift;                                                              /* right shift bit */
+        }
+        if (ir < 4)                                                                                               /* check ir channel */
+        {
+            p = &handle->buf[i * k + ir * 3];                                                                     /* ir bytes */
+            raw_ir[i] = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 0);                   /* get raw ir data */
+            raw_ir[i] = raw_ir[i] >> layout.shift;                                                                /* right shift bit */
         }
     }
     
     return r;                                                                                                     /* success return 0 */
 }
 
+/**
+ * @brief         read the data
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[out]    *raw_red pointer to a red raw data buffer
+ * @param[out]    *raw_ir pointer to an ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 3 handle is not initialized
+ *                - 4 fifo overrun
+ *                - 5 mode is invalid
+ * @note          none
+ */
+uint8_t max30102_read(max30102_handle_t *handle, uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len)
+{
+    uint8_t res;
+    uint64_t start;
+    
+    if (handle == NULL)                                                                                   /* check handle */
+    {
+        return 2;                                                                                         /* return error */
+    }
+    if (handle->inited != 1)                                                                              /* check handle initialization */
+    {
+        return 3;                                                                                         /* return error */
+    }
+    
+    if (handle->stats == NULL)                                                                            /* check stats */
+    {
+        return a_max30102_read(handle, raw_red, raw_ir, len);                                             /* read data */
+    }
+    start = handle->stats->clock_ns();                                                                    /* get start time */
+    res = a_max30102_read(handle, raw_red, raw_ir, len);                                                  /* read data */
+    handle->stats->record(handle->stats, MAX30102_STATS_EVENT_FIFO_DRAIN, start, res,
+                          ((res == 0) || (res == 4)) ? (*len) : 0);                                       /* record */
+    
+    return res;                                                                                           /* return result */
+}
+
+/**
+ * @brief      get the fifo channel layout of the current mode and slots
+ * @param[in]  *handle pointer to a max30102 handle structure
+ * @param[out] *layout pointer to a max30102 channel layout structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 get channel layout failed
+ *             - 2 handle is NULL
+ *             - 3 handle is not initialized
+ *             - 5 mode is invalid or no slot is active
+ * @note       none
+ */
+uint8_t max30102_get_channel_layout(max30102_handle_t *handle, max30102_channel_layout_t *layout)
+{
+    if (handle == NULL)                                                                                   /* check handle */
+    {
+        return 2;                                                                                         /* return error */
+    }
+    if (handle->inited != 1)                                                                              /* check handle initialization */
+    {
+        return 3;                                                                                         /* return error */
+    }
+    if (layout == NULL)                                                                                   /* check layout */
+    {
+        return 2;                                                                                         /* return error */
+    }
+    
+    return a_max30102_get_channel_layout(handle, layout);                                                 /* get channel layout */
+}
+
+/**
+ * @brief         read the data of every active channel body
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[in]     *layout pointer to a max30102 channel layout structure
+ * @param[out]    *raw pointer to a raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 4 fifo overrun
+ * @note          none
+ */
+static uint8_t a_max30102_read_channels(max30102_handle_t *handle, const max30102_channel_layout_t *layout,
+                                        uint32_t *raw, uint8_t *len)
+{
+    uint8_t res;
+    uint16_t n;
+    uint16_t i;
+    uint8_t *p;
+    uint8_t r;
+    
+    res = a_max30102_fifo_level(handle, len, &r);                                                         /* read fifo level */
+    if (res != 0)                                                                                         /* check result */
+    {
+        return 1;                                                                                         /* return error */
+    }
+    res = a_max30102_fifo_read(handle, layout, *len);                                                     /* read fifo */
+    if (res != 0)                                                                                         /* check result */
+    {
+        return 1;                                                                                         /* return error */
+    }
+    
+    n = (uint16_t)((*len) * layout->channels);                                                            /* values to decode */
+    p = handle->buf;                                                                                      /* first value */
+    for (i = 0; i < n; i++)                                                                               /* copy data */
+    {
+        raw[i] = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 0);                  /* get raw data */
+        raw[i] = raw[i] >> layout->shift;                                                                 /* right shift bit */
+        p += 3;                                                                                           /* next value */
+    }
+    
+    return r;                                                                                             /* success return 0 */
+}
+
+/**
+ * @brief         read the data of every active channel
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[in]     *layout pointer to the layout from max30102_get_channel_layout
+ * @param[out]    *raw pointer to a raw data buffer of len * layout->channels values
+ * @param[in,out] *len pointer to a length buffer
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 3 handle is not initialized
+ *                - 4 fifo overrun
+ *                - 5 layout is invalid
+ * @note          none
+ */
+uint8_t max30102_read_channels(max30102_handle_t *handle, const max30102_channel_layout_t *layout,
+                               uint32_t *raw, uint8_t *len)
+{
+    uint8_t res;
+    uint64_t start;
+    
+    if (handle == NULL)                                                                                   /* check handle */
+    {
+        return 2;                                                                                         /* return error */
+    }
+    if (handle->inited != 1)                                                                              /* check handle initialization */
+    {
+        return 3;                                                                                         /* return error */
+    }
+    if ((layout == NULL) || (raw == NULL) || (len == NULL))                                               /* check buffers */
+    {
+        return 2;                                                                                         /* return error */
+    }
+    if ((layout->channels == 0) || (layout->channels > 4) || (layout->shift > 3))                         /* check layout */
+    {
+        handle->debug_print("max30102: layout is invalid.\n");                                            /* layout is invalid */
+        
+        return 5;                                                                                         /* return error */
+    }
+    
+    if (handle->stats == NULL)                                                                            /* check stats */
+    {
+        return a_max30102_read_channels(handle, layout, raw, len);                                        /* read data */
+    }
+    start = handle->stats->clock_ns();                                                                    /* get start time */
+    res = a_max30102_read_channels(handle, layout, raw, len);                                             /* read data */
+    handle->stats->record(handle->stats, MAX30102_STATS_EVENT_FIFO_DRAIN, start, res,
+                          ((res == 0) || (res == 4)) ? (*len) : 0);                                       /* record */
+    
+    return res;                                                                                           /* return result */
+}
+
+/**
+ * @brief         read the undecoded fifo bytes body
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[in]     *layout pointer to a max30102 channel layout structure
+ * @param[in,out] *len pointer to a length buffer
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 4 fifo overrun
+ * @note          none
+ */
+static uint8_t a_max30102_read_raw(max30102_handle_t *handle, const max30102_channel_layout_t *layout, uint8_t *len)
+{
+    uint8_t res;
+    uint8_t r;
+    
+    res = a_max30102_fifo_level(handle, len, &r);                                                         /* read fifo level */
+    if (res != 0)                                                                                         /* check result */
+    {
+        return 1;                                                                                         /* return error */
+    }
+    res = a_max30102_fifo_read(handle, layout, *len);                                                     /* read fifo */
+    if (res != 0)                                                                                         /* check result */
+    {
+        return 1;                                                                                         /* return error */
+    }
+    
+    return r;                                                                                             /* success return 0 */
+}
+
+/**
+ * @brief         read the undecoded fifo bytes of every active channel
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[in]     *layout pointer to the layout from max30102_get_channel_layout
+ * @param[out]    **fifo pointer to a pointer set to the fifo bytes
+ * @param[in,out] *len pointer to a length buffer, the capacity in samples in and the samples read out
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 3 handle is not initialized
+ *                - 4 fifo overrun
+ *                - 5 layout is invalid
+ * @note          none
+ */
+uint8_t max30102_read_raw(max30102_handle_t *handle, const max30102_channel_layout_t *layout,
+                          const uint8_t **fifo, uint8_t *len)
+{
+    uint8_t res;
+    uint64_t start;
+    
+    if (handle == NULL)                                                                                   /* check handle */
+    {
+        return 2;                                                                                         /* return error */
+    }
+    if (handle->inited != 1)                                                                              /* check handle initialization */
+    {
+        return 3;                                                                                         /* return error */
+    }
+    if ((layout == NULL) || (fifo == NULL) || (len == NULL))                                              /* check buffers */
+    {
+        return 2;                                                                                         /* return error */
+    }
+    if ((layout->channels == 0) || (layout->channels > 4) || (layout->shift > 3))                         /* check layout */
+    {
+        handle->debug_print("max30102: layout is invalid.\n");                                            /* layout is invalid */
+        
+        return 5;                                                                                         /* return error */
+    }
+    
+    *fifo = handle->buf;                                                                                  /* handle buffer */
+    if (handle->stats == NULL)                                                                            /* check stats */
+    {
+        return a_max30102_read_raw(handle, layout, len);                                                  /* read data */
+    }
+    start = handle->stats->clock_ns();                                                                    /* get start time */
+    res = a_max30102_read_raw(handle, layout, len);                                                       /* read data */
+    handle->stats->record(handle->stats, MAX30102_STATS_EVENT_FIFO_DRAIN, start, res,
+                          ((res == 0) || (res == 4)) ? (*len) : 0);                                       /* record */
+    
+    return res;                                                                                           /* return result */
+}
+
 /**
  * @brief      read the temperature
  * @param[in]  *handle pointer to a max30102 handle structure
@@ -529,7 +971,7 @@ uint8_t max30102_read_temperature(max30102_handle_t *handle, uint16_t *raw, floa
         return 3;                                                                                              /* return error */
     }
 
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);            /* read interrupt enable2 */
+    res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);                   /* read interrupt enable2 */
     if (res != 0)                                                                                              /* check result */
     {
         handle->debug_print("max30102: read interrupt enable2 failed.\n");                                     /* read interrupt enable2 failed */
@@ -540,7 +982,7 @@ uint8_t max30102_read_temperature(max30102_handle_t *handle, uint16_t *raw, floa
     {
         prev &= ~(1 << 1);                                                                                     /* clear interrupt */
         prev |= 1 << 1;                                                                                        /* set interrupt */
-        res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);       /* write interrupt enable2 */
+        res = a_max30102_iic_write(handle, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);              /* write interrupt enable2 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: write interrupt enable2 failed.\n");                                /* write interrupt enable2 failed */
@@ -549,7 +991,7 @@ uint8_t max30102_read_temperature(max30102_handle_t *handle, uint16_t *raw, floa
         }
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);               /* read die temp config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);                      /* read die temp config */
     if (res != 0)                                                                                              /* check result */
     {
         handle->debug_print("max30102: read die temp config failed.\n");                                       /* read die temp config failed */
@@ -558,7 +1000,7 @@ uint8_t max30102_read_temperature(max30102_handle_t *handle, uint16_t *raw, floa
     }
     prev &= ~(1 << 0);                                                                                         /* clear config */
     prev |= (1 << 0);                                                                                          /* set bool */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);              /* write die temp config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);                     /* write die temp config */
     if (res != 0)                                                                                              /* check result */
     {
         handle->debug_print("max30102: write die temp config failed.\n");                                      /* write die temp config failed */
@@ -617,7 +1059,7 @@ uint8_t max30102_get_interrupt_status(max30102_handle_t *handle, max30102_interr
 
     if (status == MAX30102_INTERRUPT_STATUS_DIE_TEMP_RDY)                                                      /* if die temp ready status */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_STATUS_2, (uint8_t *)&prev, 1);        /* read interrupt status2 */
+        res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_STATUS_2, (uint8_t *)&prev, 1);               /* read interrupt status2 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: read interrupt status2 failed.\n");                                 /* read interrupt status2 failed */
@@ -630,7 +1072,7 @@ uint8_t max30102_get_interrupt_status(max30102_handle_t *handle, max30102_interr
     }
     else
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_STATUS_1, (uint8_t *)&prev, 1);        /* read interrupt status1 */
+        res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_STATUS_1, (uint8_t *)&prev, 1);               /* read interrupt status1 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: read interrupt status1 failed.\n");                                 /* read interrupt status1 failed */
@@ -671,7 +1113,7 @@ uint8_t max30102_set_interrupt(max30102_handle_t *handle, max30102_interrupt_t t
 
     if (type == MAX30102_INTERRUPT_DIE_TEMP_RDY_EN)                                                            /* if internal temperature enable */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);        /* read interrupt enable2 */
+        res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);               /* read interrupt enable2 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: read interrupt enable2 failed.\n");                                 /* read interrupt enable2 failed */
@@ -680,7 +1122,7 @@ uint8_t max30102_set_interrupt(max30102_handle_t *handle, max30102_interrupt_t t
         }
         prev &= ~(1 << type);                                                                                  /* clear interrupt */
         prev |= enable << type;                                                                                /* set interrupt */
-        res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);       /* write interrupt enable2 */
+        res = a_max30102_iic_write(handle, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);              /* write interrupt enable2 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: write interrupt enable2 failed.\n");                                /* write interrupt enable2 failed */
@@ -692,7 +1134,7 @@ uint8_t max30102_set_interrupt(max30102_handle_t *handle, max30102_interrupt_t t
     }
     else
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_1, (uint8_t *)&prev, 1);        /* read interrupt enable1 */
+        res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_ENABLE_1, (uint8_t *)&prev, 1);               /* read interrupt enable1 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: read interrupt enable1 failed.\n");                                 /* read interrupt enable1 failed */
@@ -701,7 +1143,7 @@ uint8_t max30102_set_interrupt(max30102_handle_t *handle, max30102_interrupt_t t
         }
         prev &= ~(1 << type);                                                                                  /* clear interrupt */
         prev |= enable << type;                                                                                /* set interrupt */
-        res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_1, (uint8_t *)&prev, 1);       /* write interrupt enable1 */
+        res = a_max30102_iic_write(handle, MAX30102_REG_INTERRUPT_ENABLE_1, (uint8_t *)&prev, 1);              /* write interrupt enable1 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: write interrupt enable1 failed.\n");                                /* write interrupt enable1 failed */
@@ -741,7 +1183,7 @@ uint8_t max30102_get_interrupt(max30102_handle_t *handle, max30102_interrupt_t t
 
     if (type == MAX30102_INTERRUPT_DIE_TEMP_RDY_EN)                                                            /* if internal temperature enable */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);        /* read interrupt enable2 */
+        res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_ENABLE_2, (uint8_t *)&prev, 1);               /* read interrupt enable2 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: read interrupt enable2 failed.\n");                                 /* read interrupt enable2 failed */
@@ -754,7 +1196,7 @@ uint8_t max30102_get_interrupt(max30102_handle_t *handle, max30102_interrupt_t t
     }
     else
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_1, (uint8_t *)&prev, 1);        /* read interrupt enable1 */
+        res = a_max30102_iic_read(handle, MAX30102_REG_INTERRUPT_ENABLE_1, (uint8_t *)&prev, 1);               /* read interrupt enable1 */
         if (res != 0)                                                                                          /* check result */
         {
             handle->debug_print("max30102: read interrupt enable1 failed.\n");                                 /* read interrupt enable1 failed */
@@ -800,7 +1242,7 @@ uint8_t max30102_set_fifo_write_pointer(max30102_handle_t *handle, uint8_t point
     }
 
     prev = pointer & 0x1F;                                                                                  /* set pointer */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_WRITE_POINTER, (uint8_t *)&prev, 1);        /* write fifo write pointer */
+    res = a_max30102_iic_write(handle, MAX30102_REG_FIFO_WRITE_POINTER, (uint8_t *)&prev, 1);               /* write fifo write pointer */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: write fifo write pointer failed.\n");                                /* write fifo write pointer failed */
@@ -836,7 +1278,7 @@ uint8_t max30102_get_fifo_write_pointer(max30102_handle_t *handle, uint8_t *poin
         return 3;                                                                                          /* return error */
     }
 
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_WRITE_POINTER, (uint8_t *)&prev, 1);        /* read fifo write pointer */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_WRITE_POINTER, (uint8_t *)&prev, 1);               /* read fifo write pointer */
     if (res != 0)                                                                                          /* check result */
     {
         handle->debug_print("max30102: read fifo write pointer failed.\n");                                /* read fifo write pointer failed */
@@ -881,7 +1323,7 @@ uint8_t max30102_set_fifo_overflow_counter(max30102_handle_t *handle, uint8_t co
     }
 
     prev = counter & 0x1F;                                                                                /* set counter */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_OVERFLOW_COUNTER, (uint8_t *)&prev, 1);        /* set fifo overflow counter */
+    res = a_max30102_iic_write(handle, MAX30102_REG_OVERFLOW_COUNTER, (uint8_t *)&prev, 1);               /* set fifo overflow counter */
     if (res != 0)                                                                                         /* check result */
     {
         handle->debug_print("max30102: set fifo overflow counter failed.\n");                             /* set fifo overflow counter failed */
@@ -917,7 +1359,7 @@ uint8_t max30102_get_fifo_overflow_counter(max30102_handle_t *handle, uint8_t *c
         return 3;                                                                                        /* return error */
     }
 
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_OVERFLOW_COUNTER, (uint8_t *)&prev, 1);        /* get fifo overflow counter */
+    res = a_max30102_iic_read(handle, MAX30102_REG_OVERFLOW_COUNTER, (uint8_t *)&prev, 1);               /* get fifo overflow counter */
     if (res != 0)                                                                                        /* check result */
     {
         handle->debug_print("max30102: get fifo overflow counter failed.\n");                            /* get fifo overflow counter failed */
@@ -962,7 +1404,7 @@ uint8_t max30102_set_fifo_read_pointer(max30102_handle_t *handle, uint8_t pointe
     }
 
     prev = pointer & 0x1F;                                                                                 /* set pointer */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_READ_POINTER, (uint8_t *)&prev, 1);        /* write fifo read pointer */
+    res = a_max30102_iic_write(handle, MAX30102_REG_FIFO_READ_POINTER, (uint8_t *)&prev, 1);               /* write fifo read pointer */
     if (res != 0)                                                                                          /* check result */
     {
         handle->debug_print("max30102: write fifo read pointer failed.\n");                                /* write fifo read pointer failed */
@@ -998,7 +1440,7 @@ uint8_t max30102_get_fifo_read_pointer(max30102_handle_t *handle, uint8_t *point
         return 3;                                                                                         /* return error */
     }
 
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_READ_POINTER, (uint8_t *)&prev, 1);        /* read fifo read pointer */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_READ_POINTER, (uint8_t *)&prev, 1);               /* read fifo read pointer */
     if (res != 0)                                                                                         /* check result */
     {
         handle->debug_print("max30102: read fifo read pointer failed.\n");                                /* read fifo read pointer failed */
@@ -1034,7 +1476,7 @@ uint8_t max30102_set_fifo_data(max30102_handle_t *handle, uint8_t data)
         return 3;                                                                                           /* return error */
     }
     
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_DATA_REGISTER, (uint8_t *)&data, 1);        /* write fifo data register */
+    res = a_max30102_iic_write(handle, MAX30102_REG_FIFO_DATA_REGISTER, (uint8_t *)&data, 1);               /* write fifo data register */
     if (res != 0)                                                                                           /* check result */
     {
         handle->debug_print("max30102: write fifo data register failed.\n");                                /* write fifo data register failed */
@@ -1069,13 +1511,14 @@ uint8_t max30102_get_fifo_data(max30102_handle_t *handle, uint8_t *data)
         return 3;                                                                                         /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_DATA_REGISTER, (uint8_t *)data, 1);        /* read fifo data register */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_DATA_REGISTER, (uint8_t *)data, 1);               /* read fifo data register */
     if (res != 0)                                                                                         /* check result */
     {
         handle->debug_print("max30102: read fifo data register failed.\n");                               /* read fifo data register failed */
        
         return 1;                                                                                         /* return error */
     }
+    handle->status = (uint8_t)(handle->status & ~MAX30102_STATUS_FIFO_MASK);                              /* the read cleared the fifo bits */
     
     return 0;                                                                                             /* success return 0 */
 }
@@ -1105,7 +1548,7 @@ uint8_t max30102_set_fifo_sample_averaging(max30102_handle_t *handle, max30102_s
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);         /* read fifo config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);                /* read fifo config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read fifo config failed.\n");                                 /* read fifo config failed */
@@ -1114,7 +1557,7 @@ uint8_t max30102_set_fifo_sample_averaging(max30102_handle_t *handle, max30102_s
     }
     prev &= ~(0x7 << 5);                                                                             /* clear config */
     prev |= sample << 5;                                                                             /* set sample */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);        /* write fifo config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);               /* write fifo config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write fifo config failed.\n");                                /* write fifo config failed */
@@ -1150,7 +1593,7 @@ uint8_t max30102_get_fifo_sample_averaging(max30102_handle_t *handle, max30102_s
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);         /* read fifo config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);                /* read fifo config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read fifo config failed.\n");                                 /* read fifo config failed */
@@ -1187,7 +1630,7 @@ uint8_t max30102_set_fifo_roll(max30102_handle_t *handle, max30102_bool_t enable
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);         /* read fifo config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);                /* read fifo config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read fifo config failed.\n");                                 /* read fifo config failed */
@@ -1196,7 +1639,7 @@ uint8_t max30102_set_fifo_roll(max30102_handle_t *handle, max30102_bool_t enable
     }
     prev &= ~(0x1 << 4);                                                                             /* clear config */
     prev |= enable << 4;                                                                             /* set enable */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);        /* write fifo config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);               /* write fifo config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write fifo config failed.\n");                                /* write fifo config failed */
@@ -1232,7 +1675,7 @@ uint8_t max30102_get_fifo_roll(max30102_handle_t *handle, max30102_bool_t *enabl
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);         /* read fifo config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);                /* read fifo config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read fifo config failed.\n");                                 /* read fifo config failed */
@@ -1276,7 +1719,7 @@ uint8_t max30102_set_fifo_almost_full(max30102_handle_t *handle, uint8_t value)
         return 4;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);         /* read fifo config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);                /* read fifo config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read fifo config failed.\n");                                 /* read fifo config failed */
@@ -1285,7 +1728,7 @@ uint8_t max30102_set_fifo_almost_full(max30102_handle_t *handle, uint8_t value)
     }
     prev &= ~(0xF << 0);                                                                             /* clear config */
     prev |= value << 0;                                                                              /* set value */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);        /* write fifo config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);               /* write fifo config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write fifo config failed.\n");                                /* write fifo config failed */
@@ -1321,7 +1764,7 @@ uint8_t max30102_get_fifo_almost_full(max30102_handle_t *handle, uint8_t *value)
         return 3;                                                                                   /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);        /* read fifo config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_FIFO_CONFIG, (uint8_t *)&prev, 1);               /* read fifo config */
     if (res != 0)                                                                                   /* check result */
     {
         handle->debug_print("max30102: read fifo config failed.\n");                                /* read fifo config failed */
@@ -1358,7 +1801,7 @@ uint8_t max30102_set_shutdown(max30102_handle_t *handle, max30102_bool_t enable)
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);         /* read mode config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                /* read mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                 /* read mode config failed */
@@ -1367,7 +1810,7 @@ uint8_t max30102_set_shutdown(max30102_handle_t *handle, max30102_bool_t enable)
     }
     prev &= ~(1 << 7);                                                                               /* clear config */
     prev |= enable << 7;                                                                             /* set bool */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);        /* write mode config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);               /* write mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write mode config failed.\n");                                /* write mode config failed */
@@ -1403,7 +1846,7 @@ uint8_t max30102_get_shutdown(max30102_handle_t *handle, max30102_bool_t *enable
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);         /* read mode config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                /* read mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                 /* read mode config failed */
@@ -1439,7 +1882,7 @@ uint8_t max30102_reset(max30102_handle_t *handle)
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);         /* read mode config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                /* read mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                 /* read mode config failed */
@@ -1448,7 +1891,7 @@ uint8_t max30102_reset(max30102_handle_t *handle)
     }
     prev &= ~(1 << 6);                                                                               /* clear config */
     prev |= 1 << 6;                                                                                  /* set 1 */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);        /* write mode config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);               /* write mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write mode config failed.\n");                                /* write mode config failed */
@@ -1484,7 +1927,7 @@ uint8_t max30102_set_mode(max30102_handle_t *handle, max30102_mode_t mode)
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);         /* read mode config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                /* read mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                 /* read mode config failed */
@@ -1493,7 +1936,7 @@ uint8_t max30102_set_mode(max30102_handle_t *handle, max30102_mode_t mode)
     }
     prev &= ~(7 << 0);                                                                               /* clear config */
     prev |= mode << 0;                                                                               /* set mode */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);        /* write mode config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);               /* write mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write mode config failed.\n");                                /* write mode config failed */
@@ -1529,7 +1972,7 @@ uint8_t max30102_get_mode(max30102_handle_t *handle, max30102_mode_t *mode)
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);         /* read mode config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_MODE_CONFIG, (uint8_t *)&prev, 1);                /* read mode config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read mode config failed.\n");                                 /* read mode config failed */
@@ -1566,7 +2009,7 @@ uint8_t max30102_set_spo2_adc_range(max30102_handle_t *handle, max30102_spo2_adc
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);         /* read spo2 config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);                /* read spo2 config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read spo2 config failed.\n");                                 /* read spo2 config failed */
@@ -1575,7 +2018,7 @@ uint8_t max30102_set_spo2_adc_range(max30102_handle_t *handle, max30102_spo2_adc
     }
     prev &= ~(3 << 5);                                                                               /* clear config */
     prev |= range << 5;                                                                              /* set range */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);        /* write spo2 config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);               /* write spo2 config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write spo2 config failed.\n");                                /* write spo2 config failed */
@@ -1611,7 +2054,7 @@ uint8_t max30102_get_spo2_adc_range(max30102_handle_t *handle, max30102_spo2_adc
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);         /* read spo2 config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);                /* read spo2 config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read spo2 config failed.\n");                                 /* read spo2 config failed */
@@ -1648,7 +2091,7 @@ uint8_t max30102_set_spo2_sample_rate(max30102_handle_t *handle, max30102_spo2_s
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);         /* read spo2 config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);                /* read spo2 config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read spo2 config failed.\n");                                 /* read spo2 config failed */
@@ -1657,7 +2100,7 @@ uint8_t max30102_set_spo2_sample_rate(max30102_handle_t *handle, max30102_spo2_s
     }
     prev &= ~(7 << 2);                                                                               /* clear config */
     prev |= rate << 2;                                                                               /* set sample rate */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);        /* write spo2 config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);               /* write spo2 config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write spo2 config failed.\n");                                /* write spo2 config failed */
@@ -1693,7 +2136,7 @@ uint8_t max30102_get_spo2_sample_rate(max30102_handle_t *handle, max30102_spo2_s
         return 3;                                                                                   /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);        /* read spo2 config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);               /* read spo2 config */
     if (res != 0)                                                                                   /* check result */
     {
         handle->debug_print("max30102: read spo2 config failed.\n");                                /* read spo2 config failed */
@@ -1730,7 +2173,7 @@ uint8_t max30102_set_adc_resolution(max30102_handle_t *handle, max30102_adc_reso
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);         /* read spo2 config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);                /* read spo2 config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read spo2 config failed.\n");                                 /* read spo2 config failed */
@@ -1739,7 +2182,7 @@ uint8_t max30102_set_adc_resolution(max30102_handle_t *handle, max30102_adc_reso
     }
     prev &= ~(3 << 0);                                                                               /* clear config */
     prev |= resolution << 0;                                                                         /* set adc resolution */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);        /* write spo2 config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);               /* write spo2 config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: write spo2 config failed.\n");                                /* write spo2 config failed */
@@ -1775,7 +2218,7 @@ uint8_t max30102_get_adc_resolution(max30102_handle_t *handle, max30102_adc_reso
         return 3;                                                                                    /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);         /* read spo2 config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_SPO2_CONFIG, (uint8_t *)&prev, 1);                /* read spo2 config */
     if (res != 0)                                                                                    /* check result */
     {
         handle->debug_print("max30102: read spo2 config failed.\n");                                 /* read spo2 config failed */
@@ -1811,7 +2254,7 @@ uint8_t max30102_set_led_red_pulse_amplitude(max30102_handle_t *handle, uint8_t
         return 3;                                                                                   /* return error */
     }
     
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_LED_PULSE_1, (uint8_t *)&amp, 1);        /* write led pulse 1 */
+    res = a_max30102_iic_write(handle, MAX30102_REG_LED_PULSE_1, (uint8_t *)&amp, 1);               /* write led pulse 1 */
     if (res != 0)                                                                                   /* check result */
     {
         handle->debug_print("max30102: write led pulse 1 failed.\n");                               /* write led pulse 1 failed */
@@ -1846,7 +2289,7 @@ uint8_t max30102_get_led_red_pulse_amplitude(max30102_handle_t *handle, uint8_t
         return 3;                                                                                 /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_LED_PULSE_1, (uint8_t *)amp, 1);        /* read led pulse 1 */
+    res = a_max30102_iic_read(handle, MAX30102_REG_LED_PULSE_1, (uint8_t *)amp, 1);               /* read led pulse 1 */
     if (res != 0)                                                                                 /* check result */
     {
         handle->debug_print("max30102: read led pulse 1 failed.\n");                              /* read led pulse 1 failed */
@@ -1881,7 +2324,7 @@ uint8_t max30102_set_led_ir_pulse_amplitude(max30102_handle_t *handle, uint8_t a
         return 3;                                                                                   /* return error */
     }
     
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_LED_PULSE_2, (uint8_t *)&amp, 1);        /* write led pulse 2 */
+    res = a_max30102_iic_write(handle, MAX30102_REG_LED_PULSE_2, (uint8_t *)&amp, 1);               /* write led pulse 2 */
     if (res != 0)                                                                                   /* check result */
     {
         handle->debug_print("max30102: write led pulse 2 failed.\n");                               /* write led pulse 2 failed */
@@ -1916,7 +2359,7 @@ uint8_t max30102_get_led_ir_pulse_amplitude(max30102_handle_t *handle, uint8_t *
         return 3;                                                                                 /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_LED_PULSE_2, (uint8_t *)amp, 1);        /* read led pulse 2 */
+    res = a_max30102_iic_read(handle, MAX30102_REG_LED_PULSE_2, (uint8_t *)amp, 1);               /* read led pulse 2 */
     if (res != 0)                                                                                 /* check result */
     {
         handle->debug_print("max30102: read led pulse 2 failed.\n");                              /* read led pulse 2 failed */
@@ -1955,7 +2398,7 @@ uint8_t max30102_set_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
     
     if (slot == MAX30102_SLOT_1)                                                                                     /* slot 1 */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);        /* read led slot */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);               /* read led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: read led slot failed.\n");                                                /* read led slot failed */
@@ -1964,7 +2407,7 @@ uint8_t max30102_set_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
         }
         prev &= ~(0x7 << 0);                                                                                         /* clear config */
         prev |= led << 0;                                                                                            /* set led */
-        res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);       /* write led slot */
+        res = a_max30102_iic_write(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);              /* write led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: write led slot failed.\n");                                               /* write led slot failed */
@@ -1976,7 +2419,7 @@ uint8_t max30102_set_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
     }
     else if (slot == MAX30102_SLOT_2)                                                                                /* slot 2 */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);        /* read led slot */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);               /* read led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: read led slot failed.\n");                                                /* read led slot failed */
@@ -1985,7 +2428,7 @@ uint8_t max30102_set_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
         }
         prev &= ~(0x7 << 4);                                                                                         /* clear config */
         prev |= led << 4;                                                                                            /* set led */
-        res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);       /* write led slot */
+        res = a_max30102_iic_write(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);              /* write led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: write led slot failed.\n");                                               /* write led slot failed */
@@ -1997,7 +2440,7 @@ uint8_t max30102_set_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
     }
     else if (slot == MAX30102_SLOT_3)                                                                                /* slot 3 */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);        /* read led slot */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);               /* read led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: read led slot failed.\n");                                                /* read led slot failed */
@@ -2006,7 +2449,7 @@ uint8_t max30102_set_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
         }
         prev &= ~(0x7 << 0);                                                                                         /* clear config */
         prev |= led << 0;                                                                                            /* set led */
-        res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);       /* write led slot */
+        res = a_max30102_iic_write(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);              /* write led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: write led slot failed.\n");                                               /* write led slot failed */
@@ -2018,7 +2461,7 @@ uint8_t max30102_set_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
     }
     else if (slot == MAX30102_SLOT_4)                                                                                /* slot 4 */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);        /* read led slot */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);               /* read led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: read led slot failed.\n");                                                /* read led slot failed */
@@ -2027,7 +2470,7 @@ uint8_t max30102_set_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
         }
         prev &= ~(0x7 << 4);                                                                                         /* clear config */
         prev |= led << 4;                                                                                            /* set led */
-        res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);       /* write led slot */
+        res = a_max30102_iic_write(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);              /* write led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: write led slot failed.\n");                                               /* write led slot failed */
@@ -2073,7 +2516,7 @@ uint8_t max30102_get_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
     
     if (slot == MAX30102_SLOT_1)                                                                                     /* slot 1 */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);        /* read led slot */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);               /* read led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: read led slot failed.\n");                                                /* read led slot failed */
@@ -2086,7 +2529,7 @@ uint8_t max30102_get_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
     }
     else if (slot == MAX30102_SLOT_2)                                                                                /* slot 2 */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);        /* read led slot */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, (uint8_t *)&prev, 1);               /* read led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: read led slot failed.\n");                                                /* read led slot failed */
@@ -2099,7 +2542,7 @@ uint8_t max30102_get_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
     }
     else if (slot == MAX30102_SLOT_3)                                                                                /* slot 3 */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);        /* read led slot */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);               /* read led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: read led slot failed.\n");                                                /* read led slot failed */
@@ -2112,7 +2555,7 @@ uint8_t max30102_get_slot(max30102_handle_t *handle, max30102_slot_t slot, max30
     }
     else if (slot == MAX30102_SLOT_4)                                                                                /* slot 4 */
     {
-        res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);        /* read led slot */
+        res = a_max30102_iic_read(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_2, (uint8_t *)&prev, 1);               /* read led slot */
         if (res != 0)                                                                                                /* check result */
         {
             handle->debug_print("max30102: read led slot failed.\n");                                                /* read led slot failed */
@@ -2156,7 +2599,7 @@ uint8_t max30102_set_die_temperature(max30102_handle_t *handle, max30102_bool_t
         return 3;                                                                                        /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);         /* read die temp config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);                /* read die temp config */
     if (res != 0)                                                                                        /* check result */
     {
         handle->debug_print("max30102: read die temp config failed.\n");                                 /* read die temp config failed */
@@ -2165,7 +2608,7 @@ uint8_t max30102_set_die_temperature(max30102_handle_t *handle, max30102_bool_t
     }
     prev &= ~(1 << 0);                                                                                   /* clear config */
     prev |= (enable << 0);                                                                               /* set bool */
-    res = handle->iic_write(MAX30102_ADDRESS, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);        /* write die temp config */
+    res = a_max30102_iic_write(handle, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);               /* write die temp config */
     if (res != 0)                                                                                        /* check result */
     {
         handle->debug_print("max30102: write die temp config failed.\n");                                /* write die temp config failed */
@@ -2201,7 +2644,7 @@ uint8_t max30102_get_die_temperature(max30102_handle_t *handle, max30102_bool_t
         return 3;                                                                                        /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);         /* read die temp config */
+    res = a_max30102_iic_read(handle, MAX30102_REG_DIE_TEMP_CONFIG, (uint8_t *)&prev, 1);                /* read die temp config */
     if (res != 0)                                                                                        /* check result */
     {
         handle->debug_print("max30102: read die temp config failed.\n");                                 /* read die temp config failed */
@@ -2238,14 +2681,14 @@ uint8_t max30102_get_id(max30102_handle_t *handle, uint8_t *revision_id, uint8_t
         return 3;                                                                                         /* return error */
     }
     
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_REVISION_ID, (uint8_t *)revision_id, 1);        /* read revision id */
+    res = a_max30102_iic_read(handle, MAX30102_REG_REVISION_ID, (uint8_t *)revision_id, 1);               /* read revision id */
     if (res != 0)                                                                                         /* check result */
     {
         handle->debug_print("max30102: read revision id failed.\n");                                      /* read revision id failed */
        
         return 1;                                                                                         /* return error */
     }
-    res = handle->iic_read(MAX30102_ADDRESS, MAX30102_REG_PART_ID, (uint8_t *)part_id, 1);                /* read part id */
+    res = a_max30102_iic_read(handle, MAX30102_REG_PART_ID, (uint8_t *)part_id, 1);                       /* read part id */
     if (res != 0)                                                                                         /* check result */
     {
         handle->debug_print("max30102: read part id failed.\n");                                          /* read part id failed */
@@ -2280,7 +2723,7 @@ uint8_t max30102_set_reg(max30102_handle_t *handle, uint8_t reg, uint8_t *buf, u
         return 3;                                                  /* return error */
     }
     
-    if (handle->iic_write(MAX30102_ADDRESS, reg, buf, len) != 0)   /* write data */
+    if (a_max30102_iic_write(handle, reg, buf, len) != 0)          /* write data */
     {
         return 1;                                                  /* return error */
     }
@@ -2314,7 +2757,7 @@ uint8_t max30102_get_reg(max30102_handle_t *handle, uint8_t reg, uint8_t *buf, u
         return 3;                                                 /* return error */
     }
     
-    if (handle->iic_read(MAX30102_ADDRESS, reg, buf, len) != 0)   /* read data */
+    if (a_max30102_iic_read(handle, reg, buf, len) != 0)          /* read data */
     {
         return 1;                                                 /* return error */
     }
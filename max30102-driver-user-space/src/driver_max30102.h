@@ -134,6 +134,42 @@ typedef enum
     MAX30102_SLOT_4 = 3,        /**< slot 4 */
 } max30102_slot_t;
 
+/**
+ * @brief max30102 channel layout structure definition
+ * @note  one channel per active slot, in slot order, so the fifo holds
+ *        channels * 3 bytes per sample; max30102_get_channel_layout fills it
+ */
+typedef struct max30102_channel_layout_s
+{
+    uint8_t channels;              /**< active slots, 1 to 4 */
+    uint8_t mask;                  /**< bit n is set when slot n + 1 is active */
+    uint8_t shift;                 /**< right shift of the adc resolution */
+    max30102_led_t led[4];         /**< led of each channel in fifo order */
+} max30102_channel_layout_t;
+
+/**
+ * @brief max30102 statistics event enumeration definition
+ */
+typedef enum
+{
+    MAX30102_STATS_EVENT_IIC_READ   = 0,        /**< iic read transaction, value is the byte count */
+    MAX30102_STATS_EVENT_IIC_WRITE  = 1,        /**< iic write transaction, value is the byte count */
+    MAX30102_STATS_EVENT_IRQ        = 2,        /**< irq handler run including callbacks */
+    MAX30102_STATS_EVENT_FIFO_DRAIN = 3,        /**< max30102_read or max30102_read_channels, value is the sample count */
+    MAX30102_STATS_EVENT_OVERRUN    = 4,        /**< fifo overrun, value is the overflow counter */
+} max30102_stats_event_t;
+
+/**
+ * @brief max30102 statistics hook structure definition
+ * @note  the driver only calls through the hook, see driver_max30102_stats.h
+ */
+typedef struct max30102_stats_hook_s
+{
+    uint64_t (*clock_ns)(void);                                                         /**< point to a monotonic clock function address */
+    void (*record)(struct max30102_stats_hook_s *hook, max30102_stats_event_t event,
+                   uint64_t start_ns, uint8_t res, uint32_t value);                     /**< point to a record function address */
+} max30102_stats_hook_t;
+
 /**
  * @brief max30102 handle structure definition
  */
@@ -150,7 +186,9 @@ typedef struct max30102_handle_s
     uint8_t finished_flag;                                                              /**< finished flag */
     uint16_t raw;                                                                       /**< raw */
     float temperature;                                                                  /**< temperature */
-    uint8_t buf[192];                                                                   /**< inner buffer */
+    uint8_t buf[384];                                                                   /**< inner buffer, 32 samples of 4 slots */
+    uint8_t status;                                                                     /**< interrupt status 1 bits read but not yet handled */
+    max30102_stats_hook_t *stats;                                                       /**< statistics hook, NULL disables */
 } max30102_handle_t;
 
 /**
@@ -306,10 +344,67 @@ uint8_t max30102_deinit(max30102_handle_t *handle);
  *                - 3 handle is not initialized
  *                - 4 fifo overrun
  *                - 5 mode is invalid
- * @note          none
+ * @note          raw_red and raw_ir get the first red and ir channel of the
+ *                layout, a buffer without a channel is left untouched
  */
 uint8_t max30102_read(max30102_handle_t *handle, uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len);
 
+/**
+ * @brief      get the fifo channel layout of the current mode and slots
+ * @param[in]  *handle pointer to a max30102 handle structure
+ * @param[out] *layout pointer to a max30102 channel layout structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 get channel layout failed
+ *             - 2 handle is NULL
+ *             - 3 handle is not initialized
+ *             - 5 mode is invalid or no slot is active
+ * @note       heart rate mode has a red channel, spo2 mode red then ir, multi
+ *             led mode one channel per slot set to red or ir; call again after
+ *             changing the mode, a slot or the adc resolution
+ */
+uint8_t max30102_get_channel_layout(max30102_handle_t *handle, max30102_channel_layout_t *layout);
+
+/**
+ * @brief         read the data of every active channel
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[in]     *layout pointer to the layout from max30102_get_channel_layout
+ * @param[out]    *raw pointer to a raw data buffer of len * layout->channels values
+ * @param[in,out] *len pointer to a length buffer, the capacity in samples in and the samples read out
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 3 handle is not initialized
+ *                - 4 fifo overrun
+ *                - 5 layout is invalid
+ * @note          raw is sample major, raw[i * layout->channels + n] is channel n
+ *                of sample i; only the active channels are read from the bus,
+ *                and the mode and resolution are not read again
+ */
+uint8_t max30102_read_channels(max30102_handle_t *handle, const max30102_channel_layout_t *layout,
+                               uint32_t *raw, uint8_t *len);
+
+/**
+ * @brief         read the undecoded fifo bytes of every active channel
+ * @param[in]     *handle pointer to a max30102 handle structure
+ * @param[in]     *layout pointer to the layout from max30102_get_channel_layout
+ * @param[out]    **fifo pointer to a pointer set to the fifo bytes
+ * @param[in,out] *len pointer to a length buffer, the capacity in samples in and the samples read out
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 3 handle is not initialized
+ *                - 4 fifo overrun
+ *                - 5 layout is invalid
+ * @note          each sample is layout->channels big endian 3 byte values in
+ *                slot order, not yet shifted by layout->shift; the bytes are
+ *                the handle buffer and stay valid until the next read
+ */
+uint8_t max30102_read_raw(max30102_handle_t *handle, const max30102_channel_layout_t *layout,
+                          const uint8_t **fifo, uint8_t *len);
+
 /**
  * @brief      read the temperature
  * @param[in]  *handle pointer to a max30102 handle structure
@@ -0,0 +1,522 @@
+
+#ifndef DRIVER_MAX30102_HPP
+#define DRIVER_MAX30102_HPP
+
+#include "driver_max30102.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if (__cplusplus >= 202002L) && defined(__has_include)
+#if __has_include(<span>)
+#include <span>
+#define DRIVER_MAX30102_HAS_STD_SPAN
+#endif
+#endif
+
+/**
+ * @defgroup max30102_cpp_driver max30102 c++ driver function
+ * @brief    max30102 header only c++17 wrapper
+ * @ingroup  max30102_driver
+ * @details  the decoder is picked once per configuration from templates
+ *           specialized on the mode and the adc resolution, so the per sample
+ *           loop has no branch on either and a constant stride and shift;
+ *           samples are decoded straight from the handle buffer into the
+ *           caller's spans
+ * @{
+ */
+
+namespace max30102
+{
+
+#ifdef DRIVER_MAX30102_HAS_STD_SPAN
+template <class T>
+using span = std::span<T>;
+#else
+/**
+ * @brief max30102 span class definition
+ * @note  the subset of std::span the wrapper uses, for c++17
+ */
+template <class T>
+class span
+{
+  public:
+    constexpr span() noexcept = default;
+    constexpr span(T *data, std::size_t size) noexcept : m_data(data), m_size(size) {}
+    template <std::size_t N>
+    constexpr span(T (&array)[N]) noexcept : m_data(array), m_size(N) {}
+    template <class U, std::size_t N>
+    constexpr span(std::array<U, N> &array) noexcept : m_data(array.data()), m_size(N) {}
+    constexpr T *data() const noexcept { return m_data; }
+    constexpr std::size_t size() const noexcept { return m_size; }
+    constexpr bool empty() const noexcept { return m_size == 0; }
+    constexpr T &operator[](std::size_t i) const noexcept { return m_data[i]; }
+    constexpr T *begin() const noexcept { return m_data; }
+    constexpr T *end() const noexcept { return m_data + m_size; }
+    constexpr span first(std::size_t n) const noexcept { return span(m_data, n); }
+
+  private:
+    T *m_data = nullptr;              /**< first element */
+    std::size_t m_size = 0;           /**< elements */
+};
+#endif
+
+/**
+ * @brief max30102 decode plan structure definition
+ * @note  built once per configuration from the channel layout
+ */
+struct plan
+{
+    uint8_t channels = 0;             /**< values per sample */
+    int8_t red = -1;                  /**< first red channel, -1 if none */
+    int8_t ir = -1;                   /**< first ir channel, -1 if none */
+};
+
+namespace detail
+{
+
+/**
+ * @brief     decode one big endian 3 byte fifo value
+ * @param[in] *p pointer to the value
+ * @return    raw value before the resolution shift
+ */
+inline uint32_t be24(const uint8_t *p) noexcept
+{
+    return (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | static_cast<uint32_t>(p[2]);
+}
+
+/**
+ * @brief     right shift of an adc resolution
+ * @param[in] r adc resolution
+ * @return    bits to drop, 18 bits drop none
+ */
+constexpr uint8_t shift_of(max30102_adc_resolution_t r) noexcept
+{
+    return static_cast<uint8_t>(MAX30102_ADC_RESOLUTION_18_BIT - r);
+}
+
+/**
+ * @brief     decode fixed channel positions
+ * @param[in] *fifo pointer to the fifo bytes
+ * @param[in] len samples
+ * @param[in] *red pointer to the red output, unused if Red is negative
+ * @param[in] *ir pointer to the ir output, unused if Ir is negative
+ * @note      Channels, Red, Ir and Shift are constants, the loop is branch free
+ */
+template <uint8_t Channels, int Red, int Ir, uint8_t Shift>
+inline void decode_fixed(const uint8_t *fifo, uint8_t len, uint32_t *red, uint32_t *ir) noexcept
+{
+    for (uint8_t i = 0; i < len; i++, fifo += Channels * 3)
+    {
+        if constexpr (Red >= 0)
+        {
+            red[i] = be24(fifo + Red * 3) >> Shift;
+        }
+        if constexpr (Ir >= 0)
+        {
+            ir[i] = be24(fifo + Ir * 3) >> Shift;
+        }
+    }
+}
+
+/**
+ * @brief     decode every value
+ * @param[in] *fifo pointer to the fifo bytes
+ * @param[in] n values
+ * @param[in] *out pointer to the output, sample major
+ */
+template <uint8_t Shift>
+inline void decode_all(const uint8_t *fifo, std::size_t n, uint32_t *out) noexcept
+{
+    for (std::size_t i = 0; i < n; i++, fifo += 3)
+    {
+        out[i] = be24(fifo) >> Shift;
+    }
+}
+
+} // namespace detail
+
+/**
+ * @brief max30102 decoder template definition
+ * @note  specialized per mode below, Resolution fixes the shift
+ */
+template <max30102_mode_t Mode, max30102_adc_resolution_t Resolution>
+struct decoder;
+
+/**
+ * @brief max30102 heart rate decoder, slot 1 is red
+ */
+template <max30102_adc_resolution_t Resolution>
+struct decoder<MAX30102_MODE_HEART_RATE, Resolution>
+{
+    static constexpr uint8_t channels = 1;                              /**< values per sample */
+    static constexpr uint8_t shift = detail::shift_of(Resolution);      /**< right shift */
+
+    static void red_ir(const plan &, const uint8_t *fifo, uint8_t len, uint32_t *red, uint32_t *ir) noexcept
+    {
+        detail::decode_fixed<1, 0, -1, shift>(fifo, len, red, ir);
+    }
+    static void all(const plan &, const uint8_t *fifo, uint8_t len, uint32_t *out) noexcept
+    {
+        detail::decode_all<shift>(fifo, len, out);
+    }
+};
+
+/**
+ * @brief max30102 spo2 decoder, slot 1 is red and slot 2 ir
+ */
+template <max30102_adc_resolution_t Resolution>
+struct decoder<MAX30102_MODE_SPO2, Resolution>
+{
+    static constexpr uint8_t channels = 2;                              /**< values per sample */
+    static constexpr uint8_t shift = detail::shift_of(Resolution);      /**< right shift */
+
+    static void red_ir(const plan &, const uint8_t *fifo, uint8_t len, uint32_t *red, uint32_t *ir) noexcept
+    {
+        detail::decode_fixed<2, 0, 1, shift>(fifo, len, red, ir);
+    }
+    static void all(const plan &, const uint8_t *fifo, uint8_t len, uint32_t *out) noexcept
+    {
+        detail::decode_all<shift>(fifo, static_cast<std::size_t>(len) * 2, out);
+    }
+};
+
+/**
+ * @brief max30102 multi led decoder, the slots decide the channels
+ * @note  the stride and channel positions come from the plan, the shift is
+ *        still a constant
+ */
+template <max30102_adc_resolution_t Resolution>
+struct decoder<MAX30102_MODE_MULTI_LED, Resolution>
+{
+    static constexpr uint8_t shift = detail::shift_of(Resolution);      /**< right shift */
+
+    static void red_ir(const plan &p, const uint8_t *fifo, uint8_t len, uint32_t *red, uint32_t *ir) noexcept
+    {
+        const uint8_t stride = static_cast<uint8_t>(p.channels * 3);
+
+        if (p.red >= 0)
+        {
+            const uint8_t *q = fifo + p.red * 3;
+            for (uint8_t i = 0; i < len; i++, q += stride)
+            {
+                red[i] = detail::be24(q) >> shift;
+            }
+        }
+        if (p.ir >= 0)
+        {
+            const uint8_t *q = fifo + p.ir * 3;
+            for (uint8_t i = 0; i < len; i++, q += stride)
+            {
+                ir[i] = detail::be24(q) >> shift;
+            }
+        }
+    }
+    static void all(const plan &p, const uint8_t *fifo, uint8_t len, uint32_t *out) noexcept
+    {
+        detail::decode_all<shift>(fifo, static_cast<std::size_t>(len) * p.channels, out);
+    }
+};
+
+/**
+ * @brief max30102 interface structure definition
+ * @note  the link functions of the handle, see DRIVER_MAX30102_LINK_*
+ */
+struct interface
+{
+    uint8_t (*iic_init)(void) = nullptr;                                            /**< iic init */
+    uint8_t (*iic_deinit)(void) = nullptr;                                          /**< iic deinit */
+    uint8_t (*iic_read)(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len) = nullptr;   /**< iic read */
+    uint8_t (*iic_write)(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len) = nullptr;  /**< iic write */
+    void (*delay_ms)(uint32_t ms) = nullptr;                                        /**< delay */
+    void (*debug_print)(const char *const fmt, ...) = nullptr;                      /**< debug print */
+    void (*receive_callback)(uint8_t type) = nullptr;                               /**< interrupt callback */
+};
+
+/**
+ * @brief max30102 device class definition
+ * @note  owns an initialized handle, deinit runs in the destructor; every
+ *        method returns the status code of the c function it wraps
+ */
+class device
+{
+  public:
+    using red_ir_fn = void (*)(const plan &, const uint8_t *, uint8_t, uint32_t *, uint32_t *);    /**< red and ir decoder */
+    using all_fn = void (*)(const plan &, const uint8_t *, uint8_t, uint32_t *);                   /**< channel decoder */
+
+    /**
+     * @brief     link the interface and init the chip
+     * @param[in] &link interface functions
+     * @note      check status() for the max30102_init result
+     */
+    explicit device(const interface &link) noexcept
+    {
+        DRIVER_MAX30102_LINK_INIT(&m_handle, max30102_handle_t);
+        DRIVER_MAX30102_LINK_IIC_INIT(&m_handle, link.iic_init);
+        DRIVER_MAX30102_LINK_IIC_DEINIT(&m_handle, link.iic_deinit);
+        DRIVER_MAX30102_LINK_IIC_READ(&m_handle, link.iic_read);
+        DRIVER_MAX30102_LINK_IIC_WRITE(&m_handle, link.iic_write);
+        DRIVER_MAX30102_LINK_DELAY_MS(&m_handle, link.delay_ms);
+        DRIVER_MAX30102_LINK_DEBUG_PRINT(&m_handle, link.debug_print);
+        DRIVER_MAX30102_LINK_RECEIVE_CALLBACK(&m_handle, link.receive_callback);
+        m_status = max30102_init(&m_handle);
+    }
+
+    device(const device &) = delete;
+    device &operator=(const device &) = delete;
+
+    /**
+     * @brief      take over an initialized handle
+     * @param[in]  &&other device to move from, left deinitialized
+     */
+    device(device &&other) noexcept
+        : m_handle(other.m_handle), m_status(other.m_status), m_layout(other.m_layout), m_plan(other.m_plan),
+          m_red_ir(other.m_red_ir), m_all(other.m_all)
+    {
+        other.m_handle.inited = 0;
+        other.m_red_ir = nullptr;
+        other.m_all = nullptr;
+    }
+
+    device &operator=(device &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle.inited == 1)
+            {
+                (void)max30102_deinit(&m_handle);
+            }
+            m_handle = other.m_handle;
+            m_status = other.m_status;
+            m_layout = other.m_layout;
+            m_plan = other.m_plan;
+            m_red_ir = other.m_red_ir;
+            m_all = other.m_all;
+            other.m_handle.inited = 0;
+            other.m_red_ir = nullptr;
+            other.m_all = nullptr;
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief deinit the chip
+     */
+    ~device()
+    {
+        if (m_handle.inited == 1)
+        {
+            (void)max30102_deinit(&m_handle);
+        }
+    }
+
+    /**
+     * @brief  max30102_init result
+     * @return status code, 0 when the device is usable
+     */
+    uint8_t status() const noexcept { return m_status; }
+
+    /**
+     * @brief  c handle for the configuration calls
+     * @return pointer to the handle
+     * @note   call configure() after changing the mode, a slot or the adc resolution
+     */
+    max30102_handle_t *handle() noexcept { return &m_handle; }
+
+    /**
+     * @brief  read the layout and pick the decoders
+     * @return status code
+     *         - 0 success
+     *         - 1 get channel layout failed
+     *         - 3 handle is not initialized
+     *         - 5 mode is invalid or no slot is active
+     */
+    uint8_t configure() noexcept
+    {
+        uint8_t mode;
+        uint8_t res;
+
+        res = max30102_get_channel_layout(&m_handle, &m_layout);
+        if (res != 0)
+        {
+            m_red_ir = nullptr;
+            m_all = nullptr;
+
+            return res;
+        }
+        m_plan = plan{};
+        m_plan.channels = m_layout.channels;
+        for (uint8_t i = m_layout.channels; i > 0; i--)
+        {
+            if (m_layout.led[i - 1] == MAX30102_LED_RED)
+            {
+                m_plan.red = static_cast<int8_t>(i - 1);
+            }
+            else
+            {
+                m_plan.ir = static_cast<int8_t>(i - 1);
+            }
+        }
+        if ((m_layout.mask == 0x1) && (m_plan.red == 0))
+        {
+            mode = MAX30102_MODE_HEART_RATE;
+        }
+        else if ((m_layout.mask == 0x3) && (m_plan.red == 0) && (m_plan.ir == 1))
+        {
+            mode = MAX30102_MODE_SPO2;                        /* spo2, or multi led with the same layout */
+        }
+        else
+        {
+            mode = MAX30102_MODE_MULTI_LED;
+        }
+        switch (mode)
+        {
+            case MAX30102_MODE_HEART_RATE :
+            {
+                select<MAX30102_MODE_HEART_RATE>();
+                break;
+            }
+            case MAX30102_MODE_SPO2 :
+            {
+                select<MAX30102_MODE_SPO2>();
+                break;
+            }
+            default :
+            {
+                select<MAX30102_MODE_MULTI_LED>();
+                break;
+            }
+        }
+
+        return 0;
+    }
+
+    /**
+     * @brief  layout the decoders were picked for
+     * @return reference to the channel layout
+     */
+    const max30102_channel_layout_t &layout() const noexcept { return m_layout; }
+
+    /**
+     * @brief         read the first red and ir channel
+     * @param[out]    red red output
+     * @param[out]    ir ir output
+     * @param[in,out] &len samples wanted in, read out
+     * @return        status code
+     *                - 0 success
+     *                - 1 read failed
+     *                - 3 not configured
+     *                - 4 fifo overrun
+     * @note          len is capped by both spans; a span without a channel is
+     *                left untouched, like max30102_read
+     */
+    uint8_t read(span<uint32_t> red, span<uint32_t> ir, uint8_t &len) noexcept
+    {
+        const uint8_t *fifo;
+        uint8_t res;
+
+        if (m_red_ir == nullptr)
+        {
+            return 3;
+        }
+        len = cap(cap(len, (m_plan.red >= 0) ? red.size() : 32), (m_plan.ir >= 0) ? ir.size() : 32);
+        res = max30102_read_raw(&m_handle, &m_layout, &fifo, &len);
+        if ((res != 0) && (res != 4))
+        {
+            return res;
+        }
+        m_red_ir(m_plan, fifo, len, red.data(), ir.data());
+
+        return res;
+    }
+
+    /**
+     * @brief         read every active channel
+     * @param[out]    raw output, raw[i * layout().channels + n] is channel n of sample i
+     * @param[in,out] &len samples wanted in, read out
+     * @return        status code
+     *                - 0 success
+     *                - 1 read failed
+     *                - 3 not configured
+     *                - 4 fifo overrun
+     */
+    uint8_t read_channels(span<uint32_t> raw, uint8_t &len) noexcept
+    {
+        const uint8_t *fifo;
+        uint8_t res;
+
+        if (m_all == nullptr)
+        {
+            return 3;
+        }
+        len = cap(len, raw.size() / m_plan.channels);
+        res = max30102_read_raw(&m_handle, &m_layout, &fifo, &len);
+        if ((res != 0) && (res != 4))
+        {
+            return res;
+        }
+        m_all(m_plan, fifo, len, raw.data());
+
+        return res;
+    }
+
+  private:
+    /**
+     * @brief pick the decoders of a mode for the layout's resolution
+     */
+    template <max30102_mode_t Mode>
+    void select() noexcept
+    {
+        switch (m_layout.shift)
+        {
+            case 0 :
+            {
+                set<Mode, MAX30102_ADC_RESOLUTION_18_BIT>();
+                break;
+            }
+            case 1 :
+            {
+                set<Mode, MAX30102_ADC_RESOLUTION_17_BIT>();
+                break;
+            }
+            case 2 :
+            {
+                set<Mode, MAX30102_ADC_RESOLUTION_16_BIT>();
+                break;
+            }
+            default :
+            {
+                set<Mode, MAX30102_ADC_RESOLUTION_15_BIT>();
+                break;
+            }
+        }
+    }
+
+    template <max30102_mode_t Mode, max30102_adc_resolution_t Resolution>
+    void set() noexcept
+    {
+        m_red_ir = &decoder<Mode, Resolution>::red_ir;
+        m_all = &decoder<Mode, Resolution>::all;
+    }
+
+    static uint8_t cap(uint8_t len, std::size_t size) noexcept
+    {
+        return (size < len) ? static_cast<uint8_t>(size) : len;
+    }
+
+    max30102_handle_t m_handle{};                 /**< c handle */
+    uint8_t m_status = 3;                         /**< init result */
+    max30102_channel_layout_t m_layout{};         /**< configured layout */
+    plan m_plan{};                                /**< decode plan */
+    red_ir_fn m_red_ir = nullptr;                 /**< red and ir decoder */
+    all_fn m_all = nullptr;                       /**< channel decoder */
+};
+
+} // namespace max30102
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,790 @@
+
+
+#include "driver_max30102_analysis.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief analysis pipeline constant definition
+ */
+#define ANALYSIS_DC_TAU_S          1.5f           /**< dc tracker time constant */
+#define ANALYSIS_LP_HZ             4.0f           /**< pulse low pass cut-off */
+#define ANALYSIS_ENV_TAU_S         3.0f           /**< pulse envelope decay time constant */
+#define ANALYSIS_THRESHOLD         0.5f           /**< beat threshold relative to the envelope */
+#define ANALYSIS_HR_MIN            30.0f          /**< lowest accepted rate in bpm */
+#define ANALYSIS_HR_MAX            220.0f         /**< highest accepted rate in bpm */
+#define ANALYSIS_PI_MIN            0.0005f        /**< lowest accepted perfusion index */
+#define ANALYSIS_PI_MAX            0.2f           /**< highest accepted perfusion index */
+#define ANALYSIS_IBI_TOLERANCE     0.3f           /**< accepted deviation from the median interval */
+#define ANALYSIS_R_MIN             0.2f           /**< lowest accepted ratio of ratios */
+#define ANALYSIS_R_MAX             2.0f           /**< highest accepted ratio of ratios */
+#define ANALYSIS_READ_SAMPLES      4096           /**< samples per reader call */
+
+/**
+ * @brief analysis batch task structure definition
+ */
+typedef struct analysis_task_s
+{
+    uint32_t file;                   /**< input index */
+    uint32_t first;                  /**< first chunk */
+    uint32_t last;                   /**< chunk after the shard, 0 for a whole unsplit file */
+} analysis_task_t;
+
+/**
+ * @brief analysis batch deque structure definition
+ * @note  the owner pushes and pops at the tail, thieves take from the head
+ */
+typedef struct analysis_deque_s
+{
+    pthread_mutex_t lock;            /**< deque lock */
+    analysis_task_t *task;           /**< ring, capacity is a power of two */
+    uint32_t capacity;               /**< ring size */
+    uint32_t head;                   /**< oldest task */
+    uint32_t tail;                   /**< one past the newest task */
+} analysis_deque_t;
+
+/**
+ * @brief analysis batch state structure definition
+ */
+typedef struct analysis_batch_s
+{
+    const char *const *inputs;                   /**< recording paths */
+    max30102_analysis_result_t *results;         /**< per input results */
+    analysis_deque_t *deque;                     /**< one deque per worker */
+    uint32_t threads;                            /**< workers */
+    atomic_uint pending;                         /**< tasks queued or running */
+    atomic_uint shards;                          /**< shards run */
+    atomic_uint steals;                          /**< shards stolen */
+    atomic_ullong samples;                       /**< samples counted */
+    atomic_ullong warmup_samples;                /**< samples replayed for warm-up */
+    atomic_uint failed;                          /**< first error + 1 */
+    pthread_mutex_t lock;                        /**< protects results */
+} analysis_batch_t;
+
+/**
+ * @brief analysis worker structure definition
+ */
+typedef struct analysis_worker_s
+{
+    analysis_batch_t *batch;                     /**< shared state */
+    uint32_t id;                                 /**< own deque */
+    max30102_record_reader_t reader;             /**< reader of the open file */
+    uint32_t open_file;                          /**< input open in reader, ~0 for none */
+    max30102_analysis_t analysis;                /**< pipeline */
+    uint32_t red[ANALYSIS_READ_SAMPLES];         /**< red buffer */
+    uint32_t ir[ANALYSIS_READ_SAMPLES];          /**< ir buffer */
+} analysis_worker_t;
+
+static void a_analysis_finish(max30102_analysis_result_t *r)
+{
+    r->hr_mean = (r->valid_beats != 0) ? (float)(r->hr_sum / r->valid_beats) : 0.0f;
+    r->spo2_mean = (r->spo2_beats != 0) ? (float)(r->spo2_sum / r->spo2_beats) : 0.0f;
+    r->pi_mean = (r->valid_beats != 0) ? (float)(r->pi_sum / r->valid_beats * 100.0) : 0.0f;
+    r->quality = (r->seconds > 0.0) ? (float)(r->valid_seconds / r->seconds) : 0.0f;
+    if (r->quality > 1.0f)
+    {
+        r->quality = 1.0f;
+    }
+}
+
+static float a_analysis_median(const float *v, uint8_t n)
+{
+    float s[MAX30102_ANALYSIS_IBI_HISTORY];
+    uint8_t i;
+    uint8_t j;
+
+    for (i = 0; i < n; i++)
+    {
+        float x = v[i];
+
+        for (j = i; (j > 0) && (s[j - 1] > x); j--)
+        {
+            s[j] = s[j - 1];
+        }
+        s[j] = x;
+    }
+
+    return s[n / 2];
+}
+
+/**
+ * @brief     close one beat
+ * @param[in] *a pointer to an analysis structure
+ * @param[in] peak sample number of the new beat
+ * @note      the beat interval runs from the previous peak to this one, the
+ *            ac amplitudes are the filtered peak to peak over that interval
+ */
+static void a_analysis_beat(max30102_analysis_t *a, uint64_t peak)
+{
+    uint8_t d = (uint8_t)(a->channels - 1);
+
+    if (a->have_peak != 0)
+    {
+        max30102_analysis_result_t *r = &a->result;
+        float ibi = (float)(peak - a->last_peak) / a->fs;
+        float ac_ir = a->beat_max[d] - a->beat_min[d];
+        float pi = (a->dc[d] > 0.0f) ? ac_ir / a->dc[d] : 0.0f;
+        uint8_t usable;
+        uint8_t valid;
+
+        r->beats++;
+        usable = ((ibi >= 60.0f / ANALYSIS_HR_MAX) && (ibi <= 60.0f / ANALYSIS_HR_MIN) && (a->beat_clipped == 0) &&
+                  (a->dc[d] >= (float)a->min_dc) && (pi >= ANALYSIS_PI_MIN) && (pi <= ANALYSIS_PI_MAX)) ? 1 : 0;
+        valid = usable;
+        if ((usable != 0) && (a->ibi_count >= 3))
+        {
+            float med = a_analysis_median(a->ibi, a->ibi_count);
+
+            valid = (fabsf(ibi - med) <= ANALYSIS_IBI_TOLERANCE * med) ? 1 : 0;
+        }
+        if (usable != 0)
+        {
+            /* every plausible interval enters the history so a rate change is followed */
+            a->ibi[a->ibi_pos] = ibi;
+            a->ibi_pos = (uint8_t)((a->ibi_pos + 1) % MAX30102_ANALYSIS_IBI_HISTORY);
+            if (a->ibi_count < MAX30102_ANALYSIS_IBI_HISTORY)
+            {
+                a->ibi_count++;
+            }
+        }
+        if (valid != 0)
+        {
+            float hr = 60.0f / ibi;
+
+            if ((r->valid_beats == 0) || (hr < r->hr_min))
+            {
+                r->hr_min = hr;
+            }
+            if ((r->valid_beats == 0) || (hr > r->hr_max))
+            {
+                r->hr_max = hr;
+            }
+            r->valid_beats++;
+            r->valid_seconds += ibi;
+            r->hr_sum += hr;
+            r->pi_sum += pi;
+            a->hr = hr;
+            if ((a->channels > 1) && (a->dc[0] > 0.0f) && (pi > 0.0f))
+            {
+                float ratio = ((a->beat_max[0] - a->beat_min[0]) / a->dc[0]) / pi;
+
+                if ((ratio >= ANALYSIS_R_MIN) && (ratio <= ANALYSIS_R_MAX))
+                {
+                    float spo2 = -45.060f * ratio * ratio + 30.354f * ratio + 94.845f;
+
+                    spo2 = (spo2 < 0.0f) ? 0.0f : ((spo2 > 100.0f) ? 100.0f : spo2);
+                    if ((r->spo2_beats == 0) || (spo2 < r->spo2_min))
+                    {
+                        r->spo2_min = spo2;
+                    }
+                    if ((r->spo2_beats == 0) || (spo2 > r->spo2_max))
+                    {
+                        r->spo2_max = spo2;
+                    }
+                    r->spo2_beats++;
+                    r->spo2_sum += spo2;
+                    a->spo2 = spo2;
+                }
+            }
+        }
+    }
+    a->last_peak = peak;
+    a->have_peak = 1;
+    a->beat_clipped = 0;
+    a->beat_max[0] = a->beat_min[0] = a->lp[0];
+    a->beat_max[1] = a->beat_min[1] = a->lp[1];
+}
+
+/**
+ * @brief     initialize the analysis pipeline
+ * @param[in] *a pointer to an analysis structure
+ * @param[in] sample_rate_mhz effective sample rate in mHz
+ * @param[in] resolution adc resolution in bits, 15 to 18
+ * @param[in] channels 1 (red only) or 2 (red and ir)
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ *            - 3 parameter is invalid
+ * @note      none
+ */
+uint8_t max30102_analysis_init(max30102_analysis_t *a, uint32_t sample_rate_mhz, uint8_t resolution, uint8_t channels)
+{
+    if (a == NULL)
+    {
+        return 2;
+    }
+    if ((sample_rate_mhz < 10000) || (resolution < 15) || (resolution > 18) || (channels < 1) || (channels > 2))
+    {
+        return 3;
+    }
+
+    memset(a, 0, sizeof(max30102_analysis_t));
+    a->fs = (float)sample_rate_mhz / 1000.0f;
+    a->a_dc = 1.0f - expf(-1.0f / (a->fs * ANALYSIS_DC_TAU_S));
+    a->a_lp = 1.0f - expf(-2.0f * 3.14159265f * ANALYSIS_LP_HZ / a->fs);
+    a->env_decay = expf(-1.0f / (a->fs * ANALYSIS_ENV_TAU_S));
+    a->refractory = (uint32_t)(a->fs * 60.0f / ANALYSIS_HR_MAX);
+    a->full_scale = (1U << resolution) - 1;
+    a->min_dc = a->full_scale / 32;
+    a->channels = channels;
+
+    return 0;
+}
+
+/**
+ * @brief     initialize the analysis pipeline for a recording
+ * @param[in] *a pointer to an analysis structure
+ * @param[in] *header pointer to a record header structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ *            - 3 header is invalid
+ * @note      none
+ */
+uint8_t max30102_analysis_init_from_header(max30102_analysis_t *a, const max30102_record_header_t *header)
+{
+    if ((a == NULL) || (header == NULL))
+    {
+        return 2;
+    }
+
+    return max30102_analysis_init(a, header->sample_rate_mhz, (uint8_t)(15 + (header->spo2_config & 0x03)),
+                                  header->channels);
+}
+
+/**
+ * @brief     feed samples
+ * @param[in] *a pointer to an analysis structure
+ * @param[in] *raw_red pointer to red samples
+ * @param[in] *raw_ir pointer to ir samples, ignored for one channel
+ * @param[in] len number of samples
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      a->hr and a->spo2 follow the last valid beat
+ */
+uint8_t max30102_analysis_update(max30102_analysis_t *a, const uint32_t *raw_red, const uint32_t *raw_ir, uint32_t len)
+{
+    uint8_t d;
+    uint32_t i;
+
+    if ((a == NULL) || (raw_red == NULL) || ((a->channels > 1) && (raw_ir == NULL)))
+    {
+        return 2;
+    }
+
+    d = (uint8_t)(a->channels - 1);
+    for (i = 0; i < len; i++)
+    {
+        uint32_t x[2];
+        uint8_t c;
+        float s;
+
+        x[0] = raw_red[i];
+        x[1] = (a->channels > 1) ? raw_ir[i] : 0;
+        for (c = 0; c < a->channels; c++)
+        {
+            float v = (float)x[c];
+
+            if (a->n == 0)
+            {
+                a->dc[c] = v;
+            }
+            a->dc[c] += a->a_dc * (v - a->dc[c]);
+            a->lp[c] += a->a_lp * ((v - a->dc[c]) - a->lp[c]);
+            if (a->lp[c] > a->beat_max[c])
+            {
+                a->beat_max[c] = a->lp[c];
+            }
+            if (a->lp[c] < a->beat_min[c])
+            {
+                a->beat_min[c] = a->lp[c];
+            }
+            if (x[c] >= a->full_scale)
+            {
+                a->result.clipped++;
+                a->beat_clipped = 1;
+            }
+        }
+
+        /* systole lowers the detected light, so beats are peaks of the inverted signal */
+        s = -a->lp[d];
+        a->env = (s > a->env * a->env_decay) ? s : a->env * a->env_decay;
+        if ((a->rising != 0) && (s < a->prev))
+        {
+            a->rising = 0;
+            if ((a->prev > 0.0f) && (a->prev > ANALYSIS_THRESHOLD * a->env) &&
+                ((a->have_peak == 0) || (a->n - 1 - a->last_peak >= a->refractory)))
+            {
+                a_analysis_beat(a, a->n - 1);
+            }
+        }
+        else if (s > a->prev)
+        {
+            a->rising = 1;
+        }
+        else
+        {
+            /* flat */
+        }
+        a->prev = s;
+        a->n++;
+    }
+    a->result.samples += len;
+    a->result.seconds += (double)len / a->fs;
+
+    return 0;
+}
+
+/**
+ * @brief     drop the accumulated result but keep the filter state
+ * @param[in] *a pointer to an analysis structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      used after a warm-up
+ */
+uint8_t max30102_analysis_clear_result(max30102_analysis_t *a)
+{
+    if (a == NULL)
+    {
+        return 2;
+    }
+
+    memset(&a->result, 0, sizeof(max30102_analysis_result_t));
+
+    return 0;
+}
+
+/**
+ * @brief      get the accumulated result
+ * @param[in]  *a pointer to an analysis structure
+ * @param[out] *result pointer to a result structure
+ * @return     status code
+ *             - 0 success
+ *             - 2 handle is NULL
+ * @note       none
+ */
+uint8_t max30102_analysis_get_result(max30102_analysis_t *a, max30102_analysis_result_t *result)
+{
+    if ((a == NULL) || (result == NULL))
+    {
+        return 2;
+    }
+
+    *result = a->result;
+    a_analysis_finish(result);
+
+    return 0;
+}
+
+/**
+ * @brief         merge a result into another
+ * @param[in,out] *dst pointer to the accumulating result, zeroed before the first merge
+ * @param[in]     *src pointer to the result to add
+ * @return        status code
+ *                - 0 success
+ *                - 2 handle is NULL
+ * @note          the means of dst are recomputed
+ */
+uint8_t max30102_analysis_merge(max30102_analysis_result_t *dst, const max30102_analysis_result_t *src)
+{
+    if ((dst == NULL) || (src == NULL))
+    {
+        return 2;
+    }
+
+    if (src->valid_beats != 0)
+    {
+        dst->hr_min = ((dst->valid_beats == 0) || (src->hr_min < dst->hr_min)) ? src->hr_min : dst->hr_min;
+        dst->hr_max = ((dst->valid_beats == 0) || (src->hr_max > dst->hr_max)) ? src->hr_max : dst->hr_max;
+    }
+    if (src->spo2_beats != 0)
+    {
+        dst->spo2_min = ((dst->spo2_beats == 0) || (src->spo2_min < dst->spo2_min)) ? src->spo2_min : dst->spo2_min;
+        dst->spo2_max = ((dst->spo2_beats == 0) || (src->spo2_max > dst->spo2_max)) ? src->spo2_max : dst->spo2_max;
+    }
+    dst->samples += src->samples;
+    dst->seconds += src->seconds;
+    dst->beats += src->beats;
+    dst->valid_beats += src->valid_beats;
+    dst->spo2_beats += src->spo2_beats;
+    dst->clipped += src->clipped;
+    dst->valid_seconds += src->valid_seconds;
+    dst->hr_sum += src->hr_sum;
+    dst->spo2_sum += src->spo2_sum;
+    dst->pi_sum += src->pi_sum;
+    a_analysis_finish(dst);
+
+    return 0;
+}
+
+static uint8_t a_deque_push(analysis_deque_t *q, const analysis_task_t *t)
+{
+    uint8_t res = 0;
+
+    (void)pthread_mutex_lock(&q->lock);
+    if (q->tail - q->head == q->capacity)
+    {
+        uint32_t capacity = (q->capacity != 0) ? q->capacity * 2 : 64;
+        analysis_task_t *task = (analysis_task_t *)malloc(capacity * sizeof(analysis_task_t));
+        uint32_t i;
+
+        if (task == NULL)
+        {
+            res = 1;
+        }
+        else
+        {
+            for (i = q->head; i != q->tail; i++)
+            {
+                task[i & (capacity - 1)] = q->task[i & (q->capacity - 1)];
+            }
+            free(q->task);
+            q->task = task;
+            q->capacity = capacity;
+        }
+    }
+    if (res == 0)
+    {
+        q->task[q->tail & (q->capacity - 1)] = *t;
+        q->tail++;
+    }
+    (void)pthread_mutex_unlock(&q->lock);
+
+    return res;
+}
+
+static uint8_t a_deque_take(analysis_deque_t *q, analysis_task_t *t, uint8_t steal)
+{
+    uint8_t res = 1;
+
+    (void)pthread_mutex_lock(&q->lock);
+    if (q->tail != q->head)
+    {
+        if (steal != 0)
+        {
+            *t = q->task[q->head & (q->capacity - 1)];
+            q->head++;
+        }
+        else
+        {
+            q->tail--;
+            *t = q->task[q->tail & (q->capacity - 1)];
+        }
+        res = 0;
+    }
+    (void)pthread_mutex_unlock(&q->lock);
+
+    return res;
+}
+
+/**
+ * @brief     run one shard
+ * @param[in] *w pointer to a worker
+ * @param[in] *t pointer to a task, a whole file task is split first
+ * @return    status code
+ *            - 0 success
+ *            - 1 read failed
+ *            - 3 file is invalid
+ * @note      none
+ */
+static uint8_t a_analysis_run(analysis_worker_t *w, analysis_task_t *t)
+{
+    analysis_batch_t *b = w->batch;
+    max30102_record_reader_t *rd = &w->reader;
+    max30102_analysis_result_t result;
+    uint64_t warmup;
+    uint32_t per_shard;
+    uint32_t start;
+    uint8_t counting;
+    uint8_t res;
+
+    if (w->open_file != t->file)
+    {
+        if (w->open_file != 0xFFFFFFFFU)
+        {
+            (void)max30102_record_reader_close(rd);
+            w->open_file = 0xFFFFFFFFU;
+        }
+        res = max30102_record_reader_open(rd, b->inputs[t->file]);
+        if (res != 0)
+        {
+            return (res == 3) ? 3 : 1;
+        }
+        w->open_file = t->file;
+    }
+    if (max30102_analysis_init_from_header(&w->analysis, &rd->header) != 0)
+    {
+        return 3;
+    }
+    if (rd->chunk_count == 0)
+    {
+        return 0;
+    }
+
+    /* split on first sight, the other shards go to the own deque for thieves to find */
+    per_shard = MAX30102_ANALYSIS_SHARD_SAMPLES / ((rd->header.chunk_samples != 0) ? rd->header.chunk_samples : 1);
+    per_shard = (per_shard != 0) ? per_shard : 1;
+    if (t->last == 0)
+    {
+        uint32_t first;
+
+        for (first = ((rd->chunk_count - 1) / per_shard) * per_shard; first > 0; first -= per_shard)
+        {
+            analysis_task_t shard;
+
+            shard.file = t->file;
+            shard.first = first;
+            shard.last = (first + per_shard < rd->chunk_count) ? first + per_shard : rd->chunk_count;
+            atomic_fetch_add(&b->pending, 1);
+            if (a_deque_push(&b->deque[w->id], &shard) != 0)
+            {
+                atomic_fetch_sub(&b->pending, 1);
+
+                return 1;
+            }
+        }
+        t->first = 0;
+        t->last = (per_shard < rd->chunk_count) ? per_shard : rd->chunk_count;
+    }
+
+    /* replay the warm-up without counting it */
+    warmup = (uint64_t)MAX30102_ANALYSIS_WARMUP_S * rd->header.sample_rate_mhz / 1000;
+    start = t->first;
+    while ((start > 0) && ((uint64_t)(t->first - start) * rd->header.chunk_samples < warmup))
+    {
+        start--;
+    }
+    if (max30102_record_reader_seek(rd, rd->index[start].t_first) != 0)
+    {
+        return 1;
+    }
+    counting = (start == t->first) ? 1 : 0;
+    while (1)
+    {
+        uint32_t len = ANALYSIS_READ_SAMPLES;
+
+        res = max30102_record_reader_read(rd, w->red, w->ir, &len, NULL);
+        if (res == 4)
+        {
+            break;
+        }
+        if (res != 0)
+        {
+            return 1;
+        }
+        if (rd->chunk >= t->last)
+        {
+            break;
+        }
+        if ((counting == 0) && (rd->chunk >= t->first))
+        {
+            atomic_fetch_add(&b->warmup_samples, w->analysis.result.samples);
+            (void)max30102_analysis_clear_result(&w->analysis);
+            counting = 1;
+        }
+        (void)max30102_analysis_update(&w->analysis, w->red, w->ir, len);
+    }
+
+    (void)max30102_analysis_get_result(&w->analysis, &result);
+    atomic_fetch_add(&b->samples, result.samples);
+    atomic_fetch_add(&b->shards, 1);
+    (void)pthread_mutex_lock(&b->lock);
+    (void)max30102_analysis_merge(&b->results[t->file], &result);
+    (void)pthread_mutex_unlock(&b->lock);
+
+    return 0;
+}
+
+static void *a_analysis_worker(void *arg)
+{
+    analysis_worker_t *w = (analysis_worker_t *)arg;
+    analysis_batch_t *b = w->batch;
+    uint32_t victim = w->id;
+
+    while (atomic_load(&b->failed) == 0)
+    {
+        analysis_task_t t;
+        uint8_t found;
+        uint8_t res;
+        uint32_t i;
+
+        found = (a_deque_take(&b->deque[w->id], &t, 0) == 0) ? 1 : 0;
+        for (i = 1; (found == 0) && (i < b->threads); i++)
+        {
+            victim = (victim + 1) % b->threads;
+            if ((victim != w->id) && (a_deque_take(&b->deque[victim], &t, 1) == 0))
+            {
+                atomic_fetch_add(&b->steals, 1);
+                found = 1;
+            }
+        }
+        if (found == 0)
+        {
+            if (atomic_load(&b->pending) == 0)
+            {
+                break;
+            }
+            (void)sched_yield();
+
+            continue;
+        }
+        res = a_analysis_run(w, &t);
+        if (res != 0)
+        {
+            unsigned int expect = 0;
+
+            (void)atomic_compare_exchange_strong(&b->failed, &expect, (unsigned int)res + 1);
+        }
+        atomic_fetch_sub(&b->pending, 1);
+    }
+    if (w->open_file != 0xFFFFFFFFU)
+    {
+        (void)max30102_record_reader_close(&w->reader);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief      analyse recordings on a work-stealing thread pool
+ * @param[in]  **inputs pointer to recording paths
+ * @param[in]  input_count number of recordings
+ * @param[in]  threads number of workers, 0 uses one per cpu
+ * @param[out] *results pointer to input_count results
+ * @param[out] *stats pointer to a statistics structure, may be NULL
+ * @return     status code
+ *             - 0 success
+ *             - 1 analysis failed
+ *             - 2 handle is NULL
+ *             - 3 input is invalid
+ * @note       each worker owns a deque of shards and steals from the
+ *             others when it runs dry; a recording is split into shards of
+ *             MAX30102_ANALYSIS_SHARD_SAMPLES when first opened, and each
+ *             shard replays MAX30102_ANALYSIS_WARMUP_S seconds before its
+ *             start so beats across shard boundaries are counted once
+ */
+uint8_t max30102_analysis_batch(const char *const *inputs, uint32_t input_count, uint32_t threads,
+                                max30102_analysis_result_t *results, max30102_analysis_stats_t *stats)
+{
+    analysis_batch_t b;
+    analysis_worker_t *workers;
+    pthread_t *tid;
+    struct timespec t0;
+    struct timespec t1;
+    uint32_t started;
+    uint32_t i;
+    uint8_t res;
+
+    if ((inputs == NULL) || (results == NULL))
+    {
+        return 2;
+    }
+    if (input_count == 0)
+    {
+        return 3;
+    }
+    if (threads == 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = (n > 0) ? (uint32_t)n : 1;
+    }
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+    memset(results, 0, input_count * sizeof(max30102_analysis_result_t));
+    memset(&b, 0, sizeof(b));
+    b.inputs = inputs;
+    b.results = results;
+    b.threads = threads;
+    atomic_init(&b.pending, input_count);
+    atomic_init(&b.shards, 0);
+    atomic_init(&b.steals, 0);
+    atomic_init(&b.samples, 0);
+    atomic_init(&b.warmup_samples, 0);
+    atomic_init(&b.failed, 0);
+    (void)pthread_mutex_init(&b.lock, NULL);
+    b.deque = (analysis_deque_t *)calloc(threads, sizeof(analysis_deque_t));
+    workers = (analysis_worker_t *)calloc(threads, sizeof(analysis_worker_t));
+    tid = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    if ((b.deque == NULL) || (workers == NULL) || (tid == NULL))
+    {
+        res = 1;
+
+        goto exit;
+    }
+    for (i = 0; i < threads; i++)
+    {
+        (void)pthread_mutex_init(&b.deque[i].lock, NULL);
+        workers[i].batch = &b;
+        workers[i].id = i;
+        workers[i].open_file = 0xFFFFFFFFU;
+    }
+
+    /* deal whole files round robin, the last file dealt is taken first */
+    for (i = 0; i < input_count; i++)
+    {
+        analysis_task_t t;
+
+        t.file = input_count - 1 - i;
+        t.first = 0;
+        t.last = 0;
+        if (a_deque_push(&b.deque[i % threads], &t) != 0)
+        {
+            res = 1;
+
+            goto exit;
+        }
+    }
+
+    for (started = 0; started < threads; started++)
+    {
+        if (pthread_create(&tid[started], NULL, a_analysis_worker, &workers[started]) != 0)
+        {
+            break;
+        }
+    }
+    if (started == 0)
+    {
+        atomic_store(&b.failed, 2);
+    }
+    /* the deques of workers that failed to start are drained by thieves */
+    for (i = 0; i < started; i++)
+    {
+        (void)pthread_join(tid[i], NULL);
+    }
+    res = (uint8_t)((atomic_load(&b.failed) != 0) ? atomic_load(&b.failed) - 1 : 0);
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (stats != NULL)
+    {
+        stats->samples = atomic_load(&b.samples);
+        stats->warmup_samples = atomic_load(&b.warmup_samples);
+        stats->shards = atomic_load(&b.shards);
+        stats->steals = atomic_load(&b.steals);
+        stats->threads = started;
+        stats->elapsed = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    }
+
+    exit:
+    if (b.deque != NULL)
+    {
+        for (i = 0; i < threads; i++)
+        {
+            free(b.deque[i].task);
+            (void)pthread_mutex_destroy(&b.deque[i].lock);
+        }
+    }
+    (void)pthread_mutex_destroy(&b.lock);
+    free(b.deque);
+    free(workers);
+    free(tid);
+
+    return res;
+}
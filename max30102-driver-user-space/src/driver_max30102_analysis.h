@@ -0,0 +1,198 @@
+
+#ifndef DRIVER_MAX30102_ANALYSIS_H
+#define DRIVER_MAX30102_ANALYSIS_H
+
+#include "driver_max30102_record.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @defgroup max30102_analysis_driver max30102 analysis driver function
+ * @brief    max30102 analysis driver modules
+ * @ingroup  max30102_driver
+ * @{
+ */
+
+/**
+ * @brief max30102 analysis parameter definition
+ */
+#define MAX30102_ANALYSIS_VERSION           1                  /**< algorithm version, bump when results change */
+#define MAX30102_ANALYSIS_SHARD_SAMPLES     (1 << 20)          /**< samples per batch shard */
+#define MAX30102_ANALYSIS_WARMUP_S          10                 /**< seconds replayed before a shard */
+#define MAX30102_ANALYSIS_IBI_HISTORY       5                  /**< beat intervals kept for the median */
+
+/**
+ * @brief max30102 analysis result structure definition
+ * @note  the sums are merged across shards, the means are derived from them
+ */
+typedef struct max30102_analysis_result_s
+{
+    uint64_t samples;                 /**< samples analysed */
+    double seconds;                   /**< signal duration */
+    uint32_t beats;                   /**< detected beats */
+    uint32_t valid_beats;             /**< beats that passed the quality checks */
+    uint32_t spo2_beats;              /**< valid beats with a usable ratio */
+    uint64_t clipped;                 /**< samples at adc full scale */
+    double valid_seconds;             /**< sum of valid beat intervals */
+    double hr_sum;                    /**< sum of valid beat rates */
+    double spo2_sum;                  /**< sum of valid beat saturations */
+    double pi_sum;                    /**< sum of valid beat ir perfusion indices */
+    float hr_min;                     /**< lowest valid beat rate */
+    float hr_max;                     /**< highest valid beat rate */
+    float spo2_min;                   /**< lowest valid beat saturation */
+    float spo2_max;                   /**< highest valid beat saturation */
+    float hr_mean;                    /**< mean heart rate in bpm, 0 if no valid beat */
+    float spo2_mean;                  /**< mean spo2 in percent, 0 if unavailable */
+    float pi_mean;                    /**< mean ir perfusion index in percent */
+    float quality;                    /**< valid_seconds / seconds */
+} max30102_analysis_result_t;
+
+/**
+ * @brief max30102 analysis structure definition
+ * @note  constant size, the pipeline keeps no sample history
+ */
+typedef struct max30102_analysis_s
+{
+    float fs;                                           /**< sample rate in Hz */
+    float a_dc;                                         /**< dc tracker coefficient */
+    float a_lp;                                         /**< low pass coefficient */
+    float env_decay;                                    /**< envelope decay per sample */
+    uint32_t refractory;                                /**< min samples between beats */
+    uint32_t min_dc;                                    /**< min ir dc for a finger */
+    uint32_t full_scale;                                /**< adc full scale code */
+    uint8_t channels;                                   /**< 1 red only, 2 red and ir */
+    float dc[2];                                        /**< red and ir dc */
+    float lp[2];                                        /**< red and ir filtered ac */
+    float env;                                          /**< pulse envelope */
+    float prev;                                         /**< previous pulse sample */
+    uint8_t rising;                                     /**< pulse is rising */
+    uint8_t have_peak;                                  /**< last_peak is valid */
+    uint8_t beat_clipped;                               /**< clipping since the last beat */
+    uint64_t n;                                         /**< samples seen */
+    uint64_t last_peak;                                 /**< sample number of the last beat */
+    float beat_max[2];                                  /**< ac maximum since the last beat */
+    float beat_min[2];                                  /**< ac minimum since the last beat */
+    float ibi[MAX30102_ANALYSIS_IBI_HISTORY];           /**< recent valid beat intervals */
+    uint8_t ibi_count;                                  /**< valid entries in ibi */
+    uint8_t ibi_pos;                                    /**< next ibi slot */
+    float hr;                                           /**< last valid heart rate */
+    float spo2;                                         /**< last valid spo2 */
+    max30102_analysis_result_t result;                  /**< running result */
+} max30102_analysis_t;
+
+/**
+ * @brief max30102 analysis batch statistics structure definition
+ */
+typedef struct max30102_analysis_stats_s
+{
+    uint64_t samples;                 /**< samples analysed, warm-up excluded */
+    uint64_t warmup_samples;          /**< samples replayed to warm up shards */
+    uint32_t shards;                  /**< shards run */
+    uint32_t steals;                  /**< shards taken from another worker */
+    uint32_t threads;                 /**< workers used */
+    double elapsed;                   /**< wall time in seconds */
+} max30102_analysis_stats_t;
+
+/**
+ * @brief     initialize the analysis pipeline
+ * @param[in] *a pointer to an analysis structure
+ * @param[in] sample_rate_mhz effective sample rate in mHz
+ * @param[in] resolution adc resolution in bits, 15 to 18
+ * @param[in] channels 1 (red only) or 2 (red and ir)
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ *            - 3 parameter is invalid
+ * @note      none
+ */
+uint8_t max30102_analysis_init(max30102_analysis_t *a, uint32_t sample_rate_mhz, uint8_t resolution, uint8_t channels);
+
+/**
+ * @brief     initialize the analysis pipeline for a recording
+ * @param[in] *a pointer to an analysis structure
+ * @param[in] *header pointer to a record header structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ *            - 3 header is invalid
+ * @note      none
+ */
+uint8_t max30102_analysis_init_from_header(max30102_analysis_t *a, const max30102_record_header_t *header);
+
+/**
+ * @brief     feed samples
+ * @param[in] *a pointer to an analysis structure
+ * @param[in] *raw_red pointer to red samples
+ * @param[in] *raw_ir pointer to ir samples, ignored for one channel
+ * @param[in] len number of samples
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      a->hr and a->spo2 follow the last valid beat
+ */
+uint8_t max30102_analysis_update(max30102_analysis_t *a, const uint32_t *raw_red, const uint32_t *raw_ir, uint32_t len);
+
+/**
+ * @brief     drop the accumulated result but keep the filter state
+ * @param[in] *a pointer to an analysis structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      used after a warm-up
+ */
+uint8_t max30102_analysis_clear_result(max30102_analysis_t *a);
+
+/**
+ * @brief      get the accumulated result
+ * @param[in]  *a pointer to an analysis structure
+ * @param[out] *result pointer to a result structure
+ * @return     status code
+ *             - 0 success
+ *             - 2 handle is NULL
+ * @note       none
+ */
+uint8_t max30102_analysis_get_result(max30102_analysis_t *a, max30102_analysis_result_t *result);
+
+/**
+ * @brief         merge a result into another
+ * @param[in,out] *dst pointer to the accumulating result, zeroed before the first merge
+ * @param[in]     *src pointer to the result to add
+ * @return        status code
+ *                - 0 success
+ *                - 2 handle is NULL
+ * @note          the means of dst are recomputed
+ */
+uint8_t max30102_analysis_merge(max30102_analysis_result_t *dst, const max30102_analysis_result_t *src);
+
+/**
+ * @brief      analyse recordings on a work-stealing thread pool
+ * @param[in]  **inputs pointer to recording paths
+ * @param[in]  input_count number of recordings
+ * @param[in]  threads number of workers, 0 uses one per cpu
+ * @param[out] *results pointer to input_count results
+ * @param[out] *stats pointer to a statistics structure, may be NULL
+ * @return     status code
+ *             - 0 success
+ *             - 1 analysis failed
+ *             - 2 handle is NULL
+ *             - 3 input is invalid
+ * @note       each worker owns a deque of shards and steals from the
+ *             others when it runs dry; a recording is split into shards of
+ *             MAX30102_ANALYSIS_SHARD_SAMPLES when first opened, and each
+ *             shard replays MAX30102_ANALYSIS_WARMUP_S seconds before its
+ *             start so beats across shard boundaries are counted once
+ */
+uint8_t max30102_analysis_batch(const char *const *inputs, uint32_t input_count, uint32_t threads,
+                                max30102_analysis_result_t *results, max30102_analysis_stats_t *stats);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
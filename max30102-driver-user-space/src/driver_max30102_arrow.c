@@ -0,0 +1,1314 @@
+
+
+#include "driver_max30102_arrow.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+/**
+ * @brief arrow flatbuffers enumeration definition
+ * @note  values from the arrow format Schema.fbs, Message.fbs and File.fbs
+ */
+#define ARROW_METADATA_V5                4           /**< MetadataVersion.V5 */
+#define ARROW_HEADER_SCHEMA              1           /**< MessageHeader.Schema */
+#define ARROW_HEADER_DICTIONARY_BATCH    2           /**< MessageHeader.DictionaryBatch */
+#define ARROW_HEADER_RECORD_BATCH        3           /**< MessageHeader.RecordBatch */
+#define ARROW_TYPE_INT                   2           /**< Type.Int */
+#define ARROW_TYPE_UTF8                  5           /**< Type.Utf8 */
+#define ARROW_TYPE_TIMESTAMP             10          /**< Type.Timestamp */
+#define ARROW_TIME_UNIT_NANOSECOND       3           /**< TimeUnit.NANOSECOND */
+
+/**
+ * @brief arrow layout definition
+ */
+#define ARROW_ALIGNMENT                  64          /**< body buffer alignment */
+#define ARROW_CONTINUATION               0xFFFFFFFFU /**< encapsulated message marker */
+#define ARROW_FIELDS                     5           /**< schema fields */
+#define ARROW_MAX_BUFFERS                10          /**< body buffers per record batch */
+#define ARROW_FB_INIT_SIZE               1024        /**< initial flatbuffer size */
+#define ARROW_FB_MAX_SLOTS               8           /**< max fields per flatbuffer table */
+
+static const uint8_t gs_magic[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};        /**< file magic with padding */
+static const uint8_t gs_zero[ARROW_ALIGNMENT];                                  /**< padding source */
+
+/**
+ * @brief arrow flatbuffer builder structure definition
+ * @note  the buffer is filled from the end like the reference builder, all
+ *        offsets below are distances from the end of the buffer
+ */
+typedef struct arrow_fb_s
+{
+    uint8_t *buf;                                /**< buffer */
+    size_t cap;                                  /**< buffer size */
+    size_t head;                                 /**< bytes used at the end */
+    size_t minalign;                             /**< largest alignment used */
+    size_t table;                                /**< head when the open table started */
+    uint32_t slot[ARROW_FB_MAX_SLOTS];           /**< head after each field of the open table */
+    uint8_t slots;                               /**< vtable entries of the open table */
+    uint8_t failed;                              /**< set if the buffer could not grow */
+} arrow_fb_t;
+
+/**
+ * @brief arrow message body structure definition
+ */
+typedef struct arrow_body_s
+{
+    struct iovec iov[2 * ARROW_MAX_BUFFERS];     /**< buffers and padding */
+    int iovcnt;                                  /**< used iov entries */
+    uint64_t size;                               /**< body size */
+    uint64_t offset[ARROW_MAX_BUFFERS];          /**< buffer offsets in the body */
+    uint64_t length[ARROW_MAX_BUFFERS];          /**< buffer lengths */
+    uint32_t count;                              /**< buffers */
+} arrow_body_t;
+
+/**
+ * @brief arrow export state structure definition
+ */
+typedef struct arrow_export_s
+{
+    max30102_arrow_t *w;                         /**< shared writer */
+    const char *const *inputs;                   /**< recording paths */
+    uint32_t input_count;                        /**< recordings */
+    uint16_t *device;                            /**< device index per recording */
+    uint16_t *config;                            /**< config index per recording */
+    pthread_mutex_t lock;                        /**< protects next and res */
+    uint32_t next;                               /**< next recording to take */
+    uint8_t res;                                 /**< first error */
+} arrow_export_t;
+
+static void a_put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 0);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void a_put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 0);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void a_put_le64(uint8_t *p, uint64_t v)
+{
+    a_put_le32(p, (uint32_t)v);
+    a_put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint8_t a_fb_init(arrow_fb_t *fb)
+{
+    memset(fb, 0, sizeof(arrow_fb_t));
+    fb->buf = (uint8_t *)malloc(ARROW_FB_INIT_SIZE);
+    if (fb->buf == NULL)
+    {
+        return 1;
+    }
+    fb->cap = ARROW_FB_INIT_SIZE;
+    fb->minalign = 1;
+
+    return 0;
+}
+
+static uint8_t a_fb_reserve(arrow_fb_t *fb, size_t n)
+{
+    uint8_t *buf;
+    size_t cap;
+
+    if (fb->failed != 0)
+    {
+        return 1;
+    }
+    if (fb->head + n <= fb->cap)
+    {
+        return 0;
+    }
+    cap = fb->cap;
+    while (fb->head + n > cap)
+    {
+        cap *= 2;
+    }
+    buf = (uint8_t *)malloc(cap);
+    if (buf == NULL)
+    {
+        fb->failed = 1;
+
+        return 1;
+    }
+    memcpy(buf + cap - fb->head, fb->buf + fb->cap - fb->head, fb->head);
+    free(fb->buf);
+    fb->buf = buf;
+    fb->cap = cap;
+
+    return 0;
+}
+
+static void a_fb_push(arrow_fb_t *fb, const void *p, size_t n)
+{
+    if (a_fb_reserve(fb, n) != 0)
+    {
+        return;
+    }
+    fb->head += n;
+    memcpy(fb->buf + fb->cap - fb->head, p, n);
+}
+
+/**
+ * @brief     pad so that the buffer is aligned after extra more bytes
+ * @param[in] *fb pointer to a flatbuffer builder
+ * @param[in] align power of two alignment
+ * @param[in] extra bytes about to be pushed
+ * @note      none
+ */
+static void a_fb_prep(arrow_fb_t *fb, size_t align, size_t extra)
+{
+    if (align > fb->minalign)
+    {
+        fb->minalign = align;
+    }
+    a_fb_push(fb, gs_zero, (align - ((fb->head + extra) & (align - 1))) & (align - 1));
+}
+
+static void a_fb_u8(arrow_fb_t *fb, uint8_t v)
+{
+    a_fb_push(fb, &v, 1);
+}
+
+static void a_fb_u16(arrow_fb_t *fb, uint16_t v)
+{
+    uint8_t b[2];
+
+    a_fb_prep(fb, 2, 0);
+    a_put_le16(b, v);
+    a_fb_push(fb, b, 2);
+}
+
+static void a_fb_u32(arrow_fb_t *fb, uint32_t v)
+{
+    uint8_t b[4];
+
+    a_fb_prep(fb, 4, 0);
+    a_put_le32(b, v);
+    a_fb_push(fb, b, 4);
+}
+
+static void a_fb_u64(arrow_fb_t *fb, uint64_t v)
+{
+    uint8_t b[8];
+
+    a_fb_prep(fb, 8, 0);
+    a_put_le64(b, v);
+    a_fb_push(fb, b, 8);
+}
+
+static void a_fb_uoffset(arrow_fb_t *fb, uint32_t target)
+{
+    a_fb_prep(fb, 4, 0);
+    a_fb_u32(fb, (uint32_t)(fb->head + 4 - target));
+}
+
+static uint32_t a_fb_string(arrow_fb_t *fb, const char *s)
+{
+    size_t n;
+
+    n = strlen(s);
+    a_fb_prep(fb, 4, n + 1);
+    a_fb_u8(fb, 0);
+    a_fb_push(fb, s, n);
+    a_fb_u32(fb, (uint32_t)n);
+
+    return (uint32_t)fb->head;
+}
+
+/**
+ * @brief     push a vector of structs
+ * @param[in] *fb pointer to a flatbuffer builder
+ * @param[in] *elems pointer to little endian struct bytes
+ * @param[in] size struct size
+ * @param[in] count number of structs
+ * @return    vector offset
+ * @note      all arrow structs used here are 8 byte aligned
+ */
+static uint32_t a_fb_struct_vector(arrow_fb_t *fb, const uint8_t *elems, size_t size, uint32_t count)
+{
+    uint32_t i;
+
+    a_fb_prep(fb, 4, size * count);
+    a_fb_prep(fb, 8, size * count);
+    for (i = count; i > 0; i--)
+    {
+        a_fb_push(fb, elems + (size_t)(i - 1) * size, size);
+    }
+    a_fb_u32(fb, count);
+
+    return (uint32_t)fb->head;
+}
+
+static uint32_t a_fb_offset_vector(arrow_fb_t *fb, const uint32_t *offsets, uint32_t count)
+{
+    uint32_t i;
+
+    a_fb_prep(fb, 4, 4 * (size_t)count);
+    for (i = count; i > 0; i--)
+    {
+        a_fb_uoffset(fb, offsets[i - 1]);
+    }
+    a_fb_u32(fb, count);
+
+    return (uint32_t)fb->head;
+}
+
+static void a_fb_start_table(arrow_fb_t *fb)
+{
+    memset(fb->slot, 0, sizeof(fb->slot));
+    fb->slots = 0;
+    fb->table = fb->head;
+}
+
+static void a_fb_slot(arrow_fb_t *fb, uint8_t slot)
+{
+    fb->slot[slot] = (uint32_t)fb->head;
+    if (slot + 1 > fb->slots)
+    {
+        fb->slots = (uint8_t)(slot + 1);
+    }
+}
+
+static void a_fb_add_u8(arrow_fb_t *fb, uint8_t slot, uint8_t v)
+{
+    a_fb_u8(fb, v);
+    a_fb_slot(fb, slot);
+}
+
+static void a_fb_add_u16(arrow_fb_t *fb, uint8_t slot, uint16_t v)
+{
+    a_fb_u16(fb, v);
+    a_fb_slot(fb, slot);
+}
+
+static void a_fb_add_u32(arrow_fb_t *fb, uint8_t slot, uint32_t v)
+{
+    a_fb_u32(fb, v);
+    a_fb_slot(fb, slot);
+}
+
+static void a_fb_add_u64(arrow_fb_t *fb, uint8_t slot, uint64_t v)
+{
+    a_fb_u64(fb, v);
+    a_fb_slot(fb, slot);
+}
+
+static void a_fb_add_offset(arrow_fb_t *fb, uint8_t slot, uint32_t target)
+{
+    a_fb_uoffset(fb, target);
+    a_fb_slot(fb, slot);
+}
+
+/**
+ * @brief     close the open table and write its vtable
+ * @param[in] *fb pointer to a flatbuffer builder
+ * @return    table offset
+ * @note      vtables are not deduplicated, the metadata is a few hundred bytes
+ */
+static uint32_t a_fb_end_table(arrow_fb_t *fb)
+{
+    uint32_t table;
+    uint32_t vtable;
+    uint8_t i;
+
+    a_fb_u32(fb, 0);
+    table = (uint32_t)fb->head;
+    for (i = fb->slots; i > 0; i--)
+    {
+        a_fb_u16(fb, (uint16_t)((fb->slot[i - 1] != 0) ? (table - fb->slot[i - 1]) : 0));
+    }
+    a_fb_u16(fb, (uint16_t)(table - fb->table));
+    a_fb_u16(fb, (uint16_t)(4 + 2 * fb->slots));
+    vtable = (uint32_t)fb->head;
+    if (fb->failed == 0)
+    {
+        a_put_le32(fb->buf + fb->cap - table, vtable - table);
+    }
+
+    return table;
+}
+
+static void a_fb_finish(arrow_fb_t *fb, uint32_t root)
+{
+    a_fb_prep(fb, (fb->minalign > 8) ? fb->minalign : 8, 4);
+    a_fb_uoffset(fb, root);
+}
+
+static uint32_t a_arrow_int_type(arrow_fb_t *fb, uint32_t bits, uint8_t is_signed)
+{
+    a_fb_start_table(fb);
+    a_fb_add_u32(fb, 0, bits);
+    a_fb_add_u8(fb, 1, is_signed);
+
+    return a_fb_end_table(fb);
+}
+
+/**
+ * @brief     build one schema field
+ * @param[in] *fb pointer to a flatbuffer builder
+ * @param[in] *name pointer to the field name
+ * @param[in] nullable nullable flag
+ * @param[in] type Type union tag
+ * @param[in] type_table Type union table
+ * @param[in] dictionary dictionary id, negative for plain columns
+ * @param[in] children empty children vector
+ * @return    field offset
+ * @note      none
+ */
+static uint32_t a_arrow_field(arrow_fb_t *fb, const char *name, uint8_t nullable, uint8_t type, uint32_t type_table,
+                              int32_t dictionary, uint32_t children)
+{
+    uint32_t name_off;
+    uint32_t dict_off;
+
+    name_off = a_fb_string(fb, name);
+    dict_off = 0;
+    if (dictionary >= 0)
+    {
+        uint32_t index_type;
+
+        index_type = a_arrow_int_type(fb, 16, 1);
+        a_fb_start_table(fb);
+        a_fb_add_u64(fb, 0, (uint64_t)dictionary);
+        a_fb_add_offset(fb, 1, index_type);
+        a_fb_add_u8(fb, 2, 0);
+        dict_off = a_fb_end_table(fb);
+    }
+    a_fb_start_table(fb);
+    a_fb_add_offset(fb, 0, name_off);
+    a_fb_add_u8(fb, 1, nullable);
+    a_fb_add_u8(fb, 2, type);
+    a_fb_add_offset(fb, 3, type_table);
+    if (dict_off != 0)
+    {
+        a_fb_add_offset(fb, 4, dict_off);
+    }
+    a_fb_add_offset(fb, 5, children);
+
+    return a_fb_end_table(fb);
+}
+
+static uint32_t a_arrow_schema(arrow_fb_t *fb)
+{
+    uint32_t fields[ARROW_FIELDS];
+    uint32_t children;
+    uint32_t type;
+    uint32_t tz;
+    uint32_t vec;
+
+    children = a_fb_offset_vector(fb, NULL, 0);
+
+    tz = a_fb_string(fb, "UTC");
+    a_fb_start_table(fb);
+    a_fb_add_u16(fb, 0, ARROW_TIME_UNIT_NANOSECOND);
+    a_fb_add_offset(fb, 1, tz);
+    type = a_fb_end_table(fb);
+    fields[0] = a_arrow_field(fb, "timestamp", 0, ARROW_TYPE_TIMESTAMP, type, -1, children);
+
+    a_fb_start_table(fb);
+    type = a_fb_end_table(fb);
+    fields[1] = a_arrow_field(fb, "device", 0, ARROW_TYPE_UTF8, type, 0, children);
+
+    type = a_arrow_int_type(fb, 32, 0);
+    fields[2] = a_arrow_field(fb, "red", 0, ARROW_TYPE_INT, type, -1, children);
+    fields[3] = a_arrow_field(fb, "ir", 1, ARROW_TYPE_INT, type, -1, children);
+
+    a_fb_start_table(fb);
+    type = a_fb_end_table(fb);
+    fields[4] = a_arrow_field(fb, "config", 1, ARROW_TYPE_UTF8, type, 1, children);
+
+    vec = a_fb_offset_vector(fb, fields, ARROW_FIELDS);
+    a_fb_start_table(fb);
+    a_fb_add_u16(fb, 0, 0);
+    a_fb_add_offset(fb, 1, vec);
+
+    return a_fb_end_table(fb);
+}
+
+/**
+ * @brief     build a RecordBatch table
+ * @param[in] *fb pointer to a flatbuffer builder
+ * @param[in] length rows
+ * @param[in] *null_count pointer to the null count of each field
+ * @param[in] fields number of fields
+ * @param[in] *body pointer to the laid out body
+ * @return    table offset
+ * @note      none
+ */
+static uint32_t a_arrow_record_batch(arrow_fb_t *fb, uint64_t length, const uint64_t *null_count, uint32_t fields,
+                                     const arrow_body_t *body)
+{
+    uint8_t nodes[ARROW_FIELDS * 16];
+    uint8_t buffers[ARROW_MAX_BUFFERS * 16];
+    uint32_t nodes_off;
+    uint32_t buffers_off;
+    uint32_t i;
+
+    for (i = 0; i < fields; i++)
+    {
+        a_put_le64(&nodes[i * 16], length);
+        a_put_le64(&nodes[i * 16 + 8], null_count[i]);
+    }
+    for (i = 0; i < body->count; i++)
+    {
+        a_put_le64(&buffers[i * 16], body->offset[i]);
+        a_put_le64(&buffers[i * 16 + 8], body->length[i]);
+    }
+    nodes_off = a_fb_struct_vector(fb, nodes, 16, fields);
+    buffers_off = a_fb_struct_vector(fb, buffers, 16, body->count);
+    a_fb_start_table(fb);
+    a_fb_add_u64(fb, 0, length);
+    a_fb_add_offset(fb, 1, nodes_off);
+    a_fb_add_offset(fb, 2, buffers_off);
+
+    return a_fb_end_table(fb);
+}
+
+static uint32_t a_arrow_message(arrow_fb_t *fb, uint8_t type, uint32_t header, uint64_t body_length)
+{
+    a_fb_start_table(fb);
+    a_fb_add_u16(fb, 0, ARROW_METADATA_V5);
+    a_fb_add_u8(fb, 1, type);
+    a_fb_add_offset(fb, 2, header);
+    a_fb_add_u64(fb, 3, body_length);
+
+    return a_fb_end_table(fb);
+}
+
+static void a_body_add(arrow_body_t *body, const void *p, uint64_t len)
+{
+    uint64_t pad;
+
+    body->offset[body->count] = body->size;
+    body->length[body->count] = len;
+    body->count++;
+    if (len == 0)
+    {
+        return;
+    }
+    body->iov[body->iovcnt].iov_base = (void *)p;
+    body->iov[body->iovcnt].iov_len = len;
+    body->iovcnt++;
+    body->size += len;
+    pad = (ARROW_ALIGNMENT - (body->size & (ARROW_ALIGNMENT - 1))) & (ARROW_ALIGNMENT - 1);
+    if (pad != 0)
+    {
+        body->iov[body->iovcnt].iov_base = (void *)gs_zero;
+        body->iov[body->iovcnt].iov_len = pad;
+        body->iovcnt++;
+        body->size += pad;
+    }
+}
+
+static uint8_t a_write_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t n;
+
+        n = writev(fd, iov, iovcnt);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return 1;
+        }
+        while ((iovcnt > 0) && ((size_t)n >= iov->iov_len))
+        {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      append one encapsulated message
+ * @param[in]  *w pointer to an arrow writer structure
+ * @param[in]  *fb pointer to the finished message metadata
+ * @param[in]  *body pointer to the message body, may be NULL
+ * @param[out] *block pointer to the written block, may be NULL
+ * @return     status code
+ *             - 0 success
+ *             - 1 write failed
+ * @note       the caller holds the writer lock
+ */
+static uint8_t a_arrow_emit(max30102_arrow_t *w, const arrow_fb_t *fb, arrow_body_t *body, max30102_arrow_block_t *block)
+{
+    struct iovec iov[3 + 2 * ARROW_MAX_BUFFERS];
+    uint8_t prefix[8];
+    uint32_t meta;
+    uint64_t body_size;
+    int iovcnt;
+
+    if ((w->failed != 0) || (fb->failed != 0))
+    {
+        w->failed = 1;
+
+        return 1;
+    }
+    meta = (uint32_t)((fb->head + 7) & ~(size_t)7);
+    a_put_le32(prefix, ARROW_CONTINUATION);
+    a_put_le32(prefix + 4, meta);
+    iov[0].iov_base = prefix;
+    iov[0].iov_len = 8;
+    iov[1].iov_base = fb->buf + fb->cap - fb->head;
+    iov[1].iov_len = fb->head;
+    iov[2].iov_base = (void *)gs_zero;
+    iov[2].iov_len = meta - fb->head;
+    iovcnt = 3;
+    body_size = 0;
+    if (body != NULL)
+    {
+        memcpy(&iov[3], body->iov, (size_t)body->iovcnt * sizeof(struct iovec));
+        iovcnt += body->iovcnt;
+        body_size = body->size;
+    }
+    if (a_write_all(w->fd, iov, iovcnt) != 0)
+    {
+        w->failed = 1;
+
+        return 1;
+    }
+    if (block != NULL)
+    {
+        block->offset = w->offset;
+        block->meta_length = 8 + meta;
+        block->body_length = body_size;
+    }
+    w->offset += 8 + meta + body_size;
+
+    return 0;
+}
+
+/**
+ * @brief     write one utf8 dictionary batch
+ * @param[in] *w pointer to an arrow writer structure
+ * @param[in] id dictionary id
+ * @param[in] *entries pointer to fixed size entries
+ * @param[in] size entry size
+ * @param[in] count number of entries
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ * @note      none
+ */
+static uint8_t a_arrow_dictionary(max30102_arrow_t *w, uint32_t id, const char *entries, size_t size, uint16_t count)
+{
+    arrow_fb_t fb;
+    arrow_body_t body;
+    uint64_t null_count;
+    uint32_t *offsets;
+    char *data;
+    uint32_t batch;
+    uint32_t dict;
+    uint32_t i;
+    uint8_t res;
+
+    offsets = (uint32_t *)malloc(((size_t)count + 1) * sizeof(uint32_t));
+    data = (char *)malloc((size_t)count * size + 1);
+    if ((offsets == NULL) || (data == NULL) || (a_fb_init(&fb) != 0))
+    {
+        free(offsets);
+        free(data);
+
+        return 1;
+    }
+    offsets[0] = 0;
+    for (i = 0; i < count; i++)
+    {
+        size_t n = strlen(entries + i * size);
+
+        memcpy(data + offsets[i], entries + i * size, n);
+        offsets[i + 1] = offsets[i] + (uint32_t)n;
+    }
+    memset(&body, 0, sizeof(body));
+    a_body_add(&body, NULL, 0);
+    a_body_add(&body, offsets, ((uint64_t)count + 1) * sizeof(uint32_t));
+    a_body_add(&body, data, offsets[count]);
+    null_count = 0;
+
+    batch = a_arrow_record_batch(&fb, count, &null_count, 1, &body);
+    a_fb_start_table(&fb);
+    a_fb_add_u64(&fb, 0, id);
+    a_fb_add_offset(&fb, 1, batch);
+    a_fb_add_u8(&fb, 2, 0);
+    dict = a_fb_end_table(&fb);
+    a_fb_finish(&fb, a_arrow_message(&fb, ARROW_HEADER_DICTIONARY_BATCH, dict, body.size));
+    res = a_arrow_emit(w, &fb, &body, &w->dictionaries[id]);
+
+    free(fb.buf);
+    free(offsets);
+    free(data);
+
+    return res;
+}
+
+/**
+ * @brief      format the config dictionary entry of a recording
+ * @param[in]  *header pointer to a record header structure
+ * @param[out] *config pointer to a MAX30102_ARROW_CONFIG_LEN buffer
+ * @note       e.g. "fifo=0x80 mode=0x03 spo2=0x47 led=0x1f,0x1f slot=0x21,0x00 rate_mhz=100000"
+ */
+void max30102_arrow_config_from_header(const max30102_record_header_t *header, char *config)
+{
+    (void)snprintf(config, MAX30102_ARROW_CONFIG_LEN,
+                   "fifo=0x%02x mode=0x%02x spo2=0x%02x led=0x%02x,0x%02x slot=0x%02x,0x%02x rate_mhz=%u",
+                   header->fifo_config, header->mode_config, header->spo2_config,
+                   header->led_pulse[0], header->led_pulse[1], header->multi_led[0], header->multi_led[1],
+                   (unsigned int)header->sample_rate_mhz);
+}
+
+/**
+ * @brief     create an arrow ipc file or stream
+ * @param[in] *w pointer to an arrow writer structure
+ * @param[in] *path pointer to a file path, "-" writes to stdout
+ * @param[in] format output format
+ * @param[in] **devices pointer to the device dictionary
+ * @param[in] device_count number of devices
+ * @param[in] **configs pointer to the config dictionary
+ * @param[in] config_count number of configs
+ * @return    status code
+ *            - 0 success
+ *            - 1 create failed
+ *            - 2 handle is NULL
+ *            - 3 dictionary is invalid
+ * @note      writes the schema and both dictionaries
+ */
+uint8_t max30102_arrow_open(max30102_arrow_t *w, const char *path, max30102_arrow_format_t format,
+                            const char *const *devices, uint16_t device_count,
+                            const char *const *configs, uint16_t config_count)
+{
+    arrow_fb_t fb;
+    uint16_t i;
+    uint8_t res;
+
+    if ((w == NULL) || (path == NULL) || ((devices == NULL) && (device_count != 0)) ||
+        ((configs == NULL) && (config_count != 0)))
+    {
+        return 2;
+    }
+    if ((device_count == 0) || (device_count > MAX30102_ARROW_MAX_DICTIONARY) ||
+        (config_count > MAX30102_ARROW_MAX_DICTIONARY) || (format > MAX30102_ARROW_FORMAT_STREAM))
+    {
+        return 3;
+    }
+
+    memset(w, 0, sizeof(max30102_arrow_t));
+    w->format = (uint8_t)format;
+    w->devices = calloc(device_count, MAX30102_ARROW_DEVICE_LEN);
+    w->configs = calloc((config_count != 0) ? config_count : 1, MAX30102_ARROW_CONFIG_LEN);
+    if ((w->devices == NULL) || (w->configs == NULL))
+    {
+        free(w->devices);
+        free(w->configs);
+
+        return 1;
+    }
+    for (i = 0; i < device_count; i++)
+    {
+        (void)snprintf(w->devices[i], MAX30102_ARROW_DEVICE_LEN, "%s", devices[i]);
+    }
+    for (i = 0; i < config_count; i++)
+    {
+        (void)snprintf(w->configs[i], MAX30102_ARROW_CONFIG_LEN, "%s", configs[i]);
+    }
+    w->device_count = device_count;
+    w->config_count = config_count;
+
+    if (strcmp(path, "-") == 0)
+    {
+        w->fd = STDOUT_FILENO;
+    }
+    else
+    {
+        w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (w->fd < 0)
+    {
+        free(w->devices);
+        free(w->configs);
+
+        return 1;
+    }
+    (void)pthread_mutex_init(&w->lock, NULL);
+
+    res = 0;
+    if (w->format == MAX30102_ARROW_FORMAT_FILE)
+    {
+        struct iovec iov = {(void *)gs_magic, sizeof(gs_magic)};
+
+        res = a_write_all(w->fd, &iov, 1);
+        w->offset = sizeof(gs_magic);
+    }
+    if ((res == 0) && (a_fb_init(&fb) == 0))
+    {
+        uint32_t schema;
+
+        schema = a_arrow_schema(&fb);
+        a_fb_finish(&fb, a_arrow_message(&fb, ARROW_HEADER_SCHEMA, schema, 0));
+        res = a_arrow_emit(w, &fb, NULL, NULL);
+        free(fb.buf);
+    }
+    else
+    {
+        res = 1;
+    }
+    if (res == 0)
+    {
+        res = a_arrow_dictionary(w, 0, &w->devices[0][0], MAX30102_ARROW_DEVICE_LEN, w->device_count);
+    }
+    if (res == 0)
+    {
+        res = a_arrow_dictionary(w, 1, &w->configs[0][0], MAX30102_ARROW_CONFIG_LEN, w->config_count);
+    }
+    if (res != 0)
+    {
+        if (w->fd != STDOUT_FILENO)
+        {
+            (void)close(w->fd);
+        }
+        (void)pthread_mutex_destroy(&w->lock);
+        free(w->devices);
+        free(w->configs);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     append one record batch
+ * @param[in] *w pointer to an arrow writer structure
+ * @param[in] device device dictionary index
+ * @param[in] config config dictionary index, -1 for null
+ * @param[in] *timestamp_ns pointer to utc timestamps in ns
+ * @param[in] *red pointer to red samples
+ * @param[in] *ir pointer to ir samples, NULL for null
+ * @param[in] count number of rows
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ *            - 2 handle is NULL
+ *            - 3 index is invalid
+ * @note      thread safe, the batch is encoded by the caller and appended
+ *            under the writer lock with one writev
+ */
+uint8_t max30102_arrow_write(max30102_arrow_t *w, uint16_t device, int32_t config,
+                             const int64_t *timestamp_ns, const uint32_t *red, const uint32_t *ir, uint32_t count)
+{
+    arrow_fb_t fb;
+    arrow_body_t body;
+    uint64_t null_count[ARROW_FIELDS];
+    uint8_t *scratch;
+    int16_t *device_index;
+    int16_t *config_index;
+    uint8_t *validity;
+    uint32_t *ir_values;
+    size_t bitmap;
+    uint32_t i;
+    uint8_t res;
+
+    if ((w == NULL) || (timestamp_ns == NULL) || (red == NULL))
+    {
+        return 2;
+    }
+    if ((device >= w->device_count) || (config >= (int32_t)w->config_count))
+    {
+        return 3;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    /* dictionary indices, an all null validity bitmap and zero values for a null ir column */
+    bitmap = ((size_t)count + 7) / 8;
+    scratch = (uint8_t *)calloc(1, 4 * (size_t)count + bitmap + ((ir == NULL) ? 4 * (size_t)count : 0));
+    if ((scratch == NULL) || (a_fb_init(&fb) != 0))
+    {
+        free(scratch);
+
+        return 1;
+    }
+    device_index = (int16_t *)scratch;
+    config_index = device_index + count;
+    validity = (uint8_t *)(config_index + count);
+    ir_values = (ir == NULL) ? (uint32_t *)(scratch + 4 * (size_t)count + bitmap) : (uint32_t *)ir;
+    for (i = 0; i < count; i++)
+    {
+        device_index[i] = (int16_t)device;
+        config_index[i] = (int16_t)((config < 0) ? 0 : config);
+    }
+
+    memset(&body, 0, sizeof(body));
+    a_body_add(&body, NULL, 0);
+    a_body_add(&body, timestamp_ns, (uint64_t)count * sizeof(int64_t));
+    a_body_add(&body, NULL, 0);
+    a_body_add(&body, device_index, (uint64_t)count * sizeof(int16_t));
+    a_body_add(&body, NULL, 0);
+    a_body_add(&body, red, (uint64_t)count * sizeof(uint32_t));
+    a_body_add(&body, (ir == NULL) ? validity : NULL, (ir == NULL) ? bitmap : 0);
+    a_body_add(&body, ir_values, (uint64_t)count * sizeof(uint32_t));
+    a_body_add(&body, (config < 0) ? validity : NULL, (config < 0) ? bitmap : 0);
+    a_body_add(&body, config_index, (uint64_t)count * sizeof(int16_t));
+    null_count[0] = 0;
+    null_count[1] = 0;
+    null_count[2] = 0;
+    null_count[3] = (ir == NULL) ? count : 0;
+    null_count[4] = (config < 0) ? count : 0;
+
+    a_fb_finish(&fb, a_arrow_message(&fb, ARROW_HEADER_RECORD_BATCH,
+                                     a_arrow_record_batch(&fb, count, null_count, ARROW_FIELDS, &body), body.size));
+
+    (void)pthread_mutex_lock(&w->lock);
+    res = 0;
+    if (w->batch_count == w->batch_capacity)
+    {
+        uint32_t capacity = (w->batch_capacity != 0) ? w->batch_capacity * 2 : 64;
+        max30102_arrow_block_t *batches;
+
+        batches = (max30102_arrow_block_t *)realloc(w->batches, capacity * sizeof(max30102_arrow_block_t));
+        if (batches == NULL)
+        {
+            res = 1;
+        }
+        else
+        {
+            w->batches = batches;
+            w->batch_capacity = capacity;
+        }
+    }
+    if ((res == 0) && (a_arrow_emit(w, &fb, &body, &w->batches[w->batch_count]) == 0))
+    {
+        w->batch_count++;
+        w->rows += count;
+    }
+    else
+    {
+        res = 1;
+    }
+    (void)pthread_mutex_unlock(&w->lock);
+
+    free(fb.buf);
+    free(scratch);
+
+    return res;
+}
+
+/**
+ * @brief     finish the stream and write the footer
+ * @param[in] *w pointer to an arrow writer structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 close failed
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_arrow_close(max30102_arrow_t *w)
+{
+    uint8_t eos[8];
+    struct iovec iov[4];
+    uint8_t res;
+
+    if (w == NULL)
+    {
+        return 2;
+    }
+
+    res = w->failed;
+    a_put_le32(eos, ARROW_CONTINUATION);
+    a_put_le32(eos + 4, 0);
+    iov[0].iov_base = eos;
+    iov[0].iov_len = sizeof(eos);
+    if ((res == 0) && (w->format == MAX30102_ARROW_FORMAT_FILE))
+    {
+        arrow_fb_t fb;
+        uint8_t *blocks;
+        uint8_t size[4];
+        uint32_t schema;
+        uint32_t dicts;
+        uint32_t batches;
+        uint32_t footer;
+        uint32_t i;
+
+        blocks = (uint8_t *)malloc(((size_t)w->batch_count + 2) * 24);
+        if ((blocks == NULL) || (a_fb_init(&fb) != 0))
+        {
+            free(blocks);
+            res = 1;
+        }
+        else
+        {
+            memset(blocks, 0, ((size_t)w->batch_count + 2) * 24);
+            for (i = 0; i < w->batch_count + 2; i++)
+            {
+                const max30102_arrow_block_t *b = (i < 2) ? &w->dictionaries[i] : &w->batches[i - 2];
+
+                a_put_le64(&blocks[i * 24], b->offset);
+                a_put_le32(&blocks[i * 24 + 8], b->meta_length);
+                a_put_le64(&blocks[i * 24 + 16], b->body_length);
+            }
+            schema = a_arrow_schema(&fb);
+            dicts = a_fb_struct_vector(&fb, blocks, 24, 2);
+            batches = a_fb_struct_vector(&fb, blocks + 48, 24, w->batch_count);
+            a_fb_start_table(&fb);
+            a_fb_add_u16(&fb, 0, ARROW_METADATA_V5);
+            a_fb_add_offset(&fb, 1, schema);
+            a_fb_add_offset(&fb, 2, dicts);
+            a_fb_add_offset(&fb, 3, batches);
+            footer = a_fb_end_table(&fb);
+            a_fb_finish(&fb, footer);
+
+            a_put_le32(size, (uint32_t)fb.head);
+            iov[1].iov_base = fb.buf + fb.cap - fb.head;
+            iov[1].iov_len = fb.head;
+            iov[2].iov_base = size;
+            iov[2].iov_len = sizeof(size);
+            iov[3].iov_base = (void *)gs_magic;
+            iov[3].iov_len = 6;
+            res = fb.failed | a_write_all(w->fd, iov, 4);
+            free(fb.buf);
+            free(blocks);
+        }
+    }
+    else if (res == 0)
+    {
+        res = a_write_all(w->fd, iov, 1);
+    }
+    else
+    {
+        /* keep the error */
+    }
+    if (w->fd != STDOUT_FILENO)
+    {
+        if ((res == 0) && (fdatasync(w->fd) != 0) && (errno != EINVAL))
+        {
+            res = 1;
+        }
+        if (close(w->fd) != 0)
+        {
+            res = 1;
+        }
+    }
+    (void)pthread_mutex_destroy(&w->lock);
+    free(w->batches);
+    free(w->devices);
+    free(w->configs);
+    w->batches = NULL;
+    w->devices = NULL;
+    w->configs = NULL;
+
+    return (res != 0) ? 1 : 0;
+}
+
+/**
+ * @brief     find or add a dictionary entry
+ * @param[in] *entries pointer to fixed size entries
+ * @param[in] size entry size
+ * @param[in] *count pointer to the number of entries
+ * @param[in] *value pointer to the entry
+ * @return    entry index, -1 if the dictionary is full
+ * @note      linear search, dictionaries hold a few devices and configs
+ */
+static int32_t a_arrow_intern(char *entries, size_t size, uint16_t *count, const char *value)
+{
+    uint16_t i;
+
+    for (i = 0; i < *count; i++)
+    {
+        if (strncmp(entries + i * size, value, size - 1) == 0)
+        {
+            return i;
+        }
+    }
+    if (*count == MAX30102_ARROW_MAX_DICTIONARY)
+    {
+        return -1;
+    }
+    (void)snprintf(entries + (size_t)(*count) * size, size, "%s", value);
+    (*count)++;
+
+    return *count - 1;
+}
+
+/**
+ * @brief     export worker
+ * @param[in] *arg pointer to the export state
+ * @return    NULL
+ * @note      each worker owns a reader and one batch of column buffers,
+ *            timestamps are the recording start time plus the sample
+ *            offset from the first sample of the recording
+ */
+static void *a_arrow_export_worker(void *arg)
+{
+    arrow_export_t *e = (arrow_export_t *)arg;
+    max30102_record_reader_t *rd;
+    int64_t *ts;
+    uint32_t *red;
+    uint32_t *ir;
+    uint8_t res;
+
+    rd = (max30102_record_reader_t *)malloc(sizeof(max30102_record_reader_t));
+    ts = (int64_t *)malloc(MAX30102_ARROW_BATCH_ROWS * sizeof(int64_t));
+    red = (uint32_t *)malloc(MAX30102_ARROW_BATCH_ROWS * sizeof(uint32_t));
+    ir = (uint32_t *)malloc(MAX30102_ARROW_BATCH_ROWS * sizeof(uint32_t));
+    res = ((rd == NULL) || (ts == NULL) || (red == NULL) || (ir == NULL)) ? 1 : 0;
+
+    while (res == 0)
+    {
+        uint64_t t0;
+        uint64_t wall;
+        uint32_t input;
+        uint32_t n;
+        uint8_t ir_valid;
+
+        (void)pthread_mutex_lock(&e->lock);
+        input = e->next++;
+        res = e->res;
+        (void)pthread_mutex_unlock(&e->lock);
+        if ((input >= e->input_count) || (res != 0))
+        {
+            break;
+        }
+
+        res = max30102_record_reader_open(rd, e->inputs[input]);
+        if (res != 0)
+        {
+            res = (res == 3) ? 3 : 1;
+
+            break;
+        }
+        t0 = (rd->chunk_count != 0) ? rd->index[0].t_first : 0;
+        wall = rd->header.start_time_ns;
+        ir_valid = (rd->header.channels > 1) ? 1 : 0;
+        n = 0;
+        while (res == 0)
+        {
+            uint32_t len;
+            uint32_t pos;
+            uint32_t i;
+            uint8_t r;
+
+            len = MAX30102_ARROW_BATCH_ROWS - n;
+            r = max30102_record_reader_read(rd, red + n, ir + n, &len, NULL);
+            if (r == 0)
+            {
+                /* samples are evenly spaced between the chunk timestamps */
+                pos = rd->pos - len;
+                for (i = 0; i < len; i++)
+                {
+                    uint64_t t = rd->info.t_first;
+
+                    if (rd->info.count > 1)
+                    {
+                        t += (rd->info.t_last - rd->info.t_first) * (pos + i) / (rd->info.count - 1);
+                    }
+                    ts[n + i] = (int64_t)(wall + (t - t0));
+                }
+                n += len;
+            }
+            else if (r != 4)
+            {
+                res = 1;
+            }
+            else
+            {
+                /* end of file */
+            }
+            if ((res == 0) && ((n == MAX30102_ARROW_BATCH_ROWS) || ((r == 4) && (n != 0))))
+            {
+                res = max30102_arrow_write(e->w, e->device[input], e->config[input], ts, red,
+                                           (ir_valid != 0) ? ir : NULL, n);
+                n = 0;
+            }
+            if (r == 4)
+            {
+                break;
+            }
+        }
+        (void)max30102_record_reader_close(rd);
+    }
+
+    if (res != 0)
+    {
+        (void)pthread_mutex_lock(&e->lock);
+        if (e->res == 0)
+        {
+            e->res = res;
+        }
+        (void)pthread_mutex_unlock(&e->lock);
+    }
+    free(rd);
+    free(ts);
+    free(red);
+    free(ir);
+
+    return NULL;
+}
+
+/**
+ * @brief      export recordings to one arrow ipc file
+ * @param[in]  **inputs pointer to recording paths
+ * @param[in]  input_count number of recordings
+ * @param[in]  *output pointer to the output path
+ * @param[in]  threads number of worker threads, 0 uses one per cpu
+ * @param[out] *rows pointer to the exported row count, may be NULL
+ * @return     status code
+ *             - 0 success
+ *             - 1 export failed
+ *             - 2 handle is NULL
+ *             - 3 input is invalid
+ * @note       workers take whole recordings, devices and configs are
+ *             collected from the file headers before any samples are read
+ */
+uint8_t max30102_arrow_export(const char *const *inputs, uint32_t input_count, const char *output, uint32_t threads, uint64_t *rows)
+{
+    max30102_arrow_t w;
+    arrow_export_t e;
+    pthread_t *tid;
+    const char **devices;
+    const char **configs;
+    char (*device_names)[MAX30102_ARROW_DEVICE_LEN];
+    char (*config_names)[MAX30102_ARROW_CONFIG_LEN];
+    uint16_t device_count;
+    uint16_t config_count;
+    uint32_t started;
+    uint32_t i;
+    uint8_t res;
+
+    if ((inputs == NULL) || (output == NULL))
+    {
+        return 2;
+    }
+    if (input_count == 0)
+    {
+        return 3;
+    }
+    if (threads == 0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = (n > 0) ? (uint32_t)n : 1;
+    }
+    if (threads > input_count)
+    {
+        threads = input_count;
+    }
+
+    memset(&e, 0, sizeof(e));
+    e.device = (uint16_t *)malloc(input_count * sizeof(uint16_t));
+    e.config = (uint16_t *)malloc(input_count * sizeof(uint16_t));
+    device_names = calloc(MAX30102_ARROW_MAX_DICTIONARY, MAX30102_ARROW_DEVICE_LEN);
+    config_names = calloc(MAX30102_ARROW_MAX_DICTIONARY, MAX30102_ARROW_CONFIG_LEN);
+    devices = (const char **)malloc(MAX30102_ARROW_MAX_DICTIONARY * sizeof(char *));
+    configs = (const char **)malloc(MAX30102_ARROW_MAX_DICTIONARY * sizeof(char *));
+    tid = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    res = ((e.device == NULL) || (e.config == NULL) || (device_names == NULL) || (config_names == NULL) ||
+           (devices == NULL) || (configs == NULL) || (tid == NULL)) ? 1 : 0;
+
+    /* dictionaries from the file headers */
+    device_count = 0;
+    config_count = 0;
+    for (i = 0; (res == 0) && (i < input_count); i++)
+    {
+        max30102_record_header_t header;
+        char config[MAX30102_ARROW_CONFIG_LEN];
+        int32_t d;
+        int32_t c;
+
+        res = max30102_record_read_header(inputs[i], &header);
+        if (res != 0)
+        {
+            res = (res == 3) ? 3 : 1;
+
+            break;
+        }
+        max30102_arrow_config_from_header(&header, config);
+        d = a_arrow_intern(&device_names[0][0], MAX30102_ARROW_DEVICE_LEN, &device_count, header.device);
+        c = a_arrow_intern(&config_names[0][0], MAX30102_ARROW_CONFIG_LEN, &config_count, config);
+        if ((d < 0) || (c < 0))
+        {
+            res = 3;
+
+            break;
+        }
+        e.device[i] = (uint16_t)d;
+        e.config[i] = (uint16_t)c;
+    }
+    for (i = 0; i < device_count; i++)
+    {
+        devices[i] = device_names[i];
+    }
+    for (i = 0; i < config_count; i++)
+    {
+        configs[i] = config_names[i];
+    }
+    if (res == 0)
+    {
+        res = max30102_arrow_open(&w, output, MAX30102_ARROW_FORMAT_FILE, devices, device_count, configs, config_count);
+        res = (res != 0) ? 1 : 0;
+    }
+
+    if (res == 0)
+    {
+        e.w = &w;
+        e.inputs = inputs;
+        e.input_count = input_count;
+        (void)pthread_mutex_init(&e.lock, NULL);
+        for (started = 0; started < threads; started++)
+        {
+            if (pthread_create(&tid[started], NULL, a_arrow_export_worker, &e) != 0)
+            {
+                break;
+            }
+        }
+        if (started == 0)
+        {
+            e.res = 1;
+        }
+        for (i = 0; i < started; i++)
+        {
+            (void)pthread_join(tid[i], NULL);
+        }
+        (void)pthread_mutex_destroy(&e.lock);
+        res = e.res;
+        if (rows != NULL)
+        {
+            *rows = w.rows;
+        }
+        if ((max30102_arrow_close(&w) != 0) && (res == 0))
+        {
+            res = 1;
+        }
+    }
+
+    free(e.device);
+    free(e.config);
+    free(device_names);
+    free(config_names);
+    free(devices);
+    free(configs);
+    free(tid);
+
+    return res;
+}
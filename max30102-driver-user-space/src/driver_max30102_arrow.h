@@ -0,0 +1,159 @@
+
+#ifndef DRIVER_MAX30102_ARROW_H
+#define DRIVER_MAX30102_ARROW_H
+
+#include "driver_max30102_record.h"
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @defgroup max30102_arrow_driver max30102 arrow driver function
+ * @brief    max30102 arrow driver modules
+ * @ingroup  max30102_driver
+ * @{
+ */
+
+/**
+ * @brief max30102 arrow schema
+ * @note  timestamp  timestamp[ns, tz=UTC]           not null
+ *        device     dictionary<int16, utf8> id 0    not null
+ *        red        uint32                          not null
+ *        ir         uint32                          null for one channel recordings
+ *        config     dictionary<int16, utf8> id 1    null if unknown
+ *        files use the arrow ipc file format (metadata version 5) with the
+ *        dictionaries written once before the first record batch, buffers
+ *        are 64 byte aligned and uncompressed so the file can be mmapped
+ */
+#define MAX30102_ARROW_BATCH_ROWS         65536        /**< rows per record batch written by the exporter */
+#define MAX30102_ARROW_DEVICE_LEN         32           /**< device dictionary entry size */
+#define MAX30102_ARROW_CONFIG_LEN         96           /**< config dictionary entry size */
+#define MAX30102_ARROW_MAX_DICTIONARY     4096         /**< max entries per dictionary */
+
+/**
+ * @brief max30102 arrow format enumeration definition
+ */
+typedef enum
+{
+    MAX30102_ARROW_FORMAT_FILE   = 0x00,        /**< arrow ipc file, seekable output with footer */
+    MAX30102_ARROW_FORMAT_STREAM = 0x01,        /**< arrow ipc stream, works on pipes */
+} max30102_arrow_format_t;
+
+/**
+ * @brief max30102 arrow block structure definition
+ */
+typedef struct max30102_arrow_block_s
+{
+    uint64_t offset;                  /**< file offset of the message */
+    uint32_t meta_length;             /**< prefix and metadata bytes */
+    uint64_t body_length;             /**< body bytes */
+} max30102_arrow_block_t;
+
+/**
+ * @brief max30102 arrow writer structure definition
+ */
+typedef struct max30102_arrow_s
+{
+    int fd;                                                         /**< file descriptor */
+    uint8_t format;                                                 /**< max30102_arrow_format_t */
+    uint8_t failed;                                                 /**< set after a write error */
+    pthread_mutex_t lock;                                           /**< serialises appends */
+    uint64_t offset;                                                /**< append offset */
+    uint64_t rows;                                                  /**< rows written */
+    uint16_t device_count;                                          /**< device dictionary entries */
+    uint16_t config_count;                                          /**< config dictionary entries */
+    char (*devices)[MAX30102_ARROW_DEVICE_LEN];                     /**< device dictionary */
+    char (*configs)[MAX30102_ARROW_CONFIG_LEN];                     /**< config dictionary */
+    max30102_arrow_block_t dictionaries[2];                         /**< dictionary batch blocks */
+    max30102_arrow_block_t *batches;                                /**< record batch blocks */
+    uint32_t batch_count;                                           /**< record batches written */
+    uint32_t batch_capacity;                                        /**< allocated record batch blocks */
+} max30102_arrow_t;
+
+/**
+ * @brief      format the config dictionary entry of a recording
+ * @param[in]  *header pointer to a record header structure
+ * @param[out] *config pointer to a MAX30102_ARROW_CONFIG_LEN buffer
+ * @note       e.g. "fifo=0x80 mode=0x03 spo2=0x47 led=0x1f,0x1f slot=0x21,0x00 rate_mhz=100000"
+ */
+void max30102_arrow_config_from_header(const max30102_record_header_t *header, char *config);
+
+/**
+ * @brief     create an arrow ipc file or stream
+ * @param[in] *w pointer to an arrow writer structure
+ * @param[in] *path pointer to a file path, "-" writes to stdout
+ * @param[in] format output format
+ * @param[in] **devices pointer to the device dictionary
+ * @param[in] device_count number of devices
+ * @param[in] **configs pointer to the config dictionary
+ * @param[in] config_count number of configs
+ * @return    status code
+ *            - 0 success
+ *            - 1 create failed
+ *            - 2 handle is NULL
+ *            - 3 dictionary is invalid
+ * @note      writes the schema and both dictionaries
+ */
+uint8_t max30102_arrow_open(max30102_arrow_t *w, const char *path, max30102_arrow_format_t format,
+                            const char *const *devices, uint16_t device_count,
+                            const char *const *configs, uint16_t config_count);
+
+/**
+ * @brief     append one record batch
+ * @param[in] *w pointer to an arrow writer structure
+ * @param[in] device device dictionary index
+ * @param[in] config config dictionary index, -1 for null
+ * @param[in] *timestamp_ns pointer to utc timestamps in ns
+ * @param[in] *red pointer to red samples
+ * @param[in] *ir pointer to ir samples, NULL for null
+ * @param[in] count number of rows
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ *            - 2 handle is NULL
+ *            - 3 index is invalid
+ * @note      thread safe, the batch is encoded by the caller and appended
+ *            under the writer lock with one writev
+ */
+uint8_t max30102_arrow_write(max30102_arrow_t *w, uint16_t device, int32_t config,
+                             const int64_t *timestamp_ns, const uint32_t *red, const uint32_t *ir, uint32_t count);
+
+/**
+ * @brief     finish the stream and write the footer
+ * @param[in] *w pointer to an arrow writer structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 close failed
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_arrow_close(max30102_arrow_t *w);
+
+/**
+ * @brief      export recordings to one arrow ipc file
+ * @param[in]  **inputs pointer to recording paths
+ * @param[in]  input_count number of recordings
+ * @param[in]  *output pointer to the output path
+ * @param[in]  threads number of worker threads, 0 uses one per cpu
+ * @param[out] *rows pointer to the exported row count, may be NULL
+ * @return     status code
+ *             - 0 success
+ *             - 1 export failed
+ *             - 2 handle is NULL
+ *             - 3 input is invalid
+ * @note       workers take whole recordings, devices and configs are
+ *             collected from the file headers before any samples are read
+ */
+uint8_t max30102_arrow_export(const char *const *inputs, uint32_t input_count, const char *output, uint32_t threads, uint64_t *rows);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,489 @@
+
+
+#include "driver_max30102_codec.h"
+#include <stddef.h>
+
+/**
+ * @brief codec bit writer structure definition
+ */
+typedef struct codec_writer_s
+{
+    uint8_t *p;              /**< write pointer */
+    uint8_t *end;            /**< buffer end */
+    uint64_t acc;            /**< bit accumulator */
+    uint32_t n;              /**< pending bits in the accumulator */
+    uint8_t overflow;        /**< set if the buffer is too small */
+} codec_writer_t;
+
+/**
+ * @brief codec bit reader structure definition
+ */
+typedef struct codec_reader_s
+{
+    const uint8_t *p;        /**< read pointer */
+    const uint8_t *end;      /**< buffer end */
+    uint64_t buf;            /**< msb aligned bit buffer */
+    uint32_t n;              /**< valid bits in the buffer */
+    uint32_t pad;            /**< zero bytes fed past the end */
+} codec_reader_t;
+
+/**
+ * @brief codec adaptive rice state structure definition
+ */
+typedef struct codec_rice_s
+{
+    uint32_t a;              /**< running sum of coded values */
+    uint32_t n;              /**< running count */
+} codec_rice_t;
+
+static void a_codec_put(codec_writer_t *w, uint32_t v, uint32_t bits)
+{
+    w->acc = (w->acc << bits) | v;
+    w->n += bits;
+    if (w->n >= 32)
+    {
+        uint32_t word;
+
+        w->n -= 32;
+        word = (uint32_t)(w->acc >> w->n);
+        if ((w->end - w->p) < 4)
+        {
+            w->overflow = 1;
+
+            return;
+        }
+        w->p[0] = (uint8_t)(word >> 24);
+        w->p[1] = (uint8_t)(word >> 16);
+        w->p[2] = (uint8_t)(word >> 8);
+        w->p[3] = (uint8_t)(word >> 0);
+        w->p += 4;
+    }
+}
+
+static void a_codec_flush(codec_writer_t *w)
+{
+    while (w->n > 0)
+    {
+        uint32_t bits;
+
+        bits = (w->n >= 8) ? 8 : w->n;
+        if (w->p >= w->end)
+        {
+            w->overflow = 1;
+
+            return;
+        }
+        *w->p++ = (uint8_t)((w->acc >> (w->n - bits)) << (8 - bits));
+        w->n -= bits;
+    }
+}
+
+static void a_codec_refill(codec_reader_t *r)
+{
+    while (r->n <= 56)
+    {
+        uint64_t byte;
+
+        if (r->p < r->end)
+        {
+            byte = *r->p++;
+        }
+        else
+        {
+            byte = 0;
+            r->pad++;
+        }
+        r->buf |= byte << (56 - r->n);
+        r->n += 8;
+    }
+}
+
+static uint32_t a_codec_get(codec_reader_t *r, uint32_t bits)
+{
+    uint32_t v;
+
+    if (bits == 0)
+    {
+        return 0;
+    }
+    v = (uint32_t)(r->buf >> (64 - bits));
+    r->buf <<= bits;
+    r->n -= bits;
+
+    return v;
+}
+
+static uint32_t a_codec_rice_k(const codec_rice_t *s)
+{
+    uint32_t k;
+
+    k = 0;
+    while (((s->n << k) < s->a) && (k < MAX30102_CODEC_RAW_BITS))
+    {
+        k++;
+    }
+
+    return k;
+}
+
+static void a_codec_rice_update(codec_rice_t *s, uint32_t u)
+{
+    s->a += u;
+    s->n++;
+    if (s->n >= 32)
+    {
+        s->a >>= 1;
+        s->n >>= 1;
+    }
+}
+
+/**
+ * @brief     fixed polynomial prediction
+ * @param[in] *x pointer to the channel samples ending at n - 1
+ * @param[in] order predictor order
+ * @return    prediction, modulo 2^32
+ * @note      order 1..3 extrapolates a constant, line and parabola
+ */
+static inline uint32_t a_codec_predict(const uint32_t *x, uint8_t order)
+{
+    switch (order)
+    {
+        case 1 :
+        {
+            return x[-1];
+        }
+        case 2 :
+        {
+            return 2 * x[-1] - x[-2];
+        }
+        case 3 :
+        {
+            return 3 * x[-1] - 3 * x[-2] + x[-3];
+        }
+        default :
+        {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief      pick the predictor order with the smallest residual sum
+ * @param[in]  *a pointer to the first operand
+ * @param[in]  *b pointer to the subtrahend, may be NULL
+ * @param[in]  count number of samples
+ * @param[out] *cost pointer to the residual sum of the chosen order
+ * @return     predictor order
+ * @note       the channel is a - b
+ */
+static uint8_t a_codec_choose_order(const uint32_t *a, const uint32_t *b, uint32_t count, uint64_t *cost)
+{
+    uint64_t sum[MAX30102_CODEC_MAX_ORDER + 1] = {0};
+    int32_t x1;
+    int32_t d1;
+    int32_t d2;
+    uint32_t i;
+    uint8_t order;
+
+    if (count <= MAX30102_CODEC_MAX_ORDER)
+    {
+        *cost = 0;
+
+        return 0;
+    }
+
+    /* running differences give the residual of every order at once */
+    x1 = (int32_t)(a[2] - ((b != NULL) ? b[2] : 0));
+    d1 = x1 - (int32_t)(a[1] - ((b != NULL) ? b[1] : 0));
+    d2 = d1 - ((int32_t)(a[1] - ((b != NULL) ? b[1] : 0)) - (int32_t)(a[0] - ((b != NULL) ? b[0] : 0)));
+    for (i = MAX30102_CODEC_MAX_ORDER; i < count; i++)
+    {
+        int32_t e0;
+        int32_t e1;
+        int32_t e2;
+        int32_t e3;
+
+        e0 = (int32_t)(a[i] - ((b != NULL) ? b[i] : 0));
+        e1 = e0 - x1;
+        e2 = e1 - d1;
+        e3 = e2 - d2;
+        sum[0] += (uint64_t)((e0 < 0) ? -(int64_t)e0 : e0);
+        sum[1] += (uint64_t)((e1 < 0) ? -(int64_t)e1 : e1);
+        sum[2] += (uint64_t)((e2 < 0) ? -(int64_t)e2 : e2);
+        sum[3] += (uint64_t)((e3 < 0) ? -(int64_t)e3 : e3);
+        x1 = e0;
+        d1 = e1;
+        d2 = e2;
+    }
+
+    order = 0;
+    for (i = 1; i <= MAX30102_CODEC_MAX_ORDER; i++)
+    {
+        if (sum[i] < sum[order])
+        {
+            order = (uint8_t)i;
+        }
+    }
+    *cost = sum[order];
+
+    return order;
+}
+
+/**
+ * @brief     encode one channel
+ * @param[in] *w pointer to a bit writer
+ * @param[in] *a pointer to the first operand
+ * @param[in] *b pointer to the subtrahend, may be NULL
+ * @param[in] count number of samples
+ * @param[in] order predictor order
+ * @note      the channel is a - b
+ */
+static void a_codec_encode_channel(codec_writer_t *w, const uint32_t *a, const uint32_t *b, uint32_t count, uint8_t order)
+{
+    uint32_t hist[MAX30102_CODEC_MAX_ORDER];
+    codec_rice_t rice = {16, 1};
+    uint32_t i;
+    uint8_t j;
+
+    /* warm up samples */
+    for (i = 0; (i < order) && (i < count); i++)
+    {
+        hist[i] = a[i] - ((b != NULL) ? b[i] : 0);
+        a_codec_put(w, hist[i] & 0xFFFFFFU, MAX30102_CODEC_RAW_BITS);
+    }
+
+    for (; i < count; i++)
+    {
+        uint32_t x;
+        int32_t e;
+        uint32_t u;
+        uint32_t k;
+        uint32_t q;
+
+        x = a[i] - ((b != NULL) ? b[i] : 0);
+        e = (int32_t)(x - a_codec_predict(&hist[order], order));
+        for (j = 1; j < order; j++)
+        {
+            hist[j - 1] = hist[j];
+        }
+        if (order != 0)
+        {
+            hist[order - 1] = x;
+        }
+
+        u = ((uint32_t)e << 1) ^ (uint32_t)(e >> 31);
+        k = a_codec_rice_k(&rice);
+        q = u >> k;
+        if (q < MAX30102_CODEC_ESCAPE)
+        {
+            a_codec_put(w, 1, q + 1);
+            if (k != 0)
+            {
+                a_codec_put(w, u & ((1U << k) - 1), k);
+            }
+        }
+        else
+        {
+            a_codec_put(w, 0, MAX30102_CODEC_ESCAPE);
+            a_codec_put(w, u & 0xFFFFFFU, MAX30102_CODEC_RAW_BITS);
+        }
+        a_codec_rice_update(&rice, u);
+    }
+}
+
+/**
+ * @brief      decode one channel
+ * @param[in]  *r pointer to a bit reader
+ * @param[out] *x pointer to the output samples
+ * @param[in]  count number of samples
+ * @param[in]  order predictor order
+ * @param[in]  warm_signed 1 if warm up samples are signed 24 bit values
+ * @note       none
+ */
+static void a_codec_decode_channel(codec_reader_t *r, uint32_t *x, uint32_t count, uint8_t order, uint8_t warm_signed)
+{
+    codec_rice_t rice = {16, 1};
+    uint32_t i;
+
+    for (i = 0; (i < order) && (i < count); i++)
+    {
+        a_codec_refill(r);
+        x[i] = a_codec_get(r, MAX30102_CODEC_RAW_BITS);
+        if ((warm_signed != 0) && ((x[i] & 0x800000U) != 0))
+        {
+            x[i] |= 0xFF000000U;
+        }
+    }
+
+    for (; i < count; i++)
+    {
+        uint32_t u;
+        uint32_t k;
+        uint32_t q;
+
+        a_codec_refill(r);
+        k = a_codec_rice_k(&rice);
+        q = (r->buf != 0) ? (uint32_t)__builtin_clzll(r->buf) : 64;
+        if (q < MAX30102_CODEC_ESCAPE)
+        {
+            (void)a_codec_get(r, q + 1);
+            u = (q << k) | a_codec_get(r, k);
+        }
+        else
+        {
+            (void)a_codec_get(r, MAX30102_CODEC_ESCAPE);
+            u = a_codec_get(r, MAX30102_CODEC_RAW_BITS);
+        }
+        a_codec_rice_update(&rice, u);
+        x[i] = a_codec_predict(&x[i], order) + ((u >> 1) ^ (0U - (u & 1)));
+    }
+}
+
+/**
+ * @brief         encode one block
+ * @param[in]     *red pointer to a red samples buffer
+ * @param[in]     *ir pointer to an ir samples buffer, ignored for one channel
+ * @param[in]     count number of samples per channel
+ * @param[in]     channels 1 (red) or 2 (red and ir)
+ * @param[out]    *out pointer to an output buffer
+ * @param[in,out] *size pointer to the buffer capacity, returns the encoded size
+ * @param[out]    *info pointer to a block information structure, may be NULL
+ * @return        status code
+ *                - 0 success
+ *                - 1 buffer is too small
+ *                - 2 buffer is NULL
+ *                - 3 sample is over 18 bits or channels is invalid
+ * @note          a capacity of MAX30102_CODEC_BOUND(count, channels) never fails
+ */
+uint8_t max30102_codec_encode(const uint32_t *red, const uint32_t *ir, uint32_t count, uint8_t channels,
+                              uint8_t *out, uint32_t *size, max30102_codec_info_t *info)
+{
+    codec_writer_t w;
+    max30102_codec_info_t block;
+    uint64_t cost_ir;
+    uint64_t cost_side;
+    uint32_t i;
+    uint8_t order_side;
+
+    if ((red == NULL) || (out == NULL) || (size == NULL) || ((channels > 1) && (ir == NULL)))
+    {
+        return 2;
+    }
+    if ((channels < 1) || (channels > 2))
+    {
+        return 3;
+    }
+    if (*size < 1)
+    {
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if ((red[i] > MAX30102_CODEC_SAMPLE_MASK) || ((channels > 1) && (ir[i] > MAX30102_CODEC_SAMPLE_MASK)))
+        {
+            return 3;
+        }
+    }
+
+    /* predictor per channel, ir or ir - red whichever is cheaper */
+    block.order[0] = a_codec_choose_order(red, NULL, count, &cost_ir);
+    block.order[1] = 0;
+    block.side = 0;
+    if (channels > 1)
+    {
+        block.order[1] = a_codec_choose_order(ir, NULL, count, &cost_ir);
+        order_side = a_codec_choose_order(ir, red, count, &cost_side);
+        if (cost_side < cost_ir)
+        {
+            block.order[1] = order_side;
+            block.side = 1;
+        }
+    }
+
+    w.p = out;
+    w.end = out + *size;
+    w.acc = 0;
+    w.n = 0;
+    w.overflow = 0;
+    *w.p++ = (uint8_t)(block.order[0] | (block.order[1] << 2) | (block.side << 4));
+    a_codec_encode_channel(&w, red, NULL, count, block.order[0]);
+    if (channels > 1)
+    {
+        a_codec_encode_channel(&w, ir, (block.side != 0) ? red : NULL, count, block.order[1]);
+    }
+    a_codec_flush(&w);
+    if (w.overflow != 0)
+    {
+        return 1;
+    }
+    *size = (uint32_t)(w.p - out);
+    if (info != NULL)
+    {
+        *info = block;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      decode one block
+ * @param[in]  *in pointer to an encoded buffer
+ * @param[in]  size encoded size
+ * @param[in]  count number of samples per channel
+ * @param[in]  channels 1 (red) or 2 (red and ir)
+ * @param[out] *red pointer to a red samples buffer
+ * @param[out] *ir pointer to an ir samples buffer, ignored for one channel
+ * @return     status code
+ *             - 0 success
+ *             - 1 data is corrupted
+ *             - 2 buffer is NULL
+ *             - 3 channels is invalid
+ * @note       none
+ */
+uint8_t max30102_codec_decode(const uint8_t *in, uint32_t size, uint32_t count, uint8_t channels,
+                              uint32_t *red, uint32_t *ir)
+{
+    codec_reader_t r;
+    uint8_t flags;
+    uint32_t i;
+
+    if ((in == NULL) || (red == NULL) || ((channels > 1) && (ir == NULL)))
+    {
+        return 2;
+    }
+    if ((channels < 1) || (channels > 2))
+    {
+        return 3;
+    }
+    if ((size < 1) || ((in[0] & 0xE0) != 0))
+    {
+        return 1;
+    }
+
+    flags = in[0];
+    r.p = in + 1;
+    r.end = in + size;
+    r.buf = 0;
+    r.n = 0;
+    r.pad = 0;
+    a_codec_decode_channel(&r, red, count, flags & 0x3, 0);
+    if (channels > 1)
+    {
+        a_codec_decode_channel(&r, ir, count, (flags >> 2) & 0x3, (flags >> 4) & 0x1);
+        if ((flags & 0x10) != 0)
+        {
+            for (i = 0; i < count; i++)
+            {
+                ir[i] += red[i];
+            }
+        }
+    }
+
+    /* bits taken from the zero padding mean the block was cut short */
+    if (r.n < r.pad * 8)
+    {
+        return 1;
+    }
+
+    return 0;
+}
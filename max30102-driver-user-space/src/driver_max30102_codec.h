@@ -0,0 +1,90 @@
+
+#ifndef DRIVER_MAX30102_CODEC_H
+#define DRIVER_MAX30102_CODEC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @defgroup max30102_codec_driver max30102 codec driver function
+ * @brief    max30102 codec driver modules
+ * @ingroup  max30102_driver
+ * @{
+ */
+
+/**
+ * @brief max30102 codec block layout definition
+ * @note  block   := flags byte | bitstream
+ *        flags   := red order (bit 1:0) | second channel order (bit 3:2) | side (bit 4)
+ *        channel := order warm up samples (24 bit) | adaptive rice residuals
+ *        the second channel is ir, or ir - red when the side bit is set,
+ *        the bitstream is msb first and padded to a byte
+ */
+#define MAX30102_CODEC_MAX_ORDER        3           /**< highest fixed predictor order */
+#define MAX30102_CODEC_SAMPLE_MASK      0x3FFFFU    /**< 18 bit adc sample mask */
+#define MAX30102_CODEC_ESCAPE           16          /**< unary length that escapes to a raw residual */
+#define MAX30102_CODEC_RAW_BITS         24          /**< raw residual and warm up bits */
+
+/**
+ * @brief max30102 codec worst case encoded size definition
+ */
+#define MAX30102_CODEC_BOUND(count, channels)    (1 + 8 + (uint32_t)(count) * (uint32_t)(channels) * 5)
+
+/**
+ * @brief max30102 codec block information structure definition
+ */
+typedef struct max30102_codec_info_s
+{
+    uint8_t order[2];        /**< predictor order per channel */
+    uint8_t side;            /**< 1 if the second channel is coded as ir - red */
+} max30102_codec_info_t;
+
+/**
+ * @brief         encode one block
+ * @param[in]     *red pointer to a red samples buffer
+ * @param[in]     *ir pointer to an ir samples buffer, ignored for one channel
+ * @param[in]     count number of samples per channel
+ * @param[in]     channels 1 (red) or 2 (red and ir)
+ * @param[out]    *out pointer to an output buffer
+ * @param[in,out] *size pointer to the buffer capacity, returns the encoded size
+ * @param[out]    *info pointer to a block information structure, may be NULL
+ * @return        status code
+ *                - 0 success
+ *                - 1 buffer is too small
+ *                - 2 buffer is NULL
+ *                - 3 sample is over 18 bits or channels is invalid
+ * @note          a capacity of MAX30102_CODEC_BOUND(count, channels) never fails
+ */
+uint8_t max30102_codec_encode(const uint32_t *red, const uint32_t *ir, uint32_t count, uint8_t channels,
+                              uint8_t *out, uint32_t *size, max30102_codec_info_t *info);
+
+/**
+ * @brief      decode one block
+ * @param[in]  *in pointer to an encoded buffer
+ * @param[in]  size encoded size
+ * @param[in]  count number of samples per channel
+ * @param[in]  channels 1 (red) or 2 (red and ir)
+ * @param[out] *red pointer to a red samples buffer
+ * @param[out] *ir pointer to an ir samples buffer, ignored for one channel
+ * @return     status code
+ *             - 0 success
+ *             - 1 data is corrupted
+ *             - 2 buffer is NULL
+ *             - 3 channels is invalid
+ * @note       none
+ */
+uint8_t max30102_codec_decode(const uint8_t *in, uint32_t size, uint32_t count, uint8_t channels,
+                              uint32_t *red, uint32_t *ir);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
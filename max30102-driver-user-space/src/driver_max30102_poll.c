@@ -0,0 +1,256 @@
+
+
+#include "driver_max30102_poll.h"
+#include <errno.h>
+#include <time.h>
+
+/**
+ * @brief poll constant definition
+ */
+#define POLL_FIFO_DEPTH          32             /**< chip fifo depth */
+#define POLL_OVF_SATURATED       0x1F           /**< overflow counter limit */
+#define POLL_GAIN_UP             0.5            /**< rate estimate gain when the fifo fills faster */
+#define POLL_GAIN_DOWN           0.125          /**< rate estimate gain when the fifo fills slower */
+
+static const double gs_poll_rate_hz[8] = {50.0, 100.0, 200.0, 400.0, 800.0, 1000.0, 1600.0, 3200.0};        /**< spo2 sample rates */
+
+static uint64_t a_poll_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief      read the fifo level
+ * @param[in]  *handle pointer to a max30102 handle structure
+ * @param[in]  expect samples the rate estimate predicts
+ * @param[out] *level pointer to the unread samples
+ * @param[out] *ovf pointer to the overflow counter
+ * @return     status code
+ *             - 0 success
+ *             - 1 read failed
+ * @note       equal pointers mean full when the overflow counter is set, the
+ *             counter is read last so a fifo that fills during the reads is
+ *             not taken for empty; a fifo that reached 32 without losing a
+ *             sample is told from an empty one by the prediction
+ */
+static uint8_t a_poll_level(max30102_handle_t *handle, double expect, uint8_t *level, uint8_t *ovf)
+{
+    uint8_t wr;
+    uint8_t rd;
+
+    if ((max30102_get_fifo_write_pointer(handle, &wr) != 0) ||
+        (max30102_get_fifo_read_pointer(handle, &rd) != 0) ||
+        (max30102_get_fifo_overflow_counter(handle, ovf) != 0))
+    {
+        return 1;
+    }
+    if (wr != rd)
+    {
+        *level = (uint8_t)((wr + POLL_FIFO_DEPTH - rd) % POLL_FIFO_DEPTH);
+    }
+    else if ((*ovf != 0) || (expect > POLL_FIFO_DEPTH / 2))
+    {
+        *level = POLL_FIFO_DEPTH;
+    }
+    else
+    {
+        *level = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     update the rate estimate and schedule the next deadline
+ * @param[in] *poll pointer to a max30102 poll structure
+ * @param[in] produced samples written by the chip since the last poll
+ * @param[in] ovf overflow counter
+ * @param[in] remaining samples left in the fifo
+ * @param[in] now time of the level read
+ * @note      a poll that finds more than the target raises the estimate fast,
+ *            one that finds less lowers it slowly, so a rate step up costs a
+ *            few polls and jitter does not walk the period into overruns; an
+ *            overflow below the counter limit still counts every sample, so
+ *            only a saturated counter doubles the estimate
+ */
+static void a_poll_adapt(max30102_poll_t *poll, uint32_t produced, uint8_t ovf, uint8_t remaining, uint64_t now)
+{
+    double measured;
+    double need;
+
+    if ((poll->primed != 0) && (now > poll->last_ns))
+    {
+        measured = (double)produced * 1e9 / (double)(now - poll->last_ns);
+        if (ovf == POLL_OVF_SATURATED)
+        {
+            /* the counter saturated, so the real rate is at least this */
+            poll->rate_hz = (measured > 2.0 * poll->rate_hz) ? measured : 2.0 * poll->rate_hz;
+        }
+        else if (measured > poll->rate_hz)
+        {
+            poll->rate_hz += POLL_GAIN_UP * (measured - poll->rate_hz);
+        }
+        else
+        {
+            poll->rate_hz += POLL_GAIN_DOWN * (measured - poll->rate_hz);
+        }
+        if (poll->rate_hz > poll->nominal_hz * MAX30102_POLL_RATE_RANGE)
+        {
+            poll->rate_hz = poll->nominal_hz * MAX30102_POLL_RATE_RANGE;
+        }
+        if (poll->rate_hz < poll->nominal_hz / MAX30102_POLL_RATE_RANGE)
+        {
+            poll->rate_hz = poll->nominal_hz / MAX30102_POLL_RATE_RANGE;
+        }
+    }
+    poll->primed = 1;
+    poll->last_ns = now;
+
+    /* time until the fifo is back at the target */
+    need = (remaining < poll->target) ? (double)(poll->target - remaining) : 1.0;
+    poll->period_ns = (uint64_t)(need * 1e9 / poll->rate_hz);
+    poll->next_ns = now + poll->period_ns;
+}
+
+/**
+ * @brief     initialize the poller from the chip configuration
+ * @param[in] *poll pointer to a max30102 poll structure
+ * @param[in] *handle pointer to an initialized and configured max30102 handle
+ * @return    status code
+ *            - 0 success
+ *            - 1 read config failed
+ *            - 2 handle is NULL
+ * @note      call again after changing the sample rate, averaging or almost
+ *            full setting; the first poll drains at once
+ */
+uint8_t max30102_poll_init(max30102_poll_t *poll, max30102_handle_t *handle)
+{
+    max30102_spo2_sample_rate_t rate;
+    max30102_sample_averaging_t averaging;
+    uint8_t almost_full;
+    uint8_t margin;
+
+    if ((poll == NULL) || (handle == NULL))
+    {
+        return 2;
+    }
+    if ((max30102_get_spo2_sample_rate(handle, &rate) != 0) ||
+        (max30102_get_fifo_sample_averaging(handle, &averaging) != 0) ||
+        (max30102_get_fifo_almost_full(handle, &almost_full) != 0))
+    {
+        return 1;
+    }
+
+    memset(poll, 0, sizeof(max30102_poll_t));
+    poll->handle = handle;
+    poll->nominal_hz = gs_poll_rate_hz[rate & 0x7] / (double)(1U << ((averaging > 5) ? 5 : averaging));
+    poll->rate_hz = poll->nominal_hz;
+    poll->watermark = (uint8_t)(POLL_FIFO_DEPTH - (almost_full & 0xF));
+
+    /* leave room for the wake up jitter, about one sample in eight */
+    margin = (uint8_t)(1 + poll->watermark / 8);
+    poll->target = (poll->watermark > margin) ? (uint8_t)(poll->watermark - margin) : 1;
+    poll->period_ns = (uint64_t)((double)poll->target * 1e9 / poll->rate_hz);
+    poll->next_ns = a_poll_now();
+
+    return 0;
+}
+
+/**
+ * @brief     sleep until the next poll deadline
+ * @param[in] *poll pointer to a max30102 poll structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 sleep failed
+ *            - 2 handle is NULL
+ * @note      clock_nanosleep with TIMER_ABSTIME, restarted after signals
+ */
+uint8_t max30102_poll_wait(max30102_poll_t *poll)
+{
+    struct timespec ts;
+    int ret;
+
+    if (poll == NULL)
+    {
+        return 2;
+    }
+
+    ts.tv_sec = (time_t)(poll->next_ns / 1000000000ULL);
+    ts.tv_nsec = (long)(poll->next_ns % 1000000000ULL);
+    do
+    {
+        ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    } while (ret == EINTR);
+
+    return (ret == 0) ? 0 : 1;
+}
+
+/**
+ * @brief         wait for the next deadline and drain the fifo
+ * @param[in]     *poll pointer to a max30102 poll structure
+ * @param[out]    *raw_red pointer to a red raw data buffer
+ * @param[out]    *raw_ir pointer to an ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer, the capacity in and the samples read out
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 4 fifo overrun
+ * @note          the period adapts to the observed fill level so every poll
+ *                finds the fifo just below the watermark, an empty fifo
+ *                returns 0 with len 0
+ */
+uint8_t max30102_poll_read(max30102_poll_t *poll, uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len)
+{
+    uint8_t res;
+    uint8_t level;
+    uint8_t ovf;
+    uint8_t l;
+    uint64_t now;
+
+    if ((poll == NULL) || (poll->handle == NULL) || (raw_red == NULL) || (raw_ir == NULL) || (len == NULL))
+    {
+        return 2;
+    }
+    if (max30102_poll_wait(poll) != 0)
+    {
+        return 1;
+    }
+
+    now = a_poll_now();
+    if (a_poll_level(poll->handle, (poll->primed != 0) ? (double)(now - poll->last_ns) * poll->rate_hz / 1e9 : 0.0,
+                     &level, &ovf) != 0)
+    {
+        return 1;
+    }
+    poll->polls++;
+    poll->level = level;
+    l = 0;
+    if (level != 0)
+    {
+        l = (*len < level) ? *len : level;
+        res = max30102_read(poll->handle, raw_red, raw_ir, &l);
+        if ((res != 0) && (res != 4))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        poll->empty_polls++;
+    }
+    if (ovf != 0)
+    {
+        poll->overruns++;
+        poll->lost += ovf;
+    }
+    poll->samples += l;
+    *len = l;
+    a_poll_adapt(poll, (uint32_t)level + ovf, ovf, (uint8_t)(level - l), now);
+
+    return (ovf != 0) ? 4 : 0;
+}
@@ -0,0 +1,97 @@
+
+#ifndef DRIVER_MAX30102_POLL_H
+#define DRIVER_MAX30102_POLL_H
+
+#include "driver_max30102.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @defgroup max30102_poll_driver max30102 poll driver function
+ * @brief    max30102 poll driver modules
+ * @ingroup  max30102_driver
+ * @{
+ */
+
+/**
+ * @brief max30102 poll parameter definition
+ */
+#define MAX30102_POLL_RATE_RANGE        16          /**< the estimated rate stays within nominal / 16 and nominal * 16 */
+
+/**
+ * @brief max30102 poll structure definition
+ * @note  drains the fifo on a timer instead of the int pin, every deadline
+ *        is absolute on CLOCK_MONOTONIC so the period does not drift with the
+ *        time spent on the bus
+ */
+typedef struct max30102_poll_s
+{
+    max30102_handle_t *handle;        /**< linked and configured max30102 handle */
+    uint8_t watermark;                /**< samples at which the a_full interrupt would fire */
+    uint8_t target;                   /**< fill level each poll aims at, just below the watermark */
+    uint8_t primed;                   /**< first drain done flag */
+    uint8_t level;                    /**< fifo level found by the last poll */
+    double nominal_hz;                /**< sample rate from the chip configuration */
+    double rate_hz;                   /**< sample rate estimated from the observed fill levels */
+    uint64_t period_ns;               /**< current poll period */
+    uint64_t next_ns;                 /**< next deadline */
+    uint64_t last_ns;                 /**< time of the last level read */
+    uint64_t polls;                   /**< polls */
+    uint64_t empty_polls;             /**< polls that found the fifo empty */
+    uint64_t overruns;                /**< polls that found an overflow */
+    uint64_t samples;                 /**< samples drained */
+    uint64_t lost;                    /**< samples lost to overflows */
+} max30102_poll_t;
+
+/**
+ * @brief     initialize the poller from the chip configuration
+ * @param[in] *poll pointer to a max30102 poll structure
+ * @param[in] *handle pointer to an initialized and configured max30102 handle
+ * @return    status code
+ *            - 0 success
+ *            - 1 read config failed
+ *            - 2 handle is NULL
+ * @note      call again after changing the sample rate, averaging or almost
+ *            full setting; the first poll drains at once
+ */
+uint8_t max30102_poll_init(max30102_poll_t *poll, max30102_handle_t *handle);
+
+/**
+ * @brief     sleep until the next poll deadline
+ * @param[in] *poll pointer to a max30102 poll structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 sleep failed
+ *            - 2 handle is NULL
+ * @note      clock_nanosleep with TIMER_ABSTIME, restarted after signals
+ */
+uint8_t max30102_poll_wait(max30102_poll_t *poll);
+
+/**
+ * @brief         wait for the next deadline and drain the fifo
+ * @param[in]     *poll pointer to a max30102 poll structure
+ * @param[out]    *raw_red pointer to a red raw data buffer
+ * @param[out]    *raw_ir pointer to an ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer, the capacity in and the samples read out
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 4 fifo overrun
+ * @note          the period adapts to the observed fill level so every poll
+ *                finds the fifo just below the watermark, an empty fifo
+ *                returns 0 with len 0
+ */
+uint8_t max30102_poll_read(max30102_poll_t *poll, uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
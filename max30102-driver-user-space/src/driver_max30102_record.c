@@ -0,0 +1,1130 @@
+
+
+#include "driver_max30102_record.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+/**
+ * @brief chip register definition
+ */
+#define MAX30102_REG_FIFO_CONFIG                 0x08        /**< fifo config register */
+#define MAX30102_REG_MODE_CONFIG                 0x09        /**< mode config register */
+#define MAX30102_REG_SPO2_CONFIG                 0x0A        /**< spo2 config register */
+#define MAX30102_REG_LED_PULSE_1                 0x0C        /**< led pulse amplitude 1 register */
+#define MAX30102_REG_MULTI_LED_MODE_CONTROL_1    0x11        /**< multi led mode control 1 register */
+
+/**
+ * @brief sample rate table definition
+ */
+static const uint32_t gs_sample_rate_hz[8] = {50, 100, 200, 400, 800, 1000, 1600, 3200};        /**< spo2 sample rate in Hz */
+
+/**
+ * @brief crc32 table
+ */
+static uint32_t gs_crc_table[256];        /**< crc32 table */
+static uint8_t gs_crc_inited;             /**< crc32 table inited flag */
+
+static void a_put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 0);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void a_put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 0);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void a_put_le64(uint8_t *p, uint64_t v)
+{
+    a_put_le32(p, (uint32_t)v);
+    a_put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t a_get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t a_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t a_get_le64(const uint8_t *p)
+{
+    return (uint64_t)a_get_le32(p) | ((uint64_t)a_get_le32(p + 4) << 32);
+}
+
+/**
+ * @brief     crc32 (ieee 802.3)
+ * @param[in] *buf pointer to a data buffer
+ * @param[in] len buffer length
+ * @return    crc32
+ * @note      none
+ */
+static uint32_t a_crc32(const uint8_t *buf, size_t len)
+{
+    uint32_t crc;
+    size_t i;
+
+    if (gs_crc_inited == 0)
+    {
+        uint32_t c;
+        uint32_t n;
+        uint8_t k;
+
+        for (n = 0; n < 256; n++)
+        {
+            c = n;
+            for (k = 0; k < 8; k++)
+            {
+                c = ((c & 1) != 0) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+            }
+            gs_crc_table[n] = c;
+        }
+        gs_crc_inited = 1;
+    }
+
+    crc = 0xFFFFFFFFU;
+    for (i = 0; i < len; i++)
+    {
+        crc = gs_crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFFU;
+}
+
+static uint64_t a_monotonic_ns(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief     write the whole buffer
+ * @param[in] fd file descriptor
+ * @param[in] *iov pointer to an iovec array
+ * @param[in] iovcnt iovec count
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ * @note      none
+ */
+static uint8_t a_write_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t n;
+
+        n = writev(fd, iov, iovcnt);
+        if (n < 0)
+        {
+            return 1;
+        }
+        while ((iovcnt > 0) && ((size_t)n >= iov->iov_len))
+        {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      delta encode one channel
+ * @param[in]  *samples pointer to a samples buffer
+ * @param[in]  count number of samples
+ * @param[out] *out pointer to an output buffer
+ * @return     encoded length
+ * @note       first sample as 3 raw bytes, then zigzag varint deltas
+ */
+static uint32_t a_delta_encode(const uint32_t *samples, uint32_t count, uint8_t *out)
+{
+    uint32_t i;
+    uint32_t len;
+
+    out[0] = (uint8_t)(samples[0] >> 0);
+    out[1] = (uint8_t)(samples[0] >> 8);
+    out[2] = (uint8_t)(samples[0] >> 16);
+    len = 3;
+    for (i = 1; i < count; i++)
+    {
+        int32_t delta;
+        uint32_t zz;
+
+        delta = (int32_t)(samples[i] - samples[i - 1]);
+        zz = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        while (zz >= 0x80)
+        {
+            out[len++] = (uint8_t)(zz | 0x80);
+            zz >>= 7;
+        }
+        out[len++] = (uint8_t)zz;
+    }
+
+    return len;
+}
+
+/**
+ * @brief      delta decode one channel
+ * @param[in]  *in pointer to an encoded buffer
+ * @param[in]  size encoded buffer size
+ * @param[in]  count number of samples
+ * @param[out] *samples pointer to a samples buffer
+ * @return     consumed bytes, 0 on corrupted data
+ * @note       none
+ */
+static uint32_t a_delta_decode(const uint8_t *in, uint32_t size, uint32_t count, uint32_t *samples)
+{
+    uint32_t i;
+    uint32_t pos;
+
+    if (size < 3)
+    {
+        return 0;
+    }
+    samples[0] = (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16);
+    pos = 3;
+    for (i = 1; i < count; i++)
+    {
+        uint32_t zz;
+        uint8_t shift;
+
+        zz = 0;
+        shift = 0;
+        do
+        {
+            if ((pos >= size) || (shift > 28))
+            {
+                return 0;
+            }
+            zz |= (uint32_t)(in[pos] & 0x7F) << shift;
+            shift += 7;
+        } while ((in[pos++] & 0x80) != 0);
+        samples[i] = samples[i - 1] + (uint32_t)((zz >> 1) ^ (0U - (zz & 1)));
+    }
+
+    return pos;
+}
+
+/**
+ * @brief     encode and append the pending chunk
+ * @param[in] *rec pointer to a record structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ * @note      none
+ */
+static uint8_t a_record_flush_chunk(max30102_record_t *rec)
+{
+    uint8_t encoding;
+    uint8_t *p;
+    uint32_t payload = 0;
+    struct iovec iov;
+    uint64_t now;
+
+    if (rec->count == 0)
+    {
+        return 0;
+    }
+
+    /* encode channels after the header */
+    p = rec->buf + MAX30102_RECORD_CHUNK_HEADER_SIZE;
+    encoding = rec->encoding;
+    if (encoding == MAX30102_RECORD_ENCODING_RICE)
+    {
+        payload = sizeof(rec->buf) - MAX30102_RECORD_CHUNK_HEADER_SIZE;
+        if (max30102_codec_encode(rec->red, rec->ir, rec->count, rec->header.channels, p, &payload, NULL) != 0)
+        {
+            /* samples wider than 18 bits, keep them with the delta coder */
+            encoding = MAX30102_RECORD_ENCODING_DELTA;
+        }
+    }
+    if (encoding == MAX30102_RECORD_ENCODING_DELTA)
+    {
+        payload = a_delta_encode(rec->red, rec->count, p);
+        if (rec->header.channels > 1)
+        {
+            payload += a_delta_encode(rec->ir, rec->count, p + payload);
+        }
+    }
+
+    /* chunk header */
+    p = rec->buf;
+    memset(p, 0, MAX30102_RECORD_CHUNK_HEADER_SIZE);
+    a_put_le32(p + 0, MAX30102_RECORD_CHUNK_MAGIC);
+    p[4] = encoding;
+    p[5] = rec->header.channels;
+    a_put_le32(p + 8, rec->count);
+    a_put_le32(p + 12, payload);
+    a_put_le64(p + 16, rec->total - rec->count);
+    a_put_le64(p + 24, rec->t_first);
+    a_put_le64(p + 32, rec->t_last);
+    a_put_le32(p + 40, a_crc32(p + MAX30102_RECORD_CHUNK_HEADER_SIZE, payload));
+
+    /* grow the index */
+    if (rec->index_count == rec->index_capacity)
+    {
+        uint32_t capacity;
+        max30102_record_index_t *index;
+
+        capacity = (rec->index_capacity != 0) ? rec->index_capacity * 2 : 256;
+        index = (max30102_record_index_t *)realloc(rec->index, capacity * sizeof(max30102_record_index_t));
+        if (index == NULL)
+        {
+            return 1;
+        }
+        rec->index = index;
+        rec->index_capacity = capacity;
+    }
+    rec->index[rec->index_count].offset = rec->offset;
+    rec->index[rec->index_count].first_index = rec->total - rec->count;
+    rec->index[rec->index_count].t_first = rec->t_first;
+
+    /* one write per chunk */
+    iov.iov_base = rec->buf;
+    iov.iov_len = MAX30102_RECORD_CHUNK_HEADER_SIZE + payload;
+    if (a_write_all(rec->fd, &iov, 1) != 0)
+    {
+        return 1;
+    }
+    rec->index_count++;
+    rec->offset += MAX30102_RECORD_CHUNK_HEADER_SIZE + payload;
+    rec->count = 0;
+
+    /* sync on schedule, not per chunk */
+    if (rec->sync_interval_ms != 0)
+    {
+        now = a_monotonic_ns();
+        if ((now - rec->last_sync_ns) >= (uint64_t)rec->sync_interval_ms * 1000000ULL)
+        {
+            (void)fdatasync(rec->fd);
+            rec->last_sync_ns = now;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      fill a record header from raw register values
+ * @param[out] *header pointer to a record header structure
+ * @param[in]  *device pointer to a device name
+ * @param[in]  fifo_config fifo config register
+ * @param[in]  mode_config mode config register
+ * @param[in]  spo2_config spo2 config register
+ * @note       led and slot snapshots are left zero, set them if known
+ */
+void max30102_record_header_from_config(max30102_record_header_t *header, const char *device,
+                                        uint8_t fifo_config, uint8_t mode_config, uint8_t spo2_config)
+{
+    uint8_t ave;
+
+    memset(header, 0, sizeof(max30102_record_header_t));
+    if (device != NULL)
+    {
+        strncpy(header->device, device, sizeof(header->device) - 1);
+    }
+    header->fifo_config = fifo_config;
+    header->mode_config = mode_config;
+    header->spo2_config = spo2_config;
+    header->channels = ((mode_config & 0x7) == MAX30102_MODE_HEART_RATE) ? 1 : 2;
+    ave = (fifo_config >> 5) & 0x7;
+    ave = (ave > 5) ? 5 : ave;
+    header->sample_rate_mhz = gs_sample_rate_hz[(spo2_config >> 2) & 0x7] * 1000U / (1U << ave);
+    header->chunk_samples = MAX30102_RECORD_DEFAULT_CHUNK;
+}
+
+/**
+ * @brief      fill a record header from the current chip configuration
+ * @param[in]  *handle pointer to a max30102 handle structure
+ * @param[in]  *device pointer to a device name
+ * @param[out] *header pointer to a record header structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 read config failed
+ *             - 2 handle is NULL
+ * @note       none
+ */
+uint8_t max30102_record_header_from_handle(max30102_handle_t *handle, const char *device, max30102_record_header_t *header)
+{
+    uint8_t regs[3];
+    uint8_t led[2];
+    uint8_t slot[2];
+
+    if ((handle == NULL) || (header == NULL))
+    {
+        return 2;
+    }
+
+    /* fifo, mode and spo2 config are contiguous */
+    if (max30102_get_reg(handle, MAX30102_REG_FIFO_CONFIG, regs, 3) != 0)
+    {
+        return 1;
+    }
+    if (max30102_get_reg(handle, MAX30102_REG_LED_PULSE_1, led, 2) != 0)
+    {
+        return 1;
+    }
+    if (max30102_get_reg(handle, MAX30102_REG_MULTI_LED_MODE_CONTROL_1, slot, 2) != 0)
+    {
+        return 1;
+    }
+    max30102_record_header_from_config(header, device, regs[0], regs[1], regs[2]);
+    header->led_pulse[0] = led[0];
+    header->led_pulse[1] = led[1];
+    header->multi_led[0] = slot[0];
+    header->multi_led[1] = slot[1];
+
+    return 0;
+}
+
+/**
+ * @brief     create a recording
+ * @param[in] *rec pointer to a record structure
+ * @param[in] *path pointer to a file path
+ * @param[in] *header pointer to a record header structure
+ * @param[in] sync_interval_ms fdatasync interval, 0 syncs only on close
+ * @return    status code
+ *            - 0 success
+ *            - 1 create failed
+ *            - 2 handle is NULL
+ *            - 3 header is invalid
+ * @note      chunks are encoded with MAX30102_RECORD_ENCODING_RICE
+ */
+uint8_t max30102_record_open(max30102_record_t *rec, const char *path, const max30102_record_header_t *header, uint32_t sync_interval_ms)
+{
+    uint8_t p[MAX30102_RECORD_HEADER_SIZE];
+    struct iovec iov;
+    struct timespec ts;
+
+    if ((rec == NULL) || (path == NULL) || (header == NULL))
+    {
+        return 2;
+    }
+    if ((header->channels < 1) || (header->channels > 2) ||
+        (header->chunk_samples < 2) || (header->chunk_samples > MAX30102_RECORD_MAX_CHUNK_SAMPLES) ||
+        (header->sample_rate_mhz == 0))
+    {
+        return 3;
+    }
+
+    memset(rec, 0, sizeof(max30102_record_t));
+    rec->header = *header;
+    if (rec->header.start_time_ns == 0)
+    {
+        (void)clock_gettime(CLOCK_REALTIME, &ts);
+        rec->header.start_time_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+    rec->period_ns = 1000000000000ULL / rec->header.sample_rate_mhz;
+    rec->sync_interval_ms = sync_interval_ms;
+    rec->encoding = MAX30102_RECORD_ENCODING_RICE;
+    rec->last_sync_ns = a_monotonic_ns();
+
+    rec->fd = open(path, O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+    if (rec->fd < 0)
+    {
+        return 1;
+    }
+
+    /* file header */
+    memset(p, 0, sizeof(p));
+    a_put_le32(p + 0, MAX30102_RECORD_MAGIC);
+    a_put_le16(p + 4, MAX30102_RECORD_VERSION);
+    a_put_le16(p + 6, MAX30102_RECORD_HEADER_SIZE);
+    memcpy(p + 8, rec->header.device, 32);
+    p[40] = rec->header.fifo_config;
+    p[41] = rec->header.mode_config;
+    p[42] = rec->header.spo2_config;
+    p[43] = rec->header.led_pulse[0];
+    p[44] = rec->header.led_pulse[1];
+    p[45] = rec->header.multi_led[0];
+    p[46] = rec->header.multi_led[1];
+    p[47] = rec->header.channels;
+    a_put_le32(p + 48, rec->header.sample_rate_mhz);
+    a_put_le32(p + 52, rec->header.chunk_samples);
+    a_put_le64(p + 56, rec->header.start_time_ns);
+    iov.iov_base = p;
+    iov.iov_len = sizeof(p);
+    if (a_write_all(rec->fd, &iov, 1) != 0)
+    {
+        (void)close(rec->fd);
+
+        return 1;
+    }
+    rec->offset = MAX30102_RECORD_HEADER_SIZE;
+
+    return 0;
+}
+
+/**
+ * @brief     set the chunk encoding
+ * @param[in] *rec pointer to a record structure
+ * @param[in] encoding chunk encoding
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ *            - 3 encoding is invalid
+ * @note      applies from the next chunk
+ */
+uint8_t max30102_record_set_encoding(max30102_record_t *rec, max30102_record_encoding_t encoding)
+{
+    if (rec == NULL)
+    {
+        return 2;
+    }
+    if ((encoding != MAX30102_RECORD_ENCODING_DELTA) && (encoding != MAX30102_RECORD_ENCODING_RICE))
+    {
+        return 3;
+    }
+    rec->encoding = (uint8_t)encoding;
+
+    return 0;
+}
+
+/**
+ * @brief     append a fifo batch
+ * @param[in] *rec pointer to a record structure
+ * @param[in] *raw_red pointer to a red raw data buffer
+ * @param[in] *raw_ir pointer to an ir raw data buffer, ignored for one channel
+ * @param[in] len number of samples
+ * @param[in] timestamp_ns time the last sample of the batch was drained
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ *            - 2 handle is NULL
+ * @note      samples are buffered and written one chunk at a time
+ */
+uint8_t max30102_record_write(max30102_record_t *rec, const uint32_t *raw_red, const uint32_t *raw_ir, uint32_t len, uint64_t timestamp_ns)
+{
+    uint32_t i;
+
+    if ((rec == NULL) || (raw_red == NULL) || ((raw_ir == NULL) && (rec->header.channels > 1)))
+    {
+        return 2;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        uint64_t t;
+
+        /* back-date earlier samples of the batch by the nominal period */
+        t = timestamp_ns - (uint64_t)(len - 1 - i) * rec->period_ns;
+        if (rec->count == 0)
+        {
+            rec->t_first = t;
+        }
+        rec->t_last = t;
+        rec->red[rec->count] = raw_red[i];
+        if (rec->header.channels > 1)
+        {
+            rec->ir[rec->count] = raw_ir[i];
+        }
+        rec->count++;
+        rec->total++;
+        if (rec->count == rec->header.chunk_samples)
+        {
+            if (a_record_flush_chunk(rec) != 0)
+            {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     flush the pending chunk and write the index
+ * @param[in] *rec pointer to a record structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 close failed
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_record_close(max30102_record_t *rec)
+{
+    uint8_t res;
+    uint8_t trailer[MAX30102_RECORD_TRAILER_SIZE];
+    uint8_t *entries;
+    uint32_t i;
+    struct iovec iov[2];
+
+    if (rec == NULL)
+    {
+        return 2;
+    }
+
+    res = a_record_flush_chunk(rec);
+    entries = (uint8_t *)malloc((size_t)rec->index_count * MAX30102_RECORD_INDEX_ENTRY_SIZE + 1);
+    if ((res == 0) && (entries != NULL))
+    {
+        for (i = 0; i < rec->index_count; i++)
+        {
+            a_put_le64(entries + i * MAX30102_RECORD_INDEX_ENTRY_SIZE + 0, rec->index[i].offset);
+            a_put_le64(entries + i * MAX30102_RECORD_INDEX_ENTRY_SIZE + 8, rec->index[i].first_index);
+            a_put_le64(entries + i * MAX30102_RECORD_INDEX_ENTRY_SIZE + 16, rec->index[i].t_first);
+        }
+        a_put_le32(trailer + 0, MAX30102_RECORD_INDEX_MAGIC);
+        a_put_le32(trailer + 4, rec->index_count);
+        a_put_le64(trailer + 8, rec->offset);
+        a_put_le64(trailer + 16, rec->total);
+        iov[0].iov_base = entries;
+        iov[0].iov_len = (size_t)rec->index_count * MAX30102_RECORD_INDEX_ENTRY_SIZE;
+        iov[1].iov_base = trailer;
+        iov[1].iov_len = sizeof(trailer);
+        res = a_write_all(rec->fd, iov, 2);
+    }
+    else
+    {
+        res = 1;
+    }
+    free(entries);
+    free(rec->index);
+    rec->index = NULL;
+    if (fdatasync(rec->fd) != 0)
+    {
+        res = 1;
+    }
+    if (close(rec->fd) != 0)
+    {
+        res = 1;
+    }
+
+    return res;
+}
+
+/**
+ * @brief      parse a chunk header at an offset
+ * @param[in]  *rd pointer to a record reader structure
+ * @param[in]  offset file offset
+ * @param[out] *info pointer to a chunk information structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 chunk is corrupted
+ * @note       none
+ */
+static uint8_t a_reader_parse_chunk(max30102_record_reader_t *rd, uint64_t offset, max30102_record_chunk_t *info)
+{
+    const uint8_t *p;
+
+    if ((offset + MAX30102_RECORD_CHUNK_HEADER_SIZE) > rd->size)
+    {
+        return 1;
+    }
+    p = rd->map + offset;
+    if (a_get_le32(p) != MAX30102_RECORD_CHUNK_MAGIC)
+    {
+        return 1;
+    }
+    info->encoding = p[4];
+    info->channels = p[5];
+    info->count = a_get_le32(p + 8);
+    info->payload_size = a_get_le32(p + 12);
+    info->first_index = a_get_le64(p + 16);
+    info->t_first = a_get_le64(p + 24);
+    info->t_last = a_get_le64(p + 32);
+    info->crc = a_get_le32(p + 40);
+    if ((info->count == 0) || (info->count > MAX30102_RECORD_MAX_CHUNK_SAMPLES) ||
+        (info->channels < 1) || (info->channels > 2) ||
+        ((offset + MAX30102_RECORD_CHUNK_HEADER_SIZE + info->payload_size) > rd->size))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     load the index from the trailer or rebuild it
+ * @param[in] *rd pointer to a record reader structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 load failed
+ * @note      none
+ */
+static uint8_t a_reader_load_index(max30102_record_reader_t *rd)
+{
+    const uint8_t *t;
+    uint64_t offset;
+    uint32_t capacity;
+    uint32_t i;
+    max30102_record_chunk_t info;
+
+    /* fast path: trailer written by max30102_record_close */
+    if (rd->size >= (MAX30102_RECORD_HEADER_SIZE + MAX30102_RECORD_TRAILER_SIZE))
+    {
+        t = rd->map + rd->size - MAX30102_RECORD_TRAILER_SIZE;
+        offset = a_get_le64(t + 8);
+        if ((a_get_le32(t) == MAX30102_RECORD_INDEX_MAGIC) &&
+            (offset + (uint64_t)a_get_le32(t + 4) * MAX30102_RECORD_INDEX_ENTRY_SIZE ==
+             rd->size - MAX30102_RECORD_TRAILER_SIZE))
+        {
+            rd->chunk_count = a_get_le32(t + 4);
+            rd->total = a_get_le64(t + 16);
+            rd->index = (max30102_record_index_t *)malloc((size_t)rd->chunk_count * sizeof(max30102_record_index_t) + 1);
+            if (rd->index == NULL)
+            {
+                return 1;
+            }
+            for (i = 0; i < rd->chunk_count; i++)
+            {
+                const uint8_t *e = rd->map + offset + (uint64_t)i * MAX30102_RECORD_INDEX_ENTRY_SIZE;
+
+                rd->index[i].offset = a_get_le64(e + 0);
+                rd->index[i].first_index = a_get_le64(e + 8);
+                rd->index[i].t_first = a_get_le64(e + 16);
+            }
+
+            return 0;
+        }
+    }
+
+    /* slow path: the writer did not close, scan valid chunks */
+    capacity = 0;
+    rd->chunk_count = 0;
+    rd->total = 0;
+    offset = MAX30102_RECORD_HEADER_SIZE;
+    while (a_reader_parse_chunk(rd, offset, &info) == 0)
+    {
+        if (a_crc32(rd->map + offset + MAX30102_RECORD_CHUNK_HEADER_SIZE, info.payload_size) != info.crc)
+        {
+            break;
+        }
+        if (rd->chunk_count == capacity)
+        {
+            max30102_record_index_t *index;
+
+            capacity = (capacity != 0) ? capacity * 2 : 256;
+            index = (max30102_record_index_t *)realloc(rd->index, capacity * sizeof(max30102_record_index_t));
+            if (index == NULL)
+            {
+                return 1;
+            }
+            rd->index = index;
+        }
+        rd->index[rd->chunk_count].offset = offset;
+        rd->index[rd->chunk_count].first_index = info.first_index;
+        rd->index[rd->chunk_count].t_first = info.t_first;
+        rd->chunk_count++;
+        rd->total = info.first_index + info.count;
+        offset += MAX30102_RECORD_CHUNK_HEADER_SIZE + info.payload_size;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      parse a file header
+ * @param[in]  *p pointer to MAX30102_RECORD_HEADER_SIZE bytes
+ * @param[out] *header pointer to a record header structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 magic or version mismatch
+ * @note       none
+ */
+static uint8_t a_record_parse_header(const uint8_t *p, max30102_record_header_t *header)
+{
+    if ((a_get_le32(p) != MAX30102_RECORD_MAGIC) || (a_get_le16(p + 4) != MAX30102_RECORD_VERSION))
+    {
+        return 1;
+    }
+    memcpy(header->device, p + 8, 32);
+    header->device[31] = '\0';
+    header->fifo_config = p[40];
+    header->mode_config = p[41];
+    header->spo2_config = p[42];
+    header->led_pulse[0] = p[43];
+    header->led_pulse[1] = p[44];
+    header->multi_led[0] = p[45];
+    header->multi_led[1] = p[46];
+    header->channels = p[47];
+    header->sample_rate_mhz = a_get_le32(p + 48);
+    header->chunk_samples = a_get_le32(p + 52);
+    header->start_time_ns = a_get_le64(p + 56);
+
+    return 0;
+}
+
+/**
+ * @brief      read the file header of a recording
+ * @param[in]  *path pointer to a file path
+ * @param[out] *header pointer to a record header structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 read failed
+ *             - 2 handle is NULL
+ *             - 3 file is invalid
+ * @note       does not map the file or load the index
+ */
+uint8_t max30102_record_read_header(const char *path, max30102_record_header_t *header)
+{
+    uint8_t buf[MAX30102_RECORD_HEADER_SIZE];
+    ssize_t n;
+    int fd;
+
+    if ((path == NULL) || (header == NULL))
+    {
+        return 2;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    n = pread(fd, buf, sizeof(buf), 0);
+    (void)close(fd);
+    if (n < 0)
+    {
+        return 1;
+    }
+    if ((n != (ssize_t)sizeof(buf)) || (a_record_parse_header(buf, header) != 0))
+    {
+        return 3;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     open a recording for reading
+ * @param[in] *rd pointer to a record reader structure
+ * @param[in] *path pointer to a file path
+ * @return    status code
+ *            - 0 success
+ *            - 1 open failed
+ *            - 2 handle is NULL
+ *            - 3 file is invalid
+ * @note      the index is rebuilt by scanning if the file was not closed
+ */
+uint8_t max30102_record_reader_open(max30102_record_reader_t *rd, const char *path)
+{
+    struct stat st;
+    void *map;
+
+    if ((rd == NULL) || (path == NULL))
+    {
+        return 2;
+    }
+
+    memset(rd, 0, sizeof(max30102_record_reader_t));
+    rd->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (rd->fd < 0)
+    {
+        return 1;
+    }
+    if ((fstat(rd->fd, &st) != 0) || (st.st_size < MAX30102_RECORD_HEADER_SIZE))
+    {
+        (void)close(rd->fd);
+
+        return 3;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, rd->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        (void)close(rd->fd);
+
+        return 1;
+    }
+    rd->map = (const uint8_t *)map;
+    rd->size = (size_t)st.st_size;
+
+    /* file header */
+    if (a_record_parse_header(rd->map, &rd->header) != 0)
+    {
+        (void)max30102_record_reader_close(rd);
+
+        return 3;
+    }
+
+    if (a_reader_load_index(rd) != 0)
+    {
+        (void)max30102_record_reader_close(rd);
+
+        return 1;
+    }
+    rd->chunk = 0xFFFFFFFFU;
+    rd->pos = 0;
+    rd->info.count = 0;
+
+    return 0;
+}
+
+/**
+ * @brief     close a recording
+ * @param[in] *rd pointer to a record reader structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_record_reader_close(max30102_record_reader_t *rd)
+{
+    if (rd == NULL)
+    {
+        return 2;
+    }
+
+    free(rd->index);
+    rd->index = NULL;
+    if (rd->map != NULL)
+    {
+        (void)munmap((void *)rd->map, rd->size);
+        rd->map = NULL;
+    }
+    (void)close(rd->fd);
+
+    return 0;
+}
+
+/**
+ * @brief      get one chunk header
+ * @param[in]  *rd pointer to a record reader structure
+ * @param[in]  chunk chunk number
+ * @param[out] *info pointer to a chunk information structure
+ * @param[out] **payload pointer to the mapped payload
+ * @return     status code
+ *             - 0 success
+ *             - 1 chunk is corrupted
+ *             - 2 handle is NULL
+ *             - 4 chunk is out of range
+ * @note       payload may be NULL
+ */
+uint8_t max30102_record_reader_chunk(max30102_record_reader_t *rd, uint32_t chunk, max30102_record_chunk_t *info, const uint8_t **payload)
+{
+    if ((rd == NULL) || (info == NULL))
+    {
+        return 2;
+    }
+    if (chunk >= rd->chunk_count)
+    {
+        return 4;
+    }
+    if (a_reader_parse_chunk(rd, rd->index[chunk].offset, info) != 0)
+    {
+        return 1;
+    }
+    if (payload != NULL)
+    {
+        *payload = rd->map + rd->index[chunk].offset + MAX30102_RECORD_CHUNK_HEADER_SIZE;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     decode one chunk into the reader buffers
+ * @param[in] *rd pointer to a record reader structure
+ * @param[in] chunk chunk number
+ * @return    status code
+ *            - 0 success
+ *            - 1 chunk is corrupted
+ *            - 4 chunk is out of range
+ * @note      none
+ */
+static uint8_t a_reader_decode(max30102_record_reader_t *rd, uint32_t chunk)
+{
+    uint8_t res;
+    const uint8_t *payload;
+    uint32_t used;
+
+    res = max30102_record_reader_chunk(rd, chunk, &rd->info, &payload);
+    if (res != 0)
+    {
+        return res;
+    }
+    if (rd->info.encoding == MAX30102_RECORD_ENCODING_RICE)
+    {
+        if (max30102_codec_decode(payload, rd->info.payload_size, rd->info.count, rd->info.channels, rd->red, rd->ir) != 0)
+        {
+            return 1;
+        }
+    }
+    else if (rd->info.encoding == MAX30102_RECORD_ENCODING_DELTA)
+    {
+        used = a_delta_decode(payload, rd->info.payload_size, rd->info.count, rd->red);
+        if (used == 0)
+        {
+            return 1;
+        }
+        if (rd->info.channels > 1)
+        {
+            if (a_delta_decode(payload + used, rd->info.payload_size - used, rd->info.count, rd->ir) == 0)
+            {
+                return 1;
+            }
+        }
+    }
+    else
+    {
+        return 1;
+    }
+    rd->chunk = chunk;
+    rd->pos = 0;
+
+    return 0;
+}
+
+/**
+ * @brief     timestamp of a sample inside the decoded chunk
+ * @param[in] *rd pointer to a record reader structure
+ * @param[in] pos sample position
+ * @return    timestamp in ns
+ * @note      samples are evenly spaced between t_first and t_last
+ */
+static uint64_t a_reader_time(max30102_record_reader_t *rd, uint32_t pos)
+{
+    if (rd->info.count < 2)
+    {
+        return rd->info.t_first;
+    }
+
+    return rd->info.t_first + (rd->info.t_last - rd->info.t_first) * pos / (rd->info.count - 1);
+}
+
+/**
+ * @brief     seek to a timestamp
+ * @param[in] *rd pointer to a record reader structure
+ * @param[in] timestamp_ns target time in ns
+ * @return    status code
+ *            - 0 success
+ *            - 1 seek failed
+ *            - 2 handle is NULL
+ *            - 4 timestamp is after the end
+ * @note      positions at the first sample at or after the timestamp
+ */
+uint8_t max30102_record_reader_seek(max30102_record_reader_t *rd, uint64_t timestamp_ns)
+{
+    uint32_t lo;
+    uint32_t hi;
+    uint64_t span;
+
+    if (rd == NULL)
+    {
+        return 2;
+    }
+    if (rd->chunk_count == 0)
+    {
+        return 4;
+    }
+
+    /* last chunk starting at or before the timestamp */
+    lo = 0;
+    hi = rd->chunk_count;
+    while ((hi - lo) > 1)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (rd->index[mid].t_first <= timestamp_ns)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    if (a_reader_decode(rd, lo) != 0)
+    {
+        return 1;
+    }
+    if (timestamp_ns <= rd->info.t_first)
+    {
+        return 0;
+    }
+    if (timestamp_ns > rd->info.t_last)
+    {
+        if ((lo + 1) >= rd->chunk_count)
+        {
+            rd->pos = rd->info.count;
+
+            return 4;
+        }
+
+        return (a_reader_decode(rd, lo + 1) != 0) ? 1 : 0;
+    }
+    span = rd->info.t_last - rd->info.t_first;
+    rd->pos = (uint32_t)(((timestamp_ns - rd->info.t_first) * (rd->info.count - 1) + span - 1) / span);
+
+    return 0;
+}
+
+/**
+ * @brief         read samples
+ * @param[in]     *rd pointer to a record reader structure
+ * @param[out]    *raw_red pointer to a red raw data buffer
+ * @param[out]    *raw_ir pointer to an ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @param[out]    *timestamp_ns pointer to the time of the first returned sample, may be NULL
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 4 end of file
+ * @note          never crosses a chunk boundary in one call
+ */
+uint8_t max30102_record_reader_read(max30102_record_reader_t *rd, uint32_t *raw_red, uint32_t *raw_ir, uint32_t *len, uint64_t *timestamp_ns)
+{
+    uint32_t n;
+
+    if ((rd == NULL) || (raw_red == NULL) || (len == NULL))
+    {
+        return 2;
+    }
+
+    while (rd->pos >= rd->info.count)
+    {
+        uint32_t next;
+
+        next = (rd->chunk == 0xFFFFFFFFU) ? 0 : rd->chunk + 1;
+        if (next >= rd->chunk_count)
+        {
+            *len = 0;
+
+            return 4;
+        }
+        if (a_reader_decode(rd, next) != 0)
+        {
+            *len = 0;
+
+            return 1;
+        }
+    }
+
+    n = rd->info.count - rd->pos;
+    n = (*len < n) ? *len : n;
+    memcpy(raw_red, &rd->red[rd->pos], n * sizeof(uint32_t));
+    if ((raw_ir != NULL) && (rd->info.channels > 1))
+    {
+        memcpy(raw_ir, &rd->ir[rd->pos], n * sizeof(uint32_t));
+    }
+    if (timestamp_ns != NULL)
+    {
+        *timestamp_ns = a_reader_time(rd, rd->pos);
+    }
+    rd->pos += n;
+    *len = n;
+
+    return 0;
+}
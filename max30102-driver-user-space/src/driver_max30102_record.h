@@ -0,0 +1,300 @@
+
+#ifndef DRIVER_MAX30102_RECORD_H
+#define DRIVER_MAX30102_RECORD_H
+
+#include "driver_max30102.h"
+#include "driver_max30102_codec.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @defgroup max30102_record_driver max30102 record driver function
+ * @brief    max30102 record driver modules
+ * @ingroup  max30102_driver
+ * @{
+ */
+
+/**
+ * @brief max30102 record file layout definition
+ * @note  file     := file header | chunk* | index | trailer
+ *        chunk    := chunk header | payload
+ *        index    := index entry * chunk_count
+ *        all integers are little endian, the index and trailer are only
+ *        written on close, a file without them is recovered by scanning
+ */
+#define MAX30102_RECORD_MAGIC                0x4352334DU        /**< "M3RC" file magic */
+#define MAX30102_RECORD_CHUNK_MAGIC          0x4B43334DU        /**< "M3CK" chunk magic */
+#define MAX30102_RECORD_INDEX_MAGIC          0x5849334DU        /**< "M3IX" trailer magic */
+#define MAX30102_RECORD_VERSION              1                  /**< format version */
+#define MAX30102_RECORD_HEADER_SIZE          128                /**< file header size */
+#define MAX30102_RECORD_CHUNK_HEADER_SIZE    48                 /**< chunk header size */
+#define MAX30102_RECORD_INDEX_ENTRY_SIZE     24                 /**< index entry size */
+#define MAX30102_RECORD_TRAILER_SIZE         24                 /**< trailer size */
+#define MAX30102_RECORD_MAX_CHUNK_SAMPLES    4096               /**< max samples per chunk and channel */
+#define MAX30102_RECORD_DEFAULT_CHUNK        1024               /**< default samples per chunk */
+#define MAX30102_RECORD_DEFAULT_SYNC_MS      5000               /**< default fdatasync interval */
+
+/**
+ * @brief max30102 record chunk encoding enumeration definition
+ */
+typedef enum
+{
+    MAX30102_RECORD_ENCODING_DELTA = 0x00,        /**< first sample raw, then zigzag varint deltas */
+    MAX30102_RECORD_ENCODING_RICE  = 0x01,        /**< driver_max30102_codec block */
+} max30102_record_encoding_t;
+
+/**
+ * @brief max30102 record header structure definition
+ */
+typedef struct max30102_record_header_s
+{
+    char device[32];                  /**< device name, e.g. "max30102-87" */
+    uint8_t fifo_config;              /**< fifo config register snapshot */
+    uint8_t mode_config;              /**< mode config register snapshot */
+    uint8_t spo2_config;              /**< spo2 config register snapshot */
+    uint8_t led_pulse[2];             /**< led pulse amplitude registers snapshot */
+    uint8_t multi_led[2];             /**< multi led mode control registers snapshot */
+    uint8_t channels;                 /**< channels per sample, 1 (red) or 2 (red and ir) */
+    uint32_t sample_rate_mhz;         /**< effective sample rate in mHz after averaging */
+    uint32_t chunk_samples;           /**< samples per chunk */
+    uint64_t start_time_ns;           /**< CLOCK_REALTIME at the start of the recording */
+} max30102_record_header_t;
+
+/**
+ * @brief max30102 record index entry structure definition
+ */
+typedef struct max30102_record_index_s
+{
+    uint64_t offset;                  /**< file offset of the chunk header */
+    uint64_t first_index;             /**< stream index of the first sample in the chunk */
+    uint64_t t_first;                 /**< timestamp of the first sample in ns */
+} max30102_record_index_t;
+
+/**
+ * @brief max30102 record chunk information structure definition
+ */
+typedef struct max30102_record_chunk_s
+{
+    uint8_t encoding;                 /**< max30102_record_encoding_t */
+    uint8_t channels;                 /**< channels in the payload */
+    uint32_t count;                   /**< samples per channel */
+    uint32_t payload_size;            /**< payload bytes following the chunk header */
+    uint64_t first_index;             /**< stream index of the first sample */
+    uint64_t t_first;                 /**< timestamp of the first sample in ns */
+    uint64_t t_last;                  /**< timestamp of the last sample in ns */
+    uint32_t crc;                     /**< crc32 of the payload */
+} max30102_record_chunk_t;
+
+/**
+ * @brief max30102 record writer structure definition
+ */
+typedef struct max30102_record_s
+{
+    int fd;                                                         /**< file descriptor */
+    max30102_record_header_t header;                                /**< file header */
+    uint64_t period_ns;                                             /**< nominal sample period */
+    uint64_t offset;                                                /**< append offset */
+    uint64_t total;                                                 /**< samples written */
+    uint32_t count;                                                 /**< samples pending in the chunk */
+    uint64_t t_first;                                               /**< first pending sample time */
+    uint64_t t_last;                                                /**< last pending sample time */
+    uint32_t sync_interval_ms;                                      /**< fdatasync interval */
+    uint8_t encoding;                                               /**< chunk encoding */
+    uint64_t last_sync_ns;                                          /**< last fdatasync time */
+    max30102_record_index_t *index;                                 /**< chunk index */
+    uint32_t index_count;                                           /**< chunks written */
+    uint32_t index_capacity;                                        /**< allocated index entries */
+    uint32_t red[MAX30102_RECORD_MAX_CHUNK_SAMPLES];                /**< pending red samples */
+    uint32_t ir[MAX30102_RECORD_MAX_CHUNK_SAMPLES];                 /**< pending ir samples */
+    uint8_t buf[MAX30102_RECORD_CHUNK_HEADER_SIZE +
+                MAX30102_CODEC_BOUND(MAX30102_RECORD_MAX_CHUNK_SAMPLES, 2)];    /**< encoded chunk buffer */
+} max30102_record_t;
+
+/**
+ * @brief max30102 record reader structure definition
+ */
+typedef struct max30102_record_reader_s
+{
+    int fd;                                                         /**< file descriptor */
+    const uint8_t *map;                                             /**< read only file mapping */
+    size_t size;                                                    /**< mapping size */
+    max30102_record_header_t header;                                /**< file header */
+    max30102_record_index_t *index;                                 /**< chunk index */
+    uint32_t chunk_count;                                           /**< chunks in the file */
+    uint64_t total;                                                 /**< samples in the file */
+    uint32_t chunk;                                                 /**< decoded chunk number */
+    uint32_t pos;                                                   /**< read position in the decoded chunk */
+    max30102_record_chunk_t info;                                   /**< decoded chunk information */
+    uint32_t red[MAX30102_RECORD_MAX_CHUNK_SAMPLES];                /**< decoded red samples */
+    uint32_t ir[MAX30102_RECORD_MAX_CHUNK_SAMPLES];                 /**< decoded ir samples */
+} max30102_record_reader_t;
+
+/**
+ * @brief      fill a record header from the current chip configuration
+ * @param[in]  *handle pointer to a max30102 handle structure
+ * @param[in]  *device pointer to a device name
+ * @param[out] *header pointer to a record header structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 read config failed
+ *             - 2 handle is NULL
+ * @note       none
+ */
+uint8_t max30102_record_header_from_handle(max30102_handle_t *handle, const char *device, max30102_record_header_t *header);
+
+/**
+ * @brief      fill a record header from raw register values
+ * @param[out] *header pointer to a record header structure
+ * @param[in]  *device pointer to a device name
+ * @param[in]  fifo_config fifo config register
+ * @param[in]  mode_config mode config register
+ * @param[in]  spo2_config spo2 config register
+ * @note       led and slot snapshots are left zero, set them if known
+ */
+void max30102_record_header_from_config(max30102_record_header_t *header, const char *device,
+                                        uint8_t fifo_config, uint8_t mode_config, uint8_t spo2_config);
+
+/**
+ * @brief     create a recording
+ * @param[in] *rec pointer to a record structure
+ * @param[in] *path pointer to a file path
+ * @param[in] *header pointer to a record header structure
+ * @param[in] sync_interval_ms fdatasync interval, 0 syncs only on close
+ * @return    status code
+ *            - 0 success
+ *            - 1 create failed
+ *            - 2 handle is NULL
+ *            - 3 header is invalid
+ * @note      chunks are encoded with MAX30102_RECORD_ENCODING_RICE
+ */
+uint8_t max30102_record_open(max30102_record_t *rec, const char *path, const max30102_record_header_t *header, uint32_t sync_interval_ms);
+
+/**
+ * @brief     set the chunk encoding
+ * @param[in] *rec pointer to a record structure
+ * @param[in] encoding chunk encoding
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ *            - 3 encoding is invalid
+ * @note      applies from the next chunk
+ */
+uint8_t max30102_record_set_encoding(max30102_record_t *rec, max30102_record_encoding_t encoding);
+
+/**
+ * @brief     append a fifo batch
+ * @param[in] *rec pointer to a record structure
+ * @param[in] *raw_red pointer to a red raw data buffer
+ * @param[in] *raw_ir pointer to an ir raw data buffer, ignored for one channel
+ * @param[in] len number of samples
+ * @param[in] timestamp_ns time the last sample of the batch was drained
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ *            - 2 handle is NULL
+ * @note      samples are buffered and written one chunk at a time
+ */
+uint8_t max30102_record_write(max30102_record_t *rec, const uint32_t *raw_red, const uint32_t *raw_ir, uint32_t len, uint64_t timestamp_ns);
+
+/**
+ * @brief     flush the pending chunk and write the index
+ * @param[in] *rec pointer to a record structure
+ * @return    status code
+ *            - 0 success
+ *            - 1 close failed
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_record_close(max30102_record_t *rec);
+
+/**
+ * @brief      read the file header of a recording
+ * @param[in]  *path pointer to a file path
+ * @param[out] *header pointer to a record header structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 read failed
+ *             - 2 handle is NULL
+ *             - 3 file is invalid
+ * @note       does not map the file or load the index
+ */
+uint8_t max30102_record_read_header(const char *path, max30102_record_header_t *header);
+
+/**
+ * @brief     open a recording for reading
+ * @param[in] *rd pointer to a record reader structure
+ * @param[in] *path pointer to a file path
+ * @return    status code
+ *            - 0 success
+ *            - 1 open failed
+ *            - 2 handle is NULL
+ *            - 3 file is invalid
+ * @note      the index is rebuilt by scanning if the file was not closed
+ */
+uint8_t max30102_record_reader_open(max30102_record_reader_t *rd, const char *path);
+
+/**
+ * @brief     close a recording
+ * @param[in] *rd pointer to a record reader structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_record_reader_close(max30102_record_reader_t *rd);
+
+/**
+ * @brief      get one chunk header
+ * @param[in]  *rd pointer to a record reader structure
+ * @param[in]  chunk chunk number
+ * @param[out] *info pointer to a chunk information structure
+ * @param[out] **payload pointer to the mapped payload
+ * @return     status code
+ *             - 0 success
+ *             - 1 chunk is corrupted
+ *             - 2 handle is NULL
+ *             - 4 chunk is out of range
+ * @note       payload may be NULL
+ */
+uint8_t max30102_record_reader_chunk(max30102_record_reader_t *rd, uint32_t chunk, max30102_record_chunk_t *info, const uint8_t **payload);
+
+/**
+ * @brief     seek to a timestamp
+ * @param[in] *rd pointer to a record reader structure
+ * @param[in] timestamp_ns target time in ns
+ * @return    status code
+ *            - 0 success
+ *            - 1 seek failed
+ *            - 2 handle is NULL
+ *            - 4 timestamp is after the end
+ * @note      positions at the first sample at or after the timestamp
+ */
+uint8_t max30102_record_reader_seek(max30102_record_reader_t *rd, uint64_t timestamp_ns);
+
+/**
+ * @brief         read samples
+ * @param[in]     *rd pointer to a record reader structure
+ * @param[out]    *raw_red pointer to a red raw data buffer
+ * @param[out]    *raw_ir pointer to an ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @param[out]    *timestamp_ns pointer to the time of the first returned sample, may be NULL
+ * @return        status code
+ *                - 0 success
+ *                - 1 read failed
+ *                - 2 handle is NULL
+ *                - 4 end of file
+ * @note          never crosses a chunk boundary in one call
+ */
+uint8_t max30102_record_reader_read(max30102_record_reader_t *rd, uint32_t *raw_red, uint32_t *raw_ir, uint32_t *len, uint64_t *timestamp_ns);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
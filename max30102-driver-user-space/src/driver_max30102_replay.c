@@ -0,0 +1,750 @@
+
+
+#include "driver_max30102_replay.h"
+#include <errno.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief chip register definition
+ */
+#define MAX30102_REG_INTERRUPT_STATUS_1          0x00        /**< interrupt status 1 register */
+#define MAX30102_REG_INTERRUPT_STATUS_2          0x01        /**< interrupt status 2 register */
+#define MAX30102_REG_INTERRUPT_ENABLE_1          0x02        /**< interrupt enable 1 register */
+#define MAX30102_REG_INTERRUPT_ENABLE_2          0x03        /**< interrupt enable 2 register */
+#define MAX30102_REG_FIFO_WRITE_POINTER          0x04        /**< fifo write pointer register */
+#define MAX30102_REG_OVERFLOW_COUNTER            0x05        /**< overflow counter register */
+#define MAX30102_REG_FIFO_READ_POINTER           0x06        /**< fifo read pointer register */
+#define MAX30102_REG_FIFO_DATA_REGISTER          0x07        /**< fifo data register */
+#define MAX30102_REG_FIFO_CONFIG                 0x08        /**< fifo config register */
+#define MAX30102_REG_MODE_CONFIG                 0x09        /**< mode config register */
+#define MAX30102_REG_SPO2_CONFIG                 0x0A        /**< spo2 config register */
+#define MAX30102_REG_MULTI_LED_MODE_CONTROL_1    0x11        /**< multi led mode control 1 register */
+#define MAX30102_REG_DIE_TEMP_INTEGER            0x1F        /**< die temperature integer register */
+#define MAX30102_REG_DIE_TEMP_FRACTION           0x20        /**< die temperature fraction register */
+#define MAX30102_REG_DIE_TEMP_CONFIG             0x21        /**< die temperature config register */
+#define MAX30102_REG_REVISION_ID                 0xFE        /**< revision id register */
+#define MAX30102_REG_PART_ID                     0xFF        /**< part id register */
+
+/**
+ * @brief replay fifo depth definition
+ */
+#define REPLAY_FIFO_DEPTH        32        /**< chip fifo depth */
+
+/**
+ * @brief replay state structure definition
+ */
+typedef struct replay_s
+{
+    uint8_t opened;                            /**< opened flag */
+    uint8_t started;                           /**< replay clock started flag */
+    max30102_replay_pacing_t pacing;           /**< pacing */
+    double speed;                              /**< recorded ns per monotonic ns */
+    uint64_t t0_mono;                          /**< monotonic time of the clock start */
+    uint64_t t0_rec;                           /**< recorded time of the clock start */
+    uint8_t has_next;                          /**< next sample is valid */
+    uint32_t next_red;                         /**< next red sample */
+    uint32_t next_ir;                          /**< next ir sample */
+    uint64_t next_t;                           /**< next sample recorded time */
+    uint64_t delivered;                        /**< samples pushed into the fifo */
+    uint32_t red[REPLAY_FIFO_DEPTH];           /**< fifo red samples */
+    uint32_t ir[REPLAY_FIFO_DEPTH];            /**< fifo ir samples */
+    uint8_t rd;                                /**< fifo read pointer */
+    uint8_t count;                             /**< fifo occupancy */
+    uint8_t ovf;                               /**< overflow counter */
+    uint8_t status[2];                         /**< latched interrupt status */
+    uint8_t regs[256];                         /**< register file */
+    float temperature;                         /**< reported die temperature */
+    max30102_record_reader_t reader;           /**< recording reader */
+} replay_t;
+
+static replay_t gs_replay;        /**< replay source */
+
+static uint64_t a_replay_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief  fetch the next recorded sample
+ * @return none
+ * @note   none
+ */
+static void a_replay_fetch(void)
+{
+    uint32_t len;
+
+    len = 1;
+    gs_replay.has_next = (max30102_record_reader_read(&gs_replay.reader, &gs_replay.next_red, &gs_replay.next_ir,
+                                                      &len, &gs_replay.next_t) == 0) ? 1 : 0;
+    if (gs_replay.reader.header.channels < 2)
+    {
+        gs_replay.next_ir = 0;
+    }
+}
+
+/**
+ * @brief  push the next sample into the fifo
+ * @return none
+ * @note   follows FIFO_ROLLOVER_EN when the fifo is full
+ */
+static void a_replay_push(void)
+{
+    uint8_t threshold;
+
+    if (gs_replay.count == REPLAY_FIFO_DEPTH)
+    {
+        if (gs_replay.ovf < 0x1F)
+        {
+            gs_replay.ovf++;
+        }
+        if ((gs_replay.regs[MAX30102_REG_FIFO_CONFIG] & (1 << 4)) == 0)
+        {
+            /* no rollover, the chip drops the new sample */
+            gs_replay.delivered++;
+            a_replay_fetch();
+
+            return;
+        }
+        gs_replay.rd = (gs_replay.rd + 1) % REPLAY_FIFO_DEPTH;
+        gs_replay.count--;
+    }
+    gs_replay.red[(gs_replay.rd + gs_replay.count) % REPLAY_FIFO_DEPTH] = gs_replay.next_red;
+    gs_replay.ir[(gs_replay.rd + gs_replay.count) % REPLAY_FIFO_DEPTH] = gs_replay.next_ir;
+    gs_replay.count++;
+    gs_replay.delivered++;
+    a_replay_fetch();
+
+    /* a_full fires when the free slots drop to FIFO_A_FULL */
+    threshold = REPLAY_FIFO_DEPTH - (gs_replay.regs[MAX30102_REG_FIFO_CONFIG] & 0xF);
+    if (gs_replay.count == threshold)
+    {
+        gs_replay.status[0] |= (1 << MAX30102_INTERRUPT_STATUS_FIFO_FULL);
+    }
+    gs_replay.status[0] |= (1 << MAX30102_INTERRUPT_STATUS_PPG_RDY);
+}
+
+/**
+ * @brief  move the fifo up to the replay clock
+ * @return none
+ * @note   none
+ */
+static void a_replay_advance(void)
+{
+    uint64_t t_rec;
+
+    if (gs_replay.started == 0)
+    {
+        return;
+    }
+    if (gs_replay.pacing == MAX30102_REPLAY_PACING_FAST)
+    {
+        while ((gs_replay.has_next != 0) && (gs_replay.count < REPLAY_FIFO_DEPTH))
+        {
+            a_replay_push();
+        }
+
+        return;
+    }
+
+    t_rec = gs_replay.t0_rec + (uint64_t)((double)(a_replay_now() - gs_replay.t0_mono) * gs_replay.speed);
+    while ((gs_replay.has_next != 0) && (gs_replay.next_t <= t_rec))
+    {
+        a_replay_push();
+    }
+}
+
+/**
+ * @brief  check the emulated interrupt pin
+ * @return 1 if asserted
+ * @note   none
+ */
+static uint8_t a_replay_pin(void)
+{
+    return (((gs_replay.status[0] & gs_replay.regs[MAX30102_REG_INTERRUPT_ENABLE_1]) != 0) ||
+            ((gs_replay.status[0] & (1 << MAX30102_INTERRUPT_STATUS_PWR_RDY)) != 0) ||
+            ((gs_replay.status[1] & gs_replay.regs[MAX30102_REG_INTERRUPT_ENABLE_2]) != 0)) ? 1 : 0;
+}
+
+/**
+ * @brief  emulate a power on reset
+ * @return none
+ * @note   the replay clock keeps running
+ */
+static void a_replay_reset(void)
+{
+    memset(gs_replay.regs, 0, sizeof(gs_replay.regs));
+    gs_replay.regs[MAX30102_REG_REVISION_ID] = 0x03;
+    gs_replay.regs[MAX30102_REG_PART_ID] = 0x15;
+    gs_replay.rd = 0;
+    gs_replay.count = 0;
+    gs_replay.ovf = 0;
+    gs_replay.status[0] = (1 << MAX30102_INTERRUPT_STATUS_PWR_RDY);
+    gs_replay.status[1] = 0;
+}
+
+/**
+ * @brief     open a recording as the replay source
+ * @param[in] *path pointer to a recording made by driver_max30102_record
+ * @param[in] pacing replay pacing
+ * @param[in] speed speed factor for MAX30102_REPLAY_PACING_ACCELERATED
+ * @return    status code
+ *            - 0 success
+ *            - 1 open failed
+ *            - 2 path is NULL
+ *            - 3 speed is invalid
+ * @note      there is one replay source per process, the iic interface
+ *            functions carry no context; the replay clock starts when a
+ *            measurement mode is written to the mode config register
+ */
+uint8_t max30102_replay_open(const char *path, max30102_replay_pacing_t pacing, float speed)
+{
+    if (path == NULL)
+    {
+        return 2;
+    }
+    if ((pacing == MAX30102_REPLAY_PACING_ACCELERATED) && !(speed > 0.0f))
+    {
+        return 3;
+    }
+    if (gs_replay.opened != 0)
+    {
+        (void)max30102_replay_close();
+    }
+
+    memset(&gs_replay, 0, offsetof(replay_t, reader));
+    if (max30102_record_reader_open(&gs_replay.reader, path) != 0)
+    {
+        return 1;
+    }
+    gs_replay.pacing = pacing;
+    gs_replay.speed = (pacing == MAX30102_REPLAY_PACING_ACCELERATED) ? (double)speed : 1.0;
+    gs_replay.temperature = 25.0f;
+    a_replay_reset();
+    a_replay_fetch();
+    gs_replay.opened = 1;
+
+    return 0;
+}
+
+/**
+ * @brief  close the replay source
+ * @return status code
+ *         - 0 success
+ *         - 1 not opened
+ * @note   none
+ */
+uint8_t max30102_replay_close(void)
+{
+    if (gs_replay.opened == 0)
+    {
+        return 1;
+    }
+    (void)max30102_record_reader_close(&gs_replay.reader);
+    gs_replay.opened = 0;
+
+    return 0;
+}
+
+/**
+ * @brief      get the recording header
+ * @param[out] *header pointer to a record header structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 not opened
+ *             - 2 header is NULL
+ * @note       none
+ */
+uint8_t max30102_replay_get_header(max30102_record_header_t *header)
+{
+    if (header == NULL)
+    {
+        return 2;
+    }
+    if (gs_replay.opened == 0)
+    {
+        return 1;
+    }
+    *header = gs_replay.reader.header;
+
+    return 0;
+}
+
+/**
+ * @brief      get the replay progress
+ * @param[out] *delivered pointer to the samples pushed into the fifo so far
+ * @param[out] *total pointer to the samples in the recording
+ * @return     status code
+ *             - 0 success
+ *             - 1 not opened
+ * @note       either pointer may be NULL
+ */
+uint8_t max30102_replay_get_progress(uint64_t *delivered, uint64_t *total)
+{
+    if (gs_replay.opened == 0)
+    {
+        return 1;
+    }
+    if (delivered != NULL)
+    {
+        *delivered = gs_replay.delivered;
+    }
+    if (total != NULL)
+    {
+        *total = gs_replay.reader.total;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     set the die temperature reported by the replay
+ * @param[in] temp temperature in degrees celsius
+ * @return    status code
+ *            - 0 success
+ * @note      recordings do not carry temperature, the default is 25C
+ */
+uint8_t max30102_replay_set_temperature(float temp)
+{
+    gs_replay.temperature = temp;
+
+    return 0;
+}
+
+/**
+ * @brief      get the time of the next paced sample
+ * @param[out] *ns pointer to a CLOCK_MONOTONIC time in ns
+ * @return     status code
+ *             - 0 success
+ *             - 4 end of the recording
+ * @note       the time is now for MAX30102_REPLAY_PACING_FAST
+ */
+uint8_t max30102_replay_next_ns(uint64_t *ns)
+{
+    if ((gs_replay.opened == 0) || (gs_replay.has_next == 0))
+    {
+        return 4;
+    }
+    if ((gs_replay.started == 0) || (gs_replay.pacing == MAX30102_REPLAY_PACING_FAST) ||
+        (gs_replay.next_t <= gs_replay.t0_rec))
+    {
+        *ns = a_replay_now();
+
+        return 0;
+    }
+    *ns = gs_replay.t0_mono + (uint64_t)((double)(gs_replay.next_t - gs_replay.t0_rec) / gs_replay.speed);
+
+    return 0;
+}
+
+/**
+ * @brief     wait for the emulated interrupt pin
+ * @param[in] timeout_ms timeout in ms, 0 polls
+ * @return    status code
+ *            - 0 interrupt is pending, call max30102_irq_handler
+ *            - 1 timeout
+ *            - 4 end of the recording
+ * @note      the pin is the or of the enabled interrupt status bits
+ */
+uint8_t max30102_replay_wait(uint32_t timeout_ms)
+{
+    uint64_t deadline;
+
+    if (gs_replay.opened == 0)
+    {
+        return 4;
+    }
+
+    deadline = a_replay_now() + (uint64_t)timeout_ms * 1000000ULL;
+    while (1)
+    {
+        uint64_t next;
+        struct timespec ts;
+
+        a_replay_advance();
+        if (a_replay_pin() != 0)
+        {
+            return 0;
+        }
+        if (gs_replay.has_next == 0)
+        {
+            return 4;
+        }
+        if ((gs_replay.started == 0) || (gs_replay.pacing == MAX30102_REPLAY_PACING_FAST))
+        {
+            /* nothing will change without register access */
+            next = deadline;
+        }
+        else
+        {
+            (void)max30102_replay_next_ns(&next);
+        }
+        if (next >= deadline)
+        {
+            if (a_replay_now() >= deadline)
+            {
+                return 1;
+            }
+            next = deadline;
+        }
+        ts.tv_sec = (time_t)(next / 1000000000ULL);
+        ts.tv_nsec = (long)(next % 1000000000ULL);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        {
+        }
+    }
+}
+
+/**
+ * @brief         pop samples straight from the emulated fifo
+ * @param[out]    *raw_red pointer to a red raw data buffer
+ * @param[out]    *raw_ir pointer to an ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @param[out]    *overflow pointer to the samples lost since the last pop, may be NULL
+ * @return        status code
+ *                - 0 success
+ *                - 1 not opened
+ *                - 2 buffer is NULL
+ * @note          bypasses the register interface, for the fake character device
+ */
+uint8_t max30102_replay_fifo_read(uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len, uint8_t *overflow)
+{
+    uint8_t i;
+
+    if ((raw_red == NULL) || (raw_ir == NULL) || (len == NULL))
+    {
+        return 2;
+    }
+    if (gs_replay.opened == 0)
+    {
+        return 1;
+    }
+
+    a_replay_advance();
+    *len = (*len > gs_replay.count) ? gs_replay.count : *len;
+    for (i = 0; i < *len; i++)
+    {
+        raw_red[i] = gs_replay.red[gs_replay.rd];
+        raw_ir[i] = gs_replay.ir[gs_replay.rd];
+        gs_replay.rd = (gs_replay.rd + 1) % REPLAY_FIFO_DEPTH;
+    }
+    gs_replay.count -= *len;
+    if (overflow != NULL)
+    {
+        *overflow = gs_replay.ovf;
+    }
+    gs_replay.ovf = 0;
+    gs_replay.status[0] &= ~(1 << MAX30102_INTERRUPT_STATUS_FIFO_FULL);
+
+    return 0;
+}
+
+/**
+ * @brief  replay iic bus init
+ * @return status code
+ *         - 0 success
+ *         - 1 not opened
+ * @note   none
+ */
+uint8_t max30102_replay_iic_init(void)
+{
+    return (gs_replay.opened != 0) ? 0 : 1;
+}
+
+/**
+ * @brief  replay iic bus deinit
+ * @return status code
+ *         - 0 success
+ * @note   none
+ */
+uint8_t max30102_replay_iic_deinit(void)
+{
+    return 0;
+}
+
+/**
+ * @brief     read one fifo sample as the chip would shift it out
+ * @param[in] *buf pointer to a 12 byte buffer
+ * @return    bytes per sample
+ * @note      samples are left aligned for the configured adc resolution
+ *            so max30102_read returns the recorded value; in multi led mode
+ *            every slot set to red or ir adds its 3 bytes in slot order
+ */
+static uint8_t a_replay_fifo_sample(uint8_t *buf)
+{
+    uint8_t shift;
+    uint8_t mode;
+    uint8_t led[4];
+    uint8_t n;
+    uint8_t i;
+    uint32_t red;
+    uint32_t ir;
+    uint32_t v;
+
+    red = 0;
+    ir = 0;
+    if (gs_replay.count != 0)
+    {
+        red = gs_replay.red[gs_replay.rd];
+        ir = gs_replay.ir[gs_replay.rd];
+        gs_replay.rd = (gs_replay.rd + 1) % REPLAY_FIFO_DEPTH;
+        gs_replay.count--;
+        gs_replay.ovf = 0;
+    }
+    shift = 3 - (gs_replay.regs[MAX30102_REG_SPO2_CONFIG] & 0x3);
+    mode = gs_replay.regs[MAX30102_REG_MODE_CONFIG] & 0x7;
+    n = 0;
+    if (mode == MAX30102_MODE_HEART_RATE)
+    {
+        led[n++] = MAX30102_LED_RED;
+    }
+    else if (mode == MAX30102_MODE_MULTI_LED)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            v = (gs_replay.regs[MAX30102_REG_MULTI_LED_MODE_CONTROL_1 + i / 2] >> ((i % 2) * 4)) & 0x7;
+            if ((v == MAX30102_LED_RED) || (v == MAX30102_LED_IR))
+            {
+                led[n++] = (uint8_t)v;
+            }
+        }
+    }
+    else
+    {
+        led[n++] = MAX30102_LED_RED;
+        led[n++] = MAX30102_LED_IR;
+    }
+    for (i = 0; i < n; i++)
+    {
+        v = ((led[i] == MAX30102_LED_RED) ? red : ir) << shift;
+        buf[i * 3 + 0] = (uint8_t)(v >> 16);
+        buf[i * 3 + 1] = (uint8_t)(v >> 8);
+        buf[i * 3 + 2] = (uint8_t)(v >> 0);
+    }
+
+    return (uint8_t)(n * 3);
+}
+
+/**
+ * @brief      replay iic bus read
+ * @param[in]  addr iic device write address
+ * @param[in]  reg iic register address
+ * @param[out] *buf pointer to a data buffer
+ * @param[in]  len length of the data buffer
+ * @return     status code
+ *             - 0 success
+ *             - 1 read failed
+ * @note       registers auto increment except the fifo data register
+ */
+uint8_t max30102_replay_iic_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    uint16_t i;
+
+    (void)addr;
+    if ((gs_replay.opened == 0) || (buf == NULL))
+    {
+        return 1;
+    }
+
+    a_replay_advance();
+    if (reg == MAX30102_REG_FIFO_DATA_REGISTER)
+    {
+        uint8_t sample[12];
+        uint8_t k;
+
+        i = 0;
+        while (i < len)
+        {
+            k = a_replay_fifo_sample(sample);
+            if (k == 0)
+            {
+                /* no slot is active, the chip shifts out nothing useful */
+                memset(&buf[i], 0, len - i);
+
+                break;
+            }
+            memcpy(&buf[i], sample, ((len - i) < k) ? (len - i) : k);
+            i += k;
+        }
+        /* a fifo data read clears a_full and ppg_rdy */
+        gs_replay.status[0] &= ~((1 << MAX30102_INTERRUPT_STATUS_FIFO_FULL) | (1 << MAX30102_INTERRUPT_STATUS_PPG_RDY));
+
+        return 0;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        uint8_t r = (uint8_t)(reg + i);
+
+        switch (r)
+        {
+            case MAX30102_REG_INTERRUPT_STATUS_1 :
+            {
+                buf[i] = gs_replay.status[0];
+                gs_replay.status[0] = 0;
+
+                break;
+            }
+            case MAX30102_REG_INTERRUPT_STATUS_2 :
+            {
+                buf[i] = gs_replay.status[1];
+                gs_replay.status[1] = 0;
+
+                break;
+            }
+            case MAX30102_REG_FIFO_WRITE_POINTER :
+            {
+                buf[i] = (gs_replay.rd + gs_replay.count) % REPLAY_FIFO_DEPTH;
+
+                break;
+            }
+            case MAX30102_REG_OVERFLOW_COUNTER :
+            {
+                buf[i] = gs_replay.ovf;
+
+                break;
+            }
+            case MAX30102_REG_FIFO_READ_POINTER :
+            {
+                buf[i] = gs_replay.rd;
+
+                break;
+            }
+            case MAX30102_REG_DIE_TEMP_INTEGER :
+            {
+                buf[i] = (uint8_t)(int8_t)gs_replay.temperature;
+
+                break;
+            }
+            case MAX30102_REG_DIE_TEMP_FRACTION :
+            {
+                buf[i] = (uint8_t)((gs_replay.temperature - (float)(int8_t)gs_replay.temperature) * 16.0f) & 0xF;
+
+                break;
+            }
+            default :
+            {
+                buf[i] = gs_replay.regs[r];
+
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     replay iic bus write
+ * @param[in] addr iic device write address
+ * @param[in] reg iic register address
+ * @param[in] *buf pointer to a data buffer
+ * @param[in] len length of the data buffer
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ * @note      none
+ */
+uint8_t max30102_replay_iic_write(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    uint16_t i;
+
+    (void)addr;
+    if ((gs_replay.opened == 0) || (buf == NULL))
+    {
+        return 1;
+    }
+
+    a_replay_advance();
+    for (i = 0; i < len; i++)
+    {
+        uint8_t r = (uint8_t)(reg + i);
+
+        switch (r)
+        {
+            case MAX30102_REG_FIFO_WRITE_POINTER :
+            {
+                gs_replay.count = (uint8_t)((buf[i] - gs_replay.rd) % REPLAY_FIFO_DEPTH);
+
+                break;
+            }
+            case MAX30102_REG_OVERFLOW_COUNTER :
+            {
+                gs_replay.ovf = buf[i] & 0x1F;
+
+                break;
+            }
+            case MAX30102_REG_FIFO_READ_POINTER :
+            {
+                gs_replay.rd = buf[i] % REPLAY_FIFO_DEPTH;
+                gs_replay.count = 0;
+
+                break;
+            }
+            case MAX30102_REG_MODE_CONFIG :
+            {
+                if ((buf[i] & (1 << 6)) != 0)
+                {
+                    a_replay_reset();
+
+                    break;
+                }
+                gs_replay.regs[r] = buf[i];
+                if ((gs_replay.started == 0) && ((buf[i] & 0x80) == 0) && ((buf[i] & 0x7) != 0))
+                {
+                    /* the chip starts sampling once a mode is set */
+                    gs_replay.started = 1;
+                    gs_replay.t0_mono = a_replay_now();
+                    gs_replay.t0_rec = gs_replay.next_t;
+                }
+
+                break;
+            }
+            case MAX30102_REG_DIE_TEMP_CONFIG :
+            {
+                /* conversion completes at once, TEMP_EN self clears */
+                if ((buf[i] & 0x1) != 0)
+                {
+                    gs_replay.status[1] |= (1 << MAX30102_INTERRUPT_STATUS_DIE_TEMP_RDY);
+                }
+
+                break;
+            }
+            case MAX30102_REG_INTERRUPT_STATUS_1 :
+            case MAX30102_REG_INTERRUPT_STATUS_2 :
+            case MAX30102_REG_FIFO_DATA_REGISTER :
+            case MAX30102_REG_REVISION_ID :
+            case MAX30102_REG_PART_ID :
+            {
+                break;
+            }
+            default :
+            {
+                gs_replay.regs[r] = buf[i];
+
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     replay delay
+ * @param[in] ms time in ms
+ * @note      scaled by the pacing, no delay for MAX30102_REPLAY_PACING_FAST
+ */
+void max30102_replay_delay_ms(uint32_t ms)
+{
+    if (gs_replay.pacing == MAX30102_REPLAY_PACING_FAST)
+    {
+        return;
+    }
+    (void)usleep((useconds_t)((double)ms * 1000.0 / gs_replay.speed));
+}
@@ -0,0 +1,192 @@
+
+#ifndef DRIVER_MAX30102_REPLAY_H
+#define DRIVER_MAX30102_REPLAY_H
+
+#include "driver_max30102_record.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @defgroup max30102_replay_driver max30102 replay driver function
+ * @brief    max30102 replay driver modules
+ * @ingroup  max30102_driver
+ * @{
+ */
+
+/**
+ * @brief max30102 replay pacing enumeration definition
+ */
+typedef enum
+{
+    MAX30102_REPLAY_PACING_REALTIME    = 0x00,        /**< samples appear at their recorded times */
+    MAX30102_REPLAY_PACING_ACCELERATED = 0x01,        /**< recorded times divided by the speed factor */
+    MAX30102_REPLAY_PACING_FAST        = 0x02,        /**< fifo is refilled as soon as it is read */
+} max30102_replay_pacing_t;
+
+/**
+ * @brief     link the replay backend into a max30102 handle
+ * @param[in] HANDLE pointer to a max30102 handle structure
+ * @note      debug_print and receive_callback are left to the caller
+ */
+#define DRIVER_MAX30102_LINK_REPLAY(HANDLE)                                   \
+    do                                                                        \
+    {                                                                         \
+        DRIVER_MAX30102_LINK_IIC_INIT(HANDLE, max30102_replay_iic_init);      \
+        DRIVER_MAX30102_LINK_IIC_DEINIT(HANDLE, max30102_replay_iic_deinit);  \
+        DRIVER_MAX30102_LINK_IIC_READ(HANDLE, max30102_replay_iic_read);      \
+        DRIVER_MAX30102_LINK_IIC_WRITE(HANDLE, max30102_replay_iic_write);    \
+        DRIVER_MAX30102_LINK_DELAY_MS(HANDLE, max30102_replay_delay_ms);      \
+    } while (0)
+
+/**
+ * @brief     open a recording as the replay source
+ * @param[in] *path pointer to a recording made by driver_max30102_record
+ * @param[in] pacing replay pacing
+ * @param[in] speed speed factor for MAX30102_REPLAY_PACING_ACCELERATED
+ * @return    status code
+ *            - 0 success
+ *            - 1 open failed
+ *            - 2 path is NULL
+ *            - 3 speed is invalid
+ * @note      there is one replay source per process, the iic interface
+ *            functions carry no context; the replay clock starts when a
+ *            measurement mode is written to the mode config register
+ */
+uint8_t max30102_replay_open(const char *path, max30102_replay_pacing_t pacing, float speed);
+
+/**
+ * @brief  close the replay source
+ * @return status code
+ *         - 0 success
+ *         - 1 not opened
+ * @note   none
+ */
+uint8_t max30102_replay_close(void);
+
+/**
+ * @brief      get the recording header
+ * @param[out] *header pointer to a record header structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 not opened
+ *             - 2 header is NULL
+ * @note       none
+ */
+uint8_t max30102_replay_get_header(max30102_record_header_t *header);
+
+/**
+ * @brief      get the replay progress
+ * @param[out] *delivered pointer to the samples pushed into the fifo so far
+ * @param[out] *total pointer to the samples in the recording
+ * @return     status code
+ *             - 0 success
+ *             - 1 not opened
+ * @note       either pointer may be NULL
+ */
+uint8_t max30102_replay_get_progress(uint64_t *delivered, uint64_t *total);
+
+/**
+ * @brief     set the die temperature reported by the replay
+ * @param[in] temp temperature in degrees celsius
+ * @return    status code
+ *            - 0 success
+ * @note      recordings do not carry temperature, the default is 25C
+ */
+uint8_t max30102_replay_set_temperature(float temp);
+
+/**
+ * @brief     wait for the emulated interrupt pin
+ * @param[in] timeout_ms timeout in ms, 0 polls
+ * @return    status code
+ *            - 0 interrupt is pending, call max30102_irq_handler
+ *            - 1 timeout
+ *            - 4 end of the recording
+ * @note      the pin is the or of the enabled interrupt status bits
+ */
+uint8_t max30102_replay_wait(uint32_t timeout_ms);
+
+/**
+ * @brief      get the time of the next paced sample
+ * @param[out] *ns pointer to a CLOCK_MONOTONIC time in ns
+ * @return     status code
+ *             - 0 success
+ *             - 4 end of the recording
+ * @note       the time is now for MAX30102_REPLAY_PACING_FAST
+ */
+uint8_t max30102_replay_next_ns(uint64_t *ns);
+
+/**
+ * @brief         pop samples straight from the emulated fifo
+ * @param[out]    *raw_red pointer to a red raw data buffer
+ * @param[out]    *raw_ir pointer to an ir raw data buffer
+ * @param[in,out] *len pointer to a length buffer
+ * @param[out]    *overflow pointer to the samples lost since the last pop, may be NULL
+ * @return        status code
+ *                - 0 success
+ *                - 1 not opened
+ *                - 2 buffer is NULL
+ * @note          bypasses the register interface, for the fake character device
+ */
+uint8_t max30102_replay_fifo_read(uint32_t *raw_red, uint32_t *raw_ir, uint8_t *len, uint8_t *overflow);
+
+/**
+ * @brief  replay iic bus init
+ * @return status code
+ *         - 0 success
+ *         - 1 not opened
+ * @note   none
+ */
+uint8_t max30102_replay_iic_init(void);
+
+/**
+ * @brief  replay iic bus deinit
+ * @return status code
+ *         - 0 success
+ * @note   none
+ */
+uint8_t max30102_replay_iic_deinit(void);
+
+/**
+ * @brief      replay iic bus read
+ * @param[in]  addr iic device write address
+ * @param[in]  reg iic register address
+ * @param[out] *buf pointer to a data buffer
+ * @param[in]  len length of the data buffer
+ * @return     status code
+ *             - 0 success
+ *             - 1 read failed
+ * @note       registers auto increment except the fifo data register
+ */
+uint8_t max30102_replay_iic_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len);
+
+/**
+ * @brief     replay iic bus write
+ * @param[in] addr iic device write address
+ * @param[in] reg iic register address
+ * @param[in] *buf pointer to a data buffer
+ * @param[in] len length of the data buffer
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ * @note      none
+ */
+uint8_t max30102_replay_iic_write(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len);
+
+/**
+ * @brief     replay delay
+ * @param[in] ms time in ms
+ * @note      scaled by the pacing, no delay for MAX30102_REPLAY_PACING_FAST
+ */
+void max30102_replay_delay_ms(uint32_t ms);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
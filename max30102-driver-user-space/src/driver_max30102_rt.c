@@ -0,0 +1,328 @@
+
+
+#define _GNU_SOURCE        /**< pthread_setaffinity_np and the cpu set macros */
+
+#include "driver_max30102_rt.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/**
+ * @brief rt latency thread structure definition
+ */
+typedef struct rt_latency_run_s
+{
+    const max30102_rt_config_t *config;        /**< settings, NULL for the defaults */
+    uint64_t period_ns;                        /**< wake up period */
+    uint32_t loops;                            /**< wake ups */
+    uint64_t *late_ns;                         /**< lateness of every wake up */
+    uint8_t applied;                           /**< settings that took effect */
+    uint8_t res;                               /**< thread result */
+} rt_latency_run_t;
+
+static uint64_t a_rt_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief touch the stack the thread will use
+ * @note  kept out of line so the array is a real stack frame
+ */
+static void __attribute__((noinline)) a_rt_prefault_stack(void)
+{
+    volatile uint8_t stack[MAX30102_RT_STACK_PREFAULT];
+    size_t i;
+    long page;
+
+    page = sysconf(_SC_PAGESIZE);
+    if (page <= 0)
+    {
+        page = 4096;
+    }
+    for (i = 0; i < sizeof(stack); i += (size_t)page)
+    {
+        stack[i] = 0;
+    }
+}
+
+/**
+ * @brief     compare two latencies for qsort
+ * @param[in] *a pointer to the first latency
+ * @param[in] *b pointer to the second latency
+ * @return    ordering
+ * @note      none
+ */
+static int a_rt_compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief     latency thread
+ * @param[in] *arg pointer to a rt latency run structure
+ * @return    NULL
+ * @note      none
+ */
+static void *a_rt_latency_thread(void *arg)
+{
+    rt_latency_run_t *run = (rt_latency_run_t *)arg;
+    struct timespec ts;
+    uint64_t deadline;
+    uint32_t i;
+    int ret;
+
+    run->applied = 0;
+    if (run->config != NULL)
+    {
+        (void)max30102_rt_apply(run->config, &run->applied);
+    }
+    (void)max30102_rt_prefault(run->late_ns, sizeof(uint64_t) * run->loops);
+
+    deadline = a_rt_now() + run->period_ns;
+    for (i = 0; i < run->loops; i++)
+    {
+        ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+        ts.tv_nsec = (long)(deadline % 1000000000ULL);
+        do
+        {
+            ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        } while (ret == EINTR);
+        if (ret != 0)
+        {
+            run->res = 1;
+
+            return NULL;
+        }
+        run->late_ns[i] = a_rt_now() - deadline;
+        deadline += run->period_ns;
+    }
+    run->res = 0;
+
+    return NULL;
+}
+
+/**
+ * @brief     initialize a config that changes nothing
+ * @param[in] *config pointer to a max30102 rt config structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_rt_config_init(max30102_rt_config_t *config)
+{
+    if (config == NULL)
+    {
+        return 2;
+    }
+
+    config->priority = 0;
+    config->cpu = -1;
+    config->lock_memory = 0;
+
+    return 0;
+}
+
+/**
+ * @brief      apply the config to the calling thread
+ * @param[in]  *config pointer to a max30102 rt config structure
+ * @param[out] *applied pointer to the max30102_rt_applied_t bits that took effect, may be NULL
+ * @return     status code
+ *             - 0 success
+ *             - 1 a setting was refused, usually for lack of CAP_SYS_NICE or CAP_IPC_LOCK
+ *             - 2 handle is NULL
+ *             - 3 config is invalid
+ * @note       every setting is attempted even when an earlier one fails, call
+ *             it first thing in the acquisition thread
+ */
+uint8_t max30102_rt_apply(const max30102_rt_config_t *config, uint8_t *applied)
+{
+    struct sched_param param;
+    cpu_set_t set;
+    uint8_t done;
+    uint8_t res;
+
+    if (config == NULL)
+    {
+        return 2;
+    }
+    if ((config->priority < 0) || (config->priority > 99) || (config->cpu < -1) || (config->cpu >= CPU_SETSIZE))
+    {
+        return 3;
+    }
+
+    done = 0;
+    res = 0;
+
+    /* memory first, so the stack touched below stays resident */
+    if (config->lock_memory != 0)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+        {
+            done |= MAX30102_RT_APPLIED_MLOCK;
+        }
+        else
+        {
+            res = 1;
+        }
+        a_rt_prefault_stack();
+    }
+    if (config->cpu >= 0)
+    {
+        CPU_ZERO(&set);
+        CPU_SET(config->cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+        {
+            done |= MAX30102_RT_APPLIED_AFFINITY;
+        }
+        else
+        {
+            res = 1;
+        }
+    }
+    if (config->priority > 0)
+    {
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = config->priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0)
+        {
+            done |= MAX30102_RT_APPLIED_SCHED_FIFO;
+        }
+        else
+        {
+            res = 1;
+        }
+    }
+    if (applied != NULL)
+    {
+        *applied = done;
+    }
+
+    return res;
+}
+
+/**
+ * @brief     touch every page of a buffer
+ * @param[in] *buf pointer to a buffer
+ * @param[in] len buffer length
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      with memory locked the pages then stay resident, so the first
+ *            fifo drain into a fresh buffer does not take page faults
+ */
+uint8_t max30102_rt_prefault(void *buf, size_t len)
+{
+    volatile uint8_t *p = (volatile uint8_t *)buf;
+    size_t i;
+    long page;
+
+    if (buf == NULL)
+    {
+        return 2;
+    }
+
+    page = sysconf(_SC_PAGESIZE);
+    if (page <= 0)
+    {
+        page = 4096;
+    }
+    for (i = 0; i < len; i += (size_t)page)
+    {
+        p[i] = p[i];
+    }
+    if (len != 0)
+    {
+        p[len - 1] = p[len - 1];
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      measure the wake up latency of a periodic thread
+ * @param[in]  *config pointer to a max30102 rt config structure, NULL for the defaults
+ * @param[in]  period_us wake up period
+ * @param[in]  loops number of wake ups
+ * @param[out] *latency pointer to a max30102 rt latency structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 measure failed
+ *             - 2 handle is NULL
+ *             - 3 param is invalid
+ * @note       runs a new thread that sleeps to absolute deadlines with
+ *             clock_nanosleep, like the poll path, and records how late each
+ *             wake up is; a refused setting is reported in applied, not as
+ *             an error; locked memory stays locked afterwards
+ */
+uint8_t max30102_rt_latency(const max30102_rt_config_t *config, uint32_t period_us, uint32_t loops,
+                            max30102_rt_latency_t *latency)
+{
+    rt_latency_run_t run;
+    pthread_t tid;
+    uint64_t sum;
+    uint32_t i;
+
+    if (latency == NULL)
+    {
+        return 2;
+    }
+    if ((period_us == 0) || (loops == 0))
+    {
+        return 3;
+    }
+
+    memset(&run, 0, sizeof(run));
+    run.config = config;
+    run.period_ns = (uint64_t)period_us * 1000ULL;
+    run.loops = loops;
+    run.res = 1;
+    run.late_ns = (uint64_t *)malloc(sizeof(uint64_t) * loops);
+    if (run.late_ns == NULL)
+    {
+        return 1;
+    }
+    memset(run.late_ns, 0, sizeof(uint64_t) * loops);
+    if (pthread_create(&tid, NULL, a_rt_latency_thread, &run) != 0)
+    {
+        free(run.late_ns);
+
+        return 1;
+    }
+    (void)pthread_join(tid, NULL);
+    if (run.res != 0)
+    {
+        free(run.late_ns);
+
+        return 1;
+    }
+
+    sum = 0;
+    for (i = 0; i < loops; i++)
+    {
+        sum += run.late_ns[i];
+    }
+    qsort(run.late_ns, loops, sizeof(uint64_t), a_rt_compare);
+    latency->loops = loops;
+    latency->applied = run.applied;
+    latency->min_ns = run.late_ns[0];
+    latency->mean_ns = sum / loops;
+    latency->p99_ns = run.late_ns[(uint64_t)loops * 99 / 100];
+    latency->max_ns = run.late_ns[loops - 1];
+    free(run.late_ns);
+
+    return 0;
+}
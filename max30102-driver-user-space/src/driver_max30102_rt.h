@@ -0,0 +1,122 @@
+
+#ifndef DRIVER_MAX30102_RT_H
+#define DRIVER_MAX30102_RT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @defgroup max30102_rt_driver max30102 real-time driver function
+ * @brief    max30102 real-time driver modules
+ * @ingroup  max30102_driver
+ * @{
+ */
+
+/**
+ * @brief max30102 rt parameter definition
+ */
+#define MAX30102_RT_DEFAULT_PRIORITY        80               /**< above the threaded irq handlers at 50, below the kernel housekeeping at 99 */
+#define MAX30102_RT_STACK_PREFAULT          (64 * 1024)      /**< stack bytes touched after locking memory */
+
+/**
+ * @brief max30102 rt applied enumeration definition
+ */
+typedef enum
+{
+    MAX30102_RT_APPLIED_SCHED_FIFO = (1 << 0),        /**< SCHED_FIFO priority set */
+    MAX30102_RT_APPLIED_AFFINITY   = (1 << 1),        /**< thread pinned to the cpu */
+    MAX30102_RT_APPLIED_MLOCK      = (1 << 2),        /**< process memory locked */
+} max30102_rt_applied_t;
+
+/**
+ * @brief max30102 rt config structure definition
+ * @note  zero initialized means no change
+ */
+typedef struct max30102_rt_config_s
+{
+    int32_t priority;             /**< SCHED_FIFO priority 1 to 99, 0 keeps the default policy */
+    int32_t cpu;                  /**< cpu the thread is pinned to, -1 keeps the inherited mask */
+    uint8_t lock_memory;          /**< lock current and future pages and prefault the stack */
+} max30102_rt_config_t;
+
+/**
+ * @brief max30102 rt latency structure definition
+ */
+typedef struct max30102_rt_latency_s
+{
+    uint32_t loops;               /**< wake ups measured */
+    uint8_t applied;              /**< max30102_rt_applied_t bits that took effect */
+    uint64_t min_ns;              /**< earliest wake up after the deadline */
+    uint64_t mean_ns;             /**< mean lateness */
+    uint64_t p99_ns;              /**< 99th percentile lateness */
+    uint64_t max_ns;              /**< worst-case lateness */
+} max30102_rt_latency_t;
+
+/**
+ * @brief     initialize a config that changes nothing
+ * @param[in] *config pointer to a max30102 rt config structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_rt_config_init(max30102_rt_config_t *config);
+
+/**
+ * @brief      apply the config to the calling thread
+ * @param[in]  *config pointer to a max30102 rt config structure
+ * @param[out] *applied pointer to the max30102_rt_applied_t bits that took effect, may be NULL
+ * @return     status code
+ *             - 0 success
+ *             - 1 a setting was refused, usually for lack of CAP_SYS_NICE or CAP_IPC_LOCK
+ *             - 2 handle is NULL
+ *             - 3 config is invalid
+ * @note       every setting is attempted even when an earlier one fails, call
+ *             it first thing in the acquisition thread
+ */
+uint8_t max30102_rt_apply(const max30102_rt_config_t *config, uint8_t *applied);
+
+/**
+ * @brief     touch every page of a buffer
+ * @param[in] *buf pointer to a buffer
+ * @param[in] len buffer length
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      with memory locked the pages then stay resident, so the first
+ *            fifo drain into a fresh buffer does not take page faults
+ */
+uint8_t max30102_rt_prefault(void *buf, size_t len);
+
+/**
+ * @brief      measure the wake up latency of a periodic thread
+ * @param[in]  *config pointer to a max30102 rt config structure, NULL for the defaults
+ * @param[in]  period_us wake up period
+ * @param[in]  loops number of wake ups
+ * @param[out] *latency pointer to a max30102 rt latency structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 measure failed
+ *             - 2 handle is NULL
+ *             - 3 param is invalid
+ * @note       runs a new thread that sleeps to absolute deadlines with
+ *             clock_nanosleep, like the poll path, and records how late each
+ *             wake up is; a refused setting is reported in applied, not as
+ *             an error; locked memory stays locked afterwards
+ */
+uint8_t max30102_rt_latency(const max30102_rt_config_t *config, uint32_t period_us, uint32_t loops,
+                            max30102_rt_latency_t *latency);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
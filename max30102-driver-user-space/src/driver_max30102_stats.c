@@ -0,0 +1,587 @@
+
+
+#include "driver_max30102_stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief stats counter family structure definition
+ */
+typedef struct stats_counter_s
+{
+    const char *name;            /**< metric name */
+    const char *help;            /**< help text, NULL continues the previous family */
+    const char *op;              /**< op label, NULL for none */
+    size_t offset;               /**< snapshot field */
+} stats_counter_t;
+
+/**
+ * @brief stats histogram family structure definition
+ */
+typedef struct stats_histogram_s
+{
+    const char *name;            /**< metric name */
+    const char *help;            /**< help text, NULL continues the previous family */
+    const char *op;              /**< op label, NULL for none */
+    size_t offset;               /**< snapshot field */
+} stats_histogram_t;
+
+/**
+ * @brief stats text cursor structure definition
+ */
+typedef struct stats_text_s
+{
+    char *buf;                   /**< output */
+    size_t size;                 /**< output size */
+    size_t pos;                  /**< bytes formatted */
+    uint8_t overflow;            /**< output was too small */
+} stats_text_t;
+
+static const stats_counter_t gs_counters[] =
+{
+    {"max30102_iic_transactions_total", "I2C transactions.", "read", offsetof(max30102_stats_snapshot_t, iic_reads)},
+    {"max30102_iic_transactions_total", NULL, "write", offsetof(max30102_stats_snapshot_t, iic_writes)},
+    {"max30102_iic_errors_total", "Failed I2C transactions.", "read", offsetof(max30102_stats_snapshot_t, iic_read_errors)},
+    {"max30102_iic_errors_total", NULL, "write", offsetof(max30102_stats_snapshot_t, iic_write_errors)},
+    {"max30102_iic_bytes_total", "Bytes moved by successful I2C transactions.", "read", offsetof(max30102_stats_snapshot_t, iic_read_bytes)},
+    {"max30102_iic_bytes_total", NULL, "write", offsetof(max30102_stats_snapshot_t, iic_write_bytes)},
+    {"max30102_irq_total", "Interrupt handler runs.", NULL, offsetof(max30102_stats_snapshot_t, irqs)},
+    {"max30102_irq_errors_total", "Failed interrupt handler runs.", NULL, offsetof(max30102_stats_snapshot_t, irq_errors)},
+    {"max30102_fifo_drains_total", "FIFO drains.", NULL, offsetof(max30102_stats_snapshot_t, drains)},
+    {"max30102_fifo_drain_errors_total", "Failed FIFO drains.", NULL, offsetof(max30102_stats_snapshot_t, drain_errors)},
+    {"max30102_samples_total", "Samples delivered.", NULL, offsetof(max30102_stats_snapshot_t, samples)},
+    {"max30102_fifo_overruns_total", "FIFO drains that found an overflow.", NULL, offsetof(max30102_stats_snapshot_t, overruns)},
+    {"max30102_fifo_overrun_samples_total", "Samples lost to FIFO overflows, at most 31 per drain.", NULL,
+     offsetof(max30102_stats_snapshot_t, overrun_samples)},
+};
+
+static const stats_histogram_t gs_histograms[] =
+{
+    {"max30102_iic_duration_seconds", "I2C transaction latency.", "read", offsetof(max30102_stats_snapshot_t, iic_read_latency)},
+    {"max30102_iic_duration_seconds", NULL, "write", offsetof(max30102_stats_snapshot_t, iic_write_latency)},
+    {"max30102_irq_duration_seconds", "Interrupt handler latency including callbacks.", NULL,
+     offsetof(max30102_stats_snapshot_t, irq_latency)},
+    {"max30102_fifo_drain_duration_seconds", "FIFO drain latency.", NULL, offsetof(max30102_stats_snapshot_t, drain_latency)},
+};
+
+static uint64_t a_stats_clock_ns(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void a_stats_add(_Atomic uint64_t *counter, uint64_t value)
+{
+    (void)atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+static void a_stats_observe(max30102_stats_histogram_t *h, uint64_t ns)
+{
+    uint64_t us = (ns + 999) / 1000;
+    uint32_t i;
+
+    i = (us <= 1) ? 0 : (uint32_t)(64 - __builtin_clzll(us - 1));
+    i = (i < MAX30102_STATS_BUCKETS - 1) ? i : MAX30102_STATS_BUCKETS - 1;
+    a_stats_add(&h->bucket[i], 1);
+    a_stats_add(&h->sum_ns, ns);
+    a_stats_add(&h->count, 1);
+}
+
+/**
+ * @brief     driver hook
+ * @param[in] *hook pointer to the hook inside a max30102 stats structure
+ * @param[in] event event type
+ * @param[in] start_ns clock value when the event started
+ * @param[in] res driver status code of the event
+ * @param[in] value event value
+ * @note      relaxed atomic adds only, no locks and no system calls
+ *            besides the clock read
+ */
+static void a_stats_record(max30102_stats_hook_t *hook, max30102_stats_event_t event, uint64_t start_ns, uint8_t res,
+                           uint32_t value)
+{
+    max30102_stats_t *stats = (max30102_stats_t *)hook;
+    max30102_stats_bus_t *bus;
+    uint64_t ns;
+
+    switch (event)
+    {
+        case MAX30102_STATS_EVENT_IIC_READ :
+        case MAX30102_STATS_EVENT_IIC_WRITE :
+        {
+            bus = (event == MAX30102_STATS_EVENT_IIC_READ) ? &stats->iic_read : &stats->iic_write;
+            ns = a_stats_clock_ns() - start_ns;
+            a_stats_add(&bus->transactions, 1);
+            if (res != 0)
+            {
+                a_stats_add(&bus->errors, 1);
+            }
+            else
+            {
+                a_stats_add(&bus->bytes, value);
+            }
+            a_stats_observe(&bus->latency, ns);
+
+            break;
+        }
+        case MAX30102_STATS_EVENT_IRQ :
+        {
+            ns = a_stats_clock_ns() - start_ns;
+            a_stats_add(&stats->irq.runs, 1);
+            if (res != 0)
+            {
+                a_stats_add(&stats->irq.errors, 1);
+            }
+            a_stats_observe(&stats->irq.latency, ns);
+
+            break;
+        }
+        case MAX30102_STATS_EVENT_FIFO_DRAIN :
+        {
+            ns = a_stats_clock_ns() - start_ns;
+            a_stats_add(&stats->fifo.drains, 1);
+            if ((res != 0) && (res != 4))
+            {
+                a_stats_add(&stats->fifo.errors, 1);
+            }
+            a_stats_add(&stats->fifo.samples, value);
+            a_stats_observe(&stats->fifo.latency, ns);
+
+            break;
+        }
+        case MAX30102_STATS_EVENT_OVERRUN :
+        {
+            a_stats_add(&stats->fifo.overruns, 1);
+            a_stats_add(&stats->fifo.overrun_samples, value);
+
+            break;
+        }
+        default :
+        {
+            break;
+        }
+    }
+}
+
+static void a_stats_clear_histogram(max30102_stats_histogram_t *h)
+{
+    uint32_t i;
+
+    atomic_store_explicit(&h->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->sum_ns, 0, memory_order_relaxed);
+    for (i = 0; i < MAX30102_STATS_BUCKETS; i++)
+    {
+        atomic_store_explicit(&h->bucket[i], 0, memory_order_relaxed);
+    }
+}
+
+static void a_stats_clear_bus(max30102_stats_bus_t *bus)
+{
+    atomic_store_explicit(&bus->transactions, 0, memory_order_relaxed);
+    atomic_store_explicit(&bus->errors, 0, memory_order_relaxed);
+    atomic_store_explicit(&bus->bytes, 0, memory_order_relaxed);
+    a_stats_clear_histogram(&bus->latency);
+}
+
+static void a_stats_load_histogram(max30102_stats_histogram_t *h, max30102_stats_snapshot_histogram_t *s)
+{
+    uint32_t i;
+
+    s->count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    s->sum_ns = atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+    for (i = 0; i < MAX30102_STATS_BUCKETS; i++)
+    {
+        s->bucket[i] = atomic_load_explicit(&h->bucket[i], memory_order_relaxed);
+    }
+}
+
+static void a_stats_text(stats_text_t *t, const char *fmt, ...)
+{
+    va_list args;
+    int n;
+
+    if (t->overflow != 0)
+    {
+        return;
+    }
+    va_start(args, fmt);
+    n = vsnprintf(t->buf + t->pos, t->size - t->pos, fmt, args);
+    va_end(args);
+    if ((n < 0) || ((size_t)n >= t->size - t->pos))
+    {
+        t->overflow = 1;
+
+        return;
+    }
+    t->pos += (size_t)n;
+}
+
+static void a_stats_labels(stats_text_t *t, const char *device, const char *op, const char *le)
+{
+    a_stats_text(t, "{device=\"%s\"", device);
+    if (op != NULL)
+    {
+        a_stats_text(t, ",op=\"%s\"", op);
+    }
+    if (le != NULL)
+    {
+        a_stats_text(t, ",le=\"%s\"", le);
+    }
+    a_stats_text(t, "}");
+}
+
+/**
+ * @brief     initialize a statistics registry
+ * @param[in] *stats pointer to a max30102 stats structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      the clock is CLOCK_MONOTONIC
+ */
+uint8_t max30102_stats_init(max30102_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return 2;
+    }
+
+    memset(stats, 0, sizeof(max30102_stats_t));
+    stats->hook.clock_ns = a_stats_clock_ns;
+    stats->hook.record = a_stats_record;
+
+    return 0;
+}
+
+/**
+ * @brief     reset all counters
+ * @param[in] *stats pointer to a max30102 stats structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      safe while the driver is running, events in flight may land
+ *            on either side of the reset
+ */
+uint8_t max30102_stats_reset(max30102_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return 2;
+    }
+
+    a_stats_clear_bus(&stats->iic_read);
+    a_stats_clear_bus(&stats->iic_write);
+    atomic_store_explicit(&stats->irq.runs, 0, memory_order_relaxed);
+    atomic_store_explicit(&stats->irq.errors, 0, memory_order_relaxed);
+    a_stats_clear_histogram(&stats->irq.latency);
+    atomic_store_explicit(&stats->fifo.drains, 0, memory_order_relaxed);
+    atomic_store_explicit(&stats->fifo.errors, 0, memory_order_relaxed);
+    atomic_store_explicit(&stats->fifo.samples, 0, memory_order_relaxed);
+    atomic_store_explicit(&stats->fifo.overruns, 0, memory_order_relaxed);
+    atomic_store_explicit(&stats->fifo.overrun_samples, 0, memory_order_relaxed);
+    a_stats_clear_histogram(&stats->fifo.latency);
+
+    return 0;
+}
+
+/**
+ * @brief      take a snapshot of the counters
+ * @param[in]  *stats pointer to a max30102 stats structure
+ * @param[out] *snapshot pointer to a max30102 stats snapshot structure
+ * @return     status code
+ *             - 0 success
+ *             - 2 handle is NULL
+ * @note       lock free, every counter is read atomically but the
+ *             snapshot is not a single point in time
+ */
+uint8_t max30102_stats_snapshot(max30102_stats_t *stats, max30102_stats_snapshot_t *snapshot)
+{
+    if ((stats == NULL) || (snapshot == NULL))
+    {
+        return 2;
+    }
+
+    snapshot->iic_reads = atomic_load_explicit(&stats->iic_read.transactions, memory_order_relaxed);
+    snapshot->iic_read_errors = atomic_load_explicit(&stats->iic_read.errors, memory_order_relaxed);
+    snapshot->iic_read_bytes = atomic_load_explicit(&stats->iic_read.bytes, memory_order_relaxed);
+    snapshot->iic_writes = atomic_load_explicit(&stats->iic_write.transactions, memory_order_relaxed);
+    snapshot->iic_write_errors = atomic_load_explicit(&stats->iic_write.errors, memory_order_relaxed);
+    snapshot->iic_write_bytes = atomic_load_explicit(&stats->iic_write.bytes, memory_order_relaxed);
+    snapshot->irqs = atomic_load_explicit(&stats->irq.runs, memory_order_relaxed);
+    snapshot->irq_errors = atomic_load_explicit(&stats->irq.errors, memory_order_relaxed);
+    snapshot->drains = atomic_load_explicit(&stats->fifo.drains, memory_order_relaxed);
+    snapshot->drain_errors = atomic_load_explicit(&stats->fifo.errors, memory_order_relaxed);
+    snapshot->samples = atomic_load_explicit(&stats->fifo.samples, memory_order_relaxed);
+    snapshot->overruns = atomic_load_explicit(&stats->fifo.overruns, memory_order_relaxed);
+    snapshot->overrun_samples = atomic_load_explicit(&stats->fifo.overrun_samples, memory_order_relaxed);
+    a_stats_load_histogram(&stats->iic_read.latency, &snapshot->iic_read_latency);
+    a_stats_load_histogram(&stats->iic_write.latency, &snapshot->iic_write_latency);
+    a_stats_load_histogram(&stats->irq.latency, &snapshot->irq_latency);
+    a_stats_load_histogram(&stats->fifo.latency, &snapshot->drain_latency);
+
+    return 0;
+}
+
+/**
+ * @brief      format snapshots in the prometheus text format
+ * @param[in]  *snapshots pointer to snapshots, one per device
+ * @param[in]  **devices pointer to device names, used as the device label
+ * @param[in]  count number of devices
+ * @param[out] *buf pointer to a text buffer
+ * @param[in]  size buffer size
+ * @param[out] *len pointer to the text length without the terminator
+ * @return     status code
+ *             - 0 success
+ *             - 1 buffer is too small
+ *             - 2 handle is NULL
+ * @note       about 6 KiB per device
+ */
+uint8_t max30102_stats_format(const max30102_stats_snapshot_t *snapshots, const char *const *devices, uint32_t count,
+                              char *buf, size_t size, size_t *len)
+{
+    stats_text_t t;
+    uint32_t f;
+    uint32_t d;
+    uint32_t i;
+
+    if ((snapshots == NULL) || (devices == NULL) || (buf == NULL) || (len == NULL) || (size == 0))
+    {
+        return 2;
+    }
+
+    t.buf = buf;
+    t.size = size;
+    t.pos = 0;
+    t.overflow = 0;
+    buf[0] = '\0';
+
+    /* families are grouped across devices as the format requires */
+    for (f = 0; f < sizeof(gs_counters) / sizeof(gs_counters[0]); f++)
+    {
+        const stats_counter_t *c = &gs_counters[f];
+
+        if (c->help != NULL)
+        {
+            a_stats_text(&t, "# HELP %s %s\n# TYPE %s counter\n", c->name, c->help, c->name);
+        }
+        for (d = 0; d < count; d++)
+        {
+            a_stats_text(&t, "%s", c->name);
+            a_stats_labels(&t, devices[d], c->op, NULL);
+            a_stats_text(&t, " %llu\n", (unsigned long long)*(const uint64_t *)((const uint8_t *)&snapshots[d] + c->offset));
+        }
+    }
+    for (f = 0; f < sizeof(gs_histograms) / sizeof(gs_histograms[0]); f++)
+    {
+        const stats_histogram_t *h = &gs_histograms[f];
+
+        if (h->help != NULL)
+        {
+            a_stats_text(&t, "# HELP %s %s\n# TYPE %s histogram\n", h->name, h->help, h->name);
+        }
+        for (d = 0; d < count; d++)
+        {
+            const max30102_stats_snapshot_histogram_t *s;
+            uint64_t cumulative = 0;
+
+            s = (const max30102_stats_snapshot_histogram_t *)((const uint8_t *)&snapshots[d] + h->offset);
+            for (i = 0; i < MAX30102_STATS_BUCKETS; i++)
+            {
+                char le[24];
+
+                if (i < MAX30102_STATS_BUCKETS - 1)
+                {
+                    (void)snprintf(le, sizeof(le), "%g", (double)(1U << i) / 1e6);
+                }
+                else
+                {
+                    (void)snprintf(le, sizeof(le), "+Inf");
+                }
+                cumulative += s->bucket[i];
+                a_stats_text(&t, "%s_bucket", h->name);
+                a_stats_labels(&t, devices[d], h->op, le);
+                a_stats_text(&t, " %llu\n", (unsigned long long)cumulative);
+            }
+            a_stats_text(&t, "%s_sum", h->name);
+            a_stats_labels(&t, devices[d], h->op, NULL);
+            a_stats_text(&t, " %.9f\n", (double)s->sum_ns / 1e9);
+            a_stats_text(&t, "%s_count", h->name);
+            a_stats_labels(&t, devices[d], h->op, NULL);
+            a_stats_text(&t, " %llu\n", (unsigned long long)s->count);
+        }
+    }
+    *len = t.pos;
+
+    return (t.overflow != 0) ? 1 : 0;
+}
+
+/**
+ * @brief      format several registries into a new buffer
+ * @param[in]  **stats pointer to stats structures
+ * @param[in]  **devices pointer to device names
+ * @param[in]  count number of devices
+ * @param[out] **text pointer to the allocated text, freed by the caller
+ * @param[out] *len pointer to the text length
+ * @return     status code
+ *             - 0 success
+ *             - 1 format failed
+ * @note       none
+ */
+static uint8_t a_stats_render(max30102_stats_t *const *stats, const char *const *devices, uint32_t count, char **text,
+                              size_t *len)
+{
+    max30102_stats_snapshot_t *snapshots;
+    size_t size;
+    uint32_t d;
+    uint8_t res;
+
+    snapshots = (max30102_stats_snapshot_t *)calloc((count != 0) ? count : 1, sizeof(max30102_stats_snapshot_t));
+    if (snapshots == NULL)
+    {
+        return 1;
+    }
+    for (d = 0; d < count; d++)
+    {
+        (void)max30102_stats_snapshot(stats[d], &snapshots[d]);
+    }
+    size = 8192 * (size_t)((count != 0) ? count : 1);
+    while (1)
+    {
+        *text = (char *)malloc(size);
+        if (*text == NULL)
+        {
+            res = 1;
+
+            break;
+        }
+        res = max30102_stats_format(snapshots, devices, count, *text, size, len);
+        if (res == 0)
+        {
+            break;
+        }
+        free(*text);
+        *text = NULL;
+        if (res != 1)
+        {
+            break;
+        }
+        size *= 2;
+    }
+    free(snapshots);
+
+    return (res == 0) ? 0 : 1;
+}
+
+/**
+ * @brief     write the prometheus text of several registries to a descriptor
+ * @param[in] **stats pointer to stats structures
+ * @param[in] **devices pointer to device names
+ * @param[in] count number of devices
+ * @param[in] fd file, pipe or connected socket
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_stats_write_fd(max30102_stats_t *const *stats, const char *const *devices, uint32_t count, int fd)
+{
+    char *text;
+    size_t len;
+    size_t done;
+    uint32_t d;
+
+    if ((stats == NULL) || (devices == NULL))
+    {
+        return 2;
+    }
+    for (d = 0; d < count; d++)
+    {
+        if ((stats[d] == NULL) || (devices[d] == NULL))
+        {
+            return 2;
+        }
+    }
+
+    if (a_stats_render(stats, devices, count, &text, &len) != 0)
+    {
+        return 1;
+    }
+    done = 0;
+    while (done < len)
+    {
+        ssize_t n = write(fd, text + done, len - done);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            free(text);
+
+            return 1;
+        }
+        done += (size_t)n;
+    }
+    free(text);
+
+    return 0;
+}
+
+/**
+ * @brief     write the prometheus text of several registries to a file
+ * @param[in] **stats pointer to stats structures
+ * @param[in] **devices pointer to device names
+ * @param[in] count number of devices
+ * @param[in] *path pointer to a file path, e.g. in the node_exporter textfile directory
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ *            - 2 handle is NULL
+ * @note      written to path.tmp and renamed, so scrapers never see a partial file
+ */
+uint8_t max30102_stats_write_file(max30102_stats_t *const *stats, const char *const *devices, uint32_t count,
+                                  const char *path)
+{
+    char tmp[4096];
+    uint8_t res;
+    int fd;
+
+    if (path == NULL)
+    {
+        return 2;
+    }
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+    {
+        return 1;
+    }
+
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    res = max30102_stats_write_fd(stats, devices, count, fd);
+    if (close(fd) != 0)
+    {
+        res = (res == 0) ? 1 : res;
+    }
+    if ((res == 0) && (rename(tmp, path) != 0))
+    {
+        res = 1;
+    }
+    if (res != 0)
+    {
+        (void)unlink(tmp);
+    }
+
+    return res;
+}
@@ -0,0 +1,203 @@
+
+#ifndef DRIVER_MAX30102_STATS_H
+#define DRIVER_MAX30102_STATS_H
+
+#include "driver_max30102.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @defgroup max30102_stats_driver max30102 stats driver function
+ * @brief    max30102 stats driver modules
+ * @ingroup  max30102_driver
+ * @{
+ */
+
+/**
+ * @brief max30102 stats parameter definition
+ */
+#define MAX30102_STATS_BUCKETS          18          /**< latency buckets, 1us to 65.536ms in powers of two and +Inf */
+
+/**
+ * @brief     link a statistics registry into a max30102 handle
+ * @param[in] HANDLE pointer to a max30102 handle structure
+ * @param[in] STATS pointer to an initialized max30102 stats structure
+ * @note      link after DRIVER_MAX30102_LINK_INIT, set the hook to NULL to detach
+ */
+#define DRIVER_MAX30102_LINK_STATS(HANDLE, STATS)    (HANDLE)->stats = &(STATS)->hook
+
+/**
+ * @brief max30102 stats histogram structure definition
+ * @note  bucket i counts durations up to 2^i us, the last bucket the rest
+ */
+typedef struct max30102_stats_histogram_s
+{
+    _Atomic uint64_t count;                                  /**< observations */
+    _Atomic uint64_t sum_ns;                                 /**< sum of durations */
+    _Atomic uint64_t bucket[MAX30102_STATS_BUCKETS];         /**< per bucket observations, not cumulative */
+} max30102_stats_histogram_t;
+
+/**
+ * @brief max30102 stats bus structure definition
+ */
+typedef struct max30102_stats_bus_s
+{
+    _Atomic uint64_t transactions;                           /**< transactions */
+    _Atomic uint64_t errors;                                 /**< failed transactions */
+    _Atomic uint64_t bytes;                                  /**< bytes of successful transactions */
+    max30102_stats_histogram_t latency;                      /**< transaction latency */
+} max30102_stats_bus_t;
+
+/**
+ * @brief max30102 stats structure definition
+ * @note  every group is updated by one path and sits on its own cache line,
+ *        so the irq and reader threads never write the same line
+ */
+typedef struct max30102_stats_s
+{
+    max30102_stats_hook_t hook;                                      /**< driver hook, must stay first */
+    max30102_stats_bus_t iic_read __attribute__((aligned(64)));      /**< iic reads */
+    max30102_stats_bus_t iic_write __attribute__((aligned(64)));     /**< iic writes */
+    struct
+    {
+        _Atomic uint64_t runs;                                       /**< handler runs */
+        _Atomic uint64_t errors;                                     /**< failed runs */
+        max30102_stats_histogram_t latency;                          /**< handler latency */
+    } irq __attribute__((aligned(64)));                              /**< irq handler */
+    struct
+    {
+        _Atomic uint64_t drains;                                     /**< max30102_read calls */
+        _Atomic uint64_t errors;                                     /**< failed calls */
+        _Atomic uint64_t samples;                                    /**< samples delivered */
+        _Atomic uint64_t overruns;                                   /**< drains that found an overflow */
+        _Atomic uint64_t overrun_samples;                            /**< overflow counter sum, saturates at 31 per drain */
+        max30102_stats_histogram_t latency;                          /**< drain latency */
+    } fifo __attribute__((aligned(64)));                             /**< fifo drains */
+} max30102_stats_t;
+
+/**
+ * @brief max30102 stats snapshot histogram structure definition
+ */
+typedef struct max30102_stats_snapshot_histogram_s
+{
+    uint64_t count;                                  /**< observations */
+    uint64_t sum_ns;                                 /**< sum of durations */
+    uint64_t bucket[MAX30102_STATS_BUCKETS];         /**< per bucket observations, not cumulative */
+} max30102_stats_snapshot_histogram_t;
+
+/**
+ * @brief max30102 stats snapshot structure definition
+ */
+typedef struct max30102_stats_snapshot_s
+{
+    uint64_t iic_reads;                                      /**< iic read transactions */
+    uint64_t iic_read_errors;                                /**< failed iic reads */
+    uint64_t iic_read_bytes;                                 /**< bytes read */
+    uint64_t iic_writes;                                     /**< iic write transactions */
+    uint64_t iic_write_errors;                               /**< failed iic writes */
+    uint64_t iic_write_bytes;                                /**< bytes written */
+    uint64_t irqs;                                           /**< irq handler runs */
+    uint64_t irq_errors;                                     /**< failed irq handler runs */
+    uint64_t drains;                                         /**< fifo drains */
+    uint64_t drain_errors;                                   /**< failed fifo drains */
+    uint64_t samples;                                        /**< samples delivered */
+    uint64_t overruns;                                       /**< drains that found an overflow */
+    uint64_t overrun_samples;                                /**< samples lost to overflows */
+    max30102_stats_snapshot_histogram_t iic_read_latency;    /**< iic read latency */
+    max30102_stats_snapshot_histogram_t iic_write_latency;   /**< iic write latency */
+    max30102_stats_snapshot_histogram_t irq_latency;         /**< irq handler latency */
+    max30102_stats_snapshot_histogram_t drain_latency;       /**< fifo drain latency */
+} max30102_stats_snapshot_t;
+
+/**
+ * @brief     initialize a statistics registry
+ * @param[in] *stats pointer to a max30102 stats structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      the clock is CLOCK_MONOTONIC
+ */
+uint8_t max30102_stats_init(max30102_stats_t *stats);
+
+/**
+ * @brief     reset all counters
+ * @param[in] *stats pointer to a max30102 stats structure
+ * @return    status code
+ *            - 0 success
+ *            - 2 handle is NULL
+ * @note      safe while the driver is running, events in flight may land
+ *            on either side of the reset
+ */
+uint8_t max30102_stats_reset(max30102_stats_t *stats);
+
+/**
+ * @brief      take a snapshot of the counters
+ * @param[in]  *stats pointer to a max30102 stats structure
+ * @param[out] *snapshot pointer to a max30102 stats snapshot structure
+ * @return     status code
+ *             - 0 success
+ *             - 2 handle is NULL
+ * @note       lock free, every counter is read atomically but the
+ *             snapshot is not a single point in time
+ */
+uint8_t max30102_stats_snapshot(max30102_stats_t *stats, max30102_stats_snapshot_t *snapshot);
+
+/**
+ * @brief      format snapshots in the prometheus text format
+ * @param[in]  *snapshots pointer to snapshots, one per device
+ * @param[in]  **devices pointer to device names, used as the device label
+ * @param[in]  count number of devices
+ * @param[out] *buf pointer to a text buffer
+ * @param[in]  size buffer size
+ * @param[out] *len pointer to the text length without the terminator
+ * @return     status code
+ *             - 0 success
+ *             - 1 buffer is too small
+ *             - 2 handle is NULL
+ * @note       about 6 KiB per device
+ */
+uint8_t max30102_stats_format(const max30102_stats_snapshot_t *snapshots, const char *const *devices, uint32_t count,
+                              char *buf, size_t size, size_t *len);
+
+/**
+ * @brief     write the prometheus text of several registries to a descriptor
+ * @param[in] **stats pointer to stats structures
+ * @param[in] **devices pointer to device names
+ * @param[in] count number of devices
+ * @param[in] fd file, pipe or connected socket
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ *            - 2 handle is NULL
+ * @note      none
+ */
+uint8_t max30102_stats_write_fd(max30102_stats_t *const *stats, const char *const *devices, uint32_t count, int fd);
+
+/**
+ * @brief     write the prometheus text of several registries to a file
+ * @param[in] **stats pointer to stats structures
+ * @param[in] **devices pointer to device names
+ * @param[in] count number of devices
+ * @param[in] *path pointer to a file path, e.g. in the node_exporter textfile directory
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ *            - 2 handle is NULL
+ * @note      written to path.tmp and renamed, so scrapers never see a partial file
+ */
+uint8_t max30102_stats_write_file(max30102_stats_t *const *stats, const char *const *devices, uint32_t count,
+                                  const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
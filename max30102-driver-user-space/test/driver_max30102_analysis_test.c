@@ -0,0 +1,248 @@
+
+
+#include "driver_max30102_analysis_test.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define ANALYSIS_TEST_FILES          5             /**< recordings, the last one without a finger */
+#define ANALYSIS_TEST_SAMPLES        1500000       /**< samples per recording with a finger */
+#define ANALYSIS_TEST_FLAT_SAMPLES   200000        /**< samples of the recording without a finger */
+#define ANALYSIS_TEST_THREADS        4             /**< batch threads */
+#define ANALYSIS_TEST_SPO2           97.0f         /**< synthetic saturation */
+#define ANALYSIS_TEST_DC_IR          120000.0f     /**< synthetic ir dc */
+#define ANALYSIS_TEST_DC_RED         100000.0f     /**< synthetic red dc */
+#define ANALYSIS_TEST_MOD_IR         0.01f         /**< synthetic ir modulation depth */
+
+static const float gs_hr[ANALYSIS_TEST_FILES - 1] = {60.0f, 75.0f, 90.0f, 120.0f};     /**< synthetic rates */
+static max30102_record_t gs_record;                                                    /**< record writer */
+static max30102_record_reader_t gs_reader;                                             /**< record reader */
+static max30102_analysis_t gs_analysis;                                                /**< streaming pipeline */
+static char gs_inputs[ANALYSIS_TEST_FILES][256];                                       /**< recording paths */
+static uint32_t gs_red[4096];                                                          /**< red buffer */
+static uint32_t gs_ir[4096];                                                           /**< ir buffer */
+
+/**
+ * @brief     synthetic pulse shape
+ * @param[in] phase beat phase, 0 to 1
+ * @return    light absorbed relative to the systolic peak
+ * @note      main peak and a small dicrotic wave
+ */
+static float a_analysis_test_pulse(float phase)
+{
+    float a = (phase - 0.20f) / 0.07f;
+    float b = (phase - 0.55f) / 0.08f;
+
+    return expf(-0.5f * a * a) + 0.3f * expf(-0.5f * b * b);
+}
+
+/**
+ * @brief     write one synthetic recording
+ * @param[in] *path pointer to a recording path
+ * @param[in] hr heart rate in bpm, 0 for no finger
+ * @param[in] samples number of samples
+ * @return    status code
+ *            - 0 success
+ *            - 1 write failed
+ * @note      100 Hz, 18 bit; the rate drifts by 3 % over five minutes and a
+ *            slow baseline wander plus noise is added to both channels
+ */
+static uint8_t a_analysis_test_write(const char *path, float hr, uint32_t samples)
+{
+    max30102_record_header_t header;
+    float ratio;
+    float phase;
+    uint32_t seed;
+    uint32_t i;
+    uint32_t j;
+
+    /* invert spo2 = -45.060 r^2 + 30.354 r + 94.845 on the falling branch */
+    ratio = (30.354f + sqrtf(30.354f * 30.354f - 4.0f * 45.060f * (ANALYSIS_TEST_SPO2 - 94.845f))) / (2.0f * 45.060f);
+    max30102_record_header_from_config(&header, "max30102-analysis", 0x00, MAX30102_MODE_SPO2, 0x27);
+    header.start_time_ns = 1700000000000000000ULL;
+    if (max30102_record_open(&gs_record, path, &header, 0) != 0)
+    {
+        return 1;
+    }
+    phase = 0.0f;
+    seed = 12345;
+    for (i = 0; i < samples; i += 100)
+    {
+        for (j = 0; j < 100; j++)
+        {
+            float t = (float)(i + j) / 100.0f;
+            float wander = 1.0f + 0.005f * sinf(2.0f * 3.14159265f * t / 25.0f);
+            float p;
+
+            seed = seed * 1664525U + 1013904223U;
+            if (hr > 0.0f)
+            {
+                phase += hr * (1.0f + 0.03f * sinf(2.0f * 3.14159265f * t / 300.0f)) / 60.0f / 100.0f;
+                phase -= floorf(phase);
+                p = a_analysis_test_pulse(phase);
+                gs_ir[j] = (uint32_t)(ANALYSIS_TEST_DC_IR * wander * (1.0f - ANALYSIS_TEST_MOD_IR * p)) + (seed >> 26);
+                gs_red[j] = (uint32_t)(ANALYSIS_TEST_DC_RED * wander * (1.0f - ratio * ANALYSIS_TEST_MOD_IR * p)) +
+                            ((seed >> 20) & 0x3F);
+            }
+            else
+            {
+                /* ambient light only */
+                gs_ir[j] = 600U + (seed >> 26);
+                gs_red[j] = 500U + ((seed >> 20) & 0x3F);
+            }
+        }
+        if (max30102_record_write(&gs_record, gs_red, gs_ir, 100, (uint64_t)(i + 100) * 10000000ULL) != 0)
+        {
+            (void)max30102_record_close(&gs_record);
+
+            return 1;
+        }
+    }
+
+    return (max30102_record_close(&gs_record) != 0) ? 1 : 0;
+}
+
+/**
+ * @brief      analyse one recording in a single streaming pass
+ * @param[in]  *path pointer to a recording path
+ * @param[out] *result pointer to a result structure
+ * @return     status code
+ *             - 0 success
+ *             - 1 read failed
+ * @note       none
+ */
+static uint8_t a_analysis_test_stream(const char *path, max30102_analysis_result_t *result)
+{
+    uint8_t res;
+
+    if (max30102_record_reader_open(&gs_reader, path) != 0)
+    {
+        return 1;
+    }
+    if (max30102_analysis_init_from_header(&gs_analysis, &gs_reader.header) != 0)
+    {
+        (void)max30102_record_reader_close(&gs_reader);
+
+        return 1;
+    }
+    while (1)
+    {
+        uint32_t len = 4096;
+
+        res = max30102_record_reader_read(&gs_reader, gs_red, gs_ir, &len, NULL);
+        if (res != 0)
+        {
+            break;
+        }
+        (void)max30102_analysis_update(&gs_analysis, gs_red, gs_ir, len);
+    }
+    (void)max30102_record_reader_close(&gs_reader);
+    (void)max30102_analysis_get_result(&gs_analysis, result);
+
+    return (res == 4) ? 0 : 1;
+}
+
+/**
+ * @brief     analysis test
+ * @param[in] *path pointer to a scratch path prefix
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      analyses synthetic recordings of known rate and saturation
+ *            on the batch pool, checks them against a single streaming
+ *            pass and reports the throughput
+ */
+uint8_t max30102_analysis_test(const char *path)
+{
+    max30102_analysis_result_t results[ANALYSIS_TEST_FILES];
+    max30102_analysis_result_t stream;
+    max30102_analysis_stats_t stats;
+    const char *inputs[ANALYSIS_TEST_FILES];
+    uint8_t res;
+    uint32_t f;
+
+    /* start analysis test */
+    max30102_interface_debug_print("max30102: start analysis test.\n");
+
+    /* synthetic recordings */
+    for (f = 0; f < ANALYSIS_TEST_FILES; f++)
+    {
+        uint8_t finger = (f < ANALYSIS_TEST_FILES - 1) ? 1 : 0;
+
+        (void)snprintf(gs_inputs[f], sizeof(gs_inputs[f]), "%s.%d.m3r", path, f);
+        inputs[f] = gs_inputs[f];
+        if (a_analysis_test_write(gs_inputs[f], (finger != 0) ? gs_hr[f] : 0.0f,
+                                  (finger != 0) ? ANALYSIS_TEST_SAMPLES : ANALYSIS_TEST_FLAT_SAMPLES) != 0)
+        {
+            max30102_interface_debug_print("max30102: record write failed.\n");
+
+            return 1;
+        }
+    }
+    max30102_interface_debug_print("max30102: %d recordings of %d samples and one without a finger.\n",
+                                   ANALYSIS_TEST_FILES - 1, ANALYSIS_TEST_SAMPLES);
+
+    /* batch */
+    res = max30102_analysis_batch(inputs, ANALYSIS_TEST_FILES, ANALYSIS_TEST_THREADS, results, &stats);
+    if (res != 0)
+    {
+        max30102_interface_debug_print("max30102: batch failed.\n");
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: %d shards, %d steals, %0.1f Msamples/s with %d threads.\n",
+                                   stats.shards, stats.steals, (double)stats.samples / stats.elapsed / 1e6, stats.threads);
+    if (stats.samples != (uint64_t)(ANALYSIS_TEST_FILES - 1) * ANALYSIS_TEST_SAMPLES + ANALYSIS_TEST_FLAT_SAMPLES)
+    {
+        max30102_interface_debug_print("max30102: check samples failed.\n");
+
+        return 1;
+    }
+    for (f = 0; f < ANALYSIS_TEST_FILES - 1; f++)
+    {
+        max30102_interface_debug_print("max30102: file %d hr %0.1f bpm spo2 %0.1f pct pi %0.2f pct quality %0.3f.\n",
+                                       f, results[f].hr_mean, results[f].spo2_mean, results[f].pi_mean, results[f].quality);
+        if ((fabsf(results[f].hr_mean - gs_hr[f]) > 2.0f) || (fabsf(results[f].spo2_mean - ANALYSIS_TEST_SPO2) > 2.0f) ||
+            (results[f].quality < 0.9f))
+        {
+            max30102_interface_debug_print("max30102: check file %d failed.\n", f);
+
+            return 1;
+        }
+    }
+    if ((results[f].quality > 0.05f) || (results[f].samples != ANALYSIS_TEST_FLAT_SAMPLES))
+    {
+        max30102_interface_debug_print("max30102: check file without a finger failed.\n");
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: file without a finger quality %0.3f.\n", results[f].quality);
+
+    /* sharding must not change the beat count beyond the shard seams */
+    if (a_analysis_test_stream(gs_inputs[1], &stream) != 0)
+    {
+        max30102_interface_debug_print("max30102: stream failed.\n");
+
+        return 1;
+    }
+    if ((abs((int)stream.valid_beats - (int)results[1].valid_beats) > 2 * (int)stats.shards) ||
+        (fabsf(stream.hr_mean - results[1].hr_mean) > 0.1f))
+    {
+        max30102_interface_debug_print("max30102: check stream %d beats vs batch %d beats failed.\n",
+                                       stream.valid_beats, results[1].valid_beats);
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: stream %d beats, batch %d beats.\n", stream.valid_beats,
+                                   results[1].valid_beats);
+    for (f = 0; f < ANALYSIS_TEST_FILES; f++)
+    {
+        (void)unlink(gs_inputs[f]);
+    }
+
+    /* finish analysis test */
+    max30102_interface_debug_print("max30102: finish analysis test.\n");
+
+    return 0;
+}
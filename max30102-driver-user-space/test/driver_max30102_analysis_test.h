@@ -0,0 +1,37 @@
+
+#ifndef DRIVER_MAX30102_ANALYSIS_TEST_H
+#define DRIVER_MAX30102_ANALYSIS_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_analysis.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief     analysis test
+ * @param[in] *path pointer to a scratch path prefix
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      analyses synthetic recordings of known rate and saturation
+ *            on the batch pool, checks them against a single streaming
+ *            pass and reports the throughput
+ */
+uint8_t max30102_analysis_test(const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
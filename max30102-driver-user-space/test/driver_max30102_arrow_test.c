@@ -0,0 +1,318 @@
+
+
+#include "driver_max30102_arrow_test.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ARROW_TEST_DEVICES           4             /**< synthetic devices */
+#define ARROW_TEST_FILES             2             /**< recordings per device */
+#define ARROW_TEST_SAMPLES           250000        /**< samples per recording */
+#define ARROW_TEST_THREADS           4             /**< export threads */
+
+static max30102_record_t gs_record;                                     /**< record writer */
+static char gs_inputs[ARROW_TEST_DEVICES * ARROW_TEST_FILES][256];      /**< recording paths */
+static uint32_t gs_red[32];                                             /**< red buffer */
+static uint32_t gs_ir[32];                                              /**< ir buffer */
+
+static uint32_t a_arrow_test_sample(uint32_t file, uint32_t i, uint32_t ch)
+{
+    return (90000U + file * 1000U + ch * 20000U + (i % 89U) * 37U + ((i * 2654435761U) >> 27)) & 0x3FFFFU;
+}
+
+static double a_arrow_test_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint32_t a_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t a_le64(const uint8_t *p)
+{
+    return (uint64_t)a_le32(p) | ((uint64_t)a_le32(p + 4) << 32);
+}
+
+/**
+ * @brief     find a flatbuffer table field
+ * @param[in] *table pointer to a table
+ * @param[in] slot field slot
+ * @return    pointer to the field, NULL if absent
+ * @note      none
+ */
+static const uint8_t *a_arrow_test_field(const uint8_t *table, uint32_t slot)
+{
+    const uint8_t *vtable;
+    uint16_t offset;
+
+    vtable = table - (int32_t)a_le32(table);
+    if (4 + 2 * slot >= (uint32_t)(vtable[0] | (vtable[1] << 8)))
+    {
+        return NULL;
+    }
+    offset = (uint16_t)(vtable[4 + 2 * slot] | (vtable[5 + 2 * slot] << 8));
+
+    return (offset != 0) ? table + offset : NULL;
+}
+
+static const uint8_t *a_arrow_test_deref(const uint8_t *p)
+{
+    return (p != NULL) ? p + a_le32(p) : NULL;
+}
+
+/**
+ * @brief     walk the record batches of an exported file
+ * @param[in] *map pointer to the mapped file
+ * @param[in] size file size
+ * @param[in] *expect_sum pointer to the expected red sum per device
+ * @param[in] *expect_rows pointer to the expected rows per device
+ * @param[in] expect_null expected null ir rows
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      checks the magic, footer, message framing, dictionary
+ *            indices, red values and ir nulls
+ */
+static uint8_t a_arrow_test_verify(const uint8_t *map, size_t size, const uint64_t *expect_sum,
+                                   const uint64_t *expect_rows, uint64_t expect_null)
+{
+    const uint8_t *footer;
+    const uint8_t *blocks;
+    uint64_t sum[ARROW_TEST_DEVICES] = {0};
+    uint64_t rows[ARROW_TEST_DEVICES] = {0};
+    uint64_t nulls;
+    int64_t last;
+    uint32_t count;
+    uint32_t i;
+    uint32_t d;
+
+    if ((size < 20) || (memcmp(map, "ARROW1", 6) != 0) || (memcmp(map + size - 6, "ARROW1", 6) != 0))
+    {
+        max30102_interface_debug_print("max30102: check magic failed.\n");
+
+        return 1;
+    }
+    footer = a_arrow_test_deref(map + size - 10 - a_le32(map + size - 10));
+    blocks = a_arrow_test_deref(a_arrow_test_field(footer, 3));
+    if ((blocks == NULL) || (a_arrow_test_field(footer, 1) == NULL))
+    {
+        max30102_interface_debug_print("max30102: check footer failed.\n");
+
+        return 1;
+    }
+    count = a_le32(blocks);
+    nulls = 0;
+    for (i = 0; i < count; i++)
+    {
+        const uint8_t *block = blocks + 4 + 24 * i;
+        const uint8_t *msg = map + a_le64(block);
+        const uint8_t *message;
+        const uint8_t *batch;
+        const uint8_t *buffers;
+        const uint8_t *body;
+        const int64_t *ts;
+        const int16_t *device;
+        const uint32_t *red;
+        uint64_t length;
+        uint32_t j;
+
+        if ((a_le32(msg) != 0xFFFFFFFFU) || (a_le32(msg + 4) + 8 != a_le32(block + 8)))
+        {
+            max30102_interface_debug_print("max30102: check block %d failed.\n", i);
+
+            return 1;
+        }
+        message = a_arrow_test_deref(msg + 8);
+        batch = a_arrow_test_deref(a_arrow_test_field(message, 2));
+        buffers = a_arrow_test_deref(a_arrow_test_field(batch, 2));
+        if ((*a_arrow_test_field(message, 1) != 3) || (buffers == NULL) || (a_le32(buffers) != 10) ||
+            (a_le64(a_arrow_test_field(message, 3)) != a_le64(block + 16)))
+        {
+            max30102_interface_debug_print("max30102: check message %d failed.\n", i);
+
+            return 1;
+        }
+        length = a_le64(a_arrow_test_field(batch, 0));
+        body = msg + a_le32(block + 8);
+        ts = (const int64_t *)(body + a_le64(buffers + 4 + 16 * 1));
+        device = (const int16_t *)(body + a_le64(buffers + 4 + 16 * 3));
+        red = (const uint32_t *)(body + a_le64(buffers + 4 + 16 * 5));
+        d = (uint32_t)device[0];
+        if (d >= ARROW_TEST_DEVICES)
+        {
+            max30102_interface_debug_print("max30102: check device failed.\n");
+
+            return 1;
+        }
+        if (a_le64(buffers + 4 + 16 * 6 + 8) != 0)
+        {
+            nulls += length;
+        }
+        last = ts[0] - 1;
+        for (j = 0; j < length; j++)
+        {
+            if ((device[j] != (int16_t)d) || (ts[j] <= last))
+            {
+                max30102_interface_debug_print("max30102: check row %d of batch %d failed.\n", j, i);
+
+                return 1;
+            }
+            last = ts[j];
+            sum[d] += red[j];
+        }
+        rows[d] += length;
+    }
+    for (d = 0; d < ARROW_TEST_DEVICES; d++)
+    {
+        if ((rows[d] != expect_rows[d]) || (sum[d] != expect_sum[d]))
+        {
+            max30102_interface_debug_print("max30102: check device %d failed.\n", d);
+
+            return 1;
+        }
+    }
+    if (nulls != expect_null)
+    {
+        max30102_interface_debug_print("max30102: check ir nulls failed.\n");
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: %d record batches ok.\n", count);
+
+    return 0;
+}
+
+/**
+ * @brief     arrow export test
+ * @param[in] *path pointer to a scratch output path
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      exports synthetic recordings of four devices with four
+ *            threads, walks the written file and reports the export rate
+ */
+uint8_t max30102_arrow_test(const char *path)
+{
+    uint8_t res;
+    uint32_t f;
+    uint32_t i;
+    uint32_t j;
+    uint64_t rows;
+    uint64_t expect_sum[ARROW_TEST_DEVICES] = {0};
+    uint64_t expect_rows[ARROW_TEST_DEVICES] = {0};
+    uint64_t expect_null;
+    const char *inputs[ARROW_TEST_DEVICES * ARROW_TEST_FILES];
+    struct stat st;
+    void *map;
+    double t0;
+    double t;
+    int fd;
+
+    /* start arrow test */
+    max30102_interface_debug_print("max30102: start arrow test.\n");
+
+    /* two recordings per device, the last device records red only */
+    expect_null = 0;
+    for (f = 0; f < ARROW_TEST_DEVICES * ARROW_TEST_FILES; f++)
+    {
+        max30102_record_header_t header;
+        char device[32];
+        uint32_t d = f / ARROW_TEST_FILES;
+        uint8_t mode = (d == ARROW_TEST_DEVICES - 1) ? MAX30102_MODE_HEART_RATE : MAX30102_MODE_SPO2;
+
+        (void)snprintf(gs_inputs[f], sizeof(gs_inputs[f]), "%s.%d.m3r", path, f);
+        (void)snprintf(device, sizeof(device), "max30102-%d", 80 + d);
+        inputs[f] = gs_inputs[f];
+        max30102_record_header_from_config(&header, device, 0x00, mode, 0x27);
+        header.start_time_ns = 1700000000000000000ULL + (uint64_t)(f % ARROW_TEST_FILES) * 3600000000000ULL;
+        if (max30102_record_open(&gs_record, gs_inputs[f], &header, 0) != 0)
+        {
+            max30102_interface_debug_print("max30102: record open failed.\n");
+
+            return 1;
+        }
+        for (i = 0; i < ARROW_TEST_SAMPLES; i += 25)
+        {
+            for (j = 0; j < 25; j++)
+            {
+                gs_red[j] = a_arrow_test_sample(f, i + j, 0);
+                gs_ir[j] = a_arrow_test_sample(f, i + j, 1);
+                expect_sum[d] += gs_red[j];
+            }
+            res = max30102_record_write(&gs_record, gs_red, gs_ir, 25, (uint64_t)(i + 25) * 10000000ULL);
+            if (res != 0)
+            {
+                max30102_interface_debug_print("max30102: record write failed.\n");
+                (void)max30102_record_close(&gs_record);
+
+                return 1;
+            }
+        }
+        if (max30102_record_close(&gs_record) != 0)
+        {
+            max30102_interface_debug_print("max30102: record close failed.\n");
+
+            return 1;
+        }
+        expect_rows[d] += ARROW_TEST_SAMPLES;
+        expect_null += (mode == MAX30102_MODE_HEART_RATE) ? ARROW_TEST_SAMPLES : 0;
+    }
+    max30102_interface_debug_print("max30102: %d recordings of %d samples.\n", ARROW_TEST_DEVICES * ARROW_TEST_FILES,
+                                   ARROW_TEST_SAMPLES);
+
+    /* export */
+    t0 = a_arrow_test_now();
+    res = max30102_arrow_export(inputs, ARROW_TEST_DEVICES * ARROW_TEST_FILES, path, ARROW_TEST_THREADS, &rows);
+    t = a_arrow_test_now() - t0;
+    if ((res != 0) || (rows != (uint64_t)ARROW_TEST_DEVICES * ARROW_TEST_FILES * ARROW_TEST_SAMPLES))
+    {
+        max30102_interface_debug_print("max30102: export failed.\n");
+
+        return 1;
+    }
+
+    /* walk the file */
+    fd = open(path, O_RDONLY);
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        max30102_interface_debug_print("max30102: open export failed.\n");
+
+        return 1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    (void)close(fd);
+    if (map == MAP_FAILED)
+    {
+        max30102_interface_debug_print("max30102: mmap export failed.\n");
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: exported %d rows, %d bytes in %0.3fs, %0.1f Mrows/s with %d threads.\n",
+                                   (uint32_t)rows, (uint32_t)st.st_size, t, (double)rows / t / 1e6, ARROW_TEST_THREADS);
+    res = a_arrow_test_verify((const uint8_t *)map, (size_t)st.st_size, expect_sum, expect_rows, expect_null);
+    (void)munmap(map, (size_t)st.st_size);
+    if (res != 0)
+    {
+        return 1;
+    }
+    for (f = 0; f < ARROW_TEST_DEVICES * ARROW_TEST_FILES; f++)
+    {
+        (void)unlink(gs_inputs[f]);
+    }
+    (void)unlink(path);
+
+    /* finish arrow test */
+    max30102_interface_debug_print("max30102: finish arrow test.\n");
+
+    return 0;
+}
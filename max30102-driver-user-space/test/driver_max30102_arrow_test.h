@@ -0,0 +1,36 @@
+
+#ifndef DRIVER_MAX30102_ARROW_TEST_H
+#define DRIVER_MAX30102_ARROW_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_arrow.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief     arrow export test
+ * @param[in] *path pointer to a scratch output path
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      exports synthetic recordings of four devices with four
+ *            threads, walks the written file and reports the export rate
+ */
+uint8_t max30102_arrow_test(const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
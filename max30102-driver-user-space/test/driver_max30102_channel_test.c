@@ -0,0 +1,314 @@
+
+
+#include "driver_max30102_channel_test.h"
+#include <stdio.h>
+#include <unistd.h>
+
+#define CHANNEL_TEST_SAMPLES        4096        /**< samples in the recording */
+#define CHANNEL_TEST_READ           512         /**< samples drained per case */
+
+/**
+ * @brief channel test case structure definition
+ */
+typedef struct channel_test_case_s
+{
+    const char *name;                /**< case name */
+    max30102_mode_t mode;            /**< mode */
+    max30102_led_t slot[4];          /**< slot 1 to 4, multi led mode only */
+    uint8_t channels;                /**< expected channels */
+    uint8_t mask;                    /**< expected slot mask */
+} channel_test_case_t;
+
+static const channel_test_case_t gs_cases[] =
+{
+    {"heart rate", MAX30102_MODE_HEART_RATE, {MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE}, 1, 0x1},
+    {"spo2", MAX30102_MODE_SPO2, {MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE}, 2, 0x3},
+    {"multi led ir", MAX30102_MODE_MULTI_LED, {MAX30102_LED_IR, MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE}, 1, 0x1},
+    {"multi led ir, red", MAX30102_MODE_MULTI_LED, {MAX30102_LED_IR, MAX30102_LED_RED, MAX30102_LED_NONE, MAX30102_LED_NONE}, 2, 0x3},
+    {"multi led ir, red, ir", MAX30102_MODE_MULTI_LED, {MAX30102_LED_IR, MAX30102_LED_RED, MAX30102_LED_IR, MAX30102_LED_NONE}, 3, 0x7},
+    {"multi led red, ir, ir, red", MAX30102_MODE_MULTI_LED, {MAX30102_LED_RED, MAX30102_LED_IR, MAX30102_LED_IR, MAX30102_LED_RED}, 4, 0xF},
+};
+
+static max30102_handle_t gs_handle;            /**< max30102 handle */
+static max30102_record_t gs_record;            /**< record writer */
+static uint32_t gs_raw_red[32];                /**< red buffer */
+static uint32_t gs_raw_ir[32];                 /**< ir buffer */
+static uint32_t gs_raw[32 * 4];                /**< channel buffer */
+static uint32_t gs_fifo_bytes;                 /**< bytes read from the fifo data register */
+static uint32_t gs_reads;                      /**< register reads */
+static uint8_t gs_irq;                         /**< run the irq handler before each fifo data read */
+static uint8_t gs_in_irq;                      /**< the irq handler is running */
+
+/**
+ * @brief     synthetic sample
+ * @param[in] i sample index
+ * @param[in] led led
+ * @return    18 bit sample
+ * @note      red and ir differ, so a mislabelled channel shows up
+ */
+static uint32_t a_channel_test_sample(uint32_t i, max30102_led_t led)
+{
+    return ((led == MAX30102_LED_RED) ? 100000U : 200000U) + i;
+}
+
+/**
+ * @brief      replay iic read that counts the fifo bytes
+ * @param[in]  addr iic device write address
+ * @param[in]  reg iic register address
+ * @param[out] *buf pointer to a data buffer
+ * @param[in]  len length of the data buffer
+ * @return     status code
+ *             - 0 success
+ *             - 1 read failed
+ * @note       with gs_irq set the irq handler runs between the fifo level
+ *             read and the fifo data read, and its reads are not counted
+ */
+static uint8_t a_channel_test_iic_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    if (reg == 0x07)
+    {
+        gs_fifo_bytes += len;
+        if (gs_irq != 0)
+        {
+            gs_in_irq = 1;
+            (void)max30102_irq_handler(&gs_handle);
+            gs_in_irq = 0;
+        }
+    }
+    if (gs_in_irq == 0)
+    {
+        gs_reads++;
+    }
+
+    return max30102_replay_iic_read(addr, reg, buf, len);
+}
+
+/**
+ * @brief     channel receive callback
+ * @param[in] type irq type
+ * @note      none
+ */
+static void a_channel_test_receive_callback(uint8_t type)
+{
+    (void)type;
+}
+
+/**
+ * @brief     run one case
+ * @param[in] *path pointer to a recording
+ * @param[in] *c pointer to a test case
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      the fast replay refills the fifo after every read, so samples
+ *            arrive in recording order without gaps
+ */
+static uint8_t a_channel_test_run(const char *path, const channel_test_case_t *c)
+{
+    max30102_channel_layout_t layout;
+    uint32_t received;
+    uint32_t errors;
+    uint8_t red;
+    uint8_t ir;
+    uint8_t len;
+    uint8_t i;
+    uint8_t n;
+
+    if (max30102_replay_open(path, MAX30102_REPLAY_PACING_FAST, 1.0f) != 0)
+    {
+        max30102_interface_debug_print("max30102: replay open failed.\n");
+
+        return 1;
+    }
+    DRIVER_MAX30102_LINK_INIT(&gs_handle, max30102_handle_t);
+    DRIVER_MAX30102_LINK_REPLAY(&gs_handle);
+    DRIVER_MAX30102_LINK_IIC_READ(&gs_handle, a_channel_test_iic_read);
+    DRIVER_MAX30102_LINK_DEBUG_PRINT(&gs_handle, max30102_interface_debug_print);
+    DRIVER_MAX30102_LINK_RECEIVE_CALLBACK(&gs_handle, a_channel_test_receive_callback);
+    if ((max30102_init(&gs_handle) != 0) ||
+        (max30102_set_fifo_roll(&gs_handle, MAX30102_BOOL_TRUE) != 0) ||
+        (max30102_set_adc_resolution(&gs_handle, MAX30102_ADC_RESOLUTION_18_BIT) != 0) ||
+        (max30102_set_slot(&gs_handle, MAX30102_SLOT_1, c->slot[0]) != 0) ||
+        (max30102_set_slot(&gs_handle, MAX30102_SLOT_2, c->slot[1]) != 0) ||
+        (max30102_set_slot(&gs_handle, MAX30102_SLOT_3, c->slot[2]) != 0) ||
+        (max30102_set_slot(&gs_handle, MAX30102_SLOT_4, c->slot[3]) != 0) ||
+        (max30102_set_mode(&gs_handle, c->mode) != 0) ||
+        (max30102_get_channel_layout(&gs_handle, &layout) != 0))
+    {
+        max30102_interface_debug_print("max30102: init failed.\n");
+        (void)max30102_deinit(&gs_handle);
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+    if ((layout.channels != c->channels) || (layout.mask != c->mask) || (layout.shift != 0))
+    {
+        max30102_interface_debug_print("max30102: %s has %d channels mask 0x%02X, expected %d mask 0x%02X.\n",
+                                       c->name, layout.channels, layout.mask, c->channels, c->mask);
+        (void)max30102_deinit(&gs_handle);
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+
+    /* every channel carries the sample of its led */
+    received = 0;
+    errors = 0;
+    gs_fifo_bytes = 0;
+    while (received < CHANNEL_TEST_READ)
+    {
+        len = 32;
+        if (max30102_read_channels(&gs_handle, &layout, gs_raw, &len) != 0)
+        {
+            max30102_interface_debug_print("max30102: read channels failed.\n");
+            (void)max30102_deinit(&gs_handle);
+            (void)max30102_replay_close();
+
+            return 1;
+        }
+        for (i = 0; i < len; i++)
+        {
+            for (n = 0; n < layout.channels; n++)
+            {
+                errors += (gs_raw[i * layout.channels + n] != a_channel_test_sample(received, layout.led[n])) ? 1 : 0;
+            }
+            received++;
+        }
+    }
+    max30102_interface_debug_print("max30102: %s, %d channels, mask 0x%02X, %d bytes per sample.\n",
+                                   c->name, layout.channels, layout.mask, gs_fifo_bytes / received);
+    if ((errors != 0) || (gs_fifo_bytes != received * layout.channels * 3))
+    {
+        max30102_interface_debug_print("max30102: %d mismatched values, %d fifo bytes for %d samples.\n",
+                                       errors, gs_fifo_bytes, received);
+        (void)max30102_deinit(&gs_handle);
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+
+    /* max30102_read takes the first red and ir channel */
+    red = 0;
+    ir = 0;
+    for (n = 0; n < layout.channels; n++)
+    {
+        red |= (layout.led[n] == MAX30102_LED_RED) ? 1 : 0;
+        ir |= (layout.led[n] == MAX30102_LED_IR) ? 1 : 0;
+    }
+    gs_raw_red[0] = 0;
+    gs_raw_ir[0] = 0;
+    len = 1;
+    if ((max30102_read(&gs_handle, gs_raw_red, gs_raw_ir, &len) != 0) || (len != 1) ||
+        (gs_raw_red[0] != ((red != 0) ? a_channel_test_sample(received, MAX30102_LED_RED) : 0)) ||
+        (gs_raw_ir[0] != ((ir != 0) ? a_channel_test_sample(received, MAX30102_LED_IR) : 0)))
+    {
+        max30102_interface_debug_print("max30102: %s read red %d ir %d mislabelled.\n", c->name, gs_raw_red[0], gs_raw_ir[0]);
+        (void)max30102_deinit(&gs_handle);
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+    received++;
+
+    /* once the recording ends the fifo is empty, not full, even when an irq
+       latched ppg_rdy between the last level read and data read */
+    gs_irq = 1;
+    for (n = 0; n < CHANNEL_TEST_SAMPLES / 32 + 2; n++)
+    {
+        len = 32;
+        gs_reads = 0;
+        gs_fifo_bytes = 0;
+        if (max30102_read(&gs_handle, gs_raw_red, gs_raw_ir, &len) != 0)
+        {
+            max30102_interface_debug_print("max30102: read failed.\n");
+            (void)max30102_deinit(&gs_handle);
+            (void)max30102_replay_close();
+
+            return 1;
+        }
+        if (len == 0)
+        {
+            break;
+        }
+        received += len;
+    }
+    gs_irq = 0;
+    if ((len != 0) || (received != CHANNEL_TEST_SAMPLES) || (gs_fifo_bytes != 0) || (gs_reads != 2))
+    {
+        max30102_interface_debug_print("max30102: %s empty fifo read %d samples of %d, %d fifo bytes in %d reads.\n",
+                                       c->name, len, received, gs_fifo_bytes, gs_reads);
+        (void)max30102_deinit(&gs_handle);
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+    (void)max30102_deinit(&gs_handle);
+    (void)max30102_replay_close();
+
+    return 0;
+}
+
+/**
+ * @brief     channel test
+ * @param[in] *path pointer to a scratch path prefix
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      none
+ */
+uint8_t max30102_channel_test(const char *path)
+{
+    max30102_record_header_t header;
+    char recording[256];
+    uint32_t i;
+    uint32_t j;
+
+    /* start channel test */
+    max30102_interface_debug_print("max30102: start channel test.\n");
+
+    (void)snprintf(recording, sizeof(recording), "%s.m3r", path);
+    max30102_record_header_from_config(&header, "max30102-channel", 0x00, MAX30102_MODE_SPO2, 0x27);
+    if (max30102_record_open(&gs_record, recording, &header, 0) != 0)
+    {
+        max30102_interface_debug_print("max30102: record open failed.\n");
+
+        return 1;
+    }
+    for (i = 0; i < CHANNEL_TEST_SAMPLES; i += 32)
+    {
+        for (j = 0; j < 32; j++)
+        {
+            gs_raw_red[j] = a_channel_test_sample(i + j, MAX30102_LED_RED);
+            gs_raw_ir[j] = a_channel_test_sample(i + j, MAX30102_LED_IR);
+        }
+        if (max30102_record_write(&gs_record, gs_raw_red, gs_raw_ir, 32, (uint64_t)(i + 32) * 10000000ULL) != 0)
+        {
+            max30102_interface_debug_print("max30102: record write failed.\n");
+            (void)max30102_record_close(&gs_record);
+
+            return 1;
+        }
+    }
+    if (max30102_record_close(&gs_record) != 0)
+    {
+        max30102_interface_debug_print("max30102: record close failed.\n");
+
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(gs_cases) / sizeof(gs_cases[0]); i++)
+    {
+        if (a_channel_test_run(recording, &gs_cases[i]) != 0)
+        {
+            (void)unlink(recording);
+
+            return 1;
+        }
+    }
+    (void)unlink(recording);
+
+    /* finish channel test */
+    max30102_interface_debug_print("max30102: finish channel test.\n");
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef DRIVER_MAX30102_CHANNEL_TEST_H
+#define DRIVER_MAX30102_CHANNEL_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_record.h"
+#include "driver_max30102_replay.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief     channel test
+ * @param[in] *path pointer to a scratch path prefix
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      replays a recording through heart rate, spo2 and several multi
+ *            led slot sequences, and checks the layout, that every channel
+ *            carries the sample of its led and that only the active channels'
+ *            bytes are read from the fifo
+ */
+uint8_t max30102_channel_test(const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
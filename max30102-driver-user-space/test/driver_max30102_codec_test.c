@@ -0,0 +1,227 @@
+
+
+#include "driver_max30102_codec_test.h"
+#include "driver_max30102_record.h"
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CODEC_TEST_BLOCK             1024           /**< samples per block */
+#define CODEC_TEST_SYNTHETIC         (1 << 20)      /**< synthetic samples per channel */
+#define CODEC_TEST_MAX_RECORDED      (1 << 24)      /**< recorded samples per channel cap */
+
+static max30102_record_reader_t gs_reader;                                    /**< record reader */
+static uint8_t gs_block[MAX30102_CODEC_BOUND(CODEC_TEST_BLOCK, 2)];           /**< encoded block */
+
+static double a_codec_test_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief     encode, decode and compare a sample stream
+ * @param[in] *name pointer to a data set name
+ * @param[in] *red pointer to a red samples buffer
+ * @param[in] *ir pointer to an ir samples buffer
+ * @param[in] count number of samples per channel
+ * @param[in] channels 1 or 2
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      none
+ */
+static uint8_t a_codec_test_run(const char *name, const uint32_t *red, const uint32_t *ir, uint32_t count, uint8_t channels)
+{
+    uint8_t res;
+    uint8_t *enc;
+    uint32_t *size;
+    uint32_t *out_red;
+    uint32_t *out_ir;
+    uint32_t blocks;
+    uint32_t b;
+    uint32_t i;
+    uint64_t total;
+    double t0;
+    double t_enc;
+    double t_dec;
+    double raw_mb;
+
+    blocks = (count + CODEC_TEST_BLOCK - 1) / CODEC_TEST_BLOCK;
+    enc = (uint8_t *)malloc((size_t)blocks * sizeof(gs_block));
+    size = (uint32_t *)malloc((size_t)blocks * sizeof(uint32_t));
+    out_red = (uint32_t *)malloc((size_t)count * sizeof(uint32_t) + 1);
+    out_ir = (uint32_t *)malloc((size_t)count * sizeof(uint32_t) + 1);
+    if ((enc == NULL) || (size == NULL) || (out_red == NULL) || (out_ir == NULL))
+    {
+        max30102_interface_debug_print("max30102: malloc failed.\n");
+        res = 1;
+
+        goto exit;
+    }
+
+    /* encode */
+    total = 0;
+    t0 = a_codec_test_now();
+    for (b = 0; b < blocks; b++)
+    {
+        uint32_t n = (b == blocks - 1) ? count - b * CODEC_TEST_BLOCK : CODEC_TEST_BLOCK;
+
+        size[b] = sizeof(gs_block);
+        res = max30102_codec_encode(red + b * CODEC_TEST_BLOCK, ir + b * CODEC_TEST_BLOCK, n, channels,
+                                    enc + (size_t)b * sizeof(gs_block), &size[b], NULL);
+        if (res != 0)
+        {
+            max30102_interface_debug_print("max30102: encode failed.\n");
+            res = 1;
+
+            goto exit;
+        }
+        total += size[b];
+    }
+    t_enc = a_codec_test_now() - t0;
+
+    /* decode */
+    t0 = a_codec_test_now();
+    for (b = 0; b < blocks; b++)
+    {
+        uint32_t n = (b == blocks - 1) ? count - b * CODEC_TEST_BLOCK : CODEC_TEST_BLOCK;
+
+        res = max30102_codec_decode(enc + (size_t)b * sizeof(gs_block), size[b], n, channels,
+                                    out_red + b * CODEC_TEST_BLOCK, out_ir + b * CODEC_TEST_BLOCK);
+        if (res != 0)
+        {
+            max30102_interface_debug_print("max30102: decode failed.\n");
+            res = 1;
+
+            goto exit;
+        }
+    }
+    t_dec = a_codec_test_now() - t0;
+
+    /* lossless check */
+    for (i = 0; i < count; i++)
+    {
+        if ((out_red[i] != red[i]) || ((channels > 1) && (out_ir[i] != ir[i])))
+        {
+            max30102_interface_debug_print("max30102: sample %d mismatch.\n", i);
+            res = 1;
+
+            goto exit;
+        }
+    }
+
+    raw_mb = (double)count * channels * sizeof(uint32_t) / 1e6;
+    max30102_interface_debug_print("max30102: %s %d samples x %d channels.\n", name, count, channels);
+    max30102_interface_debug_print("max30102: %0.2f bits per sample, ratio %0.2f vs uint32, %0.2f vs 18 bit packed.\n",
+                                   (double)total * 8.0 / ((double)count * channels),
+                                   raw_mb * 1e6 / (double)total, (double)count * channels * 18.0 / 8.0 / (double)total);
+    max30102_interface_debug_print("max30102: encode %0.1f MB/s, decode %0.1f MB/s.\n",
+                                   raw_mb / ((t_enc > 0.0) ? t_enc : 1e-9), raw_mb / ((t_dec > 0.0) ? t_dec : 1e-9));
+    res = 0;
+
+    exit:
+    free(enc);
+    free(size);
+    free(out_red);
+    free(out_ir);
+
+    return res;
+}
+
+/**
+ * @brief     codec test and benchmark
+ * @param[in] *path pointer to a recording made by driver_max30102_record, may be NULL
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      reports compression ratio and encode/decode MB/s on synthetic ppg
+ *            and, if path is given, on the recorded samples
+ */
+uint8_t max30102_codec_test(const char *path)
+{
+    uint8_t res;
+    uint32_t *red;
+    uint32_t *ir;
+    uint32_t i;
+    uint32_t count;
+    uint32_t seed;
+
+    /* start codec test */
+    max30102_interface_debug_print("max30102: start codec test.\n");
+
+    red = (uint32_t *)malloc(CODEC_TEST_MAX_RECORDED * sizeof(uint32_t));
+    ir = (uint32_t *)malloc(CODEC_TEST_MAX_RECORDED * sizeof(uint32_t));
+    if ((red == NULL) || (ir == NULL))
+    {
+        max30102_interface_debug_print("max30102: malloc failed.\n");
+        free(red);
+        free(ir);
+
+        return 1;
+    }
+
+    /* synthetic ppg at 100Hz: dc, 72bpm pulse with a dicrotic notch, respiration, noise */
+    seed = 1;
+    for (i = 0; i < CODEC_TEST_SYNTHETIC; i++)
+    {
+        double t = (double)i / 100.0;
+        double pulse = sin(2.0 * M_PI * 1.2 * t) + 0.35 * sin(4.0 * M_PI * 1.2 * t + 0.8);
+        double resp = sin(2.0 * M_PI * 0.25 * t);
+        int32_t noise_red;
+        int32_t noise_ir;
+
+        seed = seed * 1103515245U + 12345U;
+        noise_red = (int32_t)((seed >> 16) % 33) - 16;
+        seed = seed * 1103515245U + 12345U;
+        noise_ir = (int32_t)((seed >> 16) % 33) - 16;
+        red[i] = (uint32_t)(int32_t)(110000.0 + 600.0 * pulse + 300.0 * resp) + (uint32_t)noise_red;
+        ir[i] = (uint32_t)(int32_t)(125000.0 + 900.0 * pulse + 320.0 * resp) + (uint32_t)noise_ir;
+    }
+    res = a_codec_test_run("synthetic", red, ir, CODEC_TEST_SYNTHETIC, 2);
+    if (res != 0)
+    {
+        goto exit;
+    }
+
+    /* recorded samples */
+    if (path != NULL)
+    {
+        if (max30102_record_reader_open(&gs_reader, path) != 0)
+        {
+            max30102_interface_debug_print("max30102: open %s failed.\n", path);
+            res = 1;
+
+            goto exit;
+        }
+        count = 0;
+        while (count < CODEC_TEST_MAX_RECORDED)
+        {
+            uint32_t len = CODEC_TEST_MAX_RECORDED - count;
+
+            if (max30102_record_reader_read(&gs_reader, red + count, ir + count, &len, NULL) != 0)
+            {
+                break;
+            }
+            count += len;
+        }
+        res = a_codec_test_run("recorded", red, ir, count, gs_reader.header.channels);
+        (void)max30102_record_reader_close(&gs_reader);
+        if (res != 0)
+        {
+            goto exit;
+        }
+    }
+
+    /* finish codec test */
+    max30102_interface_debug_print("max30102: finish codec test.\n");
+
+    exit:
+    free(red);
+    free(ir);
+
+    return res;
+}
@@ -0,0 +1,36 @@
+
+#ifndef DRIVER_MAX30102_CODEC_TEST_H
+#define DRIVER_MAX30102_CODEC_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_codec.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief     codec test and benchmark
+ * @param[in] *path pointer to a recording made by driver_max30102_record, may be NULL
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      reports compression ratio and encode/decode MB/s on synthetic ppg
+ *            and, if path is given, on the recorded samples
+ */
+uint8_t max30102_codec_test(const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
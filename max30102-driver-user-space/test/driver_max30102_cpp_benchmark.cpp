@@ -0,0 +1,232 @@
+#include "driver_max30102.hpp"
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * @file  driver_max30102_cpp_benchmark.cpp
+ * @brief compare the c++ wrapper decoders with the c read loop
+ * @note  the chip is a register file in memory whose fifo is always full, so
+ *        the time measured is the driver's and not the bus's; both sides must
+ *        decode the same values or the run fails
+ */
+
+#define BENCHMARK_READS        200000        /**< reads per case */
+
+/**
+ * @brief benchmark case structure definition
+ */
+struct benchmark_case
+{
+    const char *name;                        /**< case name */
+    max30102_mode_t mode;                    /**< mode */
+    max30102_adc_resolution_t resolution;    /**< adc resolution */
+    max30102_led_t slot[4];                  /**< slot 1 to 4, multi led mode only */
+};
+
+static const benchmark_case gs_cases[] =
+{
+    {"heart rate 18 bit", MAX30102_MODE_HEART_RATE, MAX30102_ADC_RESOLUTION_18_BIT, {MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE}},
+    {"spo2 18 bit", MAX30102_MODE_SPO2, MAX30102_ADC_RESOLUTION_18_BIT, {MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE}},
+    {"spo2 16 bit", MAX30102_MODE_SPO2, MAX30102_ADC_RESOLUTION_16_BIT, {MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE, MAX30102_LED_NONE}},
+    {"multi led ir, red, ir 17 bit", MAX30102_MODE_MULTI_LED, MAX30102_ADC_RESOLUTION_17_BIT, {MAX30102_LED_IR, MAX30102_LED_RED, MAX30102_LED_IR, MAX30102_LED_NONE}},
+};
+
+static uint8_t gs_reg[256];                  /**< register file */
+static uint8_t gs_fifo[32 * 4 * 3];          /**< fifo bytes */
+
+static uint8_t a_benchmark_iic_init(void)
+{
+    return 0;
+}
+
+static uint8_t a_benchmark_iic_deinit(void)
+{
+    return 0;
+}
+
+static uint8_t a_benchmark_iic_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    (void)addr;
+    if (reg == 0x07)
+    {
+        if (len > sizeof(gs_fifo))
+        {
+            return 1;
+        }
+        memcpy(buf, gs_fifo, len);           /* a full fifo every time */
+
+        return 0;
+    }
+    if ((size_t)reg + len > sizeof(gs_reg))
+    {
+        return 1;
+    }
+    memcpy(buf, &gs_reg[reg], len);
+
+    return 0;
+}
+
+static uint8_t a_benchmark_iic_write(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    (void)addr;
+    if ((size_t)reg + len > sizeof(gs_reg))
+    {
+        return 1;
+    }
+    memcpy(&gs_reg[reg], buf, len);
+    gs_reg[0x09] &= (uint8_t)~(1 << 6);      /* reset completes at once */
+
+    return 0;
+}
+
+static void a_benchmark_delay_ms(uint32_t ms)
+{
+    (void)ms;
+}
+
+static void a_benchmark_debug_print(const char *const fmt, ...)
+{
+    (void)fmt;
+}
+
+static void a_benchmark_receive_callback(uint8_t type)
+{
+    (void)type;
+}
+
+/**
+ * @brief     time reads
+ * @param[in] f read to time
+ * @return    ns per read
+ */
+template <class F>
+static double a_benchmark_time(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < BENCHMARK_READS; i++)
+    {
+        f();
+    }
+
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BENCHMARK_READS;
+}
+
+/**
+ * @brief  benchmark entry
+ * @return status code
+ *         - 0 success
+ *         - 1 run failed
+ */
+int main(void)
+{
+    max30102::interface link;
+    uint32_t c_red[32], c_ir[32], c_raw[32 * 4];
+    uint32_t red[32], ir[32], raw[32 * 4];
+    volatile uint32_t sink = 0;
+    uint32_t seed = 1;
+    uint8_t len;
+    uint8_t res;
+
+    for (uint8_t &b : gs_fifo)
+    {
+        seed = seed * 1103515245U + 12345U;
+        b = (uint8_t)(seed >> 16);
+    }
+    gs_reg[0xFF] = 0x15;                     /* part id */
+    gs_reg[0x00] = 1 << 7;                   /* a_full stays latched, equal pointers are a full fifo */
+
+    link.iic_init = a_benchmark_iic_init;
+    link.iic_deinit = a_benchmark_iic_deinit;
+    link.iic_read = a_benchmark_iic_read;
+    link.iic_write = a_benchmark_iic_write;
+    link.delay_ms = a_benchmark_delay_ms;
+    link.debug_print = a_benchmark_debug_print;
+    link.receive_callback = a_benchmark_receive_callback;
+    max30102::device dev(link);
+    if (dev.status() != 0)
+    {
+        printf("max30102: init failed %d.\n", dev.status());
+
+        return 1;
+    }
+
+    printf("%-30s %12s %12s %8s %12s %12s %8s\n", "case", "c read", "c++ read", "speedup",
+           "c channels", "c++ channels", "speedup");
+    for (const benchmark_case &t : gs_cases)
+    {
+        double c_read, cpp_read, c_channels, cpp_channels;
+        max30102_channel_layout_t layout;
+        uint8_t n;
+
+        res = max30102_set_mode(dev.handle(), t.mode);
+        res |= max30102_set_adc_resolution(dev.handle(), t.resolution);
+        for (uint8_t s = 0; s < 4; s++)
+        {
+            res |= max30102_set_slot(dev.handle(), (max30102_slot_t)s, t.slot[s]);
+        }
+        res |= dev.configure();
+        res |= max30102_get_channel_layout(dev.handle(), &layout);
+        if (res != 0)
+        {
+            printf("max30102: %s config failed.\n", t.name);
+
+            return 1;
+        }
+        n = layout.channels;
+
+        /* same values first */
+        memset(c_red, 0, sizeof(c_red));
+        memset(c_ir, 0, sizeof(c_ir));
+        memset(red, 0, sizeof(red));
+        memset(ir, 0, sizeof(ir));
+        len = 32;
+        res = max30102_read(dev.handle(), c_red, c_ir, &len);
+        len = 32;
+        res |= dev.read(red, ir, len);
+        if ((res != 0) || (len != 32) || (memcmp(c_red, red, sizeof(red)) != 0) || (memcmp(c_ir, ir, sizeof(ir)) != 0))
+        {
+            printf("max30102: %s read differs.\n", t.name);
+
+            return 1;
+        }
+        len = 32;
+        res = max30102_read_channels(dev.handle(), &layout, c_raw, &len);
+        len = 32;
+        res |= dev.read_channels(raw, len);
+        if ((res != 0) || (len != 32) || (memcmp(c_raw, raw, sizeof(uint32_t) * 32 * n) != 0))
+        {
+            printf("max30102: %s read channels differs.\n", t.name);
+
+            return 1;
+        }
+
+        c_read = a_benchmark_time([&]() {
+            uint8_t l = 32;
+            (void)max30102_read(dev.handle(), c_red, c_ir, &l);
+            sink = sink + c_red[l - 1] + c_ir[l - 1];
+        });
+        cpp_read = a_benchmark_time([&]() {
+            uint8_t l = 32;
+            (void)dev.read(red, ir, l);
+            sink = sink + red[l - 1] + ir[l - 1];
+        });
+        c_channels = a_benchmark_time([&]() {
+            uint8_t l = 32;
+            (void)max30102_read_channels(dev.handle(), &layout, c_raw, &l);
+            sink = sink + c_raw[l * n - 1];
+        });
+        cpp_channels = a_benchmark_time([&]() {
+            uint8_t l = 32;
+            (void)dev.read_channels(raw, l);
+            sink = sink + raw[l * n - 1];
+        });
+        printf("%-30s %9.1f ns %9.1f ns %7.2fx %9.1f ns %9.1f ns %7.2fx\n", t.name,
+               c_read, cpp_read, c_read / cpp_read, c_channels, cpp_channels, c_channels / cpp_channels);
+    }
+    (void)sink;
+
+    return 0;
+}
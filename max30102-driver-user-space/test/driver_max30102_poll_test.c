@@ -0,0 +1,202 @@
+
+
+#include "driver_max30102_poll_test.h"
+#include <stdio.h>
+#include <unistd.h>
+
+#define POLL_TEST_SAMPLES        4000          /**< four seconds at 1kHz */
+#define POLL_TEST_WARMUP         24            /**< polls allowed to settle */
+
+static max30102_handle_t gs_handle;            /**< max30102 handle */
+static max30102_record_t gs_record;            /**< record writer */
+static max30102_poll_t gs_poll;                /**< poller */
+static uint32_t gs_raw_red[32];                /**< red buffer */
+static uint32_t gs_raw_ir[32];                 /**< ir buffer */
+
+/**
+ * @brief     poll receive callback
+ * @param[in] type irq type
+ * @note      nothing is wired to the int pin, so it is never called
+ */
+static void a_poll_test_receive_callback(uint8_t type)
+{
+    (void)type;
+}
+
+/**
+ * @brief     poll one replay until enough samples arrived
+ * @param[in] *path pointer to a recording
+ * @param[in] speed replay speed factor, the recording is 1kHz
+ * @param[in] rate configured sample rate
+ * @param[in] samples samples to drain
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      the int pin is never used, after the warm up every poll must
+ *            find the fifo neither empty nor overflowed and the samples must
+ *            be contiguous; one overrun is tolerated for a wake up delayed by
+ *            a loaded machine
+ */
+static uint8_t a_poll_test_run(const char *path, float speed, max30102_spo2_sample_rate_t rate, uint32_t samples)
+{
+    uint64_t level_sum;
+    uint32_t received;
+    uint32_t polls;
+    uint32_t empty;
+    uint32_t overruns;
+    uint32_t gaps;
+    uint32_t expect;
+    uint8_t len;
+    uint8_t res;
+
+    if (max30102_replay_open(path, MAX30102_REPLAY_PACING_ACCELERATED, speed) != 0)
+    {
+        max30102_interface_debug_print("max30102: replay open failed.\n");
+
+        return 1;
+    }
+    DRIVER_MAX30102_LINK_INIT(&gs_handle, max30102_handle_t);
+    DRIVER_MAX30102_LINK_REPLAY(&gs_handle);
+    DRIVER_MAX30102_LINK_DEBUG_PRINT(&gs_handle, max30102_interface_debug_print);
+    DRIVER_MAX30102_LINK_RECEIVE_CALLBACK(&gs_handle, a_poll_test_receive_callback);
+    if ((max30102_init(&gs_handle) != 0) ||
+        (max30102_set_fifo_almost_full(&gs_handle, 15) != 0) ||
+        (max30102_set_fifo_roll(&gs_handle, MAX30102_BOOL_TRUE) != 0) ||
+        (max30102_set_fifo_sample_averaging(&gs_handle, MAX30102_SAMPLE_AVERAGING_1) != 0) ||
+        (max30102_set_spo2_sample_rate(&gs_handle, rate) != 0) ||
+        (max30102_set_adc_resolution(&gs_handle, MAX30102_ADC_RESOLUTION_18_BIT) != 0) ||
+        (max30102_set_mode(&gs_handle, MAX30102_MODE_SPO2) != 0) ||
+        (max30102_poll_init(&gs_poll, &gs_handle) != 0))
+    {
+        max30102_interface_debug_print("max30102: init failed.\n");
+        (void)max30102_deinit(&gs_handle);
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+
+    received = 0;
+    polls = 0;
+    empty = 0;
+    overruns = 0;
+    gaps = 0;
+    level_sum = 0;
+    expect = 0;
+    while (received < samples)
+    {
+        len = 32;
+        res = max30102_poll_read(&gs_poll, gs_raw_red, gs_raw_ir, &len);
+        if ((res != 0) && (res != 4))
+        {
+            max30102_interface_debug_print("max30102: poll read failed.\n");
+            (void)max30102_deinit(&gs_handle);
+            (void)max30102_replay_close();
+
+            return 1;
+        }
+        if (gs_poll.polls > POLL_TEST_WARMUP)
+        {
+            polls++;
+            level_sum += gs_poll.level;
+            empty += (len == 0) ? 1 : 0;
+            overruns += (res == 4) ? 1 : 0;
+            gaps += ((len != 0) && (gs_raw_red[0] != expect)) ? 1 : 0;
+        }
+        if (len != 0)
+        {
+            expect = gs_raw_red[len - 1] + 1;
+        }
+        received += len;
+    }
+    (void)max30102_deinit(&gs_handle);
+    (void)max30102_replay_close();
+
+    max30102_interface_debug_print("max30102: configured %0.0fHz, estimated %0.0fHz, period %0.2fms.\n",
+                                   gs_poll.nominal_hz, gs_poll.rate_hz, (double)gs_poll.period_ns / 1e6);
+    max30102_interface_debug_print("max30102: %d polls, mean level %0.1f of watermark %d, %d empty, %d overruns.\n",
+                                   polls, (polls != 0) ? (double)level_sum / polls : 0.0, gs_poll.watermark, empty,
+                                   overruns);
+    max30102_interface_debug_print("max30102: %0.2f polls per a_full interrupt the int pin would have raised.\n",
+                                   (double)gs_poll.polls * gs_poll.watermark / received);
+    if ((polls == 0) || (empty != 0) || (overruns > 1) || (gaps > overruns) ||
+        ((double)level_sum / polls > gs_poll.watermark) || ((double)level_sum / polls < gs_poll.target - 3))
+    {
+        max30102_interface_debug_print("max30102: check poll failed.\n");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     poll test
+ * @param[in] *path pointer to a scratch path prefix
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      drains a replayed recording without the int pin while the real
+ *            rate is far above and then below the configured one, and checks
+ *            that the poller settles just below the watermark
+ */
+uint8_t max30102_poll_test(const char *path)
+{
+    max30102_record_header_t header;
+    char recording[256];
+    uint32_t i;
+    uint32_t j;
+
+    /* start poll test */
+    max30102_interface_debug_print("max30102: start poll test.\n");
+
+    /* a counter at 1kHz, so lost or repeated samples show up as gaps */
+    (void)snprintf(recording, sizeof(recording), "%s.m3r", path);
+    max30102_record_header_from_config(&header, "max30102-poll", 0x00, MAX30102_MODE_SPO2, 0x37);
+    if (max30102_record_open(&gs_record, recording, &header, 0) != 0)
+    {
+        max30102_interface_debug_print("max30102: record open failed.\n");
+
+        return 1;
+    }
+    for (i = 0; i < POLL_TEST_SAMPLES; i += 32)
+    {
+        for (j = 0; j < 32; j++)
+        {
+            gs_raw_red[j] = i + j;
+            gs_raw_ir[j] = (i + j) * 3U;
+        }
+        if (max30102_record_write(&gs_record, gs_raw_red, gs_raw_ir, 32, (uint64_t)(i + 32) * 1000000ULL) != 0)
+        {
+            max30102_interface_debug_print("max30102: record write failed.\n");
+            (void)max30102_record_close(&gs_record);
+
+            return 1;
+        }
+    }
+    if (max30102_record_close(&gs_record) != 0)
+    {
+        max30102_interface_debug_print("max30102: record close failed.\n");
+
+        return 1;
+    }
+
+    /* the chip runs ten times faster than configured */
+    max30102_interface_debug_print("max30102: 1000Hz configured as 100Hz.\n");
+    if (a_poll_test_run(recording, 1.0f, MAX30102_SPO2_SAMPLE_RATE_100_HZ, 3800) != 0)
+    {
+        return 1;
+    }
+
+    /* and 2.5 times slower */
+    max30102_interface_debug_print("max30102: 400Hz configured as 1000Hz.\n");
+    if (a_poll_test_run(recording, 0.4f, MAX30102_SPO2_SAMPLE_RATE_1000_HZ, 1200) != 0)
+    {
+        return 1;
+    }
+    (void)unlink(recording);
+
+    /* finish poll test */
+    max30102_interface_debug_print("max30102: finish poll test.\n");
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+
+#ifndef DRIVER_MAX30102_POLL_TEST_H
+#define DRIVER_MAX30102_POLL_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_poll.h"
+#include "driver_max30102_replay.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief     poll test
+ * @param[in] *path pointer to a scratch path prefix
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      drains a replayed recording without the int pin while the real
+ *            rate is far above and then below the configured one, and checks
+ *            that the poller settles just below the watermark
+ */
+uint8_t max30102_poll_test(const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,207 @@
+
+
+#include "driver_max30102_record_test.h"
+#include <unistd.h>
+
+static max30102_record_t gs_record;                /**< record writer */
+static max30102_record_reader_t gs_reader;         /**< record reader */
+static uint32_t gs_red[32];                        /**< red buffer */
+static uint32_t gs_ir[32];                         /**< ir buffer */
+
+/**
+ * @brief     synthetic sample
+ * @param[in] i sample index
+ * @param[in] ch channel
+ * @return    18 bit sample
+ * @note      none
+ */
+static uint32_t a_record_test_sample(uint32_t i, uint32_t ch)
+{
+    return (100000U + ch * 20000U + (i % 97U) * 31U + ((i * 2654435761U) >> 28)) & 0x3FFFFU;
+}
+
+/**
+ * @brief     read the whole file back and compare
+ * @param[in] total expected samples
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      none
+ */
+static uint8_t a_record_test_verify(uint32_t total)
+{
+    uint8_t res;
+    uint32_t i;
+    uint32_t j;
+    uint32_t len;
+
+    i = 0;
+    while (1)
+    {
+        len = 32;
+        res = max30102_record_reader_read(&gs_reader, gs_red, gs_ir, &len, NULL);
+        if (res == 4)
+        {
+            break;
+        }
+        if (res != 0)
+        {
+            max30102_interface_debug_print("max30102: read failed.\n");
+
+            return 1;
+        }
+        for (j = 0; j < len; j++)
+        {
+            if ((gs_red[j] != a_record_test_sample(i + j, 0)) || (gs_ir[j] != a_record_test_sample(i + j, 1)))
+            {
+                max30102_interface_debug_print("max30102: sample %d mismatch.\n", i + j);
+
+                return 1;
+            }
+        }
+        i += len;
+    }
+    if (i != total)
+    {
+        max30102_interface_debug_print("max30102: read %d samples, expect %d.\n", i, total);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     record test
+ * @param[in] *path pointer to a scratch file path
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      runs on synthetic samples, no chip is needed
+ */
+uint8_t max30102_record_test(const char *path)
+{
+    uint8_t res;
+    uint32_t i;
+    uint32_t j;
+    uint32_t len;
+    uint32_t total;
+    uint64_t t;
+    uint64_t t0;
+    uint64_t period;
+    max30102_record_header_t header;
+
+    /* start record test */
+    max30102_interface_debug_print("max30102: start record test.\n");
+
+    /* 100Hz spo2 mode */
+    max30102_record_header_from_config(&header, "max30102-test", 0x00, MAX30102_MODE_SPO2, 0x27);
+    header.chunk_samples = 256;
+    header.start_time_ns = 1;
+    res = max30102_record_open(&gs_record, path, &header, 0);
+    if (res != 0)
+    {
+        max30102_interface_debug_print("max30102: record open failed.\n");
+
+        return 1;
+    }
+
+    /* write batches of varying size */
+    period = 1000000000ULL / 100;
+    t0 = 1000000000ULL;
+    total = 0;
+    for (i = 0; i < 400; i++)
+    {
+        len = 1 + (i % 32);
+        for (j = 0; j < len; j++)
+        {
+            gs_red[j] = a_record_test_sample(total + j, 0);
+            gs_ir[j] = a_record_test_sample(total + j, 1);
+        }
+        total += len;
+        res = max30102_record_write(&gs_record, gs_red, gs_ir, len, t0 + (uint64_t)(total - 1) * period);
+        if (res != 0)
+        {
+            max30102_interface_debug_print("max30102: record write failed.\n");
+            (void)max30102_record_close(&gs_record);
+
+            return 1;
+        }
+    }
+    if (max30102_record_close(&gs_record) != 0)
+    {
+        max30102_interface_debug_print("max30102: record close failed.\n");
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: wrote %d samples.\n", total);
+
+    /* read back through the index */
+    if (max30102_record_reader_open(&gs_reader, path) != 0)
+    {
+        max30102_interface_debug_print("max30102: reader open failed.\n");
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: %d chunks, %d bytes.\n", gs_reader.chunk_count, (uint32_t)gs_reader.size);
+    if ((gs_reader.header.channels != 2) || (gs_reader.header.sample_rate_mhz != 100000) ||
+        (gs_reader.total != total) || (a_record_test_verify(total) != 0))
+    {
+        max30102_interface_debug_print("max30102: check index read failed.\n");
+        (void)max30102_record_reader_close(&gs_reader);
+
+        return 1;
+    }
+
+    /* seek into the middle of a chunk */
+    res = max30102_record_reader_seek(&gs_reader, t0 + 3000ULL * period + 1);
+    len = 1;
+    if ((res != 0) || (max30102_record_reader_read(&gs_reader, gs_red, gs_ir, &len, &t) != 0) ||
+        (gs_red[0] != a_record_test_sample(3001, 0)) || (t != t0 + 3001ULL * period))
+    {
+        max30102_interface_debug_print("max30102: check seek failed.\n");
+        (void)max30102_record_reader_close(&gs_reader);
+
+        return 1;
+    }
+    if (max30102_record_reader_seek(&gs_reader, t0 + (uint64_t)total * period) != 4)
+    {
+        max30102_interface_debug_print("max30102: check seek end failed.\n");
+        (void)max30102_record_reader_close(&gs_reader);
+
+        return 1;
+    }
+    (void)max30102_record_reader_close(&gs_reader);
+    max30102_interface_debug_print("max30102: check index read ok.\n");
+
+    /* drop the trailer and a partial chunk, as after a crash */
+    if (truncate(path, (off_t)gs_reader.size - MAX30102_RECORD_TRAILER_SIZE -
+                 (off_t)gs_reader.chunk_count * MAX30102_RECORD_INDEX_ENTRY_SIZE - 10) != 0)
+    {
+        max30102_interface_debug_print("max30102: truncate failed.\n");
+
+        return 1;
+    }
+    if (max30102_record_reader_open(&gs_reader, path) != 0)
+    {
+        max30102_interface_debug_print("max30102: reader reopen failed.\n");
+
+        return 1;
+    }
+    total = (uint32_t)gs_reader.total;
+    if ((total == 0) || (a_record_test_verify(total) != 0))
+    {
+        max30102_interface_debug_print("max30102: check recovery failed.\n");
+        (void)max30102_record_reader_close(&gs_reader);
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: recovered %d samples in %d chunks.\n", total, gs_reader.chunk_count);
+    (void)max30102_record_reader_close(&gs_reader);
+    (void)unlink(path);
+
+    /* finish record test */
+    max30102_interface_debug_print("max30102: finish record test.\n");
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+
+#ifndef DRIVER_MAX30102_RECORD_TEST_H
+#define DRIVER_MAX30102_RECORD_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_record.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief     record test
+ * @param[in] *path pointer to a scratch file path
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      runs on synthetic samples, no chip is needed
+ */
+uint8_t max30102_record_test(const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,270 @@
+
+
+#include "driver_max30102_replay_test.h"
+#include <time.h>
+#include <unistd.h>
+
+static max30102_handle_t gs_handle;              /**< max30102 handle */
+static max30102_record_t gs_record;              /**< record writer */
+static uint32_t gs_raw_red[32];                  /**< red buffer */
+static uint32_t gs_raw_ir[32];                   /**< ir buffer */
+static uint32_t gs_received;                     /**< samples received */
+static uint32_t gs_errors;                       /**< mismatched or lost samples */
+static uint32_t gs_overruns;                     /**< reads that reported a fifo overrun */
+static uint8_t gs_strict;                        /**< compare sample values */
+
+/**
+ * @brief     synthetic sample
+ * @param[in] i sample index
+ * @param[in] ch channel
+ * @return    18 bit sample
+ * @note      none
+ */
+static uint32_t a_replay_test_sample(uint32_t i, uint32_t ch)
+{
+    return (90000U + ch * 30000U + (i % 83U) * 17U + ((i * 2654435761U) >> 29)) & 0x3FFFFU;
+}
+
+/**
+ * @brief     check a batch read from the driver
+ * @param[in] len number of samples
+ * @note      none
+ */
+static void a_replay_test_check(uint8_t len)
+{
+    uint8_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        if ((gs_strict != 0) &&
+            ((gs_raw_red[i] != a_replay_test_sample(gs_received, 0)) ||
+             (gs_raw_ir[i] != a_replay_test_sample(gs_received, 1))))
+        {
+            gs_errors++;
+        }
+        gs_received++;
+    }
+}
+
+/**
+ * @brief     replay receive callback
+ * @param[in] type irq type
+ * @note      none
+ */
+static void a_replay_test_receive_callback(uint8_t type)
+{
+    if (type == MAX30102_INTERRUPT_STATUS_FIFO_FULL)
+    {
+        uint8_t len;
+
+        uint8_t res;
+
+        len = 32;
+        res = max30102_read(&gs_handle, gs_raw_red, gs_raw_ir, &len);
+        if (res == 4)
+        {
+            gs_overruns++;
+        }
+        else if (res != 0)
+        {
+            gs_errors++;
+
+            return;
+        }
+        a_replay_test_check(len);
+    }
+}
+
+/**
+ * @brief     replay the recording once
+ * @param[in] *path pointer to a recording
+ * @param[in] pacing replay pacing
+ * @param[in] speed speed factor
+ * @param[in] total samples in the recording
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      paced runs depend on the scheduling latency of the host, so
+ *            they check the timing and report overruns instead of values
+ */
+static uint8_t a_replay_test_run(const char *path, max30102_replay_pacing_t pacing, float speed, uint32_t total)
+{
+    uint8_t res;
+    uint8_t len;
+    uint64_t delivered;
+    struct timespec t0;
+    struct timespec t1;
+    double elapsed;
+
+    if (max30102_replay_open(path, pacing, speed) != 0)
+    {
+        max30102_interface_debug_print("max30102: replay open failed.\n");
+
+        return 1;
+    }
+
+    /* link the replay backend instead of the iic interface */
+    DRIVER_MAX30102_LINK_INIT(&gs_handle, max30102_handle_t);
+    DRIVER_MAX30102_LINK_REPLAY(&gs_handle);
+    DRIVER_MAX30102_LINK_DEBUG_PRINT(&gs_handle, max30102_interface_debug_print);
+    DRIVER_MAX30102_LINK_RECEIVE_CALLBACK(&gs_handle, a_replay_test_receive_callback);
+    if (max30102_init(&gs_handle) != 0)
+    {
+        max30102_interface_debug_print("max30102: init failed.\n");
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+    if ((max30102_set_fifo_almost_full(&gs_handle, 15) != 0) ||
+        (max30102_set_fifo_roll(&gs_handle, MAX30102_BOOL_TRUE) != 0) ||
+        (max30102_set_adc_resolution(&gs_handle, MAX30102_ADC_RESOLUTION_18_BIT) != 0) ||
+        (max30102_set_interrupt(&gs_handle, MAX30102_INTERRUPT_FIFO_FULL_EN, MAX30102_BOOL_TRUE) != 0) ||
+        (max30102_set_mode(&gs_handle, MAX30102_MODE_SPO2) != 0))
+    {
+        max30102_interface_debug_print("max30102: config failed.\n");
+        (void)max30102_deinit(&gs_handle);
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+
+    /* the replay stands in for the gpio interrupt */
+    gs_received = 0;
+    gs_errors = 0;
+    gs_overruns = 0;
+    gs_strict = (pacing == MAX30102_REPLAY_PACING_FAST) ? 1 : 0;
+    (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (1)
+    {
+        res = max30102_replay_wait(1000);
+        if (res == 4)
+        {
+            break;
+        }
+        if (res != 0)
+        {
+            max30102_interface_debug_print("max30102: replay wait timeout.\n");
+            gs_errors++;
+
+            break;
+        }
+        if (max30102_irq_handler(&gs_handle) != 0)
+        {
+            gs_errors++;
+
+            break;
+        }
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    /* drain the tail below the almost full level */
+    (void)max30102_replay_get_progress(&delivered, NULL);
+    if (delivered > gs_received)
+    {
+        len = (uint8_t)(delivered - gs_received);
+        if (max30102_read(&gs_handle, gs_raw_red, gs_raw_ir, &len) == 0)
+        {
+            a_replay_test_check(len);
+        }
+    }
+    (void)max30102_deinit(&gs_handle);
+    (void)max30102_replay_close();
+
+    elapsed = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    max30102_interface_debug_print("max30102: replayed %d/%d samples in %0.3fs, %0.0fx real time.\n",
+                                   gs_received, total, elapsed, (double)total / 100.0 / ((elapsed > 0.0) ? elapsed : 1e-9));
+    if (gs_strict != 0)
+    {
+        if ((gs_errors != 0) || (gs_overruns != 0) || (gs_received != total))
+        {
+            max30102_interface_debug_print("max30102: %d errors.\n", gs_errors);
+
+            return 1;
+        }
+    }
+    else
+    {
+        max30102_interface_debug_print("max30102: %d fifo overruns.\n", gs_overruns);
+        if ((gs_errors != 0) || (delivered != total) ||
+            (elapsed < (double)total / 100.0 / speed * 0.95) || (elapsed > (double)total / 100.0 / speed * 1.2))
+        {
+            max30102_interface_debug_print("max30102: check pacing failed.\n");
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     replay test
+ * @param[in] *path pointer to a scratch file path
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      replays a synthetic recording through the driver api
+ *            as fast as possible and at 100x real time
+ */
+uint8_t max30102_replay_test(const char *path)
+{
+    uint32_t i;
+    uint32_t j;
+    uint32_t total;
+    max30102_record_header_t header;
+
+    /* start replay test */
+    max30102_interface_debug_print("max30102: start replay test.\n");
+
+    /* ten minutes at 100Hz */
+    max30102_record_header_from_config(&header, "max30102-test", 0x00, MAX30102_MODE_SPO2, 0x27);
+    if (max30102_record_open(&gs_record, path, &header, 0) != 0)
+    {
+        max30102_interface_debug_print("max30102: record open failed.\n");
+
+        return 1;
+    }
+    total = 0;
+    for (i = 0; i < 60000 / 20; i++)
+    {
+        for (j = 0; j < 20; j++)
+        {
+            gs_raw_red[j] = a_replay_test_sample(total + j, 0);
+            gs_raw_ir[j] = a_replay_test_sample(total + j, 1);
+        }
+        total += 20;
+        if (max30102_record_write(&gs_record, gs_raw_red, gs_raw_ir, 20, 1000000000ULL + (uint64_t)(total - 1) * 10000000ULL) != 0)
+        {
+            max30102_interface_debug_print("max30102: record write failed.\n");
+            (void)max30102_record_close(&gs_record);
+
+            return 1;
+        }
+    }
+    if (max30102_record_close(&gs_record) != 0)
+    {
+        max30102_interface_debug_print("max30102: record close failed.\n");
+
+        return 1;
+    }
+
+    /* as fast as possible */
+    max30102_interface_debug_print("max30102: replay as fast as possible.\n");
+    if (a_replay_test_run(path, MAX30102_REPLAY_PACING_FAST, 0.0f, total) != 0)
+    {
+        return 1;
+    }
+
+    /* paced at 100x */
+    max30102_interface_debug_print("max30102: replay at 100x.\n");
+    if (a_replay_test_run(path, MAX30102_REPLAY_PACING_ACCELERATED, 100.0f, total) != 0)
+    {
+        return 1;
+    }
+    (void)unlink(path);
+
+    /* finish replay test */
+    max30102_interface_debug_print("max30102: finish replay test.\n");
+
+    return 0;
+}
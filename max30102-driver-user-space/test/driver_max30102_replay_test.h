@@ -0,0 +1,36 @@
+
+#ifndef DRIVER_MAX30102_REPLAY_TEST_H
+#define DRIVER_MAX30102_REPLAY_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_replay.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief     replay test
+ * @param[in] *path pointer to a scratch file path
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      replays a synthetic recording through the driver api
+ *            as fast as possible and at 100x real time
+ */
+uint8_t max30102_replay_test(const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,302 @@
+
+
+#define _GNU_SOURCE        /**< pthread_getaffinity_np and sched_getcpu */
+
+#include "driver_max30102_rt_test.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RT_TEST_PERIOD_US        1000          /**< 1ms, a 32 sample fifo at 3200Hz drained every 10 samples */
+#define RT_TEST_LOOPS            3000          /**< three seconds per run */
+#define RT_TEST_MAX_LOAD         64            /**< load threads limit */
+#define RT_TEST_P99_FACTOR       2             /**< tuned p99 may be this many times the default one */
+#define RT_TEST_P99_SLACK_US     200           /**< plus this much, both are noise on an idle host */
+
+/**
+ * @brief rt test check structure definition
+ */
+typedef struct rt_test_check_s
+{
+    max30102_rt_config_t config;               /**< policy and affinity to apply */
+    uint8_t seen;                              /**< max30102_rt_applied_t bits that read back */
+} rt_test_check_t;
+
+static volatile uint8_t gs_load_stop;          /**< load threads stop flag */
+
+/**
+ * @brief     busy load thread
+ * @param[in] *arg unused
+ * @return    NULL
+ * @note      spins at the default priority until told to stop
+ */
+static void *a_rt_test_load(void *arg)
+{
+    volatile uint64_t n = 0;
+
+    (void)arg;
+    while (gs_load_stop == 0)
+    {
+        n++;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief     print one latency run
+ * @param[in] *name pointer to a run name
+ * @param[in] *latency pointer to a max30102 rt latency structure
+ * @note      none
+ */
+static void a_rt_test_print(const char *name, const max30102_rt_latency_t *latency)
+{
+    max30102_interface_debug_print("max30102: %s min %0.1fus, mean %0.1fus, p99 %0.1fus, max %0.1fus.\n", name,
+                                   (double)latency->min_ns / 1e3, (double)latency->mean_ns / 1e3,
+                                   (double)latency->p99_ns / 1e3, (double)latency->max_ns / 1e3);
+}
+
+/**
+ * @brief      settings check thread
+ * @param[in]  *arg pointer to an rt test check structure
+ * @return     NULL
+ * @note       applies the config like the latency thread does and records
+ *             which settings read back
+ */
+static void *a_rt_test_check(void *arg)
+{
+    rt_test_check_t *check = (rt_test_check_t *)arg;
+    const max30102_rt_config_t *config = &check->config;
+    struct sched_param param;
+    cpu_set_t set;
+    uint8_t applied;
+    uint8_t seen;
+    int policy;
+
+    seen = 0;
+    (void)max30102_rt_apply(config, &applied);
+    if ((applied & MAX30102_RT_APPLIED_SCHED_FIFO) != 0)
+    {
+        if ((pthread_getschedparam(pthread_self(), &policy, &param) == 0) && (policy == SCHED_FIFO) &&
+            (param.sched_priority == config->priority))
+        {
+            seen |= MAX30102_RT_APPLIED_SCHED_FIFO;
+        }
+    }
+    if ((applied & MAX30102_RT_APPLIED_AFFINITY) != 0)
+    {
+        if ((pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) && (CPU_COUNT(&set) == 1) &&
+            CPU_ISSET(config->cpu, &set) && (sched_getcpu() == config->cpu))
+        {
+            seen |= MAX30102_RT_APPLIED_AFFINITY;
+        }
+    }
+    check->seen = seen;
+
+    return NULL;
+}
+
+/**
+ * @brief  read the locked memory of the process
+ * @return locked kB, 0 if unknown
+ * @note   VmLck in /proc/self/status
+ */
+static unsigned long a_rt_test_locked_kb(void)
+{
+    char line[128];
+    unsigned long kb;
+    FILE *fp;
+
+    kb = 0;
+    fp = fopen("/proc/self/status", "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (sscanf(line, "VmLck: %lu", &kb) == 1)
+        {
+            break;
+        }
+    }
+    (void)fclose(fp);
+
+    return kb;
+}
+
+/**
+ * @brief     check that the tuned settings took effect
+ * @param[in] *config pointer to the max30102 rt config structure of the tuned run
+ * @return    status code
+ *            - 0 success
+ *            - 1 a reported setting did not read back
+ * @note      policy and affinity are per thread, so a new thread applies the
+ *            config again and reads both back; memory stays locked after
+ *            the tuned run, so the process must show locked pages
+ */
+static uint8_t a_rt_test_verify(const max30102_rt_config_t *config)
+{
+    rt_test_check_t check;
+    pthread_t tid;
+
+    check.config = *config;
+    check.config.lock_memory = 0;
+    check.seen = 0;
+    if (pthread_create(&tid, NULL, a_rt_test_check, &check) != 0)
+    {
+        max30102_interface_debug_print("max30102: create check thread failed.\n");
+
+        return 1;
+    }
+    (void)pthread_join(tid, NULL);
+    if ((check.seen & MAX30102_RT_APPLIED_SCHED_FIFO) == 0)
+    {
+        max30102_interface_debug_print("max30102: check sched_fifo priority %d failed.\n", (int)config->priority);
+
+        return 1;
+    }
+    if ((check.seen & MAX30102_RT_APPLIED_AFFINITY) == 0)
+    {
+        max30102_interface_debug_print("max30102: check affinity to cpu %d failed.\n", (int)config->cpu);
+
+        return 1;
+    }
+    if (a_rt_test_locked_kb() == 0)
+    {
+        max30102_interface_debug_print("max30102: check mlock failed.\n");
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief  rt test
+ * @return status code
+ *         - 0 success
+ *         - 1 test failed
+ *         - 2 skipped, SCHED_FIFO or mlock was refused
+ * @note   measures the wake up jitter of a 1ms acquisition loop on a loaded
+ *         machine with the default scheduling and again with SCHED_FIFO,
+ *         cpu pinning and locked memory; fails when a setting reported as
+ *         applied does not read back, or when the tuned p99 is far above
+ *         the default one, the worst case is only printed
+ */
+uint8_t max30102_rt_test(void)
+{
+    pthread_t load[RT_TEST_MAX_LOAD];
+    max30102_rt_config_t config;
+    cpu_set_t set;
+    max30102_rt_latency_t plain;
+    max30102_rt_latency_t tuned;
+    long cpus;
+    long i;
+    int cpu;
+    uint8_t res;
+
+    /* start rt test */
+    max30102_interface_debug_print("max30102: start rt test.\n");
+
+    /* one busy thread per cpu, so the default scheduler has to share */
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+    {
+        cpus = 1;
+    }
+    if (cpus > RT_TEST_MAX_LOAD)
+    {
+        cpus = RT_TEST_MAX_LOAD;
+    }
+    /* pin to the last cpu this process may run on, not just the last online one */
+    cpu = (int)(cpus - 1);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+    {
+        cpu = CPU_SETSIZE - 1;
+        while ((cpu > 0) && (CPU_ISSET(cpu, &set) == 0))
+        {
+            cpu--;
+        }
+    }
+    max30102_interface_debug_print("max30102: %d load threads, %dus period, %d wake ups.\n",
+                                   (int)cpus, RT_TEST_PERIOD_US, RT_TEST_LOOPS);
+    gs_load_stop = 0;
+    for (i = 0; i < cpus; i++)
+    {
+        if (pthread_create(&load[i], NULL, a_rt_test_load, NULL) != 0)
+        {
+            max30102_interface_debug_print("max30102: create load thread failed.\n");
+            gs_load_stop = 1;
+            while (i > 0)
+            {
+                (void)pthread_join(load[--i], NULL);
+            }
+
+            return 1;
+        }
+    }
+
+    /* default policy first, the tuned run locks memory for good */
+    res = max30102_rt_latency(NULL, RT_TEST_PERIOD_US, RT_TEST_LOOPS, &plain);
+    if (res == 0)
+    {
+        (void)max30102_rt_config_init(&config);
+        config.priority = MAX30102_RT_DEFAULT_PRIORITY;
+        config.cpu = (int32_t)cpu;
+        config.lock_memory = 1;
+        res = max30102_rt_latency(&config, RT_TEST_PERIOD_US, RT_TEST_LOOPS, &tuned);
+    }
+    gs_load_stop = 1;
+    for (i = 0; i < cpus; i++)
+    {
+        (void)pthread_join(load[i], NULL);
+    }
+    if (res != 0)
+    {
+        max30102_interface_debug_print("max30102: measure latency failed.\n");
+
+        return 1;
+    }
+
+    a_rt_test_print("default:", &plain);
+    a_rt_test_print("tuned:  ", &tuned);
+    max30102_interface_debug_print("max30102: sched_fifo %s, affinity %s, mlock %s.\n",
+                                   (tuned.applied & MAX30102_RT_APPLIED_SCHED_FIFO) ? "on" : "refused",
+                                   (tuned.applied & MAX30102_RT_APPLIED_AFFINITY) ? "on" : "refused",
+                                   (tuned.applied & MAX30102_RT_APPLIED_MLOCK) ? "on" : "refused");
+    if (((tuned.applied & MAX30102_RT_APPLIED_SCHED_FIFO) == 0) || ((tuned.applied & MAX30102_RT_APPLIED_MLOCK) == 0))
+    {
+        max30102_interface_debug_print("max30102: run as root or grant CAP_SYS_NICE and CAP_IPC_LOCK to compare.\n");
+        max30102_interface_debug_print("max30102: skip rt test.\n");
+
+        return 2;
+    }
+    if ((tuned.applied & MAX30102_RT_APPLIED_AFFINITY) == 0)
+    {
+        max30102_interface_debug_print("max30102: pin to cpu %d failed.\n", cpu);
+
+        return 1;
+    }
+    if (a_rt_test_verify(&config) != 0)
+    {
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: default over tuned, p99 %0.1fx, worst case %0.1fx.\n",
+                                   (tuned.p99_ns != 0) ? (double)plain.p99_ns / (double)tuned.p99_ns : 0.0,
+                                   (tuned.max_ns != 0) ? (double)plain.max_ns / (double)tuned.max_ns : 0.0);
+    if (tuned.p99_ns > plain.p99_ns * RT_TEST_P99_FACTOR + RT_TEST_P99_SLACK_US * 1000ULL)
+    {
+        max30102_interface_debug_print("max30102: tuned p99 is over %dx the default plus %dus.\n",
+                                       RT_TEST_P99_FACTOR, RT_TEST_P99_SLACK_US);
+
+        return 1;
+    }
+
+    /* finish rt test */
+    max30102_interface_debug_print("max30102: finish rt test.\n");
+
+    return 0;
+}
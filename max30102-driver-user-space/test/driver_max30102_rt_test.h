@@ -0,0 +1,38 @@
+#ifndef DRIVER_MAX30102_RT_TEST_H
+#define DRIVER_MAX30102_RT_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_rt.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief  rt test
+ * @return status code
+ *         - 0 success
+ *         - 1 test failed
+ *         - 2 skipped, SCHED_FIFO or mlock was refused
+ * @note   measures the wake up jitter of a 1ms acquisition loop on a loaded
+ *         machine with the default scheduling and again with SCHED_FIFO,
+ *         cpu pinning and locked memory; fails when a setting reported as
+ *         applied does not read back, or when the tuned p99 is far above
+ *         the default one, the worst case is only printed
+ */
+uint8_t max30102_rt_test(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
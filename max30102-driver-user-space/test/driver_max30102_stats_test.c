@@ -0,0 +1,339 @@
+
+
+#include "driver_max30102_stats_test.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#define STATS_TEST_SAMPLES        6000          /**< one minute at 100Hz */
+#define STATS_TEST_EVENTS         1000000       /**< hook calls timed for the cost */
+#define STATS_TEST_DEVICE         "max30102-test"
+
+static max30102_handle_t gs_handle;              /**< max30102 handle */
+static max30102_record_t gs_record;              /**< record writer */
+static max30102_stats_t gs_stats;                /**< statistics registry */
+static max30102_stats_t gs_stats_idle;           /**< second registry for the multi device text */
+static uint32_t gs_raw_red[32];                  /**< red buffer */
+static uint32_t gs_raw_ir[32];                   /**< ir buffer */
+static uint32_t gs_received;                     /**< samples received */
+static char gs_text[65536];                      /**< prometheus text */
+
+/**
+ * @brief     stats receive callback
+ * @param[in] type irq type
+ * @note      none
+ */
+static void a_stats_test_receive_callback(uint8_t type)
+{
+    if (type == MAX30102_INTERRUPT_STATUS_FIFO_FULL)
+    {
+        uint8_t len = 32;
+
+        if (max30102_read(&gs_handle, gs_raw_red, gs_raw_ir, &len) == 0)
+        {
+            gs_received += len;
+        }
+    }
+}
+
+/**
+ * @brief     open the replay and link the registry
+ * @param[in] *path pointer to a recording
+ * @param[in] pacing replay pacing
+ * @param[in] speed speed factor
+ * @return    status code
+ *            - 0 success
+ *            - 1 open failed
+ * @note      none
+ */
+static uint8_t a_stats_test_open(const char *path, max30102_replay_pacing_t pacing, float speed)
+{
+    if (max30102_replay_open(path, pacing, speed) != 0)
+    {
+        return 1;
+    }
+    DRIVER_MAX30102_LINK_INIT(&gs_handle, max30102_handle_t);
+    DRIVER_MAX30102_LINK_REPLAY(&gs_handle);
+    DRIVER_MAX30102_LINK_DEBUG_PRINT(&gs_handle, max30102_interface_debug_print);
+    DRIVER_MAX30102_LINK_RECEIVE_CALLBACK(&gs_handle, a_stats_test_receive_callback);
+    DRIVER_MAX30102_LINK_STATS(&gs_handle, &gs_stats);
+    if (max30102_init(&gs_handle) != 0)
+    {
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+    if ((max30102_set_fifo_almost_full(&gs_handle, 15) != 0) ||
+        (max30102_set_fifo_roll(&gs_handle, MAX30102_BOOL_TRUE) != 0) ||
+        (max30102_set_adc_resolution(&gs_handle, MAX30102_ADC_RESOLUTION_18_BIT) != 0) ||
+        (max30102_set_interrupt(&gs_handle, MAX30102_INTERRUPT_FIFO_FULL_EN, MAX30102_BOOL_TRUE) != 0) ||
+        (max30102_set_mode(&gs_handle, MAX30102_MODE_SPO2) != 0))
+    {
+        (void)max30102_deinit(&gs_handle);
+        (void)max30102_replay_close();
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief     check a histogram against its event count
+ * @param[in] *h pointer to a snapshot histogram
+ * @param[in] events expected observations
+ * @return    status code
+ *            - 0 success
+ *            - 1 check failed
+ * @note      none
+ */
+static uint8_t a_stats_test_histogram(const max30102_stats_snapshot_histogram_t *h, uint64_t events)
+{
+    uint64_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < MAX30102_STATS_BUCKETS; i++)
+    {
+        sum += h->bucket[i];
+    }
+
+    return ((h->count == events) && (sum == events) && ((events == 0) || (h->sum_ns != 0))) ? 0 : 1;
+}
+
+/**
+ * @brief     count occurrences of a string
+ * @param[in] *text pointer to a text
+ * @param[in] *needle pointer to the string to count
+ * @return    occurrences
+ * @note      none
+ */
+static uint32_t a_stats_test_count(const char *text, const char *needle)
+{
+    uint32_t n = 0;
+
+    while ((text = strstr(text, needle)) != NULL)
+    {
+        n++;
+        text++;
+    }
+
+    return n;
+}
+
+/**
+ * @brief     stats test
+ * @param[in] *path pointer to a scratch path prefix
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      drives the driver from a replayed recording with a registry
+ *            linked, checks the counters, a forced fifo overflow and the
+ *            prometheus text, and reports the cost per event
+ */
+uint8_t max30102_stats_test(const char *path)
+{
+    max30102_record_header_t header;
+    max30102_stats_snapshot_t snap;
+    max30102_stats_t *registries[2];
+    const char *devices[2];
+    char recording[256];
+    char prom[256];
+    char line[128];
+    uint64_t delivered;
+    uint64_t irqs;
+    uint64_t start;
+    struct timespec t0;
+    struct timespec t1;
+    struct stat st;
+    double ns;
+    size_t got;
+    uint32_t i;
+    uint32_t j;
+    uint8_t len;
+    uint8_t res;
+    int sv[2];
+
+    /* start stats test */
+    max30102_interface_debug_print("max30102: start stats test.\n");
+
+    /* one minute at 100Hz */
+    (void)snprintf(recording, sizeof(recording), "%s.m3r", path);
+    (void)snprintf(prom, sizeof(prom), "%s.prom", path);
+    max30102_record_header_from_config(&header, STATS_TEST_DEVICE, 0x00, MAX30102_MODE_SPO2, 0x27);
+    if (max30102_record_open(&gs_record, recording, &header, 0) != 0)
+    {
+        max30102_interface_debug_print("max30102: record open failed.\n");
+
+        return 1;
+    }
+    for (i = 0; i < STATS_TEST_SAMPLES; i += 20)
+    {
+        for (j = 0; j < 20; j++)
+        {
+            gs_raw_red[j] = 90000U + ((i + j) % 97U) * 13U;
+            gs_raw_ir[j] = 120000U + ((i + j) % 89U) * 11U;
+        }
+        if (max30102_record_write(&gs_record, gs_raw_red, gs_raw_ir, 20, (uint64_t)(i + 20) * 10000000ULL) != 0)
+        {
+            max30102_interface_debug_print("max30102: record write failed.\n");
+            (void)max30102_record_close(&gs_record);
+
+            return 1;
+        }
+    }
+    if (max30102_record_close(&gs_record) != 0)
+    {
+        max30102_interface_debug_print("max30102: record close failed.\n");
+
+        return 1;
+    }
+
+    /* every sample through the irq path */
+    (void)max30102_stats_init(&gs_stats);
+    if (a_stats_test_open(recording, MAX30102_REPLAY_PACING_FAST, 0.0f) != 0)
+    {
+        max30102_interface_debug_print("max30102: replay open failed.\n");
+
+        return 1;
+    }
+    gs_received = 0;
+    irqs = 0;
+    while (max30102_replay_wait(1000) == 0)
+    {
+        (void)max30102_irq_handler(&gs_handle);
+        irqs++;
+    }
+    (void)max30102_replay_get_progress(&delivered, NULL);
+    if (delivered > gs_received)
+    {
+        len = (uint8_t)(delivered - gs_received);
+        if (max30102_read(&gs_handle, gs_raw_red, gs_raw_ir, &len) == 0)
+        {
+            gs_received += len;
+        }
+    }
+    (void)max30102_deinit(&gs_handle);
+    (void)max30102_replay_close();
+    (void)max30102_stats_snapshot(&gs_stats, &snap);
+    max30102_interface_debug_print("max30102: %d irqs, %d drains, %d samples, %d iic reads, %d iic writes.\n",
+                                   (uint32_t)snap.irqs, (uint32_t)snap.drains, (uint32_t)snap.samples,
+                                   (uint32_t)snap.iic_reads, (uint32_t)snap.iic_writes);
+    if ((snap.samples != STATS_TEST_SAMPLES) || (gs_received != STATS_TEST_SAMPLES) || (snap.irqs != irqs) ||
+        (snap.drains == 0) || (snap.iic_read_errors != 0) || (snap.iic_write_errors != 0) || (snap.irq_errors != 0) ||
+        (snap.drain_errors != 0) || (snap.overruns != 0) || (snap.iic_read_bytes < (uint64_t)STATS_TEST_SAMPLES * 6) ||
+        (snap.iic_write_bytes != snap.iic_writes))
+    {
+        max30102_interface_debug_print("max30102: check counters failed.\n");
+
+        return 1;
+    }
+    if ((a_stats_test_histogram(&snap.iic_read_latency, snap.iic_reads) != 0) ||
+        (a_stats_test_histogram(&snap.iic_write_latency, snap.iic_writes) != 0) ||
+        (a_stats_test_histogram(&snap.irq_latency, snap.irqs) != 0) ||
+        (a_stats_test_histogram(&snap.drain_latency, snap.drains) != 0))
+    {
+        max30102_interface_debug_print("max30102: check histograms failed.\n");
+
+        return 1;
+    }
+
+    /* a reader that falls behind at 1000x real time */
+    (void)max30102_stats_reset(&gs_stats);
+    if (a_stats_test_open(recording, MAX30102_REPLAY_PACING_ACCELERATED, 1000.0f) != 0)
+    {
+        max30102_interface_debug_print("max30102: replay open failed.\n");
+
+        return 1;
+    }
+    (void)usleep(20000);
+    len = 32;
+    res = max30102_read(&gs_handle, gs_raw_red, gs_raw_ir, &len);
+    (void)max30102_deinit(&gs_handle);
+    (void)max30102_replay_close();
+    (void)max30102_stats_snapshot(&gs_stats, &snap);
+    max30102_interface_debug_print("max30102: overrun lost %d samples.\n", (uint32_t)snap.overrun_samples);
+    if ((res != 4) || (snap.overruns != 1) || (snap.overrun_samples == 0) || (snap.drains != 1) ||
+        (snap.drain_errors != 0) || (snap.samples != len))
+    {
+        max30102_interface_debug_print("max30102: check overrun failed.\n");
+
+        return 1;
+    }
+
+    /* prometheus text over a socket, two devices share the family headers */
+    (void)max30102_stats_init(&gs_stats_idle);
+    registries[0] = &gs_stats;
+    registries[1] = &gs_stats_idle;
+    devices[0] = STATS_TEST_DEVICE;
+    devices[1] = "max30102-idle";
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    {
+        max30102_interface_debug_print("max30102: socketpair failed.\n");
+
+        return 1;
+    }
+    res = max30102_stats_write_fd(registries, devices, 2, sv[0]);
+    (void)close(sv[0]);
+    got = 0;
+    while (got < sizeof(gs_text) - 1)
+    {
+        ssize_t n = read(sv[1], gs_text + got, sizeof(gs_text) - 1 - got);
+
+        if (n <= 0)
+        {
+            break;
+        }
+        got += (size_t)n;
+    }
+    gs_text[got] = '\0';
+    (void)close(sv[1]);
+    (void)snprintf(line, sizeof(line), "max30102_fifo_overruns_total{device=\"%s\"} 1\n", STATS_TEST_DEVICE);
+    if ((res != 0) || (strstr(gs_text, line) == NULL) ||
+        (strstr(gs_text, "max30102_samples_total{device=\"max30102-idle\"} 0\n") == NULL) ||
+        (strstr(gs_text, "max30102_iic_duration_seconds_bucket{device=\"max30102-idle\",op=\"write\",le=\"+Inf\"} 0\n") == NULL) ||
+        (a_stats_test_count(gs_text, "# TYPE max30102_samples_total counter\n") != 1) ||
+        (a_stats_test_count(gs_text, "max30102_samples_total{") != 2))
+    {
+        max30102_interface_debug_print("max30102: check prometheus text failed.\n");
+
+        return 1;
+    }
+    max30102_interface_debug_print("max30102: prometheus text %d bytes for 2 devices.\n", (uint32_t)got);
+
+    /* textfile collector */
+    if ((max30102_stats_write_file(registries, devices, 1, prom) != 0) || (stat(prom, &st) != 0) || (st.st_size == 0))
+    {
+        max30102_interface_debug_print("max30102: write file failed.\n");
+
+        return 1;
+    }
+    (void)strncat(prom, ".tmp", sizeof(prom) - strlen(prom) - 1);
+    if (stat(prom, &st) == 0)
+    {
+        max30102_interface_debug_print("max30102: temporary file left behind.\n");
+
+        return 1;
+    }
+    prom[strlen(prom) - 4] = '\0';
+
+    /* cost of one event as seen by the read path */
+    (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < STATS_TEST_EVENTS; i++)
+    {
+        start = gs_stats.hook.clock_ns();
+        gs_stats.hook.record(&gs_stats.hook, MAX30102_STATS_EVENT_IIC_READ, start, 0, 1);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec)) / STATS_TEST_EVENTS;
+    max30102_interface_debug_print("max30102: %0.1fns per event.\n", ns);
+    (void)unlink(recording);
+    (void)unlink(prom);
+
+    /* finish stats test */
+    max30102_interface_debug_print("max30102: finish stats test.\n");
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+
+#ifndef DRIVER_MAX30102_STATS_TEST_H
+#define DRIVER_MAX30102_STATS_TEST_H
+
+#include "driver_max30102_interface.h"
+#include "driver_max30102_stats.h"
+#include "driver_max30102_replay.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**
+ * @addtogroup max30102_test_driver
+ * @{
+ */
+
+/**
+ * @brief     stats test
+ * @param[in] *path pointer to a scratch path prefix
+ * @return    status code
+ *            - 0 success
+ *            - 1 test failed
+ * @note      drives the driver from a replayed recording with a registry
+ *            linked, checks the counters, a forced fifo overflow and the
+ *            prometheus text, and reports the cost per event
+ */
+uint8_t max30102_stats_test(const char *path);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
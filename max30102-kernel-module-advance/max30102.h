@@ -1,8 +1,9 @@
 #ifndef MAX30102_H
 #define MAX30102_H
 
+#ifdef __KERNEL__
 #include <linux/i2c.h>
-#include <linux/rwlock.h>  // Changed from mutex.h to rwlock.h
+#include <linux/mutex.h>
 #include <linux/workqueue.h>
 #include <linux/gpio/consumer.h>
 #include <linux/miscdevice.h>
@@ -13,6 +14,13 @@
 #include <linux/regulator/consumer.h>  // Added for regulator support
 #include <linux/hwmon.h>  // Added for hwmon integration
 #include <linux/hwmon-sysfs.h>  // Added for hwmon sysfs
+#include <linux/hrtimer.h>  // FIFO polling without the INT pin
+#include <linux/completion.h>  // Deferred sensor bring-up
+#include <linux/spinlock.h>  // Sample history ring
+#else
+#include <stdint.h>
+#include <sys/ioctl.h>  // User-space builds only need the ABI below
+#endif
 
 /* MAX30102 Register Definitions */
 #define MAX30102_ADDRESS                0x57
@@ -81,6 +89,19 @@ enum max30102_smp_ave {
 #define MAX30102_IOC_SET_SLOT       _IOW(MAX30102_IOC_MAGIC, 3, struct max30102_slot_config)
 #define MAX30102_IOC_SET_FIFO_CONFIG _IOW(MAX30102_IOC_MAGIC, 4, uint8_t)
 #define MAX30102_IOC_SET_SPO2_CONFIG _IOW(MAX30102_IOC_MAGIC, 5, uint8_t)
+#define MAX30102_IOC_READ_CHANNELS  _IOR(MAX30102_IOC_MAGIC, 6, struct max30102_channel_data)
+#define MAX30102_IOC_SET_HISTORY    _IOW(MAX30102_IOC_MAGIC, 7, uint8_t)
+#define MAX30102_IOC_GET_HISTORY    _IOR(MAX30102_IOC_MAGIC, 8, struct max30102_history_info)
+#define MAX30102_IOC_SET_REDUCE     _IOW(MAX30102_IOC_MAGIC, 9, struct max30102_reduce_config)
+#define MAX30102_IOC_SET_QOS        _IOW(MAX30102_IOC_MAGIC, 10, struct max30102_qos)
+#define MAX30102_IOC_GET_QOS        _IOR(MAX30102_IOC_MAGIC, 11, struct max30102_qos_info)
+
+#define MAX30102_MAX_CHANNELS       4  // One per multi-LED slot
+#define MAX30102_FIFO_DEPTH         32
+#define MAX30102_FIFO_BYTES         (MAX30102_FIFO_DEPTH * MAX30102_MAX_CHANNELS * 3)  // A full FIFO, 3 bytes per slot
+#define MAX30102_REDUCE_MAX_FACTOR  1024
+#define MAX30102_REDUCE_MAX_ORDER   4
+#define MAX30102_REDUCE_MAX_TAPS    32
 
 struct max30102_fifo_data {
     uint32_t red[32];
@@ -88,44 +109,294 @@ struct max30102_fifo_data {
     uint8_t len;
 };
 
+/*
+ * Every active slot of a drain, one channel per slot in slot order. Heart
+ * rate mode has a red channel, SpO2 mode red then IR, multi-LED mode one
+ * channel per slot set to red or IR.
+ */
+struct max30102_channel_data {
+    uint8_t mask;       // Bit n set: slot n + 1 is active
+    uint8_t channels;   // Active slots, values per sample
+    uint8_t led[MAX30102_MAX_CHANNELS];  // LED of each channel: 1 = red, 2 = IR
+    uint8_t len;        // Samples
+    uint32_t sample[32][MAX30102_MAX_CHANNELS];  // First channels entries of each row are valid
+};
+
+/*
+ * One sample of the history window, see max30102_history.c. In history mode
+ * the file offset of sample n is n * sizeof(struct max30102_sample).
+ */
+struct max30102_sample {
+    uint64_t timestamp_ns;  // CLOCK_MONOTONIC time of the drain that read it
+    uint32_t value[MAX30102_MAX_CHANNELS];  // First channels entries are valid, in slot order
+    uint8_t mask;
+    uint8_t channels;
+    uint8_t led[MAX30102_MAX_CHANNELS];
+    uint8_t reserved[2];
+};
+
+struct max30102_history_info {
+    uint64_t first;         // Oldest sequence number still held
+    uint64_t next;          // Sequence number of the next sample drained
+    uint32_t window;        // Samples the history holds
+    uint32_t sample_size;   // sizeof(struct max30102_sample)
+};
+
+/* Per-open reduction stage, see max30102_reduce.c */
+enum max30102_reduce_type {
+    MAX30102_REDUCE_NONE     = 0,  // Raw batches or history, as without a stage
+    MAX30102_REDUCE_CIC      = 1,  // CIC decimator of order stages, 1 is a boxcar mean
+    MAX30102_REDUCE_ENVELOPE = 2,  // Mean, min and max of each window
+    MAX30102_REDUCE_FIR      = 3,  // Fixed-point FIR evaluated once per window
+};
+
+struct max30102_reduce_config {
+    uint8_t type;       // enum max30102_reduce_type
+    uint8_t order;      // CIC stages, 1..MAX30102_REDUCE_MAX_ORDER
+    uint16_t factor;    // Samples per output, 1..MAX30102_REDUCE_MAX_FACTOR
+    uint8_t taps;       // FIR taps, 1..MAX30102_REDUCE_MAX_TAPS
+    uint8_t shift;      // FIR coefficients are fixed point with this many fraction bits
+    int16_t coef[MAX30102_REDUCE_MAX_TAPS];  // coef[0] weighs the newest sample
+};
+
+/* One output of the reduction stage, read() returns whole records */
+struct max30102_reduced {
+    uint64_t seq;       // Sequence number of the last sample of the window
+    uint8_t mask;
+    uint8_t channels;
+    uint8_t led[MAX30102_MAX_CHANNELS];
+    uint16_t dropped;   // Records dropped just before this one, the reader fell behind
+    int32_t value[MAX30102_MAX_CHANNELS];  // Filter output, the mean for envelopes
+    int32_t min[MAX30102_MAX_CHANNELS];    // Envelopes only
+    int32_t max[MAX30102_MAX_CHANNELS];
+};
+
 struct max30102_slot_config {
     uint8_t slot;
     uint8_t led;
 };
 
+/* Per-open QoS request, see max30102_qos.c. Both bounds 0 clears it */
+struct max30102_qos {
+    uint32_t max_latency_us;  // Longest a sample may wait in the FIFO, 0 for no bound
+    uint32_t min_rate_hz;     // Fewest FIFO samples per second, 0 keeps the configured rate
+};
+
+/* Strictest bounds of all open requests and the settings chosen for them */
+struct max30102_qos_info {
+    uint32_t requests;        // Open files with a request, the rest is 0 without any
+    uint32_t max_latency_us;
+    uint32_t min_rate_hz;
+    uint32_t latency_us;      // Longest wait of the chosen settings
+    uint32_t rate_mhz;        // FIFO samples per second, in millihertz
+    uint32_t wakeups_mhz;     // Drains per second, in millihertz
+    uint8_t average;          // Samples averaged per FIFO sample
+    uint8_t watermark;        // Unread samples at A_FULL
+    uint8_t ppg_rdy;          // One interrupt per sample
+    uint8_t met;              // 1 if the settings meet both bounds
+};
+
+#ifdef __KERNEL__
+struct max30102_sched;
+
+/* Boot profile: parsed from the device tree, written by max30102_init_sensor() in one burst */
+struct max30102_profile {
+    uint8_t fifo_config;  // 0x08: SMP_AVE, ROLLOVER_EN, FIFO_A_FULL
+    uint8_t mode;         // 0x09
+    uint8_t spo2_config;  // 0x0A: ADC range, sample rate, pulse width
+    uint8_t led1;         // 0x0C: 0.2 mA steps
+    uint8_t led2;         // 0x0D
+    uint8_t slots[2];     // 0x11, 0x12: SLOT2|SLOT1, SLOT4|SLOT3
+};
+
+/* FIFO layout of the profile's mode and slots, see max30102_profile_layout() */
+struct max30102_layout {
+    uint8_t channels;
+    uint8_t mask;
+    uint8_t led[MAX30102_MAX_CHANNELS];
+};
+
+/* Ring of the last window samples drained, see max30102_history.c */
+struct max30102_history {
+    spinlock_t lock;
+    struct max30102_sample *ring;
+    u32 window;  // Power of two, 0 keeps no history
+    u64 first;   // Oldest sequence number held
+    u64 next;    // Sequence number of the next sample drained
+};
+
+/* Filter state and output queue of one open file, see max30102_reduce.c */
+#define MAX30102_REDUCE_QUEUE   64  // Records, power of two
+
+struct max30102_reducer {
+    struct list_head node;  // In data->reducers while a stage is set
+    wait_queue_head_t wait;  // Woken only when a record was queued
+    spinlock_t lock;  // Protects the queue
+    struct max30102_reduce_config config;
+    u64 gain;  // CIC gain, factor ^ order
+    struct max30102_layout layout;  // Layout the state was built for
+    struct {
+        u32 count;  // Samples in the current window
+        u64 integ[MAX30102_MAX_CHANNELS][MAX30102_REDUCE_MAX_ORDER];
+        u64 comb[MAX30102_MAX_CHANNELS][MAX30102_REDUCE_MAX_ORDER];
+        s64 sum[MAX30102_MAX_CHANNELS];
+        s32 min[MAX30102_MAX_CHANNELS];
+        s32 max[MAX30102_MAX_CHANNELS];
+        s32 line[MAX30102_MAX_CHANNELS][MAX30102_REDUCE_MAX_TAPS];  // FIR delay line
+        u8 pos;  // Next delay line entry
+        u16 dropped;
+    } st;
+    struct max30102_reduced queue[MAX30102_REDUCE_QUEUE];
+    u32 head, tail;
+};
+
+/* I2C error classes, see max30102_i2c.c; shown in debugfs under max30102/i2c */
+struct max30102_i2c_stats {
+    atomic_t transfers;
+    atomic_t retries;   // -EAGAIN (arbitration lost) or -EBUSY, retried after a backoff
+    atomic_t naks;      // -ENXIO or -EREMOTEIO, failed at once
+    atomic_t timeouts;  // -ETIMEDOUT
+    atomic_t recoveries;  // Bus recoveries after repeated timeouts
+    atomic_t other;     // Any other error, failed at once
+    atomic_t failures;  // Transfers that returned an error
+    atomic_t split_reads;  // FIFO reads split to fit the adapter's read limit
+    atomic_t timeouts_in_row;
+};
+
 struct max30102_data {
     struct i2c_client *client;
-    rwlock_t lock;  // Changed to rwlock for optimized read/write access
-    struct work_struct work;
+    struct mutex lock;  // Drain, configuration and ioctls; held across I2C transfers, so it sleeps
+    struct max30102_sched *sched;  // Drain scheduler shared by the sensors on this bus
+    struct list_head sched_node;  // In the scheduler's pending list or batch
+    bool sched_detached;
+    atomic_t drain_deferred;  // A drain found the lock held, max30102_unlock() kicks it again
+    struct work_struct bringup_work;  // Reset and configuration, off the probe path
+    struct completion ready;  // Done once bring-up finished, successfully or not
+    int bringup_ret;
     struct gpio_desc *irq_gpio;
+    int irq;
     struct gpio_desc *reset_gpio;  // Added for reset GPIO
     struct miscdevice miscdev;
     struct input_dev *input_dev;  // Added for input subsystem
     struct regulator *vcc_regulator;  // Added for regulator
+    struct max30102_profile profile;  // Applied on every bring-up, kept in sync by the setters
+    struct max30102_i2c_stats i2c_stats;
     struct device *hwmon_dev;  // Added for hwmon
-    uint32_t red_data[32];
-    uint32_t ir_data[32];
+    struct max30102_layout layout;  // Layout the samples were drained with
+    uint8_t fifo_buf[MAX30102_FIFO_BYTES];  // Raw FIFO bytes of the drain, under lock
+    uint32_t samples[32][MAX30102_MAX_CHANNELS];
     uint8_t data_len;
     bool fifo_full;
+    struct max30102_history history;
+    struct list_head reducers;  // Open files with a reduction stage, under lock
     wait_queue_head_t wait_data_ready;
     struct dentry *debug_dir;
+    /* FIFO polling, used when int-gpios is absent or interrupts are mitigated (max30102_poll.c) */
+    bool polling;
+    bool poll_running;
+    bool poll_stale;  // FIFO or SpO2 config changed, re-derive the nominal rate
+    uint8_t poll_watermark;
+    uint8_t poll_target;
+    struct hrtimer poll_timer;
+    ktime_t poll_last;
+    u64 poll_nominal_mhz;
+    u64 poll_rate_mhz;
+    u64 poll_period_ns;
+    /* Interrupt mitigation on boards with INT (max30102_mitigate.c), mode switches under lock */
+    bool mitigate;  // Switching enabled
+    bool irq_masked;  // A_FULL, PPG_RDY and the IRQ are off, the poll timer drains
+    uint8_t mitigate_restore;  // Interrupt enable bits to set again on leaving polling
+    u32 mitigate_above_hz;  // Poll when interrupts come faster than this, 0 never polls
+    u32 mitigate_below_hz;  // Interrupts again when they would come slower than this
+    atomic_t irqs;  // Hard interrupts taken
+    u32 mitigate_window_irqs;  // irqs at the start of the rate window
+    ktime_t mitigate_window;
+    ktime_t mitigate_since;  // Start of the current mode
+    u64 mitigate_ns[2];  // Time spent in interrupt and polled mode, until mitigate_since
+    u64 mitigate_samples[2];  // Samples drained in each mode
+    u64 mitigate_switches;
+    /* QoS requests of the open files (max30102_qos.c), under lock */
+    struct list_head qos_requests;
+    struct max30102_qos_info qos_info;  // Aggregate and the settings chosen for it
+    bool qos_active;  // Settings chosen by requests, the base below is saved
+    bool qos_irq;  // The latency needs PPG_RDY, mitigation stays in interrupt mode
+    bool qos_base_ppg;  // PPG_RDY enable before the first request
+    uint8_t qos_base_fifo;  // FIFO_CONFIG before the first request
+};
+
+/* Per-open state, file->private_data */
+struct max30102_file {
+    struct max30102_data *data;
+    bool history;  // Reads address the history window by offset instead of taking batches
+    struct max30102_reducer *reducer;  // Allocated by the first MAX30102_IOC_SET_REDUCE
+    struct max30102_qos qos;
+    struct list_head qos_node;  // In data->qos_requests while a request is set
 };
 
 extern const struct file_operations max30102_fops;
-extern void max30102_work_handler(struct work_struct *work);
+extern struct dentry *max30102_debugfs_root;
+extern void max30102_drain(struct max30102_data *data);
+extern void max30102_unlock(struct max30102_data *data);
+extern int max30102_sched_attach(struct max30102_data *data);
+extern void max30102_sched_detach(struct max30102_data *data);
+extern void max30102_sched_kick(struct max30102_data *data);
+extern void max30102_sched_cancel(struct max30102_data *data);
+extern int max30102_open(struct inode *inode, struct file *file);
+extern int max30102_release(struct inode *inode, struct file *file);
+extern long max30102_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+extern long max30102_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 extern irqreturn_t max30102_irq_handler(int irq, void *dev_id);
 extern int max30102_write_reg(struct max30102_data *data, uint8_t reg, uint8_t *buf, uint16_t len);
 extern int max30102_read_reg(struct max30102_data *data, uint8_t reg, uint8_t *buf, uint16_t len);
+extern int max30102_read_fifo_data(struct max30102_data *data, uint8_t *buf, uint8_t len, uint8_t sample_bytes);
+extern int max30102_parse_profile(struct max30102_data *data);
 extern int max30102_init_sensor(struct max30102_data *data);
+extern int max30102_wait_ready(struct max30102_data *data, bool nonblock);
 extern int max30102_set_mode(struct max30102_data *data, uint8_t mode);
 extern int max30102_set_slot(struct max30102_data *data, uint8_t slot, uint8_t led);
 extern int max30102_set_interrupt(struct max30102_data *data, uint8_t interrupt, bool enable);
+extern void max30102_profile_layout(const struct max30102_profile *p, struct max30102_layout *layout);
+extern void max30102_publish(struct max30102_data *data, const struct max30102_layout *layout, const uint8_t *buf,
+                             uint8_t len);
 extern int max30102_read_fifo(struct max30102_data *data, uint32_t *red, uint32_t *ir, uint8_t *len);
+extern int max30102_read_channels(struct max30102_data *data, struct max30102_channel_data *out);
+extern int max30102_history_init(struct max30102_data *data);
+extern void max30102_history_free(struct max30102_data *data);
+extern int max30102_history_resize(struct max30102_data *data, u32 window);
+extern u64 max30102_history_append(struct max30102_data *data, const struct max30102_layout *layout,
+                                   uint32_t (*samples)[MAX30102_MAX_CHANNELS], uint8_t len);
+extern bool max30102_history_ready(struct max30102_data *data, loff_t pos);
+extern ssize_t max30102_history_read(struct max30102_data *data, struct kiocb *iocb, struct iov_iter *to,
+                                     bool nonblock);
+extern void max30102_history_info(struct max30102_data *data, struct max30102_history_info *info);
+extern int max30102_reduce_set(struct max30102_file *mf, const struct max30102_reduce_config *config);
+extern void max30102_reduce_release(struct max30102_file *mf);
+extern void max30102_reduce_feed(struct max30102_data *data, const struct max30102_layout *layout,
+                                 uint32_t (*samples)[MAX30102_MAX_CHANNELS], uint8_t len, u64 seq);
+extern bool max30102_reduce_active(struct max30102_file *mf);
+extern bool max30102_reduce_ready(struct max30102_reducer *r);
+extern ssize_t max30102_reduce_read(struct max30102_reducer *r, struct iov_iter *to, bool nonblock);
 extern int max30102_read_temperature(struct max30102_data *data, float *temp);
 extern int max30102_set_fifo_config(struct max30102_data *data, uint8_t config);
 extern int max30102_set_spo2_config(struct max30102_data *data, uint8_t config);
+extern void max30102_poll_init(struct max30102_data *data);
+extern int max30102_poll_configure(struct max30102_data *data);
+extern int max30102_poll_start(struct max30102_data *data);
+extern void max30102_poll_stop(struct max30102_data *data);
+extern uint8_t max30102_poll_expected(struct max30102_data *data);
+extern void max30102_poll_rearm(struct max30102_data *data, int produced, uint8_t ovf);
+extern void max30102_mitigate_init(struct max30102_data *data);
+extern void max30102_mitigate_start(struct max30102_data *data);
+extern void max30102_mitigate_stop(struct max30102_data *data);
+extern void max30102_mitigate_update(struct max30102_data *data, int drained);
+extern void max30102_qos_init(struct max30102_data *data);
+extern int max30102_qos_set(struct max30102_file *mf, const struct max30102_qos *qos);
+extern void max30102_qos_release(struct max30102_file *mf);
+extern int max30102_qos_update(struct max30102_data *data);
+extern void max30102_qos_resume(struct max30102_data *data);
 
 /* Sysfs Attributes */
 extern struct attribute_group max30102_attr_group;
+#endif /* __KERNEL__ */
 
 #endif
\ No newline at end of file
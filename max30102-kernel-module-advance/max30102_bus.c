@@ -0,0 +1,299 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "max30102_bus.h"
+
+static size_t max30102_bus_map_size(uint32_t slots)
+{
+    return sizeof(struct max30102_bus_header) + (size_t)slots * sizeof(struct max30102_bus_slot);
+}
+
+static int max30102_bus_map(struct max30102_bus *bus, size_t size, int prot)
+{
+    void *ptr = mmap(NULL, size, prot, MAP_SHARED, bus->fd, 0);
+    if (ptr == MAP_FAILED)
+        return -errno;
+    bus->hdr = ptr;
+    bus->ring = (struct max30102_bus_slot *)(bus->hdr + 1);
+    bus->map_size = size;
+    return 0;
+}
+
+/**
+ * max30102_bus_create - Create the shared-memory ring as its single publisher
+ * @bus: Bus handle to fill in
+ * @name: POSIX shm name (e.g. MAX30102_BUS_NAME)
+ * @slots: Ring size in records, must be a power of two
+ * Returns: 0 on success, negative errno on failure
+ */
+int max30102_bus_create(struct max30102_bus *bus, const char *name, uint32_t slots)
+{
+    size_t size;
+    int ret;
+
+    if (!bus || !name || slots < 2 || (slots & (slots - 1)))
+        return -EINVAL;
+
+    memset(bus, 0, sizeof(*bus));
+    strncpy(bus->name, name, sizeof(bus->name) - 1);
+    size = max30102_bus_map_size(slots);
+
+    // Start from a fresh segment so stale readers of a previous run see a new magic
+    shm_unlink(name);
+    bus->fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (bus->fd < 0)
+        return -errno;
+    if (ftruncate(bus->fd, size) < 0) {
+        ret = -errno;
+        goto err_unlink;
+    }
+    ret = max30102_bus_map(bus, size, PROT_READ | PROT_WRITE);
+    if (ret < 0)
+        goto err_unlink;
+
+    // ftruncate() zero-fills, so every slot starts with lock == 0 (never written)
+    bus->hdr->version = MAX30102_BUS_VERSION;
+    bus->hdr->slots = slots;
+    bus->hdr->record_size = sizeof(struct max30102_bus_slot);
+    atomic_store_explicit(&bus->hdr->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&bus->hdr->futex, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    bus->hdr->magic = MAX30102_BUS_MAGIC;  // Published last: readers check it before trusting the rest
+
+    bus->mask = slots - 1;
+    bus->owner = 1;
+    return 0;
+
+err_unlink:
+    close(bus->fd);
+    shm_unlink(name);
+    bus->fd = -1;
+    return ret;
+}
+
+/**
+ * max30102_bus_open - Attach to an existing bus as a reader
+ * @bus: Bus handle to fill in
+ * @name: POSIX shm name used by the publisher
+ * Returns: 0 on success, negative errno on failure
+ *
+ * The segment is mapped read-only: readers never write shared state, so
+ * adding readers costs the publisher nothing.
+ */
+int max30102_bus_open(struct max30102_bus *bus, const char *name)
+{
+    uint32_t id[4];  // magic, version, slots, record_size
+    struct stat st;
+    int ret;
+
+    if (!bus || !name)
+        return -EINVAL;
+
+    memset(bus, 0, sizeof(*bus));
+    strncpy(bus->name, name, sizeof(bus->name) - 1);
+    bus->fd = shm_open(name, O_RDONLY, 0);
+    if (bus->fd < 0)
+        return -errno;
+    if (fstat(bus->fd, &st) < 0 || (size_t)st.st_size < sizeof(struct max30102_bus_header)) {
+        ret = -ENODATA;
+        goto err_close;
+    }
+    if (pread(bus->fd, id, sizeof(id), 0) != (ssize_t)sizeof(id)) {
+        ret = -EIO;
+        goto err_close;
+    }
+    if (id[0] != MAX30102_BUS_MAGIC || id[1] != MAX30102_BUS_VERSION ||
+        id[3] != sizeof(struct max30102_bus_slot) ||
+        id[2] < 2 || (id[2] & (id[2] - 1)) ||
+        (size_t)st.st_size < max30102_bus_map_size(id[2])) {
+        ret = -EPROTO;
+        goto err_close;
+    }
+    ret = max30102_bus_map(bus, max30102_bus_map_size(id[2]), PROT_READ);
+    if (ret < 0)
+        goto err_close;
+    bus->mask = id[2] - 1;
+    return 0;
+
+err_close:
+    close(bus->fd);
+    bus->fd = -1;
+    return ret;
+}
+
+/**
+ * max30102_bus_close - Detach from the bus (and remove it if we published it)
+ * @bus: Bus handle
+ */
+void max30102_bus_close(struct max30102_bus *bus)
+{
+    if (!bus || !bus->hdr)
+        return;
+    munmap(bus->hdr, bus->map_size);
+    close(bus->fd);
+    if (bus->owner)
+        shm_unlink(bus->name);
+    bus->hdr = NULL;
+    bus->ring = NULL;
+    bus->fd = -1;
+}
+
+/**
+ * max30102_bus_publish - Append a batch of samples and wake waiting readers
+ * @bus: Bus handle created with max30102_bus_create()
+ * @red: Red samples
+ * @ir: IR samples
+ * @count: Number of samples in @red and @ir
+ * @timestamp_ns: CLOCK_MONOTONIC time the batch was drained
+ * Returns: 0 on success, negative errno on failure
+ *
+ * Must only be called from a single thread. The futex wake is issued once
+ * per batch, never per sample.
+ */
+int max30102_bus_publish(struct max30102_bus *bus, const uint32_t *red, const uint32_t *ir,
+                         uint32_t count, uint64_t timestamp_ns)
+{
+    struct max30102_bus_slot *slot;
+    uint64_t head, pos;
+    uint32_t i;
+
+    if (!bus || !bus->owner || !red || !ir)
+        return -EINVAL;
+    if (count == 0)
+        return 0;
+
+    head = atomic_load_explicit(&bus->hdr->head, memory_order_relaxed);
+    for (i = 0; i < count; i++) {
+        pos = head + i;
+        slot = &bus->ring[pos & bus->mask];
+        atomic_store_explicit(&slot->lock, 2 * pos + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        slot->rec.seq = pos;
+        slot->rec.timestamp_ns = timestamp_ns;
+        slot->rec.red = red[i];
+        slot->rec.ir = ir[i];
+        atomic_store_explicit(&slot->lock, 2 * pos + 2, memory_order_release);
+    }
+    atomic_store_explicit(&bus->hdr->head, head + count, memory_order_release);
+    atomic_fetch_add_explicit(&bus->hdr->futex, 1, memory_order_release);
+    syscall(SYS_futex, &bus->hdr->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    return 0;
+}
+
+/**
+ * max30102_bus_reader_init - Position a reader on the bus
+ * @rd: Reader state (private to the calling process)
+ * @bus: Bus handle opened with max30102_bus_open() or max30102_bus_create()
+ * @from_oldest: Non-zero to start at the oldest retained record, zero for live data only
+ */
+void max30102_bus_reader_init(struct max30102_bus_reader *rd, struct max30102_bus *bus, int from_oldest)
+{
+    uint64_t head = atomic_load_explicit(&bus->hdr->head, memory_order_acquire);
+    uint64_t slots = bus->mask + 1;
+
+    rd->bus = bus;
+    rd->lost = 0;
+    if (from_oldest)
+        rd->next = head > slots ? head - slots : 0;
+    else
+        rd->next = head;
+}
+
+/* Jump a lapped reader forward to the oldest record that is still safe to read */
+static void max30102_bus_resync(struct max30102_bus_reader *rd, uint64_t head)
+{
+    uint64_t slots = rd->bus->mask + 1;
+    uint64_t oldest = head - slots + slots / 8;  // Leave headroom for the publisher's next batch
+
+    if (head > slots && rd->next < oldest) {
+        rd->lost += oldest - rd->next;
+        rd->next = oldest;
+    }
+}
+
+/**
+ * max30102_bus_read - Copy up to @max new records without blocking
+ * @rd: Reader state
+ * @out: Destination records
+ * @max: Capacity of @out
+ * Returns: Number of records copied (0 if none are pending)
+ *
+ * If the publisher lapped the reader, the reader skips ahead and the number
+ * of missed records is added to rd->lost.
+ */
+int max30102_bus_read(struct max30102_bus_reader *rd, struct max30102_bus_record *out, uint32_t max)
+{
+    struct max30102_bus *bus = rd->bus;
+    struct max30102_bus_slot *slot;
+    uint64_t head, want, before, after;
+    uint32_t n = 0;
+
+    head = atomic_load_explicit(&bus->hdr->head, memory_order_acquire);
+    if (head - rd->next > bus->mask + 1)
+        max30102_bus_resync(rd, head);
+
+    while (n < max && rd->next < head) {
+        slot = &bus->ring[rd->next & bus->mask];
+        want = 2 * rd->next + 2;
+        before = atomic_load_explicit(&slot->lock, memory_order_acquire);
+        if (before == want) {
+            out[n] = slot->rec;
+            atomic_thread_fence(memory_order_acquire);
+            after = atomic_load_explicit(&slot->lock, memory_order_relaxed);
+            if (after == want) {
+                n++;
+                rd->next++;
+                continue;
+            }
+        }
+        // Slot is being rewritten for a later lap: we fell behind mid-read
+        max30102_bus_resync(rd, atomic_load_explicit(&bus->hdr->head, memory_order_acquire));
+        head = atomic_load_explicit(&bus->hdr->head, memory_order_acquire);
+    }
+    return n;
+}
+
+/**
+ * max30102_bus_wait - Sleep until new records are published
+ * @rd: Reader state
+ * @timeout_ms: Timeout in milliseconds, negative to wait forever
+ * Returns: 0 when data is pending, -ETIMEDOUT or -EINTR otherwise
+ */
+int max30102_bus_wait(struct max30102_bus_reader *rd, int timeout_ms)
+{
+    struct max30102_bus_header *hdr = rd->bus->hdr;
+    struct timespec ts, *tsp = NULL;
+    uint32_t seen;
+
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        tsp = &ts;
+    }
+
+    // Sample the futex word before head so a publish in between makes FUTEX_WAIT return at once
+    seen = atomic_load_explicit(&hdr->futex, memory_order_acquire);
+    if (atomic_load_explicit(&hdr->head, memory_order_acquire) != rd->next)
+        return 0;
+    if (syscall(SYS_futex, &hdr->futex, FUTEX_WAIT, seen, tsp, NULL, 0) < 0 &&
+        errno != EAGAIN) {
+        return errno == ETIMEDOUT ? -ETIMEDOUT : -EINTR;
+    }
+    return atomic_load_explicit(&hdr->head, memory_order_acquire) != rd->next ? 0 : -ETIMEDOUT;
+}
+
+/**
+ * max30102_bus_lag - Number of published records this reader has not consumed yet
+ * @rd: Reader state
+ */
+uint64_t max30102_bus_lag(const struct max30102_bus_reader *rd)
+{
+    return atomic_load_explicit(&rd->bus->hdr->head, memory_order_acquire) - rd->next;
+}
@@ -0,0 +1,72 @@
+#ifndef MAX30102_BUS_H
+#define MAX30102_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/*
+ * Shared-memory sample bus.
+ *
+ * One publisher (the process draining /dev/max30102-*) appends binary sample
+ * records to a power-of-two ring in POSIX shared memory. Any number of local
+ * processes map the ring read-only and consume it at their own pace: every
+ * slot carries a seqlock word, so readers never take a lock and never block
+ * the publisher. A reader that falls more than one ring behind is detected
+ * and resynchronised, and the number of records it missed is reported.
+ */
+
+#define MAX30102_BUS_NAME           "/max30102_bus"
+#define MAX30102_BUS_MAGIC          0x4D334255  // "M3BU"
+#define MAX30102_BUS_VERSION        1
+#define MAX30102_BUS_DEFAULT_SLOTS  4096        // ~40 s of history at 100 sps
+
+struct max30102_bus_record {
+    uint64_t seq;           // Position of the record on the bus
+    uint64_t timestamp_ns;  // CLOCK_MONOTONIC time the sample was drained
+    uint32_t red;
+    uint32_t ir;
+};
+
+struct max30102_bus_slot {
+    _Atomic uint64_t lock;  // 2n+1 while record n is written, 2n+2 once it is readable
+    struct max30102_bus_record rec;
+};
+
+struct max30102_bus_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;         // Ring size, power of two
+    uint32_t record_size;   // sizeof(struct max30102_bus_slot), for ABI checks
+    _Atomic uint64_t head __attribute__((aligned(64)));  // Records published so far
+    _Atomic uint32_t futex __attribute__((aligned(64))); // Bumped once per publish, readers wait on it
+};
+
+struct max30102_bus {
+    struct max30102_bus_header *hdr;
+    struct max30102_bus_slot *ring;
+    size_t map_size;
+    uint64_t mask;
+    int fd;
+    int owner;              // Publisher side: unlinks the segment on close
+    char name[64];
+};
+
+struct max30102_bus_reader {
+    struct max30102_bus *bus;
+    uint64_t next;          // Next position this reader will consume
+    uint64_t lost;          // Records overwritten before this reader reached them
+};
+
+extern int max30102_bus_create(struct max30102_bus *bus, const char *name, uint32_t slots);
+extern int max30102_bus_open(struct max30102_bus *bus, const char *name);
+extern void max30102_bus_close(struct max30102_bus *bus);
+extern int max30102_bus_publish(struct max30102_bus *bus, const uint32_t *red, const uint32_t *ir,
+                                uint32_t count, uint64_t timestamp_ns);
+
+extern void max30102_bus_reader_init(struct max30102_bus_reader *rd, struct max30102_bus *bus, int from_oldest);
+extern int max30102_bus_read(struct max30102_bus_reader *rd, struct max30102_bus_record *out, uint32_t max);
+extern int max30102_bus_wait(struct max30102_bus_reader *rd, int timeout_ms);
+extern uint64_t max30102_bus_lag(const struct max30102_bus_reader *rd);
+
+#endif
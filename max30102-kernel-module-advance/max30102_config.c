@@ -1,19 +1,180 @@
 #include <linux/delay.h>
+#include <linux/property.h>
+#include <linux/string.h>
 #include "max30102.h"
+#include "max30102_plan.h"
+
+#define MAX30102_PROFILE_LEN  (MAX30102_REG_MULTI_LED_MODE_2 - MAX30102_REG_FIFO_CONFIG + 1)
+
+static const u32 max30102_sample_rates[] = { 50, 100, 200, 400, 800, 1000, 1600, 3200 };
+static const u32 max30102_pulse_widths[] = { 69, 118, 215, 411 };
+static const u32 max30102_adc_ranges[] = { 2048, 4096, 8192, 16384 };
+static const u32 max30102_averages[] = { 1, 2, 4, 8, 16, 32 };
+static const char * const max30102_modes[] = { "heart-rate", "spo2", "multi-led" };
+static const uint8_t max30102_mode_values[] = { 0x02, 0x03, 0x07 };
+
+/**
+ * max30102_profile_check - Check the sample rate and pulse width combination
+ * @dev: Device, for the error message
+ * @p: Profile to check
+ * Returns: 0 if the sensor can run it, -EINVAL otherwise
+ *
+ * The allowed combinations depend on the number of active slots and come
+ * from the datasheet table in max30102_plan.h, which the capacity planner
+ * uses as well. Callers check before they write a register.
+ */
+static int max30102_profile_check(struct device *dev, const struct max30102_profile *p)
+{
+    struct max30102_layout layout;
+
+    max30102_profile_layout(p, &layout);
+    if (max30102_plan_supported(layout.channels, p->spo2_config)) return 0;
+    dev_err(dev, "Sample rate %u Hz is not supported with %u us pulses and %d slots\n",
+            max30102_sample_rates[(p->spo2_config >> 2) & 0x07], max30102_pulse_widths[p->spo2_config & 0x03],
+            layout.channels);
+    return -EINVAL;
+}
+
+/**
+ * max30102_prop_index - Look up an optional u32 property in a table of allowed values
+ * @dev: Device
+ * @name: Property name
+ * @table: Allowed values, the index is the register field
+ * @n: Table size
+ * @index: Field value, left alone if the property is absent
+ * Returns: 0 on success or absence, -EINVAL for a value not in the table
+ */
+static int max30102_prop_index(struct device *dev, const char *name, const u32 *table, int n, int *index)
+{
+    u32 val;
+    int i, ret;
+
+    if (!device_property_present(dev, name)) return 0;
+    ret = device_property_read_u32(dev, name, &val);
+    if (ret < 0) return ret;
+    for (i = 0; i < n; i++) {
+        if (table[i] == val) {
+            *index = i;
+            return 0;
+        }
+    }
+    dev_err(dev, "Unsupported %s: %u\n", name, val);
+    return -EINVAL;
+}
 
 /**
- * max30102_init_sensor - Initialize MAX30102 sensor with default settings
+ * max30102_parse_profile - Build the boot profile from device properties
+ * @data: MAX30102 device data
+ * Returns: 0 on success, negative error code on an invalid property
+ *
+ * Every property is optional; the defaults are the settings the driver has
+ * always used. The profile is checked here, so a bad overlay fails probe
+ * instead of leaving the sensor half configured.
+ */
+int max30102_parse_profile(struct max30102_data *data)
+{
+    struct device *dev = &data->client->dev;
+    struct max30102_profile *p = &data->profile;
+    int avg, rate, width, range, i, n, ret;
+    u32 slots[4] = { 0 }, val;
+    const char *mode;
+
+    p->fifo_config = MAX30102_FIFO_SMP_AVE_8;
+    p->mode = MAX30102_MODE_SPO2;
+    p->spo2_config = MAX30102_SPO2_CONFIG_DEFAULT;
+    p->led1 = MAX30102_LED_PULSE_DEFAULT;
+    p->led2 = MAX30102_LED_PULSE_DEFAULT;
+    p->slots[0] = MAX30102_SLOT1_RED;
+    p->slots[1] = MAX30102_SLOT2_IR;
+
+    if (!device_property_read_string(dev, "maxim,mode", &mode)) {
+        ret = match_string(max30102_modes, ARRAY_SIZE(max30102_modes), mode);
+        if (ret < 0) {
+            dev_err(dev, "Unsupported maxim,mode: %s\n", mode);
+            return -EINVAL;
+        }
+        p->mode = max30102_mode_values[ret];
+    }
+
+    n = device_property_count_u32(dev, "maxim,slots");
+    if (n > 0) {
+        if (n > 4) {
+            dev_err(dev, "maxim,slots has %d entries, max is 4\n", n);
+            return -EINVAL;
+        }
+        ret = device_property_read_u32_array(dev, "maxim,slots", slots, n);
+        if (ret < 0) return ret;
+        for (i = 0; i < 4; i++) {
+            if (slots[i] > 2) {  // 0 = none, 1 = red, 2 = IR
+                dev_err(dev, "Unsupported LED %u in slot %d\n", slots[i], i + 1);
+                return -EINVAL;
+            }
+        }
+        p->slots[0] = slots[1] << 4 | slots[0];
+        p->slots[1] = slots[3] << 4 | slots[2];
+    }
+
+    avg = (p->fifo_config >> 5) & 0x07;
+    rate = (p->spo2_config >> 2) & 0x07;
+    width = p->spo2_config & 0x03;
+    range = (p->spo2_config >> 5) & 0x03;
+    ret = max30102_prop_index(dev, "maxim,sample-average", max30102_averages, ARRAY_SIZE(max30102_averages), &avg);
+    if (!ret) ret = max30102_prop_index(dev, "maxim,sample-rate-hz", max30102_sample_rates, ARRAY_SIZE(max30102_sample_rates), &rate);
+    if (!ret) ret = max30102_prop_index(dev, "maxim,pulse-width-us", max30102_pulse_widths, ARRAY_SIZE(max30102_pulse_widths), &width);
+    if (!ret) ret = max30102_prop_index(dev, "maxim,adc-range-nA", max30102_adc_ranges, ARRAY_SIZE(max30102_adc_ranges), &range);
+    if (ret < 0) return ret;
+    p->fifo_config = (p->fifo_config & 0x1F) | avg << 5;
+    p->spo2_config = range << 5 | rate << 2 | width;
+    ret = max30102_profile_check(dev, p);
+    if (ret < 0) return ret;
+
+    if (device_property_read_bool(dev, "maxim,fifo-rollover"))
+        p->fifo_config |= 0x10;
+    if (!device_property_read_u32(dev, "maxim,fifo-watermark", &val)) {
+        // A_FULL fires with this many unread samples; the register holds the free slots
+        if (val < 17 || val > 32) {
+            dev_err(dev, "maxim,fifo-watermark %u out of range 17..32\n", val);
+            return -EINVAL;
+        }
+        p->fifo_config = (p->fifo_config & 0xF0) | (32 - val);
+    }
+
+    if (!device_property_read_u32(dev, "led1-current-mA", &val)) {
+        if (val > 51) {
+            dev_err(dev, "led1-current-mA %u above 51\n", val);
+            return -EINVAL;
+        }
+        p->led1 = val * 5;  // 0.2 mA per step
+    }
+    if (!device_property_read_u32(dev, "led2-current-mA", &val)) {
+        if (val > 51) {
+            dev_err(dev, "led2-current-mA %u above 51\n", val);
+            return -EINVAL;
+        }
+        p->led2 = val * 5;
+    }
+
+    dev_dbg(dev, "Boot profile: fifo 0x%02x mode 0x%02x spo2 0x%02x led 0x%02x/0x%02x slots 0x%02x/0x%02x\n",
+            p->fifo_config, p->mode, p->spo2_config, p->led1, p->led2, p->slots[0], p->slots[1]);
+    return 0;
+}
+
+/**
+ * max30102_init_sensor - Reset the sensor and apply the boot profile
  * @data: MAX30102 device data
  * Returns: 0 on success, negative error code on failure
  */
 int max30102_init_sensor(struct max30102_data *data)
 {
+    struct max30102_profile *p;
+    uint8_t head[5], regs[MAX30102_PROFILE_LEN] = { 0 };
     uint8_t value;
     int ret;
 
     if (!data || !data->reset_gpio) {
         return -EINVAL;
     }
+    p = &data->profile;
 
     /* Hardware reset using GPIO */
     gpiod_set_value(data->reset_gpio, MAX30102_RESET_HARD_LOW);  // Assert reset (active low)
@@ -30,51 +191,72 @@ int max30102_init_sensor(struct max30102_data *data)
     }
     msleep(100);  // Wait for reset as per datasheet
 
-    /* Clear FIFO pointers */
-    value = 0x00;
-    ret = max30102_write_reg(data, MAX30102_REG_FIFO_WRITE_POINTER, &value, 1);
-    if (ret < 0) return ret;
-    ret = max30102_write_reg(data, MAX30102_REG_FIFO_READ_POINTER, &value, 1);
-    if (ret < 0) return ret;
-    ret = max30102_write_reg(data, MAX30102_REG_OVERFLOW_COUNTER, &value, 1);
+    /* Interrupt enables and cleared FIFO pointers, 0x02..0x06 in one write */
+    head[0] = MAX30102_INT_ENABLE_FIFO_PPG;  // A_FULL_EN = 1, PPG_RDY_EN = 1
+    head[1] = 0x00;  // Interrupt enable 2
+    head[2] = 0x00;  // Write pointer
+    head[3] = 0x00;  // Overflow counter
+    head[4] = 0x00;  // Read pointer
+    ret = max30102_write_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, head, sizeof(head));
     if (ret < 0) return ret;
 
-    /* Configure FIFO: sample averaging = 8, rollover enabled, A_FULL = 0 */
-    value = MAX30102_FIFO_SMP_AVE_8;
-    ret = max30102_write_reg(data, MAX30102_REG_FIFO_CONFIG, &value, 1);
-    if (ret < 0) return ret;
-
-    /* Set SpO2 mode */
-    value = MAX30102_MODE_SPO2;
-    ret = max30102_write_reg(data, MAX30102_REG_MODE_CONFIG, &value, 1);
-    if (ret < 0) return ret;
-
-    /* Configure SpO2: ADC range 16384, 100Hz, 18-bit */
-    value = MAX30102_SPO2_CONFIG_DEFAULT;
-    ret = max30102_write_reg(data, MAX30102_REG_SPO2_CONFIG, &value, 1);
-    if (ret < 0) return ret;
+    /*
+     * The whole profile, 0x08..0x12 in one write. The reserved registers in
+     * between get their reset value 0. The mode byte starts conversions and
+     * the SpO2, LED and slot bytes follow within the same transfer, long
+     * before the first sample completes, so no sample uses the reset defaults.
+     */
+    regs[MAX30102_REG_FIFO_CONFIG - MAX30102_REG_FIFO_CONFIG] = p->fifo_config;
+    regs[MAX30102_REG_MODE_CONFIG - MAX30102_REG_FIFO_CONFIG] = p->mode;
+    regs[MAX30102_REG_SPO2_CONFIG - MAX30102_REG_FIFO_CONFIG] = p->spo2_config;
+    regs[MAX30102_REG_LED_PULSE_1 - MAX30102_REG_FIFO_CONFIG] = p->led1;
+    regs[MAX30102_REG_LED_PULSE_2 - MAX30102_REG_FIFO_CONFIG] = p->led2;
+    regs[MAX30102_REG_MULTI_LED_MODE_1 - MAX30102_REG_FIFO_CONFIG] = p->slots[0];
+    regs[MAX30102_REG_MULTI_LED_MODE_2 - MAX30102_REG_FIFO_CONFIG] = p->slots[1];
+    return max30102_write_reg(data, MAX30102_REG_FIFO_CONFIG, regs, sizeof(regs));
+}
 
-    /* Set LED pulse amplitudes (default 0x1F ~6.4mA, adjustable via sysfs later) */
-    value = MAX30102_LED_PULSE_DEFAULT;
-    ret = max30102_write_reg(data, MAX30102_REG_LED_PULSE_1, &value, 1);
-    if (ret < 0) return ret;
-    ret = max30102_write_reg(data, MAX30102_REG_LED_PULSE_2, &value, 1);
-    if (ret < 0) return ret;
+/**
+ * max30102_profile_layout - FIFO sample layout of a mode and slot setting
+ * @p: Profile holding the mode and slot registers
+ * @layout: Filled with one channel per active slot, in FIFO order
+ *
+ * Multi-LED slots set to none write nothing, so a sample is three bytes per
+ * channel. A multi-LED profile without an active slot has no channels.
+ */
+void max30102_profile_layout(const struct max30102_profile *p, struct max30102_layout *layout)
+{
+    uint8_t led;
+    int i;
 
-    /* Enable slots: Slot 1 = Red LED, Slot 2 = IR LED */
-    value = MAX30102_SLOT1_RED;  // SLOT2[2:0] = 000, SLOT1[2:0] = 001 (Red)
-    ret = max30102_write_reg(data, MAX30102_REG_MULTI_LED_MODE_1, &value, 1);
-    if (ret < 0) return ret;
-    value = MAX30102_SLOT2_IR;  // SLOT4[2:0] = 000, SLOT3[2:0] = 010 (IR)
-    ret = max30102_write_reg(data, MAX30102_REG_MULTI_LED_MODE_2, &value, 1);
-    if (ret < 0) return ret;
+    memset(layout, 0, sizeof(*layout));
+    if (p->mode == MAX30102_MODE_SPO2) {
+        layout->led[layout->channels++] = MAX30102_SLOT1_RED;
+        layout->led[layout->channels++] = MAX30102_SLOT2_IR;
+        layout->mask = 0x03;
+    } else if (p->mode == 0x02) {  // Heart rate
+        layout->led[layout->channels++] = MAX30102_SLOT1_RED;
+        layout->mask = 0x01;
+    } else if (p->mode == 0x07) {  // Multi-LED
+        for (i = 0; i < MAX30102_MAX_CHANNELS; i++) {
+            led = (p->slots[i / 2] >> ((i % 2) * 4)) & 0x07;
+            if (led != 1 && led != 2) continue;  // Red and IR are the only LEDs
+            layout->led[layout->channels++] = led;
+            layout->mask |= 1 << i;
+        }
+    }
+}
 
-    /* Enable FIFO full and PPG ready interrupts */
-    value = MAX30102_INT_ENABLE_FIFO_PPG;  // A_FULL_EN = 1, PPG_RDY_EN = 1
-    ret = max30102_write_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, &value, 1);
-    if (ret < 0) return ret;
+/**
+ * max30102_flush_fifo - Drop the samples taken with the previous layout
+ * @data: MAX30102 device data
+ * Returns: 0 on success, negative error code on failure
+ */
+static int max30102_flush_fifo(struct max30102_data *data)
+{
+    uint8_t ptrs[3] = { 0 };  // FIFO_WR_PTR, OVF_COUNTER, FIFO_RD_PTR
 
-    return 0;
+    return max30102_write_reg(data, MAX30102_REG_FIFO_WRITE_POINTER, ptrs, sizeof(ptrs));
 }
 
 /**
@@ -85,12 +267,22 @@ int max30102_init_sensor(struct max30102_data *data)
  */
 int max30102_set_mode(struct max30102_data *data, uint8_t mode)
 {
+    struct max30102_profile p;
+    int ret;
+
     if (!data) return -EINVAL;
     if (mode != 0x02 && mode != 0x03 && mode != 0x07) {
         dev_err(&data->client->dev, "Invalid mode: 0x%02x\n", mode);
         return -EINVAL;
     }
-    return max30102_write_reg(data, MAX30102_REG_MODE_CONFIG, &mode, 1);
+    p = data->profile;
+    p.mode = mode;  // More slots may not fit the sample period
+    ret = max30102_profile_check(&data->client->dev, &p);
+    if (ret < 0) return ret;
+    ret = max30102_write_reg(data, MAX30102_REG_MODE_CONFIG, &mode, 1);
+    if (ret < 0) return ret;
+    data->profile.mode = mode;  // Kept across resume
+    return max30102_flush_fifo(data);  // The channel layout changed
 }
 
 /**
@@ -102,6 +294,7 @@ int max30102_set_mode(struct max30102_data *data, uint8_t mode)
  */
 int max30102_set_slot(struct max30102_data *data, uint8_t slot, uint8_t led)
 {
+    struct max30102_profile p;
     uint8_t reg, shift, value, current;
     int ret;
 
@@ -112,10 +305,18 @@ int max30102_set_slot(struct max30102_data *data, uint8_t slot, uint8_t led)
     }
     reg = (slot <= 2) ? MAX30102_REG_MULTI_LED_MODE_1 : MAX30102_REG_MULTI_LED_MODE_2;
     shift = (slot % 2 == 1) ? 0 : 4;
+    p = data->profile;
+    p.slots[reg - MAX30102_REG_MULTI_LED_MODE_1] &= ~(0x07 << shift);
+    p.slots[reg - MAX30102_REG_MULTI_LED_MODE_1] |= led << shift;
+    ret = max30102_profile_check(&data->client->dev, &p);
+    if (ret < 0) return ret;
     ret = max30102_read_reg(data, reg, &current, 1);
     if (ret < 0) return ret;
     value = (current & ~(0x07 << shift)) | (led << shift);
-    return max30102_write_reg(data, reg, &value, 1);
+    ret = max30102_write_reg(data, reg, &value, 1);
+    if (ret < 0) return ret;
+    data->profile.slots[reg - MAX30102_REG_MULTI_LED_MODE_1] = value;
+    return max30102_flush_fifo(data);
 }
 
 /**
@@ -141,6 +342,12 @@ int max30102_set_interrupt(struct max30102_data *data, uint8_t interrupt, bool e
     reg = (interrupt == MAX30102_INT_DIE_TEMP_RDY) ? MAX30102_REG_INTERRUPT_ENABLE_2 : MAX30102_REG_INTERRUPT_ENABLE_1;
     mask = 1 << interrupt;
 
+    if (data->irq_masked && reg == MAX30102_REG_INTERRUPT_ENABLE_1 && (mask & MAX30102_INT_ENABLE_FIFO_PPG)) {
+        // Masked while polling, applied when interrupts come back
+        data->mitigate_restore = enable ? (data->mitigate_restore | mask) : (data->mitigate_restore & ~mask);
+        return 0;
+    }
+
     ret = max30102_read_reg(data, reg, &value, 1);
     if (ret < 0) return ret;
 
@@ -156,12 +363,19 @@ int max30102_set_interrupt(struct max30102_data *data, uint8_t interrupt, bool e
  */
 int max30102_set_fifo_config(struct max30102_data *data, uint8_t config)
 {
+    int ret;
+
     if (!data) return -EINVAL;
     if (config & ~0xFF) {
         dev_err(&data->client->dev, "Invalid FIFO config: 0x%02x\n", config);
         return -EINVAL;
     }
-    return max30102_write_reg(data, MAX30102_REG_FIFO_CONFIG, &config, 1);
+    ret = max30102_write_reg(data, MAX30102_REG_FIFO_CONFIG, &config, 1);
+    if (ret == 0)
+        data->profile.fifo_config = config;
+    if (ret == 0 && data->polling)
+        WRITE_ONCE(data->poll_stale, true);  // The next drain re-derives the poll period
+    return ret;
 }
 
 /**
@@ -172,18 +386,22 @@ int max30102_set_fifo_config(struct max30102_data *data, uint8_t config)
  */
 int max30102_set_spo2_config(struct max30102_data *data, uint8_t config)
 {
-    uint8_t pw, sr;
+    struct max30102_profile p;
+    int ret;
 
     if (!data) return -EINVAL;
     if (config & ~0x7F) {
         dev_err(&data->client->dev, "Invalid SpO2 config: 0x%02x\n", config);
         return -EINVAL;
     }
-    pw = config & 0x03;
-    sr = (config >> 2) & 0x07;
-    if ((pw == 0 && sr > 4) || (pw == 1 && sr > 6)) {
-        dev_err(&data->client->dev, "Invalid SR/PW combination\n");
-        return -EINVAL;
-    }
-    return max30102_write_reg(data, MAX30102_REG_SPO2_CONFIG, &config, 1);
+    p = data->profile;
+    p.spo2_config = config;
+    ret = max30102_profile_check(&data->client->dev, &p);
+    if (ret < 0) return ret;
+    ret = max30102_write_reg(data, MAX30102_REG_SPO2_CONFIG, &config, 1);
+    if (ret == 0)
+        data->profile.spo2_config = config;
+    if (ret == 0 && data->polling)
+        WRITE_ONCE(data->poll_stale, true);  // The next drain re-derives the poll period
+    return ret;
 }
\ No newline at end of file
@@ -6,12 +6,15 @@
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>  // Added for runtime PM
 #include <linux/fs.h>
+#include <linux/uio.h>  // read_iter and splice
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
 #include <linux/compat.h>  // Added for compat_ioctl
 #include <linux/platform_data/max30102.h>  // Added for platform data support
 #include "max30102.h"
 
+struct dentry *max30102_debugfs_root;  // Per-sensor and per-bus directories
+
 static const struct of_device_id max30102_of_match[] = {
     { .compatible = "maxim,max30102" },
     { }
@@ -24,6 +27,73 @@ static const struct i2c_device_id max30102_id[] = {
 };
 MODULE_DEVICE_TABLE(i2c, max30102_id);
 
+/**
+ * max30102_bringup_work - Reset and configure the sensor after probe returned
+ * @work: Bring-up work structure
+ *
+ * The resets alone sleep for over 200 ms, so probe only checks the part ID,
+ * registers the device node and queues this on the unbound workqueue, where
+ * every sensor on the system is brought up in parallel. Readers, ioctls and
+ * sysfs wait on data->ready until it has run. It also holds data->lock, for
+ * a writer that got past the wait just before a resume started it again.
+ */
+static void max30102_bringup_work(struct work_struct *work)
+{
+    struct max30102_data *data = container_of(work, struct max30102_data, bringup_work);
+    struct device *dev = &data->client->dev;
+    ktime_t start = ktime_get();
+    int ret;
+
+    mutex_lock(&data->lock);
+    ret = max30102_init_sensor(data);
+    if (ret < 0) {
+        dev_err(dev, "Failed to initialize sensor: %d\n", ret);
+        goto done;
+    }
+
+    if (data->polling) {
+        ret = max30102_poll_start(data);
+        if (ret < 0) {
+            dev_err(dev, "Failed to start FIFO polling: %d\n", ret);
+            goto done;
+        }
+        dev_info(dev, "No int-gpios, polling the FIFO every %llu us to start\n",
+                 data->poll_period_ns / NSEC_PER_USEC);
+    }
+    dev_info(dev, "Sensor ready after %lld ms\n", ktime_ms_delta(ktime_get(), start));
+
+done:
+    max30102_unlock(data);
+    data->bringup_ret = ret;
+    complete_all(&data->ready);
+    if (ret == 0)
+        max30102_qos_resume(data);  // Bring-up enabled PPG_RDY again
+    // An A_FULL edge during bring-up was dropped by the work handler, and INT
+    // stays low until the status is read, so check once now
+    if (ret == 0 && !data->polling) {
+        max30102_mitigate_start(data);
+        max30102_sched_kick(data);
+    }
+}
+
+/**
+ * max30102_wait_ready - Wait for the deferred bring-up
+ * @data: MAX30102 device data
+ * @nonblock: Return -EAGAIN instead of sleeping
+ * Returns: 0 once the sensor is configured, the bring-up error if it failed
+ */
+int max30102_wait_ready(struct max30102_data *data, bool nonblock)
+{
+    int ret;
+
+    if (!completion_done(&data->ready)) {
+        if (nonblock) return -EAGAIN;
+        ret = wait_for_completion_interruptible(&data->ready);
+        if (ret < 0) return ret;
+    }
+    return data->bringup_ret;
+}
+
 /**
  * max30102_probe - Probe function for MAX30102 I2C device
  * @client: I2C client structure
@@ -34,6 +104,7 @@ static int max30102_probe(struct i2c_client *client, const struct i2c_device_id
 {
     struct max30102_data *data;
     struct max30102_platform_data *pdata = client->dev.platform_data;  // Platform data support
+    struct dentry *i2c_dir;
     uint8_t part_id;
     int ret, irq;
 
@@ -44,8 +115,12 @@ static int max30102_probe(struct i2c_client *client, const struct i2c_device_id
 
     data->client = client;
     i2c_set_clientdata(client, data);
-    rwlock_init(&data->lock);  // Initialize rwlock
-    INIT_WORK(&data->work, max30102_work_handler);
+    mutex_init(&data->lock);
+    INIT_WORK(&data->bringup_work, max30102_bringup_work);
+    init_completion(&data->ready);
+    init_waitqueue_head(&data->wait_data_ready);  // Before the node exists, open no longer resets it
+    INIT_LIST_HEAD(&data->reducers);
+    INIT_LIST_HEAD(&data->qos_requests);
 
     /* Regulator support */
     data->vcc_regulator = devm_regulator_get(&client->dev, "vcc");
@@ -74,25 +149,41 @@ static int max30102_probe(struct i2c_client *client, const struct i2c_device_id
         goto err_reg_disable;
     }
 
+    ret = max30102_parse_profile(data);
+    if (ret < 0)
+        goto err_reg_disable;
+
+    ret = max30102_history_init(data);
+    if (ret < 0) {
+        dev_err(&client->dev, "Failed to allocate sample history: %d\n", ret);
+        goto err_reg_disable;
+    }
+
+    ret = max30102_sched_attach(data);  // Before anything can queue a drain
+    if (ret < 0)
+        goto err_history_free;
+
     data->miscdev.minor = MISC_DYNAMIC_MINOR;
     data->miscdev.name = devm_kasprintf(&client->dev, GFP_KERNEL, "max30102-%d", client->addr);
     if (!data->miscdev.name) {
         ret = -ENOMEM;
-        goto err_reg_disable;
+        goto err_sched_detach;
     }
     data->miscdev.fops = &max30102_fops;
     ret = misc_register(&data->miscdev);
     if (ret < 0) {
         dev_err(&client->dev, "Failed to register misc device: %d\n", ret);
-        goto err_reg_disable;
+        goto err_sched_detach;
     }
 
-    data->irq_gpio = devm_gpiod_get(&client->dev, "int", GPIOD_IN);
+    data->irq_gpio = devm_gpiod_get_optional(&client->dev, "int", GPIOD_IN);  // Absent on boards that do not route INT
     if (IS_ERR(data->irq_gpio)) {
         ret = PTR_ERR(data->irq_gpio);
         dev_err(&client->dev, "Failed to get IRQ GPIO: %d\n", ret);
         goto err_misc_dereg;
     }
+    data->polling = !data->irq_gpio;
+    max30102_poll_init(data);
 
     data->reset_gpio = devm_gpiod_get(&client->dev, "reset", GPIOD_OUT_HIGH);  // Added reset GPIO
     if (IS_ERR(data->reset_gpio)) {
@@ -101,32 +192,48 @@ static int max30102_probe(struct i2c_client *client, const struct i2c_device_id
         goto err_misc_dereg;
     }
 
-    irq = gpiod_to_irq(data->irq_gpio);
-    if (irq < 0) {
-        dev_err(&client->dev, "Failed to get IRQ number: %d\n", irq);
-        ret = irq;
-        goto err_misc_dereg;
-    }
+    if (!data->polling) {
+        irq = gpiod_to_irq(data->irq_gpio);
+        if (irq < 0) {
+            dev_err(&client->dev, "Failed to get IRQ number: %d\n", irq);
+            ret = irq;
+            goto err_misc_dereg;
+        }
 
-    ret = devm_request_irq(&client->dev, irq, max30102_irq_handler, IRQF_TRIGGER_FALLING, "max30102_irq", data);
-    if (ret < 0) {
-        dev_err(&client->dev, "Failed to request IRQ: %d\n", ret);
-        goto err_misc_dereg;
+        ret = devm_request_irq(&client->dev, irq, max30102_irq_handler, IRQF_TRIGGER_FALLING, "max30102_irq", data);
+        if (ret < 0) {
+            dev_err(&client->dev, "Failed to request IRQ: %d\n", ret);
+            goto err_misc_dereg;
+        }
+        data->irq = irq;
     }
 
     ret = sysfs_create_group(&client->dev.kobj, &max30102_attr_group);
     if (ret < 0) {
         dev_err(&client->dev, "Failed to create sysfs group: %d\n", ret);
-        goto err_misc_dereg;
+        goto err_free_irq;
     }
 
-    data->debug_dir = debugfs_create_dir("max30102", NULL);
+    data->debug_dir = debugfs_create_dir(dev_name(&client->dev), max30102_debugfs_root);
     if (!data->debug_dir) {
         ret = -ENOMEM;
         dev_err(&client->dev, "Failed to create debugfs dir\n");
         goto err_sysfs_remove;
     }
     debugfs_create_u8("status1", 0444, data->debug_dir, (u8 *)data);
+    i2c_dir = debugfs_create_dir("i2c", data->debug_dir);
+    debugfs_create_atomic_t("transfers", 0444, i2c_dir, &data->i2c_stats.transfers);
+    debugfs_create_atomic_t("retries", 0444, i2c_dir, &data->i2c_stats.retries);
+    debugfs_create_atomic_t("naks", 0444, i2c_dir, &data->i2c_stats.naks);
+    debugfs_create_atomic_t("timeouts", 0444, i2c_dir, &data->i2c_stats.timeouts);
+    debugfs_create_atomic_t("recoveries", 0444, i2c_dir, &data->i2c_stats.recoveries);
+    debugfs_create_atomic_t("other", 0444, i2c_dir, &data->i2c_stats.other);
+    debugfs_create_atomic_t("failures", 0444, i2c_dir, &data->i2c_stats.failures);
+    debugfs_create_atomic_t("split_reads", 0444, i2c_dir, &data->i2c_stats.split_reads);
+    max30102_mitigate_init(data);
+    max30102_qos_init(data);
+    if (data->polling || data->mitigate_above_hz)
+        debugfs_create_u64("poll_period_ns", 0444, data->debug_dir, &data->poll_period_ns);
 
     // Input subsystem integration
     data->input_dev = devm_input_allocate_device(&client->dev);
@@ -153,29 +260,31 @@ static int max30102_probe(struct i2c_client *client, const struct i2c_device_id
         goto err_input_unregister;
     }
 
-    ret = max30102_init_sensor(data);
-    if (ret < 0) {
-        dev_err(&client->dev, "Failed to initialize sensor: %d\n", ret);
-        goto err_hwmon_remove;
-    }
-
     // Runtime PM
     pm_runtime_enable(&client->dev);
     pm_runtime_set_active(&client->dev);
 
+    // Resets and configuration run off the probe path, see max30102_bringup_work()
+    queue_work(system_unbound_wq, &data->bringup_work);
+
     dev_info(&client->dev, "MAX30102 driver probed successfully, part ID: 0x%02x\n", part_id);
     return 0;
 
-err_hwmon_remove:
-    // No need for devm_hwmon_device_unregister as devm_ handles it
 err_input_unregister:
     input_unregister_device(data->input_dev);
 err_debugfs_remove:
     debugfs_remove_recursive(data->debug_dir);
 err_sysfs_remove:
     sysfs_remove_group(&client->dev.kobj, &max30102_attr_group);
+err_free_irq:
+    if (data->irq)
+        devm_free_irq(&client->dev, data->irq, data);  // An edge would kick the scheduler detached below
 err_misc_dereg:
     misc_deregister(&data->miscdev);
+err_sched_detach:
+    max30102_sched_detach(data);
+err_history_free:
+    max30102_history_free(data);
 err_reg_disable:
     regulator_disable(data->vcc_regulator);
     return ret;
@@ -188,13 +297,21 @@ err_reg_disable:
 static void max30102_remove(struct i2c_client *client)
 {
     struct max30102_data *data = i2c_get_clientdata(client);
+    cancel_work_sync(&data->bringup_work);
+    max30102_mitigate_stop(data);  // Back to interrupts on boards with INT
+    if (data->polling)
+        max30102_poll_stop(data);
+    else
+        disable_irq(data->irq);  // The devm IRQ outlives remove, keep it from kicking a freed scheduler
+    max30102_sched_detach(data);
     pm_runtime_disable(&client->dev);
     sysfs_remove_group(&client->dev.kobj, &max30102_attr_group);
     misc_deregister(&data->miscdev);
+    max30102_history_free(data);
     input_unregister_device(data->input_dev);
     debugfs_remove_recursive(data->debug_dir);
     regulator_disable(data->vcc_regulator);
-    // No need to destroy rwlock (kernel handles it)
+    mutex_destroy(&data->lock);
 }
 
 /**
@@ -206,9 +323,19 @@ static int max30102_suspend(struct device *dev)
 {
     struct max30102_data *data = i2c_get_clientdata(to_i2c_client(dev));
     uint8_t value = 0x80;
-    int ret = max30102_write_reg(data, MAX30102_REG_MODE_CONFIG, &value, 1);
+    int ret;
+
+    flush_work(&data->bringup_work);  // A resume bring-up may still be running
+    max30102_mitigate_stop(data);  // Resume brings the sensor up in interrupt mode
+    if (data->polling)
+        max30102_poll_stop(data);
+    ret = max30102_write_reg(data, MAX30102_REG_MODE_CONFIG, &value, 1);
     if (ret < 0) {
         dev_err(dev, "Failed to suspend device: %d\n", ret);
+        if (data->polling)
+            max30102_poll_start(data);
+        else
+            max30102_mitigate_start(data);
         return ret;
     }
     regulator_disable(data->vcc_regulator);
@@ -228,12 +355,9 @@ static int max30102_resume(struct device *dev)
         dev_err(dev, "Failed to enable regulator on resume: %d\n", ret);
         return ret;
     }
-    ret = max30102_init_sensor(data);
-    if (ret < 0) {
-        dev_err(dev, "Failed to re-init sensor on resume: %d\n", ret);
-        regulator_disable(data->vcc_regulator);
-        return ret;
-    }
+    // Same deferred bring-up as probe, so resume does not sleep through the resets
+    reinit_completion(&data->ready);
+    queue_work(system_unbound_wq, &data->bringup_work);
     return 0;
 }
 
@@ -244,6 +368,7 @@ static struct i2c_driver max30102_driver = {
         .name = "max30102",
         .of_match_table = max30102_of_match,
         .pm = &max30102_pm_ops,
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS,  // Sensors probe in parallel, off the boot path
     },
     .probe = max30102_probe,
     .remove = max30102_remove,
@@ -251,15 +376,46 @@ static struct i2c_driver max30102_driver = {
 };
 
 // File operations
-static ssize_t max30102_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+
+/**
+ * max30102_read_iter - Hand out one FIFO batch as struct max30102_fifo_data
+ * @iocb: I/O control block
+ * @to: Destination, user memory for read() or pipe pages for splice()
+ * Returns: Bytes copied, negative error code on failure
+ *
+ * Also backs splice() and sendfile(), so a recorder can move batches from
+ * the device through a pipe into a file or socket without copying them
+ * through user memory. A file in history mode reads struct max30102_sample
+ * records at the offset instead, see max30102_history.c, and a file with a
+ * reduction stage reads struct max30102_reduced records, see
+ * max30102_reduce.c.
+ *
+ * IOCB_NOWAIT is treated like O_NONBLOCK, so io_uring tries the read inline
+ * and waits on the poll queue on -EAGAIN; many sensors can then keep a read
+ * in flight each without a worker thread per read. No read touches the bus:
+ * a batch read takes the snapshot of the last drain, a history read the
+ * ring, so the inline attempt never sleeps on I2C.
+ */
+static ssize_t max30102_read_iter(struct kiocb *iocb, struct iov_iter *to)
 {
-    struct max30102_data *data = file->private_data;
+    struct file *file = iocb->ki_filp;
+    struct max30102_file *mf = file->private_data;
+    struct max30102_data *data = mf->data;
     struct max30102_fifo_data fifo_data;
+    bool nonblock = (file->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT);
     int ret;
 
     if (!data) return -EINVAL;
+    if (mf->history)
+        return max30102_history_read(data, iocb, to, nonblock);  // Never touches the chip, no bring-up wait
+    if (max30102_reduce_active(mf))
+        return max30102_reduce_read(mf->reducer, to, nonblock);
+    if (iov_iter_count(to) < sizeof(fifo_data)) return -EINVAL;  // Before the batch is consumed
+
+    ret = max30102_wait_ready(data, nonblock);
+    if (ret < 0) return ret;
 
-    if (file->f_flags & O_NONBLOCK) {
+    if (nonblock) {
         if (!data->fifo_full) return -EAGAIN;
     } else {
         ret = wait_event_interruptible(data->wait_data_ready, data->fifo_full);
@@ -269,36 +425,57 @@ static ssize_t max30102_read(struct file *file, char __user *buf, size_t count,
     ret = max30102_read_fifo(data, fifo_data.red, fifo_data.ir, &fifo_data.len);
     if (ret < 0) return ret;
 
-    if (count < sizeof(fifo_data)) return -EINVAL;
-    if (copy_to_user(buf, &fifo_data, sizeof(fifo_data))) return -EFAULT;
+    if (copy_to_iter(&fifo_data, sizeof(fifo_data), to) != sizeof(fifo_data)) return -EFAULT;
 
     return sizeof(fifo_data);
 }
 
 static ssize_t max30102_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
 {
-    struct max30102_data *data = file->private_data;
+    struct max30102_data *data = ((struct max30102_file *)file->private_data)->data;
     uint8_t config;
+    int ret;
     if (!data) return -EINVAL;
     if (count != sizeof(uint8_t)) return -EINVAL;
     if (copy_from_user(&config, buf, sizeof(uint8_t))) return -EFAULT;
-    return max30102_set_mode(data, config);
+    ret = max30102_wait_ready(data, file->f_flags & O_NONBLOCK);  // Bring-up would overwrite the mode
+    if (ret < 0) return ret;
+    mutex_lock(&data->lock);
+    ret = max30102_set_mode(data, config);
+    max30102_unlock(data);
+    return ret;
 }
 
 static loff_t max30102_llseek(struct file *file, loff_t offset, int whence)
 {
-    return fixed_size_llseek(file, offset, whence, sizeof(struct max30102_fifo_data));
+    struct max30102_file *mf = file->private_data;
+    struct max30102_history_info info;
+
+    if (!mf->history)
+        return fixed_size_llseek(file, offset, whence, sizeof(struct max30102_fifo_data));
+
+    // SEEK_END is the next sample drained, seeking past it waits for that sample
+    max30102_history_info(mf->data, &info);
+    return generic_file_llseek_size(file, offset, whence, MAX_LFS_FILESIZE, info.next * info.sample_size);
 }
 
 static unsigned int max30102_poll(struct file *file, struct poll_table_struct *wait)
 {
-    struct max30102_data *data = file->private_data;
+    struct max30102_file *mf = file->private_data;
+    struct max30102_data *data = mf->data;
     unsigned int revents = 0;
 
     if (!data) return -EINVAL;
 
+    if (max30102_reduce_active(mf)) {
+        poll_wait(file, &mf->reducer->wait, wait);  // Woken per record, not per drain
+        if (max30102_reduce_ready(mf->reducer))
+            revents |= POLLIN | POLLRDNORM;
+        return revents;
+    }
+
     poll_wait(file, &data->wait_data_ready, wait);
-    if (data->fifo_full)
+    if (mf->history ? max30102_history_ready(data, file->f_pos) : data->fifo_full)
         revents |= POLLIN | POLLRDNORM;
 
     return revents;
@@ -307,19 +484,29 @@ static unsigned int max30102_poll(struct file *file, struct poll_table_struct *w
 const struct file_operations max30102_fops = {
     .owner = THIS_MODULE,
     .open = max30102_open,
+    .release = max30102_release,
     .unlocked_ioctl = max30102_ioctl,
     .compat_ioctl = max30102_compat_ioctl,
-    .read = max30102_read,
+    .read_iter = max30102_read_iter,
+    .splice_read = generic_file_splice_read,  // Pipe pages filled through read_iter
     .write = max30102_write,
     .llseek = max30102_llseek,
     .poll = max30102_poll,
 };
 
+/*
+ * The attributes below use the bus and the profile like the ioctls do, so
+ * they wait for bring-up and take data->lock the same way.
+ */
 static ssize_t temperature_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
     struct max30102_data *data = i2c_get_clientdata(to_i2c_client(dev));
     float temp;
-    int ret = max30102_read_temperature(data, &temp);
+    int ret = max30102_wait_ready(data, false);
+    if (ret < 0) return ret;
+    mutex_lock(&data->lock);
+    ret = max30102_read_temperature(data, &temp);
+    max30102_unlock(data);
     if (ret < 0)
         return ret;
     return scnprintf(buf, PAGE_SIZE, "%.4f\n", temp);
@@ -329,9 +516,13 @@ static ssize_t status_show(struct device *dev, struct device_attribute *attr, ch
 {
     struct max30102_data *data = i2c_get_clientdata(to_i2c_client(dev));
     uint8_t status1, status2;
-    int ret = max30102_read_reg(data, MAX30102_REG_INTERRUPT_STATUS_1, &status1, 1);
+    int ret = max30102_wait_ready(data, false);
     if (ret < 0) return ret;
-    ret = max30102_read_reg(data, MAX30102_REG_INTERRUPT_STATUS_2, &status2, 1);
+    mutex_lock(&data->lock);
+    ret = max30102_read_reg(data, MAX30102_REG_INTERRUPT_STATUS_1, &status1, 1);
+    if (ret >= 0)
+        ret = max30102_read_reg(data, MAX30102_REG_INTERRUPT_STATUS_2, &status2, 1);
+    max30102_unlock(data);
     if (ret < 0) return ret;
     return scnprintf(buf, PAGE_SIZE, "Status1: 0x%02x, Status2: 0x%02x\n", status1, status2);
 }
@@ -340,9 +531,13 @@ static ssize_t led_current_show(struct device *dev, struct device_attribute *att
 {
     struct max30102_data *data = i2c_get_clientdata(to_i2c_client(dev));
     uint8_t led1, led2;
-    int ret = max30102_read_reg(data, MAX30102_REG_LED_PULSE_1, &led1, 1);
+    int ret = max30102_wait_ready(data, false);
     if (ret < 0) return ret;
-    ret = max30102_read_reg(data, MAX30102_REG_LED_PULSE_2, &led2, 1);
+    mutex_lock(&data->lock);
+    ret = max30102_read_reg(data, MAX30102_REG_LED_PULSE_1, &led1, 1);
+    if (ret >= 0)
+        ret = max30102_read_reg(data, MAX30102_REG_LED_PULSE_2, &led2, 1);
+    max30102_unlock(data);
     if (ret < 0) return ret;
     return scnprintf(buf, PAGE_SIZE, "LED1: 0x%02x, LED2: 0x%02x\n", led1, led2);
 }
@@ -353,9 +548,36 @@ static ssize_t led_current_store(struct device *dev, struct device_attribute *at
     uint8_t value;
     int ret = kstrtou8(buf, 16, &value);
     if (ret < 0) return ret;
-    ret = max30102_write_reg(data, MAX30102_REG_LED_PULSE_1, &value, 1);
+    ret = max30102_wait_ready(data, false);  // Bring-up would overwrite the currents
     if (ret < 0) return ret;
+    mutex_lock(&data->lock);
+    ret = max30102_write_reg(data, MAX30102_REG_LED_PULSE_1, &value, 1);
+    if (ret < 0) goto unlock;
     ret = max30102_write_reg(data, MAX30102_REG_LED_PULSE_2, &value, 1);
+    if (ret < 0) goto unlock;
+    data->profile.led1 = value;  // Kept across resume
+    data->profile.led2 = value;
+unlock:
+    max30102_unlock(data);
+    return ret < 0 ? ret : count;
+}
+
+static ssize_t history_samples_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    struct max30102_data *data = i2c_get_clientdata(to_i2c_client(dev));
+    struct max30102_history_info info;
+
+    max30102_history_info(data, &info);
+    return scnprintf(buf, PAGE_SIZE, "%u\n", info.window);
+}
+
+static ssize_t history_samples_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct max30102_data *data = i2c_get_clientdata(to_i2c_client(dev));
+    u32 window;
+    int ret = kstrtou32(buf, 0, &window);
+    if (ret < 0) return ret;
+    ret = max30102_history_resize(data, window);  // Drops the samples held
     if (ret < 0) return ret;
     return count;
 }
@@ -363,11 +585,13 @@ static ssize_t led_current_store(struct device *dev, struct device_attribute *at
 static DEVICE_ATTR_RO(temperature);
 static DEVICE_ATTR_RO(status);
 static DEVICE_ATTR_RW(led_current);
+static DEVICE_ATTR_RW(history_samples);
 
 static struct attribute *max30102_attrs[] = {
     &dev_attr_temperature.attr,
     &dev_attr_status.attr,
     &dev_attr_led_current.attr,
+    &dev_attr_history_samples.attr,
     NULL
 };
 
@@ -375,7 +599,24 @@ struct attribute_group max30102_attr_group = {
     .attrs = max30102_attrs,
 };
 
-module_i2c_driver(max30102_driver);
+static int __init max30102_module_init(void)
+{
+    int ret;
+
+    max30102_debugfs_root = debugfs_create_dir("max30102", NULL);
+    ret = i2c_add_driver(&max30102_driver);
+    if (ret < 0)
+        debugfs_remove_recursive(max30102_debugfs_root);
+    return ret;
+}
+module_init(max30102_module_init);
+
+static void __exit max30102_module_exit(void)
+{
+    i2c_del_driver(&max30102_driver);
+    debugfs_remove_recursive(max30102_debugfs_root);
+}
+module_exit(max30102_module_exit);
 
 MODULE_ALIAS("i2c:max30102");  // Added for module autoloading
 MODULE_AUTHOR("Nguyen Nhan");
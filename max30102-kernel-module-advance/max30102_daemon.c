@@ -0,0 +1,523 @@
+#define _GNU_SOURCE  // accept4()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "max30102.h"
+#include "max30102_daemon.h"
+#include "driver_max30102_rt.h"
+
+/*
+ * max30102d - single-threaded acquisition daemon.
+ *
+ * One epoll loop owns every /dev/max30102-* node, the listening socket,
+ * all client sockets, a housekeeping timerfd and a signalfd. Devices are
+ * drained as soon as they turn readable; each batch is fanned out to the
+ * subscribed clients with one non-blocking sendmsg() whose iovec points
+ * straight into the drained buffer. A client that cannot keep up gets a
+ * bounded backlog and then loses its oldest batches; acquisition never
+ * waits for a client.
+ */
+
+#define MAX_CLIENTS        64
+#define MAX_EVENTS         32
+#define CLIENT_BACKLOG     32   // Queued batches per slow client before dropping
+#define RESCAN_TICKS       5    // Housekeeping ticks (1 s) between device rescans
+#define TEMP_TICKS         10   // Housekeeping ticks between temperature reads
+#define BATCH_MAX_SIZE     (sizeof(struct max30102_daemon_batch) + 2 * 32 * sizeof(uint32_t))
+
+enum src_type {
+    SRC_DEVICE,
+    SRC_LISTEN,
+    SRC_CLIENT,
+    SRC_TIMER,
+    SRC_SIGNAL,
+};
+
+struct src {
+    enum src_type type;
+    int fd;
+};
+
+struct device {
+    struct src src;           // Must stay first: epoll hands back this pointer
+    char name[32];
+    struct max30102_fifo_data fifo;
+    int present;
+};
+
+struct pending {
+    uint16_t len;
+    uint8_t buf[BATCH_MAX_SIZE];
+};
+
+struct client {
+    struct src src;
+    uint8_t subs[MAX30102_DAEMON_MAX_DEVICES];  // Channel mask per device
+    struct pending backlog[CLIENT_BACKLOG];
+    unsigned int head, tail;  // Backlog ring indices (tail - head = queued)
+    uint32_t dropped;
+    int want_out;             // EPOLLOUT currently armed
+    int active;
+};
+
+static int epfd = -1;
+static struct device devices[MAX30102_DAEMON_MAX_DEVICES];
+static struct client clients[MAX_CLIENTS];
+static struct src listen_src = { SRC_LISTEN, -1 };
+static struct src timer_src = { SRC_TIMER, -1 };
+static struct src signal_src = { SRC_SIGNAL, -1 };
+static unsigned long ticks;
+static int running = 1;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int ep_add(struct src *src, uint32_t events) {
+    struct epoll_event ev = { .events = events, .data.ptr = src };
+    return epoll_ctl(epfd, EPOLL_CTL_ADD, src->fd, &ev);
+}
+
+static void ep_mod(struct src *src, uint32_t events) {
+    struct epoll_event ev = { .events = events, .data.ptr = src };
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, src->fd, &ev) < 0)
+        perror("epoll_ctl MOD");
+}
+
+/* Client side */
+
+static void client_close(struct client *c) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->src.fd, NULL);
+    close(c->src.fd);
+    c->active = 0;
+}
+
+static void client_queue(struct client *c, const struct iovec *iov, int iovcnt) {
+    struct pending *p;
+    size_t off = 0;
+    int i;
+
+    if (c->tail - c->head == CLIENT_BACKLOG) {
+        c->head++;  // Drop the oldest batch rather than stall the loop
+        c->dropped++;
+    }
+    p = &c->backlog[c->tail++ % CLIENT_BACKLOG];
+    for (i = 0; i < iovcnt; i++) {
+        memcpy(p->buf + off, iov[i].iov_base, iov[i].iov_len);
+        off += iov[i].iov_len;
+    }
+    p->len = off;
+    if (!c->want_out) {
+        ep_mod(&c->src, EPOLLIN | EPOLLOUT);
+        c->want_out = 1;
+    }
+}
+
+static int client_sendv(struct client *c, struct iovec *iov, int iovcnt) {
+    struct msghdr msg = { .msg_iov = iov, .msg_iovlen = iovcnt };
+    ssize_t ret = sendmsg(c->src.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (ret >= 0)
+        return 0;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+        return -EAGAIN;
+    return -errno;
+}
+
+static void client_flush(struct client *c) {
+    while (c->head != c->tail) {
+        struct pending *p = &c->backlog[c->head % CLIENT_BACKLOG];
+        struct max30102_daemon_batch *hdr = (struct max30102_daemon_batch *)p->buf;
+        struct iovec iov = { .iov_base = p->buf, .iov_len = p->len };
+        int ret;
+
+        hdr->dropped = c->dropped;
+        ret = client_sendv(c, &iov, 1);
+        if (ret == -EAGAIN)
+            return;
+        if (ret < 0) {
+            client_close(c);
+            return;
+        }
+        c->dropped = 0;
+        c->head++;
+    }
+    if (c->want_out) {
+        ep_mod(&c->src, EPOLLIN);
+        c->want_out = 0;
+    }
+}
+
+/* Deliver one batch; hdr->dropped is patched per client */
+static void client_deliver(struct client *c, struct max30102_daemon_batch *hdr, struct iovec *iov, int iovcnt) {
+    int ret;
+
+    hdr->dropped = c->dropped;
+    if (c->head != c->tail) {
+        client_queue(c, iov, iovcnt);  // Keep ordering behind the existing backlog
+        return;
+    }
+    ret = client_sendv(c, iov, iovcnt);
+    if (ret == -EAGAIN) {
+        client_queue(c, iov, iovcnt);
+    } else if (ret < 0) {
+        client_close(c);
+    } else {
+        c->dropped = 0;
+    }
+}
+
+static void client_request(struct client *c) {
+    struct max30102_daemon_req req;
+    struct max30102_daemon_list list;
+    ssize_t n;
+    int i;
+
+    n = recv(c->src.fd, &req, sizeof(req), MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        client_close(c);
+        return;
+    }
+    if (n != sizeof(req))
+        return;
+
+    switch (req.op) {
+    case MAX30102_OP_LIST:
+        memset(&list, 0, sizeof(list));
+        for (i = 0; i < MAX30102_DAEMON_MAX_DEVICES; i++) {
+            if (devices[i].present) {
+                memcpy(list.names[i], devices[i].name, sizeof(list.names[i]));
+                list.count = i + 1;
+            }
+        }
+        if (send(c->src.fd, &list, sizeof(list), MSG_DONTWAIT | MSG_NOSIGNAL) < 0 && errno != EAGAIN)
+            client_close(c);
+        break;
+    case MAX30102_OP_SUBSCRIBE:
+        if (req.device < MAX30102_DAEMON_MAX_DEVICES)
+            c->subs[req.device] |= req.channels & MAX30102_CH_ALL;
+        break;
+    case MAX30102_OP_UNSUBSCRIBE:
+        if (req.device < MAX30102_DAEMON_MAX_DEVICES)
+            c->subs[req.device] &= ~req.channels;
+        break;
+    default:
+        fprintf(stderr, "Client %d: invalid op %u\n", c->src.fd, req.op);
+        break;
+    }
+}
+
+static void client_accept(void) {
+    int fd, i;
+
+    while ((fd = accept4(listen_src.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        for (i = 0; i < MAX_CLIENTS && clients[i].active; i++)
+            ;
+        if (i == MAX_CLIENTS) {
+            fprintf(stderr, "Too many clients, rejecting\n");
+            close(fd);
+            continue;
+        }
+        memset(&clients[i], 0, sizeof(clients[i]));
+        clients[i].src.type = SRC_CLIENT;
+        clients[i].src.fd = fd;
+        clients[i].active = 1;
+        if (ep_add(&clients[i].src, EPOLLIN) < 0) {
+            perror("epoll_ctl client");
+            close(fd);
+            clients[i].active = 0;
+        }
+    }
+}
+
+/* Device side */
+
+static void device_close(struct device *d) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, d->src.fd, NULL);
+    close(d->src.fd);
+    d->present = 0;
+    fprintf(stderr, "%s: removed\n", d->name);
+}
+
+static void device_publish(int idx, uint8_t channels, uint16_t count, const void *red, const void *ir,
+                           const void *temp) {
+    struct max30102_daemon_batch hdr;
+    struct iovec iov[3];
+    int i;
+
+    hdr.device = idx;
+    hdr.timestamp_ns = monotonic_ns();
+    hdr.count = count;
+
+    for (i = 0; i < MAX_CLIENTS; i++) {
+        struct client *c = &clients[i];
+        uint8_t want;
+        int n = 1;
+
+        if (!c->active)
+            continue;
+        want = c->subs[idx] & channels;
+        if (!want)
+            continue;
+
+        hdr.channels = want;
+        iov[0].iov_base = &hdr;
+        iov[0].iov_len = sizeof(hdr);
+        if (want & MAX30102_CH_RED) {
+            iov[n].iov_base = (void *)red;
+            iov[n++].iov_len = count * sizeof(uint32_t);
+        }
+        if (want & MAX30102_CH_IR) {
+            iov[n].iov_base = (void *)ir;
+            iov[n++].iov_len = count * sizeof(uint32_t);
+        }
+        if (want & MAX30102_CH_TEMP) {
+            iov[n].iov_base = (void *)temp;
+            iov[n++].iov_len = sizeof(float);
+        }
+        client_deliver(c, &hdr, iov, n);
+    }
+}
+
+static void device_drain(struct device *d) {
+    int idx = d - devices;
+    ssize_t n;
+
+    // Non-blocking read(): the driver hands out one FIFO batch per call
+    while ((n = read(d->src.fd, &d->fifo, sizeof(d->fifo))) == sizeof(d->fifo)) {
+        if (d->fifo.len > 32)
+            break;
+        device_publish(idx, MAX30102_CH_RED | MAX30102_CH_IR, d->fifo.len, d->fifo.red, d->fifo.ir, NULL);
+    }
+    if (n < 0 && errno != EAGAIN && errno != ENODATA && errno != EINTR) {
+        fprintf(stderr, "%s: read failed: %s\n", d->name, strerror(errno));
+        device_close(d);
+    }
+}
+
+static void device_temperature(struct device *d) {
+    float temp;
+
+    if (ioctl(d->src.fd, MAX30102_IOC_READ_TEMP, &temp) < 0) {
+        fprintf(stderr, "%s: temperature read failed: %s\n", d->name, strerror(errno));
+        return;
+    }
+    device_publish(d - devices, MAX30102_CH_TEMP, 1, NULL, NULL, &temp);
+}
+
+static void device_scan(void) {
+    glob_t g;
+    size_t i;
+    int j, slot;
+
+    if (glob("/dev/max30102-*", 0, NULL, &g) != 0)
+        return;
+    for (i = 0; i < g.gl_pathc; i++) {
+        const char *name = g.gl_pathv[i] + strlen("/dev/");
+
+        slot = -1;
+        for (j = 0; j < MAX30102_DAEMON_MAX_DEVICES; j++) {
+            if (devices[j].present && strcmp(devices[j].name, name) == 0)
+                break;
+            // Reuse the slot a device had before it disappeared, so client indices stay stable
+            if (!devices[j].present && (slot < 0 || strcmp(devices[j].name, name) == 0))
+                slot = j;
+        }
+        if (j < MAX30102_DAEMON_MAX_DEVICES || slot < 0)
+            continue;
+
+        devices[slot].src.type = SRC_DEVICE;
+        devices[slot].src.fd = open(g.gl_pathv[i], O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (devices[slot].src.fd < 0) {
+            fprintf(stderr, "%s: open failed: %s\n", g.gl_pathv[i], strerror(errno));
+            continue;
+        }
+        snprintf(devices[slot].name, sizeof(devices[slot].name), "%s", name);
+        if (ep_add(&devices[slot].src, EPOLLIN) < 0) {
+            perror("epoll_ctl device");
+            close(devices[slot].src.fd);
+            continue;
+        }
+        devices[slot].present = 1;
+        fprintf(stderr, "%s: acquiring as device %d\n", name, slot);
+        device_drain(&devices[slot]);  // Batch may already be pending
+    }
+    globfree(&g);
+}
+
+/* Loop */
+
+static void housekeeping(void) {
+    uint64_t expirations;
+    int i;
+
+    if (read(timer_src.fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return;
+    ticks += expirations;
+    if (ticks % RESCAN_TICKS == 0)
+        device_scan();
+    if (ticks % TEMP_TICKS == 0) {
+        for (i = 0; i < MAX30102_DAEMON_MAX_DEVICES; i++) {
+            if (devices[i].present)
+                device_temperature(&devices[i]);
+        }
+    }
+}
+
+static int setup(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct itimerspec its = { .it_interval = { 1, 0 }, .it_value = { 1, 0 } };
+    sigset_t mask;
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    signal_src.fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_src.fd < 0 || ep_add(&signal_src, EPOLLIN) < 0) {
+        perror("signalfd");
+        return -1;
+    }
+
+    timer_src.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_src.fd < 0 || timerfd_settime(timer_src.fd, 0, &its, NULL) < 0 || ep_add(&timer_src, EPOLLIN) < 0) {
+        perror("timerfd");
+        return -1;
+    }
+
+    listen_src.fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_src.fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    unlink(path);
+    if (bind(listen_src.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_src.fd, 16) < 0 || ep_add(&listen_src, EPOLLIN) < 0) {
+        perror("bind/listen");
+        return -1;
+    }
+
+    device_scan();
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    max30102_rt_config_t rt = { .priority = 0, .cpu = -1, .lock_memory = 0 };
+    struct epoll_event events[MAX_EVENTS];
+    const char *path = MAX30102_DAEMON_SOCKET;
+    uint8_t applied = 0;
+    int n, i;
+
+    // [--rt-priority=1..99] [--cpu=N] [--mlock] [socket path]
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--rt-priority=", 14) == 0) {
+            rt.priority = atoi(argv[i] + 14);
+        } else if (strncmp(argv[i], "--cpu=", 6) == 0) {
+            rt.cpu = atoi(argv[i] + 6);
+        } else if (strcmp(argv[i], "--mlock") == 0) {
+            rt.lock_memory = 1;
+        } else if (strncmp(argv[i], "--", 2) != 0) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [--rt-priority=1..99] [--cpu=N] [--mlock] [socket]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (setup(path) < 0)
+        return 1;
+
+    // This loop is the acquisition thread; the drain buffers are static, so
+    // locking memory here also faults them in
+    n = max30102_rt_apply(&rt, &applied);
+    if (n == 3) {
+        fprintf(stderr, "invalid real-time settings\n");
+        return 1;
+    } else if (n != 0) {
+        fprintf(stderr, "real-time settings refused (applied 0x%x)\n", applied);
+    }
+    printf("max30102d listening on %s\n", path);
+
+    while (running) {
+        n = epoll_wait(epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (i = 0; i < n; i++) {
+            struct src *src = events[i].data.ptr;
+            uint32_t ev = events[i].events;
+
+            switch (src->type) {
+            case SRC_DEVICE: {
+                struct device *d = (struct device *)src;
+                if (!d->present)
+                    break;
+                if (ev & EPOLLIN)
+                    device_drain(d);
+                if (d->present && (ev & (EPOLLERR | EPOLLHUP)))
+                    device_close(d);
+                break;
+            }
+            case SRC_CLIENT: {
+                struct client *c = (struct client *)src;
+                if (c->active && (ev & EPOLLOUT))
+                    client_flush(c);
+                if (c->active && (ev & EPOLLIN))
+                    client_request(c);
+                if (c->active && (ev & (EPOLLERR | EPOLLHUP)))
+                    client_close(c);
+                break;
+            }
+            case SRC_LISTEN:
+                client_accept();
+                break;
+            case SRC_TIMER:
+                housekeeping();
+                break;
+            case SRC_SIGNAL:
+                running = 0;
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].active)
+            client_close(&clients[i]);
+    }
+    for (i = 0; i < MAX30102_DAEMON_MAX_DEVICES; i++) {
+        if (devices[i].present)
+            device_close(&devices[i]);
+    }
+    close(listen_src.fd);
+    unlink(path);
+    close(timer_src.fd);
+    close(signal_src.fd);
+    close(epfd);
+    return 0;
+}
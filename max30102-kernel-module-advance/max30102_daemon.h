@@ -0,0 +1,54 @@
+#ifndef MAX30102_DAEMON_H
+#define MAX30102_DAEMON_H
+
+#include <stdint.h>
+
+/*
+ * Wire protocol of max30102d, the acquisition daemon.
+ *
+ * Clients connect to a SOCK_SEQPACKET Unix socket, so every request and
+ * every reply is exactly one message. A client subscribes to a channel mask
+ * per device; the daemon then sends one batch message per drained FIFO
+ * batch: a struct max30102_daemon_batch followed by `count` uint32_t Red
+ * samples (if MAX30102_CH_RED is set in `channels`), then `count` IR
+ * samples (if MAX30102_CH_IR is set). Temperature batches carry a single
+ * float and have `channels == MAX30102_CH_TEMP`.
+ */
+
+#define MAX30102_DAEMON_SOCKET      "/run/max30102.sock"
+#define MAX30102_DAEMON_MAX_DEVICES 16
+
+/* Channel mask bits */
+#define MAX30102_CH_RED   0x01
+#define MAX30102_CH_IR    0x02
+#define MAX30102_CH_TEMP  0x04
+#define MAX30102_CH_ALL   (MAX30102_CH_RED | MAX30102_CH_IR | MAX30102_CH_TEMP)
+
+/* Request opcodes */
+enum max30102_daemon_op {
+    MAX30102_OP_LIST        = 0,  // Reply: struct max30102_daemon_list
+    MAX30102_OP_SUBSCRIBE   = 1,  // Add `channels` for `device`
+    MAX30102_OP_UNSUBSCRIBE = 2,  // Remove `channels` for `device`
+};
+
+struct max30102_daemon_req {
+    uint8_t op;
+    uint8_t device;    // Index from MAX30102_OP_LIST
+    uint8_t channels;  // MAX30102_CH_* mask
+    uint8_t reserved;
+};
+
+struct max30102_daemon_list {
+    uint8_t count;
+    char names[MAX30102_DAEMON_MAX_DEVICES][32];  // e.g. "max30102-87", empty if slot is gone
+};
+
+struct max30102_daemon_batch {
+    uint8_t device;
+    uint8_t channels;      // Channels present in this message
+    uint16_t count;        // Samples per channel
+    uint32_t dropped;      // Batches dropped for this client since the last delivered one
+    uint64_t timestamp_ns; // CLOCK_MONOTONIC time the batch was drained
+};
+
+#endif
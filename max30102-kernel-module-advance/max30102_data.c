@@ -7,32 +7,52 @@
 static DEFINE_SPINLOCK(fifo_spinlock);
 
 /**
- * max30102_clear_fifo - Clear FIFO pointers
- * @data: MAX30102 device data
- * Returns: 0 on success, negative error code on failure
+ * max30102_publish - Decode a drained burst into the snapshot readers take
+ * @data: MAX30102 device data, the drain holds the lock
+ * @layout: Layout the burst was read with
+ * @buf: Raw FIFO bytes, three per active slot
+ * @len: Samples
+ *
+ * read() does not take data->lock, so the snapshot changes only under
+ * fifo_spinlock.
  */
-static int max30102_clear_fifo(struct max30102_data *data)
+void max30102_publish(struct max30102_data *data, const struct max30102_layout *layout, const uint8_t *buf,
+                      uint8_t len)
 {
-    uint8_t value = 0x00;
-    int ret;
-
-    if (!data) return -EINVAL;
+    unsigned long flags;
+    int i, c;
 
-    ret = max30102_write_reg(data, MAX30102_REG_FIFO_WRITE_POINTER, &value, 1);
-    if (ret < 0) {
-        dev_err(&data->client->dev, "Failed to clear FIFO write pointer: %d\n", ret);
-        return ret;
-    }
-    ret = max30102_write_reg(data, MAX30102_REG_FIFO_READ_POINTER, &value, 1);
-    if (ret < 0) {
-        dev_err(&data->client->dev, "Failed to clear FIFO read pointer: %d\n", ret);
-        return ret;
+    spin_lock_irqsave(&fifo_spinlock, flags);
+    for (i = 0; i < len; i++) {
+        for (c = 0; c < layout->channels; c++, buf += 3)
+            data->samples[i][c] = (buf[0] << 10) | (buf[1] << 2) | (buf[2] >> 6);  // 18-bit shift from datasheet
     }
-    ret = max30102_write_reg(data, MAX30102_REG_OVERFLOW_COUNTER, &value, 1);
-    if (ret < 0) {
-        dev_err(&data->client->dev, "Failed to clear FIFO overflow counter: %d\n", ret);
-        return ret;
+    data->layout = *layout;
+    data->data_len = len;
+    data->fifo_full = true;
+    spin_unlock_irqrestore(&fifo_spinlock, flags);
+}
+
+/**
+ * max30102_snapshot_take - Claim the samples of the last drain
+ * @data: MAX30102 device data
+ * @flags: Saved interrupt state, for the caller's spin_unlock_irqrestore()
+ * Returns: 0 with fifo_spinlock held, -ENODATA if nothing was drained since
+ *          the last read
+ *
+ * Each drain is read once. The chip is not touched: the drain owns the FIFO
+ * pointers and reports overflows, and clearing them here would drop the
+ * samples queued since.
+ */
+static int max30102_snapshot_take(struct max30102_data *data, unsigned long *flags)
+{
+    spin_lock_irqsave(&fifo_spinlock, *flags);
+    if (!data->fifo_full) {
+        spin_unlock_irqrestore(&fifo_spinlock, *flags);
+        dev_dbg(&data->client->dev, "No FIFO data available\n");
+        return -ENODATA;
     }
+    data->fifo_full = false;
     return 0;
 }
 
@@ -77,6 +97,22 @@ static uint32_t find_max(uint32_t *arr, uint8_t len) {
     return max_val;
 }
 
+/**
+ * max30102_channel_index - First channel of an LED in the drained layout
+ * @layout: Layout of the last drain
+ * @led: 1 = red, 2 = IR
+ * Returns: Channel index, -1 if no active slot drives the LED
+ */
+static int max30102_channel_index(const struct max30102_layout *layout, uint8_t led)
+{
+    int c;
+
+    for (c = 0; c < layout->channels; c++) {
+        if (layout->led[c] == led) return c;
+    }
+    return -1;
+}
+
 /**
  * max30102_read_fifo - Read FIFO data (Red and IR samples)
  * @data: MAX30102 device data
@@ -84,53 +120,30 @@ static uint32_t find_max(uint32_t *arr, uint8_t len) {
  * @ir: Buffer for IR LED samples
  * @len: Pointer to store number of samples read
  * Returns: 0 on success, negative error code on failure
+ *
+ * Red and IR come from the first slot of each LED, whatever the slot order.
+ * A buffer whose LED has no active slot reads as zeros.
  */
 int max30102_read_fifo(struct max30102_data *data, uint32_t *red, uint32_t *ir, uint8_t *len)
 {
     unsigned long flags;
-    uint8_t ovf_counter;
-    int ret;
+    int ret, i, red_ch, ir_ch;
 
     if (!data || !red || !ir || !len) return -EINVAL;
 
-    if (!data->fifo_full) {
-        dev_dbg(&data->client->dev, "No FIFO data available\n");
-        return -ENODATA;
-    }
-
-    // Check overflow counter as per datasheet
-    ret = max30102_read_reg(data, MAX30102_REG_OVERFLOW_COUNTER, &ovf_counter, 1);
-    if (ret < 0) {
-        dev_err(&data->client->dev, "Failed to read overflow counter: %d\n", ret);
-        return ret;
+    ret = max30102_snapshot_take(data, &flags);
+    if (ret < 0) return ret;
+    red_ch = max30102_channel_index(&data->layout, MAX30102_SLOT1_RED);
+    ir_ch = max30102_channel_index(&data->layout, MAX30102_SLOT2_IR);
+    for (i = 0; i < ARRAY_SIZE(data->samples); i++) {
+        red[i] = red_ch < 0 ? 0 : data->samples[i][red_ch];
+        ir[i] = ir_ch < 0 ? 0 : data->samples[i][ir_ch];
     }
-    if (ovf_counter > 0) {
-        dev_warn(&data->client->dev, "FIFO overflow: %d samples lost\n", ovf_counter);
-        // Auto-adjust sample rate or LED current if overflow (improvement)
-        uint8_t config;
-        ret = max30102_read_reg(data, MAX30102_REG_SPO2_CONFIG, &config, 1);
-        if (ret < 0) return ret;
-        config = (config & ~0x1C) | (0x04 << 2);  // Reduce SR to 200sps as example
-        ret = max30102_set_spo2_config(data, config);
-        if (ret < 0) return ret;
-    }
-
-    read_lock(&data->lock);  // Use read_lock for read-only operation
-    spin_lock_irqsave(&fifo_spinlock, flags);  // Atomic protection
-    memcpy(red, data->red_data, sizeof(data->red_data));
-    memcpy(ir, data->ir_data, sizeof(data->ir_data));
     *len = data->data_len;
-    data->fifo_full = false;
     spin_unlock_irqrestore(&fifo_spinlock, flags);
 
-    // Auto-clear FIFO after reading
-    ret = max30102_clear_fifo(data);
-    if (ret < 0) {
-        read_unlock(&data->lock);
-        return ret;
-    }
-
-    read_unlock(&data->lock);
+    if (red_ch < 0 || ir_ch < 0)
+        return 0;  // Heart rate and SpO2 need both LEDs
 
     // Real algorithm for heart rate and SpO2 (replaced placeholder)
     if (data->input_dev && *len > 10) {  // Require at least 10 samples for calculation
@@ -142,7 +155,6 @@ int max30102_read_fifo(struct max30102_data *data, uint32_t *red, uint32_t *ir,
         uint64_t total_interval = 0;
         int last_peak = -1;
 
-        int i;
         for (i = 1; i < *len - 1; i++) {
             if (ir[i] > threshold && ir[i] > ir[i-1] && ir[i] > ir[i+1]) {
                 if (last_peak >= 0) {
@@ -160,8 +172,7 @@ int max30102_read_fifo(struct max30102_data *data, uint32_t *red, uint32_t *ir,
         }
 
         // Calculate SpO2
-        uint32_t red_mean = calculate_mean(red, *len);
-        uint32_t ir_mean = calculate_mean(ir, *len);
+        uint32_t red_mean = calculate_mean(red, *len);  // ir_mean is from the heart rate above
         uint32_t ac_red = find_max(red, *len) - find_min(red, *len);
         uint32_t ac_ir = find_max(ir, *len) - find_min(ir, *len);
         double ratio = (ac_red * 1.0 / red_mean) / (ac_ir * 1.0 / ir_mean);
@@ -183,6 +194,32 @@ int max30102_read_fifo(struct max30102_data *data, uint32_t *red, uint32_t *ir,
     return 0;
 }
 
+/**
+ * max30102_read_channels - Read every active channel of the last drain
+ * @data: MAX30102 device data
+ * @out: Filled with the layout tag and the samples
+ * Returns: 0 on success, negative error code on failure
+ */
+int max30102_read_channels(struct max30102_data *data, struct max30102_channel_data *out)
+{
+    unsigned long flags;
+    int ret, i;
+
+    if (!data || !out) return -EINVAL;
+
+    memset(out, 0, sizeof(*out));
+    ret = max30102_snapshot_take(data, &flags);
+    if (ret < 0) return ret;
+    out->mask = data->layout.mask;
+    out->channels = data->layout.channels;
+    memcpy(out->led, data->layout.led, sizeof(out->led));
+    out->len = data->data_len;
+    for (i = 0; i < out->len; i++)
+        memcpy(out->sample[i], data->samples[i], out->channels * sizeof(uint32_t));
+    spin_unlock_irqrestore(&fifo_spinlock, flags);
+    return 0;
+}
+
 /**
  * max30102_read_temperature - Read die temperature
  * @data: MAX30102 device data
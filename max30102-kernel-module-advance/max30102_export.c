@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "driver_max30102_arrow.h"
+#include "max30102_daemon.h"
+
+/*
+ * max30102_export - columnar export for analytics tools.
+ *
+ * Offline mode converts any number of recordings (driver_max30102_record
+ * files) into one Arrow IPC file, decoding the recordings on a pool of
+ * threads. Live mode subscribes to every sensor of max30102d and writes an
+ * Arrow IPC stream until interrupted, so `max30102_export --live -o - |
+ * python3 -c 'import pyarrow.ipc ...'` works without touching disk.
+ *
+ * Both modes share the schema in driver_max30102_arrow.h: UTC timestamp,
+ * dictionary-encoded device and config, uint32 Red and IR.
+ */
+
+#define LIVE_FLUSH_ROWS  4096  // Rows buffered per device before a record batch is written
+#define LIVE_FLUSH_MS    1000  // Longest a sample waits in the buffer
+
+struct live_device {
+    int dict;             // Device dictionary index, -1 if the daemon slot is empty
+    uint64_t last_ns;     // CLOCK_MONOTONIC of the previous batch, 0 before the first
+    uint32_t count;
+    int64_t ts[LIVE_FLUSH_ROWS];
+    uint32_t red[LIVE_FLUSH_ROWS];
+    uint32_t ir[LIVE_FLUSH_ROWS];
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int live_flush(max30102_arrow_t *w, struct live_device *d) {
+    if (d->count == 0)
+        return 0;
+    if (max30102_arrow_write(w, (uint16_t)d->dict, -1, d->ts, d->red, d->ir, d->count) != 0)
+        return -EIO;
+    d->count = 0;
+    return 0;
+}
+
+/*
+ * The daemon stamps each batch with the CLOCK_MONOTONIC time it was drained.
+ * Samples are spread evenly between the previous batch and this one, then
+ * moved to UTC with an offset taken once at startup.
+ */
+static int live_append(max30102_arrow_t *w, struct live_device *d, const struct max30102_daemon_batch *b,
+                       const uint32_t *red, const uint32_t *ir, int64_t utc_offset) {
+    uint64_t span = d->last_ns ? b->timestamp_ns - d->last_ns : 0;
+    uint32_t i;
+
+    for (i = 0; i < b->count; i++) {
+        if (d->count == LIVE_FLUSH_ROWS && live_flush(w, d) < 0)
+            return -EIO;
+        d->ts[d->count] = (int64_t)(b->timestamp_ns - span + span * (i + 1) / b->count) + utc_offset;
+        d->red[d->count] = red[i];
+        d->ir[d->count] = ir[i];
+        d->count++;
+    }
+    d->last_ns = b->timestamp_ns;
+    return 0;
+}
+
+static int run_live(const char *output, const char *socket_path, unsigned int seconds) {
+    static struct live_device devices[MAX30102_DAEMON_MAX_DEVICES];
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct max30102_daemon_list list;
+    struct max30102_daemon_req req = { .op = MAX30102_OP_LIST };
+    const char *names[MAX30102_DAEMON_MAX_DEVICES];
+    uint8_t buf[sizeof(struct max30102_daemon_batch) + 2 * 32 * sizeof(uint32_t)];
+    max30102_arrow_t w;
+    int64_t utc_offset;
+    uint64_t deadline, next_flush;
+    uint16_t count = 0;
+    int fd, i, ret = 0;
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Cannot connect to %s: %s\n", socket_path, strerror(errno));
+        close(fd);
+        return 1;
+    }
+    if (send(fd, &req, sizeof(req), 0) != sizeof(req) || recv(fd, &list, sizeof(list), 0) != sizeof(list)) {
+        fprintf(stderr, "Device list failed\n");
+        close(fd);
+        return 1;
+    }
+
+    for (i = 0; i < MAX30102_DAEMON_MAX_DEVICES; i++) {
+        devices[i].dict = -1;
+        if (i >= list.count || list.names[i][0] == '\0')
+            continue;
+        list.names[i][sizeof(list.names[i]) - 1] = '\0';
+        names[count] = list.names[i];
+        devices[i].dict = count++;
+        req.op = MAX30102_OP_SUBSCRIBE;
+        req.device = i;
+        req.channels = MAX30102_CH_RED | MAX30102_CH_IR;
+        if (send(fd, &req, sizeof(req), 0) != sizeof(req)) {
+            perror("subscribe");
+            close(fd);
+            return 1;
+        }
+    }
+    if (count == 0) {
+        fprintf(stderr, "No sensors attached to max30102d\n");
+        close(fd);
+        return 1;
+    }
+    // Live data carries no register snapshot, so the config column stays null
+    if (max30102_arrow_open(&w, output, MAX30102_ARROW_FORMAT_STREAM, names, count, NULL, 0) != 0) {
+        fprintf(stderr, "Cannot create %s\n", output);
+        close(fd);
+        return 1;
+    }
+
+    utc_offset = (int64_t)(clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC));
+    deadline = seconds ? clock_ns(CLOCK_MONOTONIC) + seconds * 1000000000ULL : 0;
+    next_flush = clock_ns(CLOCK_MONOTONIC) + LIVE_FLUSH_MS * 1000000ULL;
+    while (running) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        uint64_t now = clock_ns(CLOCK_MONOTONIC);
+        int n;
+
+        if (deadline && now >= deadline)
+            break;
+        if (now >= next_flush) {
+            for (i = 0; i < MAX30102_DAEMON_MAX_DEVICES && ret == 0; i++)
+                ret = live_flush(&w, &devices[i]);
+            next_flush = now + LIVE_FLUSH_MS * 1000000ULL;
+        }
+        if (ret < 0)
+            break;
+        n = poll(&pfd, 1, (int)((next_flush - now) / 1000000) + 1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            ret = -errno;
+            break;
+        }
+        if (n == 0)
+            continue;
+
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len <= 0) {
+            if (len < 0 && errno == EINTR)
+                continue;
+            fprintf(stderr, "max30102d closed the connection\n");
+            break;
+        }
+
+        const struct max30102_daemon_batch *b = (const struct max30102_daemon_batch *)buf;
+        const uint32_t *red = (const uint32_t *)(b + 1);
+        if ((size_t)len < sizeof(*b) || b->device >= MAX30102_DAEMON_MAX_DEVICES || devices[b->device].dict < 0 ||
+            b->channels != (MAX30102_CH_RED | MAX30102_CH_IR) || b->count == 0 ||
+            (size_t)len != sizeof(*b) + 2 * b->count * sizeof(uint32_t))
+            continue;  // Temperature or malformed message
+        if (b->dropped)
+            fprintf(stderr, "%s: %u batches dropped by max30102d\n", names[devices[b->device].dict], b->dropped);
+        ret = live_append(&w, &devices[b->device], b, red, red + b->count, utc_offset);
+        if (ret < 0)
+            break;
+    }
+
+    for (i = 0; i < MAX30102_DAEMON_MAX_DEVICES && ret == 0; i++)
+        ret = live_flush(&w, &devices[i]);
+    if (ret < 0)
+        fprintf(stderr, "Write to %s failed\n", output);
+    fprintf(stderr, "%llu rows\n", (unsigned long long)w.rows);
+    if (max30102_arrow_close(&w) != 0)
+        ret = -EIO;
+    close(fd);
+    return ret < 0 ? 1 : 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s -o <out.arrow> [-j <threads>] <recording>...\n"
+                    "       %s --live -o <out.arrows | -> [--seconds=<n>] [--socket=<path>]\n", prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+    struct sigaction sa = { .sa_handler = signal_handler };
+    const char *output = NULL;
+    const char *socket_path = MAX30102_DAEMON_SOCKET;
+    const char **inputs;
+    unsigned int threads = 0, seconds = 0;
+    uint32_t count = 0;
+    uint64_t rows = 0;
+    struct timespec t0, t1;
+    int live = 0, i;
+    uint8_t res;
+
+    inputs = calloc(argc, sizeof(*inputs));
+    if (!inputs)
+        return 1;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--live") == 0) {
+            live = 1;
+        } else if (strncmp(argv[i], "--seconds=", 10) == 0) {
+            seconds = strtoul(argv[i] + 10, NULL, 10);
+        } else if (strncmp(argv[i], "--socket=", 9) == 0) {
+            socket_path = argv[i] + 9;
+        } else if (argv[i][0] != '-') {
+            inputs[count++] = argv[i];
+        } else {
+            usage(argv[0]);
+            free(inputs);
+            return 1;
+        }
+    }
+    if (!output || (live ? count != 0 : count == 0)) {
+        usage(argv[0]);
+        free(inputs);
+        return 1;
+    }
+
+    if (live) {
+        free(inputs);
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        signal(SIGPIPE, SIG_IGN);  // A closed consumer shows up as a write error
+        return run_live(output, socket_path, seconds);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    res = max30102_arrow_export(inputs, count, output, threads, &rows);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    free(inputs);
+    if (res != 0) {
+        fprintf(stderr, "Export failed: %s\n", res == 3 ? "invalid recording" : "I/O error");
+        return 1;
+    }
+    fprintf(stderr, "%llu rows from %u recordings in %.2f s\n", (unsigned long long)rows, count,
+            (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include <linux/fs.h>
+#include <linux/gfp.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/property.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+#include "max30102.h"
+
+/*
+ * Sample history for positional reads.
+ *
+ * Every drained sample gets a sequence number, counted from probe, and the
+ * last window samples are kept in a ring whether or not anyone reads them.
+ * A file switched to history mode with MAX30102_IOC_SET_HISTORY reads the
+ * ring instead of taking FIFO batches: the offset of sample n is
+ * n * sizeof(struct max30102_sample). A consumer that restarted or stalled
+ * preads exactly the range it missed, read() follows the stream from the
+ * file position without losing samples while it stays inside the window.
+ * Evicted samples return -ERANGE, samples not drained yet block like read().
+ */
+
+#define MAX30102_HISTORY_DEFAULT    1024       // About 10 s at 100 sps
+#define MAX30102_HISTORY_MAX        (1 << 20)  // 32 MB of samples
+
+/**
+ * max30102_history_init - Allocate the window from maxim,history-samples
+ * @data: MAX30102 device data
+ * Returns: 0 on success, negative error code on failure
+ */
+int max30102_history_init(struct max30102_data *data)
+{
+    u32 window = MAX30102_HISTORY_DEFAULT;
+
+    spin_lock_init(&data->history.lock);
+    device_property_read_u32(&data->client->dev, "maxim,history-samples", &window);
+    return max30102_history_resize(data, window);
+}
+
+/**
+ * max30102_history_free - Free the window
+ * @data: MAX30102 device data
+ */
+void max30102_history_free(struct max30102_data *data)
+{
+    kvfree(data->history.ring);
+    data->history.ring = NULL;
+    data->history.window = 0;
+}
+
+/**
+ * max30102_history_resize - Replace the window, dropping the samples held
+ * @data: MAX30102 device data
+ * @window: Samples to keep, rounded up to a power of two, 0 keeps none
+ * Returns: 0 on success, negative error code on failure
+ *
+ * Sequence numbers carry on, so offsets stay valid across a resize.
+ */
+int max30102_history_resize(struct max30102_data *data, u32 window)
+{
+    struct max30102_history *h = &data->history;
+    struct max30102_sample *ring = NULL, *old;
+
+    if (window > MAX30102_HISTORY_MAX) return -EINVAL;
+    if (window) {
+        window = roundup_pow_of_two(window);
+        ring = kvcalloc(window, sizeof(*ring), GFP_KERNEL);
+        if (!ring) return -ENOMEM;
+    }
+
+    spin_lock(&h->lock);
+    old = h->ring;
+    h->ring = ring;
+    h->window = window;
+    h->first = h->next;
+    spin_unlock(&h->lock);
+    kvfree(old);
+    return 0;
+}
+
+/**
+ * max30102_history_append - Number and keep the samples of a drain
+ * @data: MAX30102 device data
+ * @layout: Layout the samples were drained with
+ * @samples: Decoded samples
+ * @len: Number of samples
+ * Returns: Sequence number of the first sample
+ */
+u64 max30102_history_append(struct max30102_data *data, const struct max30102_layout *layout,
+                            uint32_t (*samples)[MAX30102_MAX_CHANNELS], uint8_t len)
+{
+    struct max30102_history *h = &data->history;
+    struct max30102_sample *s;
+    u64 now = ktime_get_ns(), seq;
+    int i;
+
+    spin_lock(&h->lock);
+    seq = h->next;
+    for (i = 0; i < len; i++, h->next++) {
+        if (!h->window) continue;  // Numbered all the same
+        s = &h->ring[h->next & (h->window - 1)];
+        s->timestamp_ns = now;
+        memcpy(s->value, samples[i], sizeof(s->value));
+        s->mask = layout->mask;
+        s->channels = layout->channels;
+        memcpy(s->led, layout->led, sizeof(s->led));
+    }
+    if (h->next - h->first > h->window)
+        h->first = h->next - h->window;
+    spin_unlock(&h->lock);
+    return seq;
+}
+
+/**
+ * max30102_history_ready - Check whether a read at an offset would not block
+ * @data: MAX30102 device data
+ * @pos: File offset
+ * Returns: true once the sample at @pos was drained or has been evicted
+ */
+bool max30102_history_ready(struct max30102_data *data, loff_t pos)
+{
+    struct max30102_history *h = &data->history;
+    bool ready;
+
+    spin_lock(&h->lock);
+    ready = div_u64(pos, sizeof(struct max30102_sample)) < h->next;
+    spin_unlock(&h->lock);
+    return ready;
+}
+
+/**
+ * max30102_history_read - Copy samples from the window at the file offset
+ * @data: MAX30102 device data
+ * @iocb: I/O control block, ki_pos is the offset and is advanced
+ * @to: Destination
+ * @nonblock: Return -EAGAIN instead of waiting for the first sample
+ * Returns: Bytes copied, -ERANGE if the first sample has been evicted,
+ *          negative error code on failure
+ *
+ * Copies whole samples, up to the newest one drained. Samples are staged in
+ * a page under the lock, so a fault in the destination never holds up the
+ * drain.
+ */
+ssize_t max30102_history_read(struct max30102_data *data, struct kiocb *iocb, struct iov_iter *to, bool nonblock)
+{
+    struct max30102_history *h = &data->history;
+    struct max30102_sample *page;
+    size_t count = iov_iter_count(to) / sizeof(*page), done = 0, n, i;
+    size_t bytes;
+    u32 rem;
+    u64 seq;
+    ssize_t ret = 0;
+
+    if (iocb->ki_pos < 0 || !count) return -EINVAL;
+    seq = div_u64_rem(iocb->ki_pos, sizeof(*page), &rem);
+    if (rem) return -EINVAL;  // Offsets fall on sample boundaries
+
+    if (nonblock) {
+        if (!max30102_history_ready(data, iocb->ki_pos)) return -EAGAIN;
+    } else {
+        ret = wait_event_interruptible(data->wait_data_ready, max30102_history_ready(data, iocb->ki_pos));
+        if (ret < 0) return ret;
+    }
+
+    page = (struct max30102_sample *)__get_free_page(GFP_KERNEL);
+    if (!page) return -ENOMEM;
+
+    while (done < count) {
+        spin_lock(&h->lock);
+        if (seq < h->first) {
+            spin_unlock(&h->lock);
+            ret = -ERANGE;
+            break;
+        }
+        n = min_t(u64, count - done, h->next - seq);
+        n = min_t(size_t, n, PAGE_SIZE / sizeof(*page));
+        for (i = 0; i < n; i++)
+            page[i] = h->ring[(seq + i) & (h->window - 1)];
+        spin_unlock(&h->lock);
+        if (!n) break;  // Caught up with the drain
+
+        bytes = n * sizeof(*page);
+        if (copy_to_iter(page, bytes, to) != bytes) {
+            ret = -EFAULT;
+            break;
+        }
+        seq += n;
+        done += n;
+    }
+    free_page((unsigned long)page);
+
+    if (!done) return ret;
+    iocb->ki_pos += done * sizeof(*page);
+    return done * sizeof(*page);
+}
+
+/**
+ * max30102_history_info - Report the sequence numbers the window holds
+ * @data: MAX30102 device data
+ * @info: Filled in
+ */
+void max30102_history_info(struct max30102_data *data, struct max30102_history_info *info)
+{
+    struct max30102_history *h = &data->history;
+
+    spin_lock(&h->lock);
+    info->first = h->first;
+    info->next = h->next;
+    info->window = h->window;
+    spin_unlock(&h->lock);
+    info->sample_size = sizeof(struct max30102_sample);
+}
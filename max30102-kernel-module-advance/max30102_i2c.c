@@ -1,6 +1,105 @@
 #include <linux/i2c.h>
+#include <linux/delay.h>
 #include "max30102.h"
 
+/*
+ * Failed transfers are classified instead of retried blindly, because the
+ * work handler holds data->lock for the whole drain:
+ * - Lost arbitration (-EAGAIN) and a busy bus (-EBUSY) are transient. They
+ *   are retried with an exponential backoff in microseconds.
+ * - A NAK (-ENXIO on the address, -EREMOTEIO on data) means the sensor is
+ *   absent, in reset or unpowered. Retrying only stalls the drain, so the
+ *   transfer fails at once.
+ * - Timeouts usually come from a slave holding SDA low. After several in a
+ *   row, the root adapter's bus recovery clocks it free and the transfer is
+ *   retried once.
+ * A drain therefore loses at most about 1 ms to retries, plus one adapter
+ * timeout when the bus is stuck.
+ */
+
+#define MAX30102_I2C_ATTEMPTS       4    // Tries for transient errors
+#define MAX30102_I2C_BACKOFF_US     50   // First backoff, doubled per retry: 50, 100, 200 us
+#define MAX30102_I2C_RECOVER_AFTER  3    // Consecutive timeouts before bus recovery
+
+/**
+ * max30102_recover_bus - Run bus recovery on the root adapter
+ * @data: MAX30102 device data
+ * Returns: 0 on success, negative error code if the adapter cannot recover
+ */
+static int max30102_recover_bus(struct max30102_data *data)
+{
+    struct i2c_adapter *root = i2c_root_adapter(&data->client->adapter->dev);  // Muxes have no recovery info
+    int ret;
+
+    if (!root || !root->bus_recovery_info)
+        return -EOPNOTSUPP;
+    i2c_lock_bus(root, I2C_LOCK_ROOT_ADAPTER);
+    ret = i2c_recover_bus(root);
+    i2c_unlock_bus(root, I2C_LOCK_ROOT_ADAPTER);
+    if (ret == 0)
+        atomic_inc(&data->i2c_stats.recoveries);
+    dev_warn(&data->client->dev, "I2C bus recovery after %d timeouts: %d\n", MAX30102_I2C_RECOVER_AFTER, ret);
+    return ret;
+}
+
+/**
+ * max30102_transfer - Run an I2C transfer with classified retries
+ * @data: MAX30102 device data
+ * @msgs: Messages
+ * @num: Number of messages
+ * @reg: Register address, for the error message
+ * @len: Payload length, for the error message
+ * Returns: 0 on success, negative error code on failure
+ */
+static int max30102_transfer(struct max30102_data *data, struct i2c_msg *msgs, int num, uint8_t reg, uint16_t len)
+{
+    struct max30102_i2c_stats *st = &data->i2c_stats;
+    unsigned int backoff = MAX30102_I2C_BACKOFF_US;
+    bool recovered = false;
+    int attempt = 0, ret;
+
+    atomic_inc(&st->transfers);
+    for (;;) {
+        ret = i2c_transfer(data->client->adapter, msgs, num);
+        if (ret == num) {
+            atomic_set(&st->timeouts_in_row, 0);
+            return 0;
+        }
+        if (ret >= 0) ret = -EIO;  // Short transfer
+
+        switch (ret) {
+        case -EAGAIN:
+        case -EBUSY:
+            atomic_inc(&st->retries);
+            if (++attempt >= MAX30102_I2C_ATTEMPTS) goto fail;
+            usleep_range(backoff, backoff * 2);
+            backoff *= 2;
+            continue;
+        case -ENXIO:
+        case -EREMOTEIO:
+            atomic_inc(&st->naks);
+            goto fail;
+        case -ETIMEDOUT:
+            atomic_inc(&st->timeouts);
+            if (!recovered && atomic_inc_return(&st->timeouts_in_row) >= MAX30102_I2C_RECOVER_AFTER) {
+                recovered = true;
+                atomic_set(&st->timeouts_in_row, 0);
+                if (max30102_recover_bus(data) == 0) continue;
+            }
+            goto fail;
+        default:
+            atomic_inc(&st->other);
+            goto fail;
+        }
+    }
+
+fail:
+    atomic_inc(&st->failures);
+    dev_err_ratelimited(&data->client->dev, "I2C %s failed: reg=0x%02x, len=%d, error=%d\n",
+                        (msgs[num - 1].flags & I2C_M_RD) ? "read" : "write", reg, len, ret);
+    return ret;
+}
+
 /**
  * max30102_write_reg - Write to MAX30102 register via I2C
  * @data: MAX30102 device data
@@ -13,7 +112,7 @@ int max30102_write_reg(struct max30102_data *data, uint8_t reg, uint8_t *buf, ui
 {
     struct i2c_msg msg;
     uint8_t *send_buf;  // Dynamic alloc for flexibility
-    int ret, retry = 3;  // Added retry for I2C errors (best practice)
+    int ret;
 
     if (!data || !buf) return -EINVAL;
     if (len > 32) {
@@ -32,18 +131,7 @@ int max30102_write_reg(struct max30102_data *data, uint8_t reg, uint8_t *buf, ui
     msg.buf = send_buf;
     msg.len = len + 1;
 
-    do {
-        ret = i2c_transfer(data->client->adapter, &msg, 1);
-        if (ret == 1) break;
-        msleep(10);
-    } while (--retry > 0);
-
-    if (ret != 1) {
-        dev_err(&data->client->dev, "I2C write failed after retries: reg=0x%02x, len=%d, error=%d\n", reg, len, ret);
-        ret = ret < 0 ? ret : -EIO;
-    } else {
-        ret = 0;
-    }
+    ret = max30102_transfer(data, &msg, 1, reg, len);
 
     kfree(send_buf);
     return ret;
@@ -60,7 +148,6 @@ int max30102_write_reg(struct max30102_data *data, uint8_t reg, uint8_t *buf, ui
 int max30102_read_reg(struct max30102_data *data, uint8_t reg, uint8_t *buf, uint16_t len)
 {
     struct i2c_msg msgs[2];
-    int ret, retry = 3;
 
     if (!data || !buf) return -EINVAL;
     if (len > 32) {
@@ -78,18 +165,76 @@ int max30102_read_reg(struct max30102_data *data, uint8_t reg, uint8_t *buf, uin
     msgs[1].buf = buf;
     msgs[1].len = len;
 
-    do {
-        ret = i2c_transfer(data->client->adapter, msgs, 2);
-        if (ret == 2) break;
-        msleep(10);
-    } while (--retry > 0);
-
-    if (ret != 2) {
-        dev_err(&data->client->dev, "I2C read failed after retries: reg=0x%02x, len=%d, error=%d\n", reg, len, ret);
-        ret = ret < 0 ? ret : -EIO;
-    } else {
-        ret = 0;
+    return max30102_transfer(data, msgs, 2, reg, len);
+}
+
+/**
+ * max30102_fifo_read_max - Longest FIFO data read the adapter takes at once
+ * @data: MAX30102 device data
+ * Returns: Byte limit, 0 if there is none
+ *
+ * The read is a register write and a read with a repeated start. Adapters
+ * that take it as one combined transfer limit the second message, the others
+ * limit every read message.
+ */
+static u16 max30102_fifo_read_max(struct max30102_data *data)
+{
+    const struct i2c_adapter_quirks *q = data->client->adapter->quirks;
+
+    if (!q) return 0;
+    if (q->flags & I2C_AQ_COMB) return q->max_comb_2nd_msg_len;
+    return q->max_read_len;
+}
+
+/**
+ * max30102_read_fifo_data - Burst read samples from the FIFO data register
+ * @data: MAX30102 device data
+ * @buf: Buffer for len * sample_bytes bytes
+ * @len: Number of samples, up to 32
+ * @sample_bytes: Bytes per sample, three per active slot
+ * Returns: 0 on success, negative error code on failure
+ *
+ * A full FIFO is up to 384 bytes, more than max30102_read_reg takes. It is
+ * read in one transfer when the adapter allows it. Otherwise it is split to
+ * fit the adapter's read limit, at sample boundaries: the read pointer only
+ * moves on whole samples, and each transfer starts over at FIFO_DATA.
+ */
+int max30102_read_fifo_data(struct max30102_data *data, uint8_t *buf, uint8_t len, uint8_t sample_bytes)
+{
+    uint8_t reg = MAX30102_REG_FIFO_DATA;
+    struct i2c_msg msgs[2];
+    uint16_t bytes = len * sample_bytes, chunk, max;
+    int ret;
+
+    if (!data || !buf || !sample_bytes || len > MAX30102_FIFO_DEPTH) return -EINVAL;
+
+    chunk = bytes;
+    max = max30102_fifo_read_max(data);
+    if (max && max < bytes) {
+        chunk = max - max % sample_bytes;
+        if (!chunk) {
+            dev_err_ratelimited(&data->client->dev, "Adapter reads at most %u bytes, a sample is %u\n",
+                                max, sample_bytes);
+            return -EOPNOTSUPP;
+        }
+        atomic_inc(&data->i2c_stats.split_reads);
     }
 
-    return ret;
-}
\ No newline at end of file
+    msgs[0].addr = data->client->addr;
+    msgs[0].flags = 0;
+    msgs[0].buf = &reg;
+    msgs[0].len = 1;
+
+    msgs[1].addr = data->client->addr;
+    msgs[1].flags = I2C_M_RD;
+
+    while (bytes) {
+        msgs[1].buf = buf;
+        msgs[1].len = min(chunk, bytes);
+        ret = max30102_transfer(data, msgs, 2, reg, msgs[1].len);
+        if (ret < 0) return ret;
+        buf += msgs[1].len;
+        bytes -= msgs[1].len;
+    }
+    return 0;
+}
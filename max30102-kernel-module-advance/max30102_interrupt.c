@@ -2,20 +2,42 @@
 #include "max30102.h"
 
 /**
- * max30102_work_handler - Workqueue handler for interrupt processing
- * @work: Work structure
+ * max30102_drain - Interrupt processing, run by the bus drain scheduler
+ * @data: MAX30102 device data
+ *
+ * Also runs from the poll timer when the board has no INT pin. The status
+ * registers are skipped then, the FIFO pointers decide what to drain, and the
+ * timer is re-armed from the observed fill level.
+ *
+ * The scheduler's work is shared by every sensor on the bus, so it must not
+ * sleep on one sensor's lock while an ioctl holds it across I2C or the
+ * temperature poll. If the lock is taken, the drain is left to the holder,
+ * which kicks it again from max30102_unlock().
  */
-void max30102_work_handler(struct work_struct *work)
+void max30102_drain(struct max30102_data *data)
 {
-    struct max30102_data *data = container_of(work, struct max30102_data, work);
-    uint8_t status1 = 0, status2 = 0, write_ptr = 0, read_ptr = 0;
+    uint8_t status1 = 0, status2 = 0, write_ptr, read_ptr, ovf = 0, ptrs[3];
     uint8_t len = 0;
-    uint8_t *fifo_data = NULL;
-    int ret, i;
+    struct max30102_layout layout;
+    int produced = -1, drained = 0;
+    u64 seq;
+    int ret = 0;
 
     if (!data) return;
+    if (!completion_done(&data->ready)) return;  // Bring-up owns the bus, it re-checks when done
 
-    mutex_lock(&data->lock);
+    atomic_xchg(&data->drain_deferred, 1);  // Ordered before the trylock, see max30102_unlock()
+    if (!mutex_trylock(&data->lock)) return;
+    atomic_set(&data->drain_deferred, 0);
+
+    if (data->polling) {
+        if (READ_ONCE(data->poll_stale)) {
+            ret = max30102_poll_configure(data);
+            if (ret < 0)
+                dev_err(&data->client->dev, "Failed to read poll config: %d\n", ret);
+        }
+        goto drain;  // No status to clear, the FIFO pointers decide
+    }
 
     ret = max30102_read_reg(data, MAX30102_REG_INTERRUPT_STATUS_1, &status1, 1);
     if (ret < 0) {
@@ -30,48 +52,56 @@ void max30102_work_handler(struct work_struct *work)
 
     // Clear status by reading (as per datasheet, status clears on read)
 
-    if (status1 & (1 << MAX30102_INT_FIFO_FULL)) {
-        ret = max30102_read_reg(data, MAX30102_REG_FIFO_WRITE_POINTER, &write_ptr, 1);
-        if (ret < 0) {
-            dev_err(&data->client->dev, "Failed to read write pointer: %d\n", ret);
-            goto unlock;
-        }
-        ret = max30102_read_reg(data, MAX30102_REG_FIFO_READ_POINTER, &read_ptr, 1);
+drain:
+    // A QoS latency below the lowest watermark drains on every PPG_RDY, see max30102_qos.c
+    if (data->polling || (status1 & (1 << MAX30102_INT_FIFO_FULL)) ||
+        (data->qos_irq && (status1 & (1 << MAX30102_INT_PPG_RDY)))) {
+        // Write pointer, overflow counter and read pointer are adjacent, one transfer reads them
+        ret = max30102_read_reg(data, MAX30102_REG_FIFO_WRITE_POINTER, ptrs, sizeof(ptrs));
         if (ret < 0) {
-            dev_err(&data->client->dev, "Failed to read read pointer: %d\n", ret);
+            dev_err(&data->client->dev, "Failed to read FIFO pointers: %d\n", ret);
             goto unlock;
         }
+        write_ptr = ptrs[0];
+        ovf = ptrs[1];
+        read_ptr = ptrs[2];
 
-        len = (write_ptr - read_ptr + 32) % 32;  // Improved calculation from datasheet
-        if (len == 0 || len > 32) {
-            dev_err(&data->client->dev, "Invalid FIFO length: %d\n", len);
-            goto unlock;
-        }
+        // Equal pointers are an empty or a full FIFO. Lost samples, or A_FULL
+        // latched with the watermark unread, mean it is full.
+        len = (write_ptr - read_ptr) & (MAX30102_FIFO_DEPTH - 1);
+        if (len == 0 && (ovf || (status1 & (1 << MAX30102_INT_FIFO_FULL)) ||
+                         (data->polling && max30102_poll_expected(data) > 16)))
+            len = MAX30102_FIFO_DEPTH;
+        if (ovf)
+            dev_warn_ratelimited(&data->client->dev, "FIFO overflow: %d samples lost\n", ovf);
+        if (data->polling)
+            produced = len + ovf;
+        if (len == 0)
+            goto unlock;  // Early poll, nothing to drain
 
-        fifo_data = kmalloc(len * 6, GFP_KERNEL);
-        if (!fifo_data) {
-            dev_err(&data->client->dev, "Failed to allocate FIFO buffer\n");
+        // Only the active slots are in the FIFO, three bytes each
+        max30102_profile_layout(&data->profile, &layout);
+        if (!layout.channels) {
+            dev_warn_ratelimited(&data->client->dev, "No active slot, FIFO not drained\n");
             goto unlock;
         }
 
-        ret = max30102_read_reg(data, MAX30102_REG_FIFO_DATA, fifo_data, len * 6);
+        ret = max30102_read_fifo_data(data, data->fifo_buf, len, layout.channels * 3);
         if (ret < 0) {
             dev_err(&data->client->dev, "Failed to read FIFO data: %d\n", ret);
-            goto free_fifo;
+            goto unlock;
         }
 
-        for (i = 0; i < len; i++) {
-            data->red_data[i] = (fifo_data[i*6] << 10) | (fifo_data[i*6+1] << 2) | (fifo_data[i*6+2] >> 6);  // 18-bit shift from datasheet
-            data->ir_data[i] = (fifo_data[i*6+3] << 10) | (fifo_data[i*6+4] << 2) | (fifo_data[i*6+5] >> 6);
-        }
-        data->data_len = len;
-        data->fifo_full = true;
-        wake_up_interruptible(&data->wait_data_ready);  // Wake blocking read
-        dev_info(&data->client->dev, "FIFO full: %d samples read\n", len);
+        max30102_publish(data, &layout, data->fifo_buf, len);  // Only the drain writes the samples
+        seq = max30102_history_append(data, &layout, data->samples, len);
+        max30102_reduce_feed(data, &layout, data->samples, len, seq);
+        drained = len;
+        wake_up_interruptible(&data->wait_data_ready);  // Wake blocking and history reads
+        dev_dbg(&data->client->dev, "FIFO drained: %d samples read\n", len);
     }
 
     if (status1 & (1 << MAX30102_INT_PPG_RDY))
-        dev_info(&data->client->dev, "PPG ready interrupt\n");
+        dev_dbg(&data->client->dev, "PPG ready interrupt\n");  // One per sample
     if (status1 & (1 << MAX30102_INT_ALC_OVF))
         dev_warn(&data->client->dev, "ALC overflow interrupt - adjust LED current\n");
     if (status1 & (1 << MAX30102_INT_PWR_RDY))
@@ -79,10 +109,26 @@ void max30102_work_handler(struct work_struct *work)
     if (status2 & (1 << MAX30102_INT_DIE_TEMP_RDY))
         dev_info(&data->client->dev, "Die temperature ready interrupt\n");
 
-free_fifo:
-    kfree(fifo_data);
 unlock:
+    max30102_mitigate_update(data, ret < 0 ? -1 : drained);  // May switch between interrupts and polling
+    mutex_unlock(&data->lock);
+    if (data->polling)
+        max30102_poll_rearm(data, produced, ovf);
+}
+
+/**
+ * max30102_unlock - Release data->lock and run a drain it held off
+ * @data: MAX30102 device data
+ *
+ * Every holder of data->lock other than the drain releases it here. A drain
+ * that failed its trylock flagged itself before trying, so either it got the
+ * lock after all or the flag is seen after the unlock.
+ */
+void max30102_unlock(struct max30102_data *data)
+{
     mutex_unlock(&data->lock);
+    if (atomic_xchg(&data->drain_deferred, 0))
+        max30102_sched_kick(data);
 }
 
 /**
@@ -95,6 +141,7 @@ irqreturn_t max30102_irq_handler(int irq, void *dev_id)
 {
     struct max30102_data *data = dev_id;
     if (!data) return IRQ_NONE;
-    schedule_work(&data->work);
+    atomic_inc(&data->irqs);  // Interrupts per sample, see max30102_mitigate.c
+    max30102_sched_kick(data);
     return IRQ_HANDLED;
 }
\ No newline at end of file
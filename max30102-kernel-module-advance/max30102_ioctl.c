@@ -1,5 +1,6 @@
 #include <linux/uaccess.h>
 #include <linux/compat.h>  // Added for compat_ioctl
+#include <linux/slab.h>
 #include "max30102.h"
 
 /**
@@ -8,25 +9,48 @@
  * @file: File structure
  * Returns: 0 on success, negative error code on failure
  */
-static int max30102_open(struct inode *inode, struct file *file)
+int max30102_open(struct inode *inode, struct file *file)
 {
     struct miscdevice *miscdev = file->private_data;
     struct max30102_data *data = container_of(miscdev, struct max30102_data, miscdev);
-    int ret;
+    struct max30102_file *mf;
 
     if (!data) {
         return -EINVAL;
     }
-    file->private_data = data;
-    ret = init_waitqueue_head(&data->wait_data_ready);  // Init wait queue
-    if (ret < 0) {
-        dev_err(&data->client->dev, "Failed to init waitqueue: %d\n", ret);
-        return ret;
+    mf = kzalloc(sizeof(*mf), GFP_KERNEL);
+    if (!mf) {
+        return -ENOMEM;
     }
+    mf->data = data;
+    INIT_LIST_HEAD(&mf->qos_node);
+    file->f_mode |= FMODE_NOWAIT;  // read_iter honours IOCB_NOWAIT, io_uring polls instead of punting to a worker
+    file->private_data = mf;  // Bring-up may still be running, reads and ioctls wait for it
     dev_info(&data->client->dev, "Device opened by process %d\n", current->pid);  // Process management
     return 0;
 }
 
+/**
+ * max30102_release - Release function for device file
+ * @inode: Inode structure
+ * @file: File structure
+ * Returns: 0
+ */
+int max30102_release(struct inode *inode, struct file *file)
+{
+    struct max30102_file *mf = file->private_data;
+
+    if (mf->reducer || !list_empty(&mf->qos_node)) {
+        mutex_lock(&mf->data->lock);  // Off the lists before the drain can see it freed
+        if (mf->reducer)
+            max30102_reduce_release(mf);
+        max30102_qos_release(mf);  // The remaining requests choose again
+        mutex_unlock(&mf->data->lock);
+    }
+    kfree(mf);
+    return 0;
+}
+
 /**
  * max30102_ioctl - IOCTL handler for user-space interaction
  * @file: File structure
@@ -34,11 +58,16 @@ static int max30102_open(struct inode *inode, struct file *file)
  * @arg: Argument from user space
  * Returns: 0 on success, negative error code on failure
  */
-static long max30102_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+long max30102_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
-    struct max30102_data *data = file->private_data;
+    struct max30102_file *mf = file->private_data;
+    struct max30102_data *data = mf->data;
+    struct max30102_history_info history = {0};
     struct max30102_fifo_data fifo_data = {0};
     struct max30102_slot_config slot_config = {0};
+    struct max30102_channel_data *channels = NULL;
+    struct max30102_reduce_config reduce;
+    struct max30102_qos qos;
     uint8_t mode = 0, config = 0;
     float temp = 0.0f;
     int ret = 0;
@@ -47,6 +76,11 @@ static long max30102_ioctl(struct file *file, unsigned int cmd, unsigned long ar
         return -EINVAL;
     }
 
+    // Settings made before bring-up finishes would be overwritten by it
+    ret = max30102_wait_ready(data, file->f_flags & O_NONBLOCK);
+    if (ret < 0)
+        return ret;
+
     mutex_lock(&data->lock);
 
     switch (cmd) {
@@ -63,6 +97,24 @@ static long max30102_ioctl(struct file *file, unsigned int cmd, unsigned long ar
         }
         break;
 
+    case MAX30102_IOC_READ_CHANNELS:
+        channels = kmalloc(sizeof(*channels), GFP_KERNEL);  // Too big for the stack next to fifo_data
+        if (!channels) {
+            ret = -ENOMEM;
+            goto unlock;
+        }
+        ret = max30102_read_channels(data, channels);
+        if (ret < 0) {
+            dev_err(&data->client->dev, "Failed to read channels: %d\n", ret);
+            goto unlock;
+        }
+        if (copy_to_user((void __user *)arg, channels, sizeof(*channels))) {
+            dev_err(&data->client->dev, "Failed to copy channel data to user\n");
+            ret = -EFAULT;
+            goto unlock;
+        }
+        break;
+
     case MAX30102_IOC_READ_TEMP:
         ret = max30102_read_temperature(data, &temp);
         if (ret < 0) {
@@ -113,6 +165,10 @@ static long max30102_ioctl(struct file *file, unsigned int cmd, unsigned long ar
             ret = -EFAULT;
             goto unlock;
         }
+        if (data->qos_active) {
+            ret = -EBUSY;  // QoS requests own averaging and watermark until the last one is cleared
+            goto unlock;
+        }
         ret = max30102_set_fifo_config(data, config);
         if (ret < 0) {
             dev_err(&data->client->dev, "Failed to set FIFO config: %d\n", ret);
@@ -131,6 +187,77 @@ static long max30102_ioctl(struct file *file, unsigned int cmd, unsigned long ar
             dev_err(&data->client->dev, "Failed to set SpO2 config: %d\n", ret);
             goto unlock;
         }
+        ret = max30102_qos_update(data);  // The sample rate changed under the requests
+        if (ret < 0) {
+            dev_err(&data->client->dev, "Failed to apply QoS: %d\n", ret);
+            goto unlock;
+        }
+        break;
+
+    case MAX30102_IOC_SET_HISTORY:
+        if (copy_from_user(&mode, (void __user *)arg, sizeof(mode))) {
+            dev_err(&data->client->dev, "Failed to copy history mode from user\n");
+            ret = -EFAULT;
+            goto unlock;
+        }
+        if (mode && max30102_reduce_active(mf)) {
+            ret = -EBUSY;  // One or the other, clear the reduction stage first
+            goto unlock;
+        }
+        mf->history = mode != 0;
+        if (mf->history) {
+            // read() follows the stream from the next sample drained
+            max30102_history_info(data, &history);
+            file->f_pos = history.next * sizeof(struct max30102_sample);
+        }
+        break;
+
+    case MAX30102_IOC_GET_HISTORY:
+        max30102_history_info(data, &history);
+        if (copy_to_user((void __user *)arg, &history, sizeof(history))) {
+            dev_err(&data->client->dev, "Failed to copy history info to user\n");
+            ret = -EFAULT;
+            goto unlock;
+        }
+        break;
+
+    case MAX30102_IOC_SET_REDUCE:
+        if (copy_from_user(&reduce, (void __user *)arg, sizeof(reduce))) {
+            dev_err(&data->client->dev, "Failed to copy reduction stage from user\n");
+            ret = -EFAULT;
+            goto unlock;
+        }
+        if (reduce.type != MAX30102_REDUCE_NONE && mf->history) {
+            ret = -EBUSY;
+            goto unlock;
+        }
+        ret = max30102_reduce_set(mf, &reduce);
+        if (ret < 0) {
+            dev_err(&data->client->dev, "Invalid reduction stage type=%d factor=%d\n", reduce.type, reduce.factor);
+            goto unlock;
+        }
+        break;
+
+    case MAX30102_IOC_SET_QOS:
+        if (copy_from_user(&qos, (void __user *)arg, sizeof(qos))) {
+            dev_err(&data->client->dev, "Failed to copy QoS request from user\n");
+            ret = -EFAULT;
+            goto unlock;
+        }
+        ret = max30102_qos_set(mf, &qos);
+        if (ret < 0) {
+            dev_err(&data->client->dev, "Failed to set QoS %u us, %u Hz: %d\n", qos.max_latency_us,
+                    qos.min_rate_hz, ret);
+            goto unlock;
+        }
+        break;
+
+    case MAX30102_IOC_GET_QOS:
+        if (copy_to_user((void __user *)arg, &data->qos_info, sizeof(data->qos_info))) {
+            dev_err(&data->client->dev, "Failed to copy QoS info to user\n");
+            ret = -EFAULT;
+            goto unlock;
+        }
         break;
 
     default:
@@ -140,7 +267,8 @@ static long max30102_ioctl(struct file *file, unsigned int cmd, unsigned long ar
     }
 
 unlock:
-    mutex_unlock(&data->lock);
+    max30102_unlock(data);
+    kfree(channels);
     return ret;
 }
 
@@ -151,7 +279,7 @@ unlock:
  * @arg: Argument from user space
  * Returns: 0 on success, negative error code on failure
  */
-static long max30102_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+long max30102_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
     return max30102_ioctl(file, cmd, arg);  // Same implementation as unlocked_ioctl
 }
\ No newline at end of file
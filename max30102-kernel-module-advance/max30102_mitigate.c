@@ -0,0 +1,239 @@
+#include <linux/interrupt.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/property.h>
+#include <linux/seq_file.h>
+#include "max30102.h"
+
+/*
+ * Interrupt mitigation for boards with the INT pin, after NAPI.
+ *
+ * With PPG_RDY enabled the sensor interrupts once per FIFO sample, so at
+ * 1000 sps every sample costs a hard interrupt, a drain and two status reads.
+ * The drain measures the interrupt rate over a window. Above
+ * maxim,irq-poll-above-hz it masks A_FULL and PPG_RDY on the chip, disables
+ * the IRQ and hands the sensor to the poll timer of max30102_poll.c, which
+ * drains just below the watermark at the rate the FIFO fills. While polling,
+ * the drain predicts the interrupt rate from the poll rate estimate. Once
+ * that falls below maxim,irq-poll-below-hz, it unmasks both and goes back to
+ * interrupts. The gap between the thresholds and a minimum of one window in
+ * each mode keep a rate near a threshold from flapping. A QoS request whose
+ * latency needs PPG_RDY keeps the sensor in interrupt mode (max30102_qos.c).
+ */
+
+#define MAX30102_MITIGATE_WINDOW_NS  (250 * NSEC_PER_MSEC)
+#define MAX30102_MITIGATE_ABOVE_HZ   500
+#define MAX30102_MITIGATE_BELOW_HZ   200
+#define MAX30102_MITIGATE_MASK       MAX30102_INT_ENABLE_FIFO_PPG  // A_FULL_EN and PPG_RDY_EN
+
+/**
+ * max30102_mitigate_account - Close the time of the current mode and restart the window
+ * @data: MAX30102 device data
+ * @now: Current time
+ */
+static void max30102_mitigate_account(struct max30102_data *data, ktime_t now)
+{
+    data->mitigate_ns[data->irq_masked] += ktime_to_ns(ktime_sub(now, data->mitigate_since));
+    data->mitigate_since = now;
+    data->mitigate_window = now;
+    data->mitigate_window_irqs = atomic_read(&data->irqs);
+}
+
+/**
+ * max30102_mitigate_enter - Mask the FIFO interrupts and start polling
+ * @data: MAX30102 device data, the caller holds the lock
+ * @now: Current time
+ * Returns: 0 on success, negative error code on failure
+ */
+static int max30102_mitigate_enter(struct max30102_data *data, ktime_t now)
+{
+    uint8_t enable;
+    int ret;
+
+    ret = max30102_poll_configure(data);
+    if (ret < 0) return ret;
+    ret = max30102_read_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, &enable, 1);
+    if (ret < 0) return ret;
+    data->mitigate_restore = enable & MAX30102_MITIGATE_MASK;
+    enable &= ~MAX30102_MITIGATE_MASK;
+    ret = max30102_write_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, &enable, 1);
+    if (ret < 0) return ret;
+
+    disable_irq(data->irq);  // An edge already taken only queues one more drain
+    max30102_mitigate_account(data, now);
+    data->irq_masked = true;
+    data->polling = true;
+    data->poll_last = 0;  // The first poll only starts the rate estimate, as in max30102_poll_start
+    WRITE_ONCE(data->poll_running, true);
+    data->mitigate_switches++;
+    max30102_sched_kick(data);  // First poll right away, the FIFO may be close to the watermark
+    return 0;
+}
+
+/**
+ * max30102_mitigate_exit - Unmask the FIFO interrupts and stop polling
+ * @data: MAX30102 device data, the caller holds the lock
+ * @now: Current time
+ * Returns: 0 on success, negative error code on failure
+ *
+ * Runs at the end of a poll that emptied the FIFO, so the first A_FULL
+ * comes a full watermark later.
+ */
+static int max30102_mitigate_exit(struct max30102_data *data, ktime_t now)
+{
+    uint8_t enable;
+    int ret;
+
+    ret = max30102_read_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, &enable, 1);
+    if (ret < 0) return ret;
+    enable |= data->mitigate_restore;
+    ret = max30102_write_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, &enable, 1);
+    if (ret < 0) return ret;
+
+    WRITE_ONCE(data->poll_running, false);  // Not armed while the drain runs, and not re-armed after it
+    hrtimer_cancel(&data->poll_timer);
+    max30102_mitigate_account(data, now);
+    data->irq_masked = false;
+    data->polling = false;
+    data->mitigate_switches++;
+    enable_irq(data->irq);
+    max30102_sched_kick(data);  // Read the status once, a flag latched while masked would hold INT low
+    return 0;
+}
+
+/**
+ * max30102_mitigate_update - Count a drain and switch modes if the rate calls for it
+ * @data: MAX30102 device data, the caller holds the lock
+ * @drained: Samples the drain read, negative if it failed
+ */
+void max30102_mitigate_update(struct max30102_data *data, int drained)
+{
+    ktime_t now;
+    u64 dt, hz;
+    int ret;
+
+    if (drained > 0) data->mitigate_samples[data->irq_masked] += drained;
+    if (!data->mitigate || drained < 0) return;
+
+    now = ktime_get();
+    dt = ktime_to_ns(ktime_sub(now, data->mitigate_window));
+    if (dt < MAX30102_MITIGATE_WINDOW_NS) return;
+
+    if (!data->irq_masked) {
+        hz = div64_u64((u64)(u32)(atomic_read(&data->irqs) - data->mitigate_window_irqs) * NSEC_PER_SEC, dt);
+        data->mitigate_window = now;
+        data->mitigate_window_irqs = atomic_read(&data->irqs);
+        if (hz <= data->mitigate_above_hz || data->qos_irq) return;
+        ret = max30102_mitigate_enter(data, now);
+        if (ret < 0)
+            dev_err_ratelimited(&data->client->dev, "Failed to switch to polling: %d\n", ret);
+        else
+            dev_dbg(&data->client->dev, "%llu interrupts/s, polling the FIFO\n", hz);
+    } else {
+        // Interrupts the sensor would raise at the estimated sample rate
+        hz = div64_u64(data->poll_rate_mhz, 1000);
+        if (!(data->mitigate_restore & (1 << MAX30102_INT_PPG_RDY)))
+            hz /= max_t(u8, data->poll_watermark, 1);
+        if (hz >= data->mitigate_below_hz && !data->qos_irq) return;
+        ret = max30102_mitigate_exit(data, now);
+        if (ret < 0)
+            dev_err_ratelimited(&data->client->dev, "Failed to switch to interrupts: %d\n", ret);
+        else
+            dev_dbg(&data->client->dev, "%llu interrupts/s expected, back to interrupts\n", hz);
+    }
+}
+
+/**
+ * max30102_mitigate_start - Allow switching, after a bring-up in interrupt mode
+ * @data: MAX30102 device data
+ */
+void max30102_mitigate_start(struct max30102_data *data)
+{
+    if (!data->irq_gpio) return;
+    mutex_lock(&data->lock);
+    data->mitigate_window = ktime_get();
+    data->mitigate_window_irqs = atomic_read(&data->irqs);
+    data->mitigate = data->mitigate_above_hz != 0;
+    max30102_unlock(data);
+}
+
+/**
+ * max30102_mitigate_stop - Stop switching and return to interrupts
+ * @data: MAX30102 device data
+ *
+ * Called before remove and suspend, which expect a board with INT to be in
+ * interrupt mode.
+ */
+void max30102_mitigate_stop(struct max30102_data *data)
+{
+    uint8_t enable;
+    bool masked;
+
+    if (!data->irq_gpio) return;
+    mutex_lock(&data->lock);
+    data->mitigate = false;
+    masked = data->irq_masked;
+    max30102_unlock(data);
+    if (!masked) return;
+
+    max30102_poll_stop(data);  // Also waits for a drain in flight
+    mutex_lock(&data->lock);
+    if (max30102_read_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, &enable, 1) == 0) {
+        enable |= data->mitigate_restore;
+        max30102_write_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, &enable, 1);
+    }
+    max30102_mitigate_account(data, ktime_get());
+    data->irq_masked = false;
+    data->polling = false;
+    max30102_unlock(data);
+    enable_irq(data->irq);
+}
+
+static int max30102_mitigation_show(struct seq_file *m, void *v)
+{
+    struct max30102_data *data = m->private;
+    u64 ns[2] = { data->mitigate_ns[0], data->mitigate_ns[1] };
+    u64 samples = data->mitigate_samples[0] + data->mitigate_samples[1];
+    u32 irqs = atomic_read(&data->irqs);
+
+    ns[data->irq_masked] += ktime_to_ns(ktime_sub(ktime_get(), data->mitigate_since));
+    seq_printf(m, "mode: %s\n", data->irq_masked ? "poll" : "irq");
+    seq_printf(m, "enabled: %d\n", data->mitigate);
+    seq_printf(m, "poll_above_hz: %u\n", data->mitigate_above_hz);
+    seq_printf(m, "irq_below_hz: %u\n", data->mitigate_below_hz);
+    seq_printf(m, "interrupts: %u\n", irqs);
+    seq_printf(m, "irq_samples: %llu\n", data->mitigate_samples[0]);
+    seq_printf(m, "poll_samples: %llu\n", data->mitigate_samples[1]);
+    seq_printf(m, "interrupts_per_sample_permille: %llu\n", samples ? div64_u64((u64)irqs * 1000, samples) : 0);
+    seq_printf(m, "irq_ns: %llu\n", ns[0]);
+    seq_printf(m, "poll_ns: %llu\n", ns[1]);
+    seq_printf(m, "switches: %llu\n", data->mitigate_switches);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max30102_mitigation);
+
+/**
+ * max30102_mitigate_init - Read the thresholds and add the debugfs entries
+ * @data: MAX30102 device data, after the IRQ and the debugfs directory
+ *
+ * Switching starts with max30102_mitigate_start once the sensor is up.
+ */
+void max30102_mitigate_init(struct max30102_data *data)
+{
+    struct device *dev = &data->client->dev;
+
+    data->mitigate_since = ktime_get();
+    if (!data->irq_gpio) return;
+
+    data->mitigate_above_hz = MAX30102_MITIGATE_ABOVE_HZ;
+    data->mitigate_below_hz = MAX30102_MITIGATE_BELOW_HZ;
+    device_property_read_u32(dev, "maxim,irq-poll-above-hz", &data->mitigate_above_hz);
+    device_property_read_u32(dev, "maxim,irq-poll-below-hz", &data->mitigate_below_hz);
+    if (data->mitigate_above_hz && data->mitigate_below_hz >= data->mitigate_above_hz) {
+        dev_warn(dev, "maxim,irq-poll-below-hz %u not below %u, using %u\n", data->mitigate_below_hz,
+                 data->mitigate_above_hz, data->mitigate_above_hz / 2);
+        data->mitigate_below_hz = data->mitigate_above_hz / 2;
+    }
+
+    debugfs_create_file("mitigation", 0444, data->debug_dir, data, &max30102_mitigation_fops);
+}
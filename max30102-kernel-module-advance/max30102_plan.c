@@ -0,0 +1,260 @@
+#include <errno.h>
+#include <string.h>
+#include "max30102_plan.h"
+
+/*
+ * Bus cost model. Every transaction is counted in SCL periods: nine per byte
+ * with its acknowledge, one per start, repeated start and stop. A register
+ * read is S, address, register, Sr, address, n data bytes, P. The drain
+ * follows max30102_drain(): an interrupt reads both status registers, and an
+ * A_FULL interrupt or a poll also reads the three FIFO pointers in one
+ * transaction and the unread samples in one burst, split to the adapter's
+ * read limit. Gaps the controller leaves between bytes are not counted, so
+ * the bus figures are a lower bound; max30102/bus-<nr>/utilization in debugfs
+ * shows the real share once the fleet runs.
+ */
+
+#define MAX30102_PLAN_DEPTH     32
+#define MAX30102_PLAN_READ      30  // S, address, register, Sr, address, P
+#define MAX30102_PLAN_SELECT    20  // S, mux address, channel byte, P
+
+static const uint32_t max30102_plan_rates[] = { 50, 100, 200, 400, 800, 1000, 1600, 3200 };
+static const uint32_t max30102_plan_widths_us[] = { 69, 118, 215, 411 };
+static const uint32_t max30102_plan_averages[] = { 1, 2, 4, 8, 16, 32 };
+
+struct max30102_plan_cost {
+    double bits;
+    double bytes;
+    double xfers;
+};
+
+static int max30102_plan_index(const uint32_t *table, int n, uint32_t val)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (table[i] == val)
+            return i;
+    }
+    return -1;
+}
+
+static int max30102_plan_channels(const struct max30102_plan_group *g)
+{
+    if (g->mode == 0x02) return 1;
+    if (g->mode == 0x03) return 2;
+    return g->slots;
+}
+
+static void max30102_plan_read(struct max30102_plan_cost *c, uint32_t n)
+{
+    c->bits += MAX30102_PLAN_READ + 9.0 * n;
+    c->bytes += 3 + n;
+    c->xfers += 1;
+}
+
+/**
+ * max30102_plan_fifo - Add the burst read of the unread samples
+ * @c: Cost to add to
+ * @bus: Bus, for its read limit
+ * @samples: Samples to read
+ * @sample_bytes: Bytes per sample
+ * Returns: 0 on success, -EOPNOTSUPP if one sample is over the read limit
+ *
+ * Split at sample boundaries like max30102_read_fifo_data().
+ */
+static int max30102_plan_fifo(struct max30102_plan_cost *c, const struct max30102_plan_bus *bus,
+                              uint32_t samples, uint32_t sample_bytes)
+{
+    uint32_t bytes = samples * sample_bytes, chunk = bytes;
+
+    if (bus->max_read && bus->max_read < bytes) {
+        chunk = bus->max_read - bus->max_read % sample_bytes;
+        if (!chunk) return -EOPNOTSUPP;
+    }
+    while (bytes) {
+        max30102_plan_read(c, bytes < chunk ? bytes : chunk);
+        bytes -= bytes < chunk ? bytes : chunk;
+    }
+    return 0;
+}
+
+static void max30102_plan_select(struct max30102_plan_cost *c, const struct max30102_plan_bus *bus)
+{
+    if (!bus->mux) return;
+    c->bits += MAX30102_PLAN_SELECT;
+    c->bytes += 2;
+    c->xfers += 1;
+}
+
+/**
+ * max30102_plan_bus_init - Fill in the defaults
+ * @bus: Bus to initialise
+ *
+ * The CPU costs are rough figures for a Raspberry Pi 4. Replace them with
+ * measured ones for other hosts.
+ */
+void max30102_plan_bus_init(struct max30102_plan_bus *bus)
+{
+    memset(bus, 0, sizeof(*bus));
+    bus->speed_hz = 400000;
+    bus->above_hz = 500;  // Driver default of maxim,irq-poll-above-hz
+    bus->irq_us = 5;
+    bus->xfer_us = 25;
+    bus->latency_us = 500;
+}
+
+/**
+ * max30102_plan_group_init - Fill in the driver's default profile
+ * @group: Group of one sensor to initialise
+ */
+void max30102_plan_group_init(struct max30102_plan_group *group)
+{
+    memset(group, 0, sizeof(*group));
+    group->sensors = 1;
+    group->mode = 0x03;
+    group->slots = 2;
+    group->rate_hz = 100;
+    group->width_us = 411;
+    group->average = 16;
+    group->watermark = 32;
+    group->ppg_rdy = true;
+}
+
+/**
+ * max30102_plan_group_check - Check a profile against the datasheet
+ * @group: Group to check
+ * Returns: 0 if the sensor can run it, -EINVAL for a value the registers
+ *          cannot hold, -EOPNOTSUPP for a sample rate and pulse width
+ *          combination the datasheet does not allow
+ */
+int max30102_plan_group_check(const struct max30102_plan_group *group)
+{
+    int rate, width;
+
+    if (!group || !group->sensors) return -EINVAL;
+    if (group->mode != 0x02 && group->mode != 0x03 && group->mode != 0x07) return -EINVAL;
+    if (group->mode == 0x07 && (group->slots < 1 || group->slots > 4)) return -EINVAL;
+    if (group->watermark < 17 || group->watermark > MAX30102_PLAN_DEPTH) return -EINVAL;
+    if (max30102_plan_index(max30102_plan_averages, 6, group->average) < 0) return -EINVAL;
+    rate = max30102_plan_index(max30102_plan_rates, 8, group->rate_hz);
+    width = max30102_plan_index(max30102_plan_widths_us, 4, group->width_us);
+    if (rate < 0 || width < 0) return -EINVAL;
+    if (!max30102_plan_supported(max30102_plan_channels(group), rate << 2 | width)) return -EOPNOTSUPP;
+    return 0;
+}
+
+/**
+ * max30102_plan_run - Work out what a fleet costs and whether it fits
+ * @bus: Bus the sensors share
+ * @groups: Sensor groups, one per profile
+ * @n: Number of groups
+ * @results: One result per group, rates for all sensors of the group
+ * @total: Whole bus
+ * Returns: 0 on success, -EINVAL for an invalid bus or group, -EOPNOTSUPP if
+ *          a sample does not fit in the adapter's read limit
+ *
+ * A group whose profile the datasheet does not allow is still costed, with
+ * MAX30102_PLAN_PROFILE in its verdict. The worst case is every sensor on
+ * the bus queued at once, with the waiting one drained last. Its FIFO stops
+ * filling up once the burst read of the samples starts, so the wait ends
+ * there.
+ */
+int max30102_plan_run(const struct max30102_plan_bus *bus, const struct max30102_plan_group *groups, int n,
+                      struct max30102_plan_result *results, struct max30102_plan_result *total)
+{
+    struct max30102_plan_cost cost, drain, fifo;
+    double bus_us, drains, extra;
+    uint32_t batch, margin;
+    int i, ret;
+
+    if (!bus || !groups || !results || !total || n <= 0 || !bus->speed_hz) return -EINVAL;
+
+    memset(total, 0, sizeof(*total));
+    bus_us = 0;
+    for (i = 0; i < n; i++) {
+        const struct max30102_plan_group *g = &groups[i];
+        struct max30102_plan_result *r = &results[i];
+        uint32_t sample_bytes;
+
+        ret = max30102_plan_group_check(g);
+        if (ret == -EINVAL) return ret;
+        memset(r, 0, sizeof(*r));
+        if (ret < 0) r->verdict |= MAX30102_PLAN_PROFILE;
+
+        sample_bytes = max30102_plan_channels(g) * 3;
+        r->sample_hz = (double)g->rate_hz / g->average;
+        r->polling = g->polled || (g->ppg_rdy && bus->above_hz && r->sample_hz > bus->above_hz);
+
+        // One drain: the samples it finds and what it costs
+        memset(&drain, 0, sizeof(drain));
+        max30102_plan_select(&drain, bus);
+        if (r->polling) {
+            margin = 1 + g->watermark / 8;  // Same target as max30102_poll_configure()
+            batch = g->watermark > margin ? g->watermark - margin : 1;
+        } else {
+            batch = g->watermark;
+            max30102_plan_read(&drain, 1);  // Status 1
+            max30102_plan_read(&drain, 1);  // Status 2
+        }
+        max30102_plan_read(&drain, 3);  // Write pointer, overflow counter, read pointer
+        memset(&fifo, 0, sizeof(fifo));
+        ret = max30102_plan_fifo(&fifo, bus, batch, sample_bytes);
+        if (ret < 0) return ret;
+        r->worst_wait_us = -fifo.bits * 1e6 / bus->speed_hz;  // The total comes in below
+        drain.bits += fifo.bits;
+        drain.bytes += fifo.bytes;
+        drain.xfers += fifo.xfers;
+
+        // Per second for one sensor, PPG_RDY interrupts without A_FULL only read the status
+        drains = r->sample_hz / batch;
+        cost.bits = drains * drain.bits;
+        cost.bytes = drains * drain.bytes;
+        cost.xfers = drains * drain.xfers;
+        r->interrupts_per_s = drains;
+        if (!r->polling && g->ppg_rdy) {
+            extra = r->sample_hz - drains;
+            cost.bits += extra * (2 * (MAX30102_PLAN_READ + 9.0) + (bus->mux ? MAX30102_PLAN_SELECT : 0));
+            cost.bytes += extra * (2 * 4 + (bus->mux ? 2 : 0));
+            cost.xfers += extra * (2 + (bus->mux ? 1 : 0));
+            r->interrupts_per_s = r->sample_hz;
+        }
+
+        r->fill_us = (MAX30102_PLAN_DEPTH + 1 - batch) * 1e6 / r->sample_hz;
+        r->sample_hz *= g->sensors;
+        r->interrupts_per_s *= g->sensors;
+        r->bytes_per_s = cost.bytes * g->sensors;
+        r->transactions_per_s = cost.xfers * g->sensors;
+        r->bus_utilization = cost.bits * g->sensors / bus->speed_hz;
+        r->cpu_utilization = (r->interrupts_per_s * bus->irq_us + r->transactions_per_s * bus->xfer_us) / 1e6;
+        r->drain_us = drain.bits * 1e6 / bus->speed_hz;
+        bus_us += r->drain_us * g->sensors;
+
+        total->sample_hz += r->sample_hz;
+        total->interrupts_per_s += r->interrupts_per_s;
+        total->bytes_per_s += r->bytes_per_s;
+        total->transactions_per_s += r->transactions_per_s;
+        total->bus_utilization += r->bus_utilization;
+        total->cpu_utilization += r->cpu_utilization;
+        total->drain_us += r->drain_us * g->sensors;
+        total->polling |= r->polling;
+        total->verdict |= r->verdict;
+    }
+
+    for (i = 0; i < n; i++) {
+        struct max30102_plan_result *r = &results[i];
+
+        r->worst_wait_us += bus->latency_us + bus_us;
+        r->headroom_us = r->fill_us - r->worst_wait_us;
+        if (r->headroom_us < 0) r->verdict |= MAX30102_PLAN_DEADLINE;
+        if (i == 0 || r->headroom_us < total->headroom_us) {
+            total->headroom_us = r->headroom_us;
+            total->worst_wait_us = r->worst_wait_us;
+            total->fill_us = r->fill_us;
+        }
+        total->verdict |= r->verdict;
+    }
+    if (total->bus_utilization > 1) total->verdict |= MAX30102_PLAN_BUS;
+    if (total->cpu_utilization > 1) total->verdict |= MAX30102_PLAN_CPU;
+    return 0;
+}
@@ -0,0 +1,112 @@
+#ifndef MAX30102_PLAN_H
+#define MAX30102_PLAN_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdbool.h>
+#include <stdint.h>
+#endif
+
+/*
+ * Capacity planning for a fleet of MAX30102 sensors.
+ *
+ * The sample rate and pulse width combinations the sensor can run come from
+ * the datasheet tables "SpO2 Mode (Allowed Settings)" and "Heart-Rate Mode
+ * (Allowed Settings)". The driver rejects any other profile with this table
+ * before it writes a register, and the planner (max30102_plan.c) checks the
+ * same table before it works out what a fleet costs in bus time, interrupts
+ * and CPU.
+ */
+
+/**
+ * max30102_plan_widths - Number of pulse widths a sample rate allows
+ * @slots: Active LED slots per sample: 1 in heart rate mode, 2 in SpO2 mode
+ * @rate: SPO2_SR field, 0 (50 sps) to 7 (3200 sps)
+ * Returns: n, the LED_PW fields 0 to n - 1 are allowed, 0 if none is
+ *
+ * The datasheet only has tables for one and two slots. Three or four
+ * multi-LED slots take up to twice as long per sample as two, so they get
+ * the two-slot row of the lowest sample rate at least twice as high.
+ */
+static inline int max30102_plan_widths(int slots, int rate)
+{
+    // Columns are SPO2_SR 0..7: 50, 100, 200, 400, 800, 1000, 1600, 3200 sps
+    static const uint8_t widths[2][8] = {
+        { 4, 4, 4, 4, 4, 4, 3, 1 },  // One slot
+        { 4, 4, 4, 4, 3, 2, 1, 0 },  // Two slots
+    };
+    static const uint8_t doubled[8] = { 1, 2, 3, 4, 6, 7, 7, 8 };  // 8: no rate is high enough
+
+    if (rate < 0 || rate > 7 || slots > 4) return 0;
+    if (slots <= 0) return 4;  // Nothing is sampled
+    if (slots <= 2) return widths[slots - 1][rate];
+    rate = doubled[rate];
+    return rate > 7 ? 0 : widths[1][rate];
+}
+
+/**
+ * max30102_plan_supported - Check the SpO2 configuration for a slot count
+ * @slots: Active LED slots per sample
+ * @spo2_config: SPO2_CONFIG register value
+ * Returns: true if the sensor can run it
+ */
+static inline bool max30102_plan_supported(int slots, uint8_t spo2_config)
+{
+    return (spo2_config & 0x03) < max30102_plan_widths(slots, (spo2_config >> 2) & 0x07);
+}
+
+#ifndef __KERNEL__
+
+/* Why a plan does not fit, max30102_plan_result.verdict */
+#define MAX30102_PLAN_PROFILE   0x01  // Sample rate and pulse width combination not allowed
+#define MAX30102_PLAN_BUS       0x02  // More bus time than there is
+#define MAX30102_PLAN_DEADLINE  0x04  // The FIFO overflows before the worst-case wait for a drain ends
+#define MAX30102_PLAN_CPU       0x08  // More than one core
+
+struct max30102_plan_bus {
+    uint32_t speed_hz;   // SCL frequency, 100000 or 400000
+    uint16_t max_read;   // Adapter read limit in bytes, 0 for none
+    bool mux;            // Sensors behind a mux, one channel select per drain
+    uint32_t above_hz;   // maxim,irq-poll-above-hz, 0 never switches to polling
+    double irq_us;       // CPU time per interrupt or poll timer expiry
+    double xfer_us;      // CPU time per I2C transaction
+    double latency_us;   // Worst wake-up latency before a drain starts
+};
+
+struct max30102_plan_group {
+    uint32_t sensors;    // Sensors with this profile
+    uint8_t mode;        // MODE_CONFIG: 0x02 heart rate, 0x03 SpO2, 0x07 multi-LED
+    uint8_t slots;       // Active multi-LED slots, 1..4
+    uint32_t rate_hz;    // 50, 100, 200, 400, 800, 1000, 1600, 3200
+    uint32_t width_us;   // 69, 118, 215, 411
+    uint32_t average;    // 1, 2, 4, 8, 16, 32
+    uint32_t watermark;  // Unread samples at A_FULL, 17..32
+    bool ppg_rdy;        // PPG_RDY enabled, one interrupt per sample
+    bool polled;         // No INT pin
+};
+
+struct max30102_plan_result {
+    double sample_hz;           // Samples per second into each FIFO
+    double bytes_per_s;         // On the wire, address and register bytes included
+    double transactions_per_s;
+    double interrupts_per_s;    // Interrupts and poll timer expiries
+    double bus_utilization;     // Share of the bus time
+    double cpu_utilization;     // Share of one core
+    double drain_us;            // Bus time of one drain of one sensor, of all sensors in the total
+    double worst_wait_us;       // Worst time from the drain trigger to the start of the FIFO read
+    double fill_us;             // From the drain trigger to the first lost sample
+    double headroom_us;         // fill_us - worst_wait_us, the smallest group's in the total
+    bool polling;               // Drained from the poll timer
+    int verdict;                // MAX30102_PLAN_* flags, 0 if the plan fits
+};
+
+extern void max30102_plan_bus_init(struct max30102_plan_bus *bus);
+extern void max30102_plan_group_init(struct max30102_plan_group *group);
+extern int max30102_plan_group_check(const struct max30102_plan_group *group);
+extern int max30102_plan_run(const struct max30102_plan_bus *bus, const struct max30102_plan_group *groups, int n,
+                             struct max30102_plan_result *results, struct max30102_plan_result *total);
+
+#endif /* __KERNEL__ */
+
+#endif
@@ -0,0 +1,138 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "max30102_plan.h"
+
+/*
+ * max30102_planner - check that a sensor fleet fits on one I2C bus.
+ *
+ * Each group argument describes sensors sharing one profile as a comma
+ * separated list, e.g. "n=8,mode=spo2,rate=400,pw=215,avg=1,wm=24". Keys
+ * left out take the driver's defaults. The planner checks every profile
+ * against the datasheet's sample rate and pulse width table, the same one
+ * the driver enforces, and prints per group and for the whole bus the wire
+ * load, interrupt rate, CPU share, and the worst-case wait for a drain
+ * against the time the FIFO takes to overflow. It exits with 0 when the
+ * fleet fits, 1 when it does not, and 2 on a usage error.
+ */
+
+#define MAX30102_PLANNER_GROUPS 16
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-b <scl-hz>] [-r <max-read-bytes>] [-m] [-a <irq-poll-above-hz>]\n"
+            "          [--irq-us <us>] [--xfer-us <us>] [--latency-us <us>] <group>...\n"
+            "group: n=<sensors>,mode=heart-rate|spo2|multi-led,slots=<1-4>,rate=<sps>,pw=<us>,\n"
+            "       avg=<samples>,wm=<17-32>,ppg=<0|1>,poll=<0|1>\n",
+            prog);
+}
+
+/**
+ * parse_group - Parse one group argument
+ * @arg: Comma separated key=value list, changed in place
+ * @g: Group, holding the defaults
+ * Returns: 0 on success, -EINVAL on an unknown key or a bad value
+ */
+static int parse_group(char *arg, struct max30102_plan_group *g)
+{
+    char *save = NULL, *tok, *val, *end;
+    unsigned long v;
+
+    for (tok = strtok_r(arg, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        val = strchr(tok, '=');
+        if (!val) return -EINVAL;
+        *val++ = '\0';
+        if (strcmp(tok, "mode") == 0) {
+            if (strcmp(val, "heart-rate") == 0) g->mode = 0x02;
+            else if (strcmp(val, "spo2") == 0) g->mode = 0x03;
+            else if (strcmp(val, "multi-led") == 0) g->mode = 0x07;
+            else return -EINVAL;
+            continue;
+        }
+        errno = 0;
+        v = strtoul(val, &end, 10);
+        if (errno || end == val || *end) return -EINVAL;
+        if (strcmp(tok, "n") == 0) g->sensors = v;
+        else if (strcmp(tok, "slots") == 0) g->slots = v;
+        else if (strcmp(tok, "rate") == 0) g->rate_hz = v;
+        else if (strcmp(tok, "pw") == 0) g->width_us = v;
+        else if (strcmp(tok, "avg") == 0) g->average = v;
+        else if (strcmp(tok, "wm") == 0) g->watermark = v;
+        else if (strcmp(tok, "ppg") == 0) g->ppg_rdy = v != 0;
+        else if (strcmp(tok, "poll") == 0) g->polled = v != 0;
+        else return -EINVAL;
+    }
+    return 0;
+}
+
+static void print_result(const char *name, const struct max30102_plan_result *r)
+{
+    printf("%s\t%.1f\t%.0f\t%.0f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%s\t%s%s%s%s%s\n", name, r->sample_hz,
+           r->bytes_per_s, r->transactions_per_s, r->interrupts_per_s, r->bus_utilization * 100,
+           r->cpu_utilization * 100, r->drain_us, r->worst_wait_us, r->fill_us, r->polling ? "poll" : "irq",
+           r->verdict ? "" : "ok", (r->verdict & MAX30102_PLAN_PROFILE) ? "sr/pw " : "",
+           (r->verdict & MAX30102_PLAN_BUS) ? "bus " : "", (r->verdict & MAX30102_PLAN_DEADLINE) ? "deadline " : "",
+           (r->verdict & MAX30102_PLAN_CPU) ? "cpu" : "");
+}
+
+int main(int argc, char *argv[])
+{
+    struct max30102_plan_group groups[MAX30102_PLANNER_GROUPS];
+    struct max30102_plan_result results[MAX30102_PLANNER_GROUPS], total;
+    struct max30102_plan_bus bus;
+    char name[16], arg[256];
+    int i, n = 0, ret;
+
+    max30102_plan_bus_init(&bus);
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            bus.speed_hz = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            bus.max_read = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-m") == 0) {
+            bus.mux = true;
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            bus.above_hz = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--irq-us") == 0 && i + 1 < argc) {
+            bus.irq_us = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--xfer-us") == 0 && i + 1 < argc) {
+            bus.xfer_us = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--latency-us") == 0 && i + 1 < argc) {
+            bus.latency_us = strtod(argv[++i], NULL);
+        } else if (argv[i][0] != '-' && n < MAX30102_PLANNER_GROUPS) {
+            max30102_plan_group_init(&groups[n]);
+            snprintf(arg, sizeof(arg), "%s", argv[i]);
+            if (parse_group(arg, &groups[n]) < 0) {
+                fprintf(stderr, "Invalid group: %s\n", argv[i]);
+                return 2;
+            }
+            n++;
+        } else {
+            n = 0;
+            break;
+        }
+    }
+    if (n == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    ret = max30102_plan_run(&bus, groups, n, results, &total);
+    if (ret < 0) {
+        fprintf(stderr, "Planning failed: %s\n", ret == -EOPNOTSUPP ? "a sample is over the adapter's read limit"
+                                                                     : "invalid bus or group setting");
+        return 2;
+    }
+
+    printf("group\tsps\tbytes/s\txfers/s\tirqs/s\tbus%%\tcpu%%\tdrain_us\twait_us\tfill_us\tmode\tverdict\n");
+    for (i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "%d", i + 1);
+        print_result(name, &results[i]);
+    }
+    print_result("total", &total);
+    fprintf(stderr, "%u Hz bus %.1f%% busy, worst-case wait %.0f us, FIFO overflows after %.0f us, headroom %.0f us\n",
+            bus.speed_hz, total.bus_utilization * 100, total.worst_wait_us, total.fill_us, total.headroom_us);
+    return total.verdict ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include "max30102.h"
+
+/*
+ * Adaptive FIFO polling for boards that do not route the INT pin.
+ *
+ * An hrtimer queues the same drain the interrupt would. The first
+ * period comes from the sample rate, averaging and almost full settings. After
+ * each drain the sample rate estimate is updated from the number of samples
+ * found, and the timer is re-armed for the moment the FIFO will be back at a
+ * target just below the watermark. The estimate rises fast and falls slowly,
+ * so a fast sensor clock settles in a few polls and wake-up jitter does not
+ * cause overruns.
+ */
+
+#define MAX30102_POLL_DEPTH     32
+#define MAX30102_POLL_OVF_MAX   0x1F  // Overflow counter saturates here
+#define MAX30102_POLL_RANGE     16    // Estimate stays within nominal / 16 and nominal * 16
+#define MAX30102_POLL_MHZ       1000ULL
+
+static const u32 max30102_poll_rate_hz[8] = { 50, 100, 200, 400, 800, 1000, 1600, 3200 };
+
+/**
+ * max30102_poll_timer - hrtimer callback, hands the drain to the bus scheduler
+ * @timer: Poll timer
+ * Returns: HRTIMER_NORESTART, the work handler re-arms the timer
+ */
+static enum hrtimer_restart max30102_poll_timer(struct hrtimer *timer)
+{
+    struct max30102_data *data = container_of(timer, struct max30102_data, poll_timer);
+
+    max30102_sched_kick(data);
+    return HRTIMER_NORESTART;
+}
+
+/**
+ * max30102_poll_init - Prepare the poll timer
+ * @data: MAX30102 device data
+ */
+void max30102_poll_init(struct max30102_data *data)
+{
+    hrtimer_init(&data->poll_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    data->poll_timer.function = max30102_poll_timer;
+}
+
+/**
+ * max30102_poll_configure - Derive the nominal rate and target from the chip
+ * @data: MAX30102 device data
+ * Returns: 0 on success, negative error code on failure
+ */
+int max30102_poll_configure(struct max30102_data *data)
+{
+    uint8_t fifo, spo2, avg, margin;
+    int ret;
+
+    ret = max30102_read_reg(data, MAX30102_REG_FIFO_CONFIG, &fifo, 1);
+    if (ret < 0) return ret;
+    ret = max30102_read_reg(data, MAX30102_REG_SPO2_CONFIG, &spo2, 1);
+    if (ret < 0) return ret;
+
+    avg = min_t(uint8_t, (fifo >> 5) & 0x07, SMP_AVE_32);
+    data->poll_nominal_mhz = ((u64)max30102_poll_rate_hz[(spo2 >> 2) & 0x07] * MAX30102_POLL_MHZ) >> avg;
+    data->poll_rate_mhz = data->poll_nominal_mhz;
+    data->poll_watermark = MAX30102_POLL_DEPTH - (fifo & 0x0F);
+
+    // Leave room for the wake-up jitter, about one sample in eight
+    margin = 1 + data->poll_watermark / 8;
+    data->poll_target = data->poll_watermark > margin ? data->poll_watermark - margin : 1;
+    data->poll_period_ns = div64_u64((u64)data->poll_target * NSEC_PER_SEC * MAX30102_POLL_MHZ, data->poll_rate_mhz);
+    WRITE_ONCE(data->poll_stale, false);
+    return 0;
+}
+
+/**
+ * max30102_poll_start - Drain once now and keep polling
+ * @data: MAX30102 device data
+ * Returns: 0 on success, negative error code on failure
+ */
+int max30102_poll_start(struct max30102_data *data)
+{
+    int ret = max30102_poll_configure(data);
+
+    if (ret < 0) return ret;
+    data->poll_last = 0;
+    WRITE_ONCE(data->poll_running, true);
+    hrtimer_start(&data->poll_timer, ktime_get(), HRTIMER_MODE_ABS);
+    return 0;
+}
+
+/**
+ * max30102_poll_stop - Stop polling and wait for a drain in flight
+ * @data: MAX30102 device data
+ */
+void max30102_poll_stop(struct max30102_data *data)
+{
+    WRITE_ONCE(data->poll_running, false);
+    hrtimer_cancel(&data->poll_timer);
+    max30102_sched_cancel(data);
+    hrtimer_cancel(&data->poll_timer);  // The drain may have re-armed before it saw the flag
+}
+
+/**
+ * max30102_poll_expected - Samples the rate estimate predicts since the last drain
+ * @data: MAX30102 device data
+ * Returns: Predicted FIFO level, 0 before the first drain
+ *
+ * Equal FIFO pointers without an overflow are either empty or exactly full;
+ * the prediction tells the two apart.
+ */
+uint8_t max30102_poll_expected(struct max30102_data *data)
+{
+    u64 n;
+
+    if (!data->poll_last) return 0;
+    n = div64_u64((u64)ktime_to_ns(ktime_sub(ktime_get(), data->poll_last)) * data->poll_rate_mhz,
+                  NSEC_PER_SEC * MAX30102_POLL_MHZ);
+    return n > MAX30102_POLL_DEPTH ? MAX30102_POLL_DEPTH : (uint8_t)n;
+}
+
+/**
+ * max30102_poll_rearm - Update the rate estimate and schedule the next drain
+ * @data: MAX30102 device data
+ * @produced: Samples the chip wrote since the last drain (level plus overflow), negative if the drain failed
+ * @ovf: Overflow counter seen by the drain
+ */
+void max30102_poll_rearm(struct max30102_data *data, int produced, uint8_t ovf)
+{
+    ktime_t now = ktime_get();
+    u64 dt, measured, hi, lo;
+
+    if (produced >= 0 && data->poll_last) {
+        dt = ktime_to_ns(ktime_sub(now, data->poll_last));
+        if (dt) {
+            measured = div64_u64((u64)produced * NSEC_PER_SEC * MAX30102_POLL_MHZ, dt);
+            if (ovf == MAX30102_POLL_OVF_MAX) {
+                // The counter saturated, so the real rate is at least this
+                data->poll_rate_mhz = max(measured, 2 * data->poll_rate_mhz);
+            } else if (measured > data->poll_rate_mhz) {
+                data->poll_rate_mhz += (measured - data->poll_rate_mhz) / 2;
+            } else {
+                data->poll_rate_mhz -= (data->poll_rate_mhz - measured) / 8;
+            }
+            hi = data->poll_nominal_mhz * MAX30102_POLL_RANGE;
+            lo = max_t(u64, data->poll_nominal_mhz / MAX30102_POLL_RANGE, 1);
+            data->poll_rate_mhz = clamp(data->poll_rate_mhz, lo, hi);
+        }
+    }
+    if (produced >= 0) data->poll_last = now;
+
+    data->poll_period_ns = div64_u64((u64)data->poll_target * NSEC_PER_SEC * MAX30102_POLL_MHZ, data->poll_rate_mhz);
+    if (READ_ONCE(data->poll_running))
+        hrtimer_start(&data->poll_timer, ktime_add_ns(now, data->poll_period_ns), HRTIMER_MODE_ABS);
+}
@@ -0,0 +1,325 @@
+#include <linux/list.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include "max30102.h"
+
+/*
+ * QoS requests, after the PM QoS framework.
+ *
+ * Each open file may state the longest a sample may wait in the FIFO before
+ * a drain picks it up and the fewest samples per second it needs. The driver
+ * keeps the strictest of all requests: the shortest latency and the highest
+ * rate. For it, it picks the sample averaging, the A_FULL watermark and
+ * whether PPG_RDY interrupts every sample, choosing the combination with the
+ * fewest drains per second. The sample rate, pulse width and mode stay as
+ * configured. The choice is made again whenever a request is set or cleared,
+ * a file with a request is closed, or the SpO2 configuration changes. Once
+ * the last request is gone, the averaging, watermark and PPG_RDY enable from
+ * before the first one are restored.
+ *
+ * Latency counts in FIFO samples: a watermark of w means the oldest sample
+ * waited w sample periods when A_FULL fires, a poll that many periods of its
+ * target, PPG_RDY one period. With PPG_RDY chosen, data->qos_irq makes the
+ * drain read the FIFO on every PPG_RDY instead of only on A_FULL. Wake-up
+ * and bus time come on top, see max30102_planner for those.
+ */
+
+#define MAX30102_QOS_DEPTH      32
+#define MAX30102_QOS_MIN_WM     17  // FIFO_A_FULL holds 0..15 free slots
+#define MAX30102_QOS_MHZ        1000ULL
+
+static const u32 max30102_qos_rate_hz[8] = { 50, 100, 200, 400, 800, 1000, 1600, 3200 };
+
+struct max30102_qos_choice {
+    uint8_t avg;        // SMP_AVE field
+    uint8_t watermark;
+    bool ppg_rdy;
+    u64 rate_mhz;       // FIFO samples per second
+    u64 wakeups_mhz;    // Drains per second
+    u32 latency_us;
+};
+
+/**
+ * max30102_qos_samples_us - Time a number of FIFO samples take
+ * @n: Samples
+ * @rate_mhz: FIFO samples per second, in millihertz
+ * Returns: Microseconds, saturated to U32_MAX
+ */
+static u32 max30102_qos_samples_us(u32 n, u64 rate_mhz)
+{
+    return min_t(u64, div64_u64((u64)n * USEC_PER_SEC * MAX30102_QOS_MHZ, rate_mhz), U32_MAX);
+}
+
+/**
+ * max30102_qos_try - Find the fewest drains for one averaging setting
+ * @data: MAX30102 device data
+ * @avg: SMP_AVE field to try
+ * @latency_us: Latency bound, 0 for none
+ * @c: Filled in with the choice
+ * Returns: true if a watermark or PPG_RDY meets the bound, otherwise @c
+ *          holds the setting with the lowest latency
+ *
+ * The highest watermark within the bound needs the fewest drains. Boards
+ * without INT drain at the poll target below the watermark and cannot use
+ * PPG_RDY, so they have no setting below the target of the lowest watermark.
+ */
+static bool max30102_qos_try(struct max30102_data *data, uint8_t avg, u32 latency_us,
+                             struct max30102_qos_choice *c)
+{
+    u64 rate_mhz = ((u64)max30102_qos_rate_hz[(data->profile.spo2_config >> 2) & 0x07] * MAX30102_QOS_MHZ) >> avg;
+    uint8_t w, batch;
+
+    c->avg = avg;
+    c->rate_mhz = rate_mhz;
+    c->ppg_rdy = false;
+    for (w = MAX30102_QOS_DEPTH; w >= MAX30102_QOS_MIN_WM; w--) {
+        batch = data->irq_gpio ? w : w - (1 + w / 8);  // Same target as max30102_poll_configure()
+        c->watermark = w;
+        c->wakeups_mhz = div_u64(rate_mhz, batch);
+        c->latency_us = max30102_qos_samples_us(batch, rate_mhz);
+        if (!latency_us || c->latency_us <= latency_us)
+            return true;
+    }
+    if (!data->irq_gpio) return false;  // Left at the lowest watermark
+
+    c->watermark = MAX30102_QOS_DEPTH;  // A_FULL only matters if a drain falls behind
+    c->ppg_rdy = true;
+    c->wakeups_mhz = rate_mhz;
+    c->latency_us = max30102_qos_samples_us(1, rate_mhz);
+    return c->latency_us <= latency_us;
+}
+
+/**
+ * max30102_qos_choose - Pick the settings for a latency and rate bound
+ * @data: MAX30102 device data
+ * @latency_us: Latency bound, 0 for none
+ * @rate_mhz: Rate bound in millihertz
+ * @c: Filled in with the choice
+ * Returns: true if the choice meets both bounds
+ *
+ * Of the averaging settings fast enough for the rate, the one with the fewest
+ * drains wins, the higher averaging on a tie because it also moves fewer
+ * bytes. Without any setting that meets both, the fastest one is taken: no
+ * averaging, and PPG_RDY or the lowest watermark.
+ */
+static bool max30102_qos_choose(struct max30102_data *data, u32 latency_us, u64 rate_mhz,
+                                struct max30102_qos_choice *c)
+{
+    struct max30102_qos_choice t;
+    bool found = false;
+    int avg;
+
+    for (avg = SMP_AVE_32; avg >= SMP_AVE_1; avg--) {
+        if (!max30102_qos_try(data, avg, latency_us, &t) || t.rate_mhz < rate_mhz)
+            continue;
+        if (!found || t.wakeups_mhz < c->wakeups_mhz)
+            *c = t;
+        found = true;
+    }
+    if (!found)
+        max30102_qos_try(data, SMP_AVE_1, latency_us, c);
+    return found;
+}
+
+/**
+ * max30102_qos_aggregate - Strictest bounds of all requests
+ * @data: MAX30102 device data, the caller holds the lock
+ * @latency_us: Shortest latency asked for, 0 if no request bounds it
+ * @rate_mhz: Highest rate asked for, in millihertz
+ * Returns: Number of requests
+ *
+ * A request without a rate keeps the rate of the settings before the first
+ * request.
+ */
+static u32 max30102_qos_aggregate(struct max30102_data *data, u32 *latency_us, u64 *rate_mhz)
+{
+    struct max30102_file *mf;
+    uint8_t avg = min_t(uint8_t, (data->qos_base_fifo >> 5) & 0x07, SMP_AVE_32);
+    u32 n = 0, rate_hz = 0;
+    bool keep = false;
+
+    *latency_us = 0;
+    list_for_each_entry(mf, &data->qos_requests, qos_node) {
+        if (mf->qos.max_latency_us && (!*latency_us || mf->qos.max_latency_us < *latency_us))
+            *latency_us = mf->qos.max_latency_us;
+        if (mf->qos.min_rate_hz)
+            rate_hz = max(rate_hz, mf->qos.min_rate_hz);
+        else
+            keep = true;
+        n++;
+    }
+    *rate_mhz = (u64)rate_hz * MAX30102_QOS_MHZ;
+    if (keep)
+        *rate_mhz = max(*rate_mhz,
+                        ((u64)max30102_qos_rate_hz[(data->profile.spo2_config >> 2) & 0x07] * MAX30102_QOS_MHZ) >> avg);
+    return n;
+}
+
+/**
+ * max30102_qos_apply - Write the FIFO configuration and PPG_RDY enable
+ * @data: MAX30102 device data, the caller holds the lock
+ * @fifo_config: FIFO_CONFIG value
+ * @ppg_rdy: Enable PPG_RDY
+ * Returns: 0 on success, negative error code on failure
+ */
+static int max30102_qos_apply(struct max30102_data *data, uint8_t fifo_config, bool ppg_rdy)
+{
+    int ret;
+
+    if (fifo_config != data->profile.fifo_config) {
+        ret = max30102_set_fifo_config(data, fifo_config);
+        if (ret < 0) return ret;
+    }
+    return max30102_set_interrupt(data, MAX30102_INT_PPG_RDY, ppg_rdy);  // Deferred while mitigation polls
+}
+
+/**
+ * max30102_qos_update - Choose and write the settings for the current requests
+ * @data: MAX30102 device data, the caller holds the lock
+ * Returns: 0 on success, negative error code on failure
+ *
+ * Without requests, restores the settings from before the first one, or does
+ * nothing if there were none.
+ */
+int max30102_qos_update(struct max30102_data *data)
+{
+    struct max30102_qos_info *info = &data->qos_info;
+    struct max30102_qos_choice c;
+    uint8_t fifo_config;
+    u32 latency_us;
+    u64 rate_mhz;
+    int ret;
+
+    if (!data->qos_active) return 0;
+
+    memset(info, 0, sizeof(*info));
+    info->requests = max30102_qos_aggregate(data, &latency_us, &rate_mhz);
+    if (!info->requests) {
+        data->qos_active = false;
+        data->qos_irq = false;
+        return max30102_qos_apply(data, data->qos_base_fifo, data->qos_base_ppg);
+    }
+
+    info->met = max30102_qos_choose(data, latency_us, rate_mhz, &c);
+    info->max_latency_us = latency_us;
+    info->min_rate_hz = DIV_ROUND_UP_ULL(rate_mhz, MAX30102_QOS_MHZ);
+    info->latency_us = c.latency_us;
+    info->rate_mhz = min_t(u64, c.rate_mhz, U32_MAX);
+    info->wakeups_mhz = min_t(u64, c.wakeups_mhz, U32_MAX);
+    info->average = 1 << c.avg;
+    info->watermark = c.watermark;
+    info->ppg_rdy = c.ppg_rdy;
+    data->qos_irq = c.ppg_rdy;  // Polling would wait for the poll target, see max30102_mitigate_update()
+
+    fifo_config = (data->profile.fifo_config & 0x10) | (c.avg << 5) | (MAX30102_QOS_DEPTH - c.watermark);
+    ret = max30102_qos_apply(data, fifo_config, c.ppg_rdy);
+    if (ret == 0 && !info->met)
+        dev_warn(&data->client->dev, "QoS %u us, %u Hz not met at this sample rate, using %u us, %u mHz\n",
+                 latency_us, info->min_rate_hz, info->latency_us, info->rate_mhz);
+    return ret;
+}
+
+/**
+ * max30102_qos_set - Set, change or clear the request of an open file
+ * @mf: Open file, the caller holds the lock
+ * @qos: Request, both bounds 0 clears it
+ * Returns: 0 on success, -ERANGE if the sample rate cannot meet the request
+ *          even with no averaging, negative error code on other failures
+ */
+int max30102_qos_set(struct max30102_file *mf, const struct max30102_qos *qos)
+{
+    struct max30102_data *data = mf->data;
+    struct max30102_qos_choice c;
+    uint8_t enable;
+    int ret;
+
+    if (!qos->max_latency_us && !qos->min_rate_hz) {
+        if (list_empty(&mf->qos_node)) return 0;
+        list_del_init(&mf->qos_node);
+        return max30102_qos_update(data);
+    }
+    // Other requests only make the choice stricter, a request that cannot
+    // be met on its own is refused
+    if (!max30102_qos_choose(data, qos->max_latency_us, (u64)qos->min_rate_hz * MAX30102_QOS_MHZ, &c))
+        return -ERANGE;
+
+    if (!data->qos_active) {
+        if (data->irq_masked) {
+            enable = data->mitigate_restore;  // Masked on the chip while mitigation polls
+        } else {
+            ret = max30102_read_reg(data, MAX30102_REG_INTERRUPT_ENABLE_1, &enable, 1);
+            if (ret < 0) return ret;
+        }
+        data->qos_base_fifo = data->profile.fifo_config;
+        data->qos_base_ppg = enable & (1 << MAX30102_INT_PPG_RDY);
+        data->qos_active = true;
+    }
+    mf->qos = *qos;
+    if (list_empty(&mf->qos_node))
+        list_add_tail(&mf->qos_node, &data->qos_requests);
+    return max30102_qos_update(data);
+}
+
+/**
+ * max30102_qos_release - Drop the request of a file being closed
+ * @mf: Open file, the caller holds the lock
+ */
+void max30102_qos_release(struct max30102_file *mf)
+{
+    int ret;
+
+    if (list_empty(&mf->qos_node)) return;
+    list_del_init(&mf->qos_node);
+    ret = max30102_qos_update(mf->data);
+    if (ret < 0)
+        dev_err(&mf->data->client->dev, "Failed to apply QoS after close: %d\n", ret);
+}
+
+/**
+ * max30102_qos_resume - Apply the requests again after a bring-up
+ * @data: MAX30102 device data
+ *
+ * The bring-up restores the FIFO configuration from the profile, but enables
+ * PPG_RDY whatever the requests chose.
+ */
+void max30102_qos_resume(struct max30102_data *data)
+{
+    int ret;
+
+    mutex_lock(&data->lock);
+    ret = max30102_qos_update(data);
+    max30102_unlock(data);
+    if (ret < 0)
+        dev_err(&data->client->dev, "Failed to apply QoS after bring-up: %d\n", ret);
+}
+
+static int max30102_qos_show(struct seq_file *m, void *v)
+{
+    struct max30102_data *data = m->private;
+    struct max30102_qos_info info;
+
+    mutex_lock(&data->lock);
+    info = data->qos_info;
+    max30102_unlock(data);
+    seq_printf(m, "requests: %u\n", info.requests);
+    seq_printf(m, "max_latency_us: %u\n", info.max_latency_us);
+    seq_printf(m, "min_rate_hz: %u\n", info.min_rate_hz);
+    seq_printf(m, "latency_us: %u\n", info.latency_us);
+    seq_printf(m, "rate_mhz: %u\n", info.rate_mhz);
+    seq_printf(m, "wakeups_mhz: %u\n", info.wakeups_mhz);
+    seq_printf(m, "average: %u\n", info.average);
+    seq_printf(m, "watermark: %u\n", info.watermark);
+    seq_printf(m, "ppg_rdy: %u\n", info.ppg_rdy);
+    seq_printf(m, "met: %u\n", info.met);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max30102_qos);
+
+/**
+ * max30102_qos_init - Add the debugfs entry
+ * @data: MAX30102 device data, after the debugfs directory
+ */
+void max30102_qos_init(struct max30102_data *data)
+{
+    debugfs_create_file("qos", 0444, data->debug_dir, data, &max30102_qos_fops);
+}
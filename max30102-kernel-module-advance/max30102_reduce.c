@@ -0,0 +1,286 @@
+#include <linux/fs.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+#include "max30102.h"
+
+/*
+ * Per-open reduction stage.
+ *
+ * A reader that only wants trend data sets a stage with
+ * MAX30102_IOC_SET_REDUCE. The drain then feeds every sample to the stage of
+ * each such file, and read() on it returns struct max30102_reduced records,
+ * one per factor input samples:
+ *
+ * - CIC: a decimator of order integrator and comb stages, normalised by its
+ *   gain factor ^ order. Order 1 is a boxcar mean, higher orders reject more
+ *   of the band that aliases onto the output rate.
+ * - Envelope: the mean, min and max of each window.
+ * - FIR: up to 32 taps with fixed-point coefficients. The delay line takes
+ *   every sample, the dot product is only evaluated once per window.
+ *
+ * Each file has its own queue and wait queue, so a 25 Hz reader is woken and
+ * copies data at 25 Hz whatever the sensor rate. A change of mode or slots
+ * restarts the filters. The drain never waits on a reader: when the queue is
+ * full new records are dropped and counted in the next one queued.
+ */
+
+/**
+ * max30102_reduce_reset - Restart the filters and empty the queue
+ * @r: Reducer
+ *
+ * Called with the device lock held, so no drain is feeding it.
+ */
+static void max30102_reduce_reset(struct max30102_reducer *r)
+{
+    memset(&r->st, 0, sizeof(r->st));
+    memset(&r->layout, 0, sizeof(r->layout));
+    spin_lock(&r->lock);
+    r->head = r->tail = 0;
+    spin_unlock(&r->lock);
+}
+
+/**
+ * max30102_reduce_set - Set, change or clear the stage of an open file
+ * @mf: Open file, the caller holds the device lock
+ * @config: Stage to set, MAX30102_REDUCE_NONE clears it
+ * Returns: 0 on success, negative error code on failure
+ */
+int max30102_reduce_set(struct max30102_file *mf, const struct max30102_reduce_config *config)
+{
+    struct max30102_reducer *r = mf->reducer;
+    int i;
+
+    switch (config->type) {
+    case MAX30102_REDUCE_NONE:
+        if (r && !list_empty(&r->node)) {
+            list_del_init(&r->node);
+            WRITE_ONCE(r->config.type, MAX30102_REDUCE_NONE);
+        }
+        return 0;
+    case MAX30102_REDUCE_CIC:
+        if (config->order < 1 || config->order > MAX30102_REDUCE_MAX_ORDER) return -EINVAL;
+        break;
+    case MAX30102_REDUCE_ENVELOPE:
+        break;
+    case MAX30102_REDUCE_FIR:
+        if (config->taps < 1 || config->taps > MAX30102_REDUCE_MAX_TAPS || config->shift > 30) return -EINVAL;
+        break;
+    default:
+        return -EINVAL;
+    }
+    if (config->factor < 1 || config->factor > MAX30102_REDUCE_MAX_FACTOR) return -EINVAL;
+
+    if (!r) {
+        r = kzalloc(sizeof(*r), GFP_KERNEL);
+        if (!r) return -ENOMEM;
+        INIT_LIST_HEAD(&r->node);
+        init_waitqueue_head(&r->wait);
+        spin_lock_init(&r->lock);
+        mf->reducer = r;
+    }
+
+    max30102_reduce_reset(r);
+    r->config = *config;
+    r->gain = 1;
+    if (config->type == MAX30102_REDUCE_CIC) {
+        for (i = 0; i < config->order; i++)
+            r->gain *= config->factor;  // At most 2^40
+    }
+    if (list_empty(&r->node))
+        list_add_tail(&r->node, &mf->data->reducers);
+    return 0;
+}
+
+/**
+ * max30102_reduce_release - Drop the stage of a file being closed
+ * @mf: Open file, the caller holds the device lock
+ */
+void max30102_reduce_release(struct max30102_file *mf)
+{
+    if (!mf->reducer) return;
+    list_del(&mf->reducer->node);
+    kfree(mf->reducer);
+    mf->reducer = NULL;
+}
+
+/**
+ * max30102_reduce_active - Check whether reads on the file go through a stage
+ * @mf: Open file
+ * Returns: true if a stage is set
+ */
+bool max30102_reduce_active(struct max30102_file *mf)
+{
+    return mf->reducer && READ_ONCE(mf->reducer->config.type) != MAX30102_REDUCE_NONE;
+}
+
+/**
+ * max30102_reduce_emit - Close the current window into a queued record
+ * @r: Reducer
+ * @seq: Sequence number of the window's last sample
+ * Returns: true if the record was queued
+ *
+ * The window is closed whether or not the record fits, so the record after
+ * a drop still covers one window and is scaled for one.
+ */
+static bool max30102_reduce_emit(struct max30102_reducer *r, u64 seq)
+{
+    const struct max30102_reduce_config *cfg = &r->config;
+    struct max30102_reduced rec;
+    bool queued;
+    u64 v, y;
+    s64 acc;
+    int c, k, j;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.seq = seq;
+    rec.mask = r->layout.mask;
+    rec.channels = r->layout.channels;
+    memcpy(rec.led, r->layout.led, sizeof(rec.led));
+
+    for (c = 0; c < r->layout.channels; c++) {
+        switch (cfg->type) {
+        case MAX30102_REDUCE_CIC:
+            // Combs at the output rate, differences are exact in modular arithmetic
+            v = r->st.integ[c][cfg->order - 1];
+            for (k = 0; k < cfg->order; k++) {
+                y = v - r->st.comb[c][k];
+                r->st.comb[c][k] = v;
+                v = y;
+            }
+            rec.value[c] = div64_u64(v, r->gain);
+            break;
+        case MAX30102_REDUCE_ENVELOPE:
+            rec.value[c] = div_s64(r->st.sum[c], cfg->factor);
+            rec.min[c] = r->st.min[c];
+            rec.max[c] = r->st.max[c];
+            r->st.sum[c] = 0;
+            break;
+        case MAX30102_REDUCE_FIR:
+            acc = 0;
+            for (j = 0; j < cfg->taps; j++)
+                acc += (s64)cfg->coef[j] * r->st.line[c][(r->st.pos - 1 - j) & (MAX30102_REDUCE_MAX_TAPS - 1)];
+            rec.value[c] = acc >> cfg->shift;
+            break;
+        }
+    }
+
+    spin_lock(&r->lock);
+    queued = r->head - r->tail < MAX30102_REDUCE_QUEUE;
+    if (queued) {
+        rec.dropped = r->st.dropped;
+        r->queue[r->head++ & (MAX30102_REDUCE_QUEUE - 1)] = rec;
+    }
+    spin_unlock(&r->lock);
+    if (!queued) {
+        if (r->st.dropped < U16_MAX) r->st.dropped++;
+        return false;
+    }
+    r->st.dropped = 0;
+    return true;
+}
+
+/**
+ * max30102_reduce_feed - Feed a drain to every file with a stage
+ * @data: MAX30102 device data, the caller holds the device lock
+ * @layout: Layout the samples were drained with
+ * @samples: Decoded samples
+ * @len: Number of samples
+ * @seq: Sequence number of the first sample
+ */
+void max30102_reduce_feed(struct max30102_data *data, const struct max30102_layout *layout,
+                          uint32_t (*samples)[MAX30102_MAX_CHANNELS], uint8_t len, u64 seq)
+{
+    struct max30102_reducer *r;
+    bool queued;
+    s32 x;
+    int i, c, k;
+
+    list_for_each_entry(r, &data->reducers, node) {
+        if (memcmp(&r->layout, layout, sizeof(*layout))) {
+            memset(&r->st, 0, sizeof(r->st));  // New channels, the old state means nothing
+            r->layout = *layout;
+        }
+        queued = false;
+        for (i = 0; i < len; i++) {
+            for (c = 0; c < layout->channels; c++) {
+                x = samples[i][c];
+                switch (r->config.type) {
+                case MAX30102_REDUCE_CIC:
+                    r->st.integ[c][0] += x;
+                    for (k = 1; k < r->config.order; k++)
+                        r->st.integ[c][k] += r->st.integ[c][k - 1];
+                    break;
+                case MAX30102_REDUCE_ENVELOPE:
+                    if (!r->st.count || x < r->st.min[c]) r->st.min[c] = x;
+                    if (!r->st.count || x > r->st.max[c]) r->st.max[c] = x;
+                    r->st.sum[c] += x;
+                    break;
+                case MAX30102_REDUCE_FIR:
+                    r->st.line[c][r->st.pos] = x;
+                    break;
+                }
+            }
+            r->st.pos = (r->st.pos + 1) & (MAX30102_REDUCE_MAX_TAPS - 1);
+            if (++r->st.count == r->config.factor) {
+                queued |= max30102_reduce_emit(r, seq + i);
+                r->st.count = 0;
+            }
+        }
+        if (queued)
+            wake_up_interruptible(&r->wait);
+    }
+}
+
+/**
+ * max30102_reduce_ready - Check whether a record is queued
+ * @r: Reducer
+ * Returns: true if read() would not block
+ */
+bool max30102_reduce_ready(struct max30102_reducer *r)
+{
+    bool ready;
+
+    spin_lock(&r->lock);
+    ready = r->head != r->tail;
+    spin_unlock(&r->lock);
+    return ready;
+}
+
+/**
+ * max30102_reduce_read - Copy queued records
+ * @r: Reducer
+ * @to: Destination, whole records are copied
+ * @nonblock: Return -EAGAIN instead of waiting for a record
+ * Returns: Bytes copied, negative error code on failure
+ */
+ssize_t max30102_reduce_read(struct max30102_reducer *r, struct iov_iter *to, bool nonblock)
+{
+    struct max30102_reduced rec;
+    ssize_t done = 0;
+    int ret;
+
+    if (iov_iter_count(to) < sizeof(rec)) return -EINVAL;
+    if (nonblock) {
+        if (!max30102_reduce_ready(r)) return -EAGAIN;
+    } else {
+        ret = wait_event_interruptible(r->wait, max30102_reduce_ready(r));
+        if (ret < 0) return ret;
+    }
+
+    while (iov_iter_count(to) >= sizeof(rec)) {
+        spin_lock(&r->lock);
+        if (r->head == r->tail) {
+            spin_unlock(&r->lock);
+            break;
+        }
+        rec = r->queue[r->tail & (MAX30102_REDUCE_QUEUE - 1)];
+        r->tail++;
+        spin_unlock(&r->lock);
+
+        if (copy_to_iter(&rec, sizeof(rec), to) != sizeof(rec))
+            return done ? done : -EFAULT;
+        done += sizeof(rec);
+    }
+    return done;
+}
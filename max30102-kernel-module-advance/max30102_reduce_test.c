@@ -0,0 +1,117 @@
+#include <kunit/test.h>
+#include "max30102_reduce.c"  // Tests the stage on its own, statics included
+
+/*
+ * KUnit tests for the reduction stage, built as their own module with
+ * `make kunit` and run when it is loaded.
+ *
+ * Every test feeds a constant, so each record's value is that constant once
+ * the filters have settled, whatever the type and order.
+ */
+
+#define MAX30102_REDUCE_TEST_VALUE      1000
+#define MAX30102_REDUCE_TEST_FACTOR     4
+#define MAX30102_REDUCE_TEST_DROPS      2
+
+/**
+ * max30102_reduce_test_feed - Feed constant samples in drain-sized batches
+ * @data: MAX30102 device data
+ * @layout: One red channel
+ * @n: Samples
+ * @seq: Sequence number of the next sample, advanced past them
+ */
+static void max30102_reduce_test_feed(struct max30102_data *data, const struct max30102_layout *layout, u32 n,
+                                      u64 *seq)
+{
+    uint32_t samples[32][MAX30102_MAX_CHANNELS];
+    u32 i, len;
+
+    for (i = 0; i < ARRAY_SIZE(samples); i++)
+        samples[i][0] = MAX30102_REDUCE_TEST_VALUE;
+    while (n) {
+        len = min_t(u32, n, ARRAY_SIZE(samples));
+        max30102_reduce_feed(data, layout, samples, len, *seq);
+        *seq += len;
+        n -= len;
+    }
+}
+
+/**
+ * max30102_reduce_test_drop - Check the first record after the queue overflowed
+ * @test: KUnit test
+ * @type: Stage type
+ * @order: CIC order
+ *
+ * Fills the queue without reading and drops two more windows. The next
+ * record must count the drops and still cover a single window.
+ */
+static void max30102_reduce_test_drop(struct kunit *test, uint8_t type, uint8_t order)
+{
+    struct max30102_reduce_config config = { .type = type, .factor = MAX30102_REDUCE_TEST_FACTOR, .order = order };
+    struct max30102_layout layout = { .channels = 1, .mask = 0x01, .led = { MAX30102_SLOT1_RED } };
+    struct max30102_data *data;
+    struct max30102_file *mf;
+    struct max30102_reducer *r;
+    struct max30102_reduced *rec;
+    u64 seq = 0;
+
+    data = kunit_kzalloc(test, sizeof(*data), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, data);
+    mf = kunit_kzalloc(test, sizeof(*mf), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, mf);
+    INIT_LIST_HEAD(&data->reducers);
+    mf->data = data;
+    KUNIT_ASSERT_EQ(test, max30102_reduce_set(mf, &config), 0);
+    r = mf->reducer;
+
+    max30102_reduce_test_feed(data, &layout,
+                              (MAX30102_REDUCE_QUEUE + MAX30102_REDUCE_TEST_DROPS) * MAX30102_REDUCE_TEST_FACTOR, &seq);
+    KUNIT_EXPECT_EQ(test, r->head - r->tail, (u32)MAX30102_REDUCE_QUEUE);
+    KUNIT_EXPECT_EQ(test, (int)r->st.dropped, MAX30102_REDUCE_TEST_DROPS);
+
+    r->tail = r->head;  // The reader catches up
+    max30102_reduce_test_feed(data, &layout, MAX30102_REDUCE_TEST_FACTOR, &seq);
+    KUNIT_ASSERT_EQ(test, r->head - r->tail, 1U);
+    rec = &r->queue[r->tail & (MAX30102_REDUCE_QUEUE - 1)];
+    KUNIT_EXPECT_EQ(test, (int)rec->dropped, MAX30102_REDUCE_TEST_DROPS);
+    KUNIT_EXPECT_EQ(test, rec->seq, seq - 1);
+    KUNIT_EXPECT_EQ(test, rec->value[0], MAX30102_REDUCE_TEST_VALUE);
+    if (type == MAX30102_REDUCE_ENVELOPE) {
+        KUNIT_EXPECT_EQ(test, rec->min[0], MAX30102_REDUCE_TEST_VALUE);
+        KUNIT_EXPECT_EQ(test, rec->max[0], MAX30102_REDUCE_TEST_VALUE);
+    }
+    KUNIT_EXPECT_EQ(test, (int)r->st.dropped, 0);
+
+    max30102_reduce_release(mf);
+}
+
+static void max30102_reduce_test_cic1_drop(struct kunit *test)
+{
+    max30102_reduce_test_drop(test, MAX30102_REDUCE_CIC, 1);
+}
+
+static void max30102_reduce_test_cic3_drop(struct kunit *test)
+{
+    max30102_reduce_test_drop(test, MAX30102_REDUCE_CIC, 3);
+}
+
+static void max30102_reduce_test_envelope_drop(struct kunit *test)
+{
+    max30102_reduce_test_drop(test, MAX30102_REDUCE_ENVELOPE, 0);
+}
+
+static struct kunit_case max30102_reduce_test_cases[] = {
+    KUNIT_CASE(max30102_reduce_test_cic1_drop),
+    KUNIT_CASE(max30102_reduce_test_cic3_drop),
+    KUNIT_CASE(max30102_reduce_test_envelope_drop),
+    {}
+};
+
+static struct kunit_suite max30102_reduce_test_suite = {
+    .name = "max30102_reduce",
+    .test_cases = max30102_reduce_test_cases,
+};
+kunit_test_suite(max30102_reduce_test_suite);
+
+MODULE_DESCRIPTION("MAX30102 reduction stage KUnit tests");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,418 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <linux/fuse.h>
+#include "driver_max30102_replay.h"
+#include "max30102.h"  // After the library headers: its mode macros shadow their enums
+
+/*
+ * max30102_replay - fake /dev/max30102-* node backed by a recording.
+ *
+ * Speaks the CUSE protocol on /dev/cuse directly (no libfuse), so the
+ * character device exposes the same ABI as the kernel driver: read() and
+ * MAX30102_IOC_READ_FIFO return struct max30102_fifo_data, READ_CHANNELS
+ * struct max30102_channel_data, READ_TEMP a float, the SET_* ioctls are
+ * accepted, GET_QOS reports no request, and poll() reports POLLIN when the emulated A_FULL interrupt
+ * fires. Samples come from the library replay
+ * engine, which mmaps the recording and paces it in real time, N times
+ * faster, or as fast as the readers drain it. max30102d, max30102_app and
+ * anything else written against the driver run unmodified on top of it.
+ *
+ * Restricted CUSE ioctls are enough here: every command is encoded with
+ * _IOR/_IOW, so the kernel copies the argument in and out for us.
+ */
+
+#define CUSE_BUF_SIZE      (FUSE_MIN_READ_BUFFER + 4096)
+#define MAX_PENDING_READS  64
+#define MAX_POLL_HANDLES   64
+
+struct pending_read {
+    uint64_t unique;
+};
+
+static int cuse_fd = -1;
+static const char *record_path;
+static max30102_replay_pacing_t pacing = MAX30102_REPLAY_PACING_REALTIME;
+static float speed = 1.0f;
+static int loop_replay;
+static float temperature = 25.0f;
+static struct pending_read pending[MAX_PENDING_READS];
+static unsigned int pending_count;
+static uint64_t poll_kh[MAX_POLL_HANDLES];
+static unsigned int poll_count;
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static int reply(uint64_t unique, int error, const void *arg, size_t argsize) {
+    struct fuse_out_header out = {
+        .len = sizeof(out) + (error ? 0 : argsize),
+        .error = error,
+        .unique = unique,
+    };
+    struct iovec iov[2] = {
+        { .iov_base = &out, .iov_len = sizeof(out) },
+        { .iov_base = (void *)arg, .iov_len = error ? 0 : argsize },
+    };
+
+    if (writev(cuse_fd, iov, 2) < 0 && errno != ENOENT) {  // ENOENT: request was interrupted
+        perror("cuse reply");
+        return -errno;
+    }
+    return 0;
+}
+
+/* Replay side */
+
+static int replay_start(void) {
+    uint8_t v;
+
+    if (max30102_replay_open(record_path, pacing, speed) != 0) {
+        fprintf(stderr, "Cannot replay %s\n", record_path);
+        return -EINVAL;
+    }
+    max30102_replay_set_temperature(temperature);
+
+    // Same bring-up as max30102_init_sensor(), but only A_FULL drives the
+    // pin: the driver's fifo_full flag is what readers actually wait on.
+    v = MAX30102_FIFO_SMP_AVE_8;
+    max30102_replay_iic_write(MAX30102_ADDRESS, MAX30102_REG_FIFO_CONFIG, &v, 1);
+    v = MAX30102_SPO2_CONFIG_DEFAULT;
+    max30102_replay_iic_write(MAX30102_ADDRESS, MAX30102_REG_SPO2_CONFIG, &v, 1);
+    v = 0x80;
+    max30102_replay_iic_write(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_ENABLE_1, &v, 1);
+    max30102_replay_iic_read(MAX30102_ADDRESS, MAX30102_REG_INTERRUPT_STATUS_1, &v, 1);  // Clear PWR_RDY
+    v = MAX30102_MODE_SPO2;
+    max30102_replay_iic_write(MAX30102_ADDRESS, MAX30102_REG_MODE_CONFIG, &v, 1);  // Starts the clock
+    return 0;
+}
+
+// 1 if a reader would be woken, 0 if not, -1 at the end of the recording
+static int replay_ready(void) {
+    uint8_t res = max30102_replay_wait(0);
+
+    if (res == 0)
+        return 1;
+    if (res == 4) {
+        if (!loop_replay)
+            return -1;
+        max30102_replay_close();
+        if (replay_start() < 0)
+            return -1;
+        return replay_ready();
+    }
+    return 0;
+}
+
+static void replay_drain(struct max30102_fifo_data *fifo) {
+    uint8_t len = 32;
+
+    memset(fifo, 0, sizeof(*fifo));
+    max30102_replay_fifo_read(fifo->red, fifo->ir, &len, NULL);
+    fifo->len = len;
+}
+
+static void replay_drain_channels(struct max30102_channel_data *out) {
+    struct max30102_fifo_data fifo;
+    max30102_record_header_t header;
+    int i;
+
+    replay_drain(&fifo);
+    memset(out, 0, sizeof(*out));
+    out->channels = max30102_replay_get_header(&header) == 0 ? header.channels : 2;
+    out->mask = out->channels == 1 ? 0x01 : 0x03;  // Recordings hold red, or red and IR
+    out->led[0] = 1;
+    out->led[1] = out->channels == 1 ? 0 : 2;
+    out->len = fifo.len;
+    for (i = 0; i < fifo.len; i++) {
+        out->sample[i][0] = fifo.red[i];
+        out->sample[i][1] = out->channels == 1 ? 0 : fifo.ir[i];
+    }
+}
+
+/* CUSE requests */
+
+static void do_init(uint64_t unique) {
+    char info[64];
+    uint8_t buf[sizeof(struct cuse_init_out) + sizeof(info)];
+    struct cuse_init_out out = {
+        .major = FUSE_KERNEL_VERSION,
+        .minor = FUSE_KERNEL_MINOR_VERSION,
+        .max_read = sizeof(struct max30102_fifo_data),
+        .max_write = 64,
+    };
+    int n;
+
+    n = snprintf(info, sizeof(info), "DEVNAME=%s", getenv("MAX30102_REPLAY_NAME") ?
+                 getenv("MAX30102_REPLAY_NAME") : "max30102-replay");
+    memcpy(buf, &out, sizeof(out));
+    memcpy(buf + sizeof(out), info, n + 1);
+    reply(unique, 0, buf, sizeof(out) + n + 1);
+}
+
+static void do_read(uint64_t unique, const struct fuse_read_in *in) {
+    struct max30102_fifo_data fifo;
+    int ready;
+
+    if (in->size < sizeof(fifo)) {
+        reply(unique, -EINVAL, NULL, 0);
+        return;
+    }
+    ready = replay_ready();
+    if (ready > 0) {
+        replay_drain(&fifo);
+        reply(unique, 0, &fifo, sizeof(fifo));
+    } else if (ready < 0) {
+        reply(unique, 0, NULL, 0);  // End of the recording reads as EOF
+    } else if (in->flags & O_NONBLOCK) {
+        reply(unique, -EAGAIN, NULL, 0);
+    } else if (pending_count == MAX_PENDING_READS) {
+        reply(unique, -EBUSY, NULL, 0);
+    } else {
+        pending[pending_count++].unique = unique;  // Answered from the main loop
+    }
+}
+
+static void do_ioctl(uint64_t unique, const struct fuse_ioctl_in *in) {
+    uint8_t buf[sizeof(struct fuse_ioctl_out) + sizeof(struct max30102_channel_data)];
+    struct fuse_ioctl_out out = { 0 };
+    size_t size = 0;
+
+    switch (in->cmd) {
+    case MAX30102_IOC_READ_FIFO: {
+        struct max30102_fifo_data fifo;
+        replay_drain(&fifo);
+        memcpy(buf + sizeof(out), &fifo, sizeof(fifo));
+        size = sizeof(fifo);
+        break;
+    }
+    case MAX30102_IOC_READ_CHANNELS: {
+        struct max30102_channel_data channels;
+        replay_drain_channels(&channels);
+        memcpy(buf + sizeof(out), &channels, sizeof(channels));
+        size = sizeof(channels);
+        break;
+    }
+    case MAX30102_IOC_READ_TEMP:
+        memcpy(buf + sizeof(out), &temperature, sizeof(temperature));
+        size = sizeof(temperature);
+        break;
+    case MAX30102_IOC_GET_QOS:
+        memset(buf + sizeof(out), 0, sizeof(struct max30102_qos_info));  // No request is ever applied
+        size = sizeof(struct max30102_qos_info);
+        break;
+    case MAX30102_IOC_SET_MODE:
+    case MAX30102_IOC_SET_SLOT:
+    case MAX30102_IOC_SET_FIFO_CONFIG:
+    case MAX30102_IOC_SET_SPO2_CONFIG:
+    case MAX30102_IOC_SET_QOS:
+        break;  // The recording fixes the configuration
+    default:
+        reply(unique, -ENOTTY, NULL, 0);
+        return;
+    }
+    if (size > in->out_size) {
+        reply(unique, -EINVAL, NULL, 0);
+        return;
+    }
+    memcpy(buf, &out, sizeof(out));
+    reply(unique, 0, buf, sizeof(out) + size);
+}
+
+static void do_poll(uint64_t unique, const struct fuse_poll_in *in) {
+    struct fuse_poll_out out = { 0 };
+
+    if (replay_ready() != 0)
+        out.revents = POLLIN | POLLRDNORM;
+    else if ((in->flags & FUSE_POLL_SCHEDULE_NOTIFY) && poll_count < MAX_POLL_HANDLES)
+        poll_kh[poll_count++] = in->kh;
+    reply(unique, 0, &out, sizeof(out));
+}
+
+static void do_interrupt(const struct fuse_interrupt_in *in) {
+    unsigned int i;
+
+    for (i = 0; i < pending_count; i++) {
+        if (pending[i].unique == in->unique) {
+            reply(in->unique, -EINTR, NULL, 0);
+            pending[i] = pending[--pending_count];
+            return;
+        }
+    }
+}
+
+static void handle_request(const uint8_t *buf, size_t len) {
+    const struct fuse_in_header *in = (const struct fuse_in_header *)buf;
+    const void *arg = buf + sizeof(*in);
+
+    if (len < sizeof(*in) || in->len != len)
+        return;
+
+    switch (in->opcode) {
+    case CUSE_INIT:
+        do_init(in->unique);
+        break;
+    case FUSE_OPEN: {
+        struct fuse_open_out out = { .open_flags = FOPEN_DIRECT_IO | FOPEN_NONSEEKABLE };
+        reply(in->unique, 0, &out, sizeof(out));
+        break;
+    }
+    case FUSE_READ:
+        do_read(in->unique, arg);
+        break;
+    case FUSE_WRITE: {
+        const struct fuse_write_in *w = arg;
+        struct fuse_write_out out = { .size = w->size };
+        reply(in->unique, w->size == 1 ? 0 : -EINVAL, &out, sizeof(out));
+        break;
+    }
+    case FUSE_IOCTL:
+        do_ioctl(in->unique, arg);
+        break;
+    case FUSE_POLL:
+        do_poll(in->unique, arg);
+        break;
+    case FUSE_INTERRUPT:
+        do_interrupt(arg);  // No reply to the interrupt itself
+        break;
+    case FUSE_FLUSH:
+    case FUSE_RELEASE:
+        reply(in->unique, 0, NULL, 0);
+        break;
+    default:
+        reply(in->unique, -ENOSYS, NULL, 0);
+        break;
+    }
+}
+
+/* Wake blocked readers and pollers once the emulated interrupt fires */
+static void service_waiters(void) {
+    struct max30102_fifo_data fifo;
+    unsigned int i;
+    int ready;
+
+    if (pending_count == 0 && poll_count == 0)
+        return;
+    ready = replay_ready();
+    if (ready == 0)
+        return;
+
+    if (pending_count) {
+        if (ready > 0) {
+            replay_drain(&fifo);
+            reply(pending[0].unique, 0, &fifo, sizeof(fifo));
+        } else {
+            reply(pending[0].unique, 0, NULL, 0);
+        }
+        memmove(&pending[0], &pending[1], --pending_count * sizeof(pending[0]));
+    }
+    for (i = 0; i < poll_count; i++) {
+        struct fuse_out_header out = {
+            .len = sizeof(out) + sizeof(struct fuse_notify_poll_wakeup_out),
+            .error = FUSE_NOTIFY_POLL,
+        };
+        struct fuse_notify_poll_wakeup_out wake = { .kh = poll_kh[i] };
+        struct iovec iov[2] = {
+            { .iov_base = &out, .iov_len = sizeof(out) },
+            { .iov_base = &wake, .iov_len = sizeof(wake) },
+        };
+        if (writev(cuse_fd, iov, 2) < 0)
+            perror("cuse poll notify");
+    }
+    poll_count = 0;
+}
+
+static int next_timeout_ms(void) {
+    struct timespec ts;
+    uint64_t next, now;
+
+    if (pending_count == 0 && poll_count == 0)
+        return -1;
+    if (max30102_replay_next_ns(&next) != 0)
+        return loop_replay ? 0 : -1;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    return next <= now ? 0 : (int)((next - now + 999999) / 1000000);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s <recording> [--speed=<x> | --fast] [--loop] [--temp=<C>]\n"
+                    "Creates /dev/$MAX30102_REPLAY_NAME (default max30102-replay).\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    static uint8_t buf[CUSE_BUF_SIZE];
+    struct sigaction sa = { .sa_handler = signal_handler };
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--speed=", 8) == 0) {
+            pacing = MAX30102_REPLAY_PACING_ACCELERATED;
+            speed = strtof(argv[i] + 8, NULL);
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            pacing = MAX30102_REPLAY_PACING_FAST;
+        } else if (strcmp(argv[i], "--loop") == 0) {
+            loop_replay = 1;
+        } else if (strncmp(argv[i], "--temp=", 7) == 0) {
+            temperature = strtof(argv[i] + 7, NULL);
+        } else if (argv[i][0] != '-' && !record_path) {
+            record_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!record_path) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (replay_start() < 0)
+        return 1;
+
+    cuse_fd = open("/dev/cuse", O_RDWR | O_CLOEXEC);
+    if (cuse_fd < 0) {
+        perror("open /dev/cuse");
+        return 1;
+    }
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    while (running) {
+        struct pollfd pfd = { .fd = cuse_fd, .events = POLLIN };
+        int n = poll(&pfd, 1, next_timeout_ms());
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+        if (n > 0) {
+            ssize_t len = read(cuse_fd, buf, sizeof(buf));
+            if (len < 0) {
+                if (errno == EINTR || errno == ENOENT || errno == EAGAIN)
+                    continue;
+                if (errno == ENODEV)  // Device torn down
+                    break;
+                perror("read /dev/cuse");
+                break;
+            }
+            handle_request(buf, len);
+        }
+        service_waiters();
+    }
+
+    close(cuse_fd);
+    max30102_replay_close();
+    return 0;
+}
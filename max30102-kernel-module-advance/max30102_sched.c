@@ -0,0 +1,203 @@
+#include <linux/list_sort.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include "max30102.h"
+
+/*
+ * Per-bus drain scheduler.
+ *
+ * Every MAX30102 answers at 0x57, so racks put them behind PCA954x muxes,
+ * and each access to a sensor on another channel costs a mux switch. Instead
+ * of one work item per sensor, every sensor on a root adapter kicks one
+ * shared work item. The work takes all pending sensors as a batch, sorts
+ * them by mux channel, starting with the channel left selected by the last
+ * drain, and drains them one after the other. All bus operations for a
+ * sensor, including a deferred poll reconfiguration, stay contiguous, and
+ * each channel is selected once per batch. A sensor whose lock an ioctl
+ * holds is skipped, not waited for, and queued again when the ioctl unlocks.
+ */
+
+struct max30102_sched {
+    struct list_head node;      // In max30102_scheds
+    struct i2c_adapter *root;
+    int refs;
+    spinlock_t lock;            // Protects pending and each sensor's sched_node
+    struct list_head pending;
+    struct work_struct work;
+    struct i2c_adapter *last;   // Channel selected by the last drain
+    ktime_t start;
+    u64 busy_ns;                // Time spent draining
+    u64 batches;
+    u64 drains;
+    u64 switches;               // Drains that moved to another channel
+    u32 max_batch;
+    struct dentry *debug_dir;
+};
+
+static LIST_HEAD(max30102_scheds);
+static DEFINE_MUTEX(max30102_scheds_lock);
+
+static int max30102_sched_cmp(void *priv, const struct list_head *a, const struct list_head *b)
+{
+    struct max30102_sched *sched = priv;
+    struct i2c_adapter *x = list_entry(a, struct max30102_data, sched_node)->client->adapter;
+    struct i2c_adapter *y = list_entry(b, struct max30102_data, sched_node)->client->adapter;
+
+    if (x == y) return 0;
+    if (x == sched->last) return -1;  // Already selected, no switch
+    if (y == sched->last) return 1;
+    return x->nr - y->nr;
+}
+
+static void max30102_sched_work(struct work_struct *work)
+{
+    struct max30102_sched *sched = container_of(work, struct max30102_sched, work);
+    struct max30102_data *data;
+    LIST_HEAD(batch);
+    ktime_t t0;
+    u32 n = 0;
+
+    spin_lock_irq(&sched->lock);
+    list_splice_init(&sched->pending, &batch);
+    spin_unlock_irq(&sched->lock);
+    if (list_empty(&batch)) return;
+
+    list_sort(sched, &batch, max30102_sched_cmp);
+    t0 = ktime_get();
+    for (;;) {
+        spin_lock_irq(&sched->lock);
+        data = list_first_entry_or_null(&batch, struct max30102_data, sched_node);
+        if (data)
+            list_del_init(&data->sched_node);  // A kick from now on queues it again
+        spin_unlock_irq(&sched->lock);
+        if (!data) break;
+
+        if (data->client->adapter != sched->last) {
+            if (sched->last) sched->switches++;
+            sched->last = data->client->adapter;
+        }
+        max30102_drain(data);
+        n++;
+    }
+    sched->busy_ns += ktime_to_ns(ktime_sub(ktime_get(), t0));
+    sched->batches++;
+    sched->drains += n;
+    sched->max_batch = max(sched->max_batch, n);
+}
+
+static int max30102_sched_utilization_show(struct seq_file *m, void *v)
+{
+    struct max30102_sched *sched = m->private;
+    u64 elapsed = ktime_to_ns(ktime_sub(ktime_get(), sched->start));
+
+    seq_printf(m, "adapter: %s\n", sched->root->name);
+    seq_printf(m, "utilization_permille: %llu\n", elapsed ? div64_u64(sched->busy_ns * 1000, elapsed) : 0);
+    seq_printf(m, "busy_ns: %llu\n", sched->busy_ns);
+    seq_printf(m, "batches: %llu\n", sched->batches);
+    seq_printf(m, "drains: %llu\n", sched->drains);
+    seq_printf(m, "channel_switches: %llu\n", sched->switches);
+    seq_printf(m, "max_batch: %u\n", sched->max_batch);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(max30102_sched_utilization);
+
+/**
+ * max30102_sched_attach - Join the scheduler of the sensor's root adapter
+ * @data: MAX30102 device data
+ * Returns: 0 on success, negative error code on failure
+ */
+int max30102_sched_attach(struct max30102_data *data)
+{
+    struct i2c_adapter *root = i2c_root_adapter(&data->client->adapter->dev);
+    struct max30102_sched *sched;
+    char name[24];
+
+    INIT_LIST_HEAD(&data->sched_node);
+    data->sched_detached = false;
+
+    mutex_lock(&max30102_scheds_lock);
+    list_for_each_entry(sched, &max30102_scheds, node) {
+        if (sched->root == root) goto found;
+    }
+    sched = kzalloc(sizeof(*sched), GFP_KERNEL);
+    if (!sched) {
+        mutex_unlock(&max30102_scheds_lock);
+        return -ENOMEM;
+    }
+    sched->root = root;
+    spin_lock_init(&sched->lock);
+    INIT_LIST_HEAD(&sched->pending);
+    INIT_WORK(&sched->work, max30102_sched_work);
+    sched->start = ktime_get();
+    snprintf(name, sizeof(name), "bus-%d", root->nr);
+    sched->debug_dir = debugfs_create_dir(name, max30102_debugfs_root);
+    debugfs_create_file("utilization", 0444, sched->debug_dir, sched, &max30102_sched_utilization_fops);
+    list_add(&sched->node, &max30102_scheds);
+found:
+    sched->refs++;
+    data->sched = sched;
+    mutex_unlock(&max30102_scheds_lock);
+    return 0;
+}
+
+/**
+ * max30102_sched_detach - Leave the scheduler, freeing it with its last sensor
+ * @data: MAX30102 device data
+ */
+void max30102_sched_detach(struct max30102_data *data)
+{
+    struct max30102_sched *sched = data->sched;
+
+    if (!sched) return;
+    spin_lock_irq(&sched->lock);
+    data->sched_detached = true;  // Late interrupts no longer queue it
+    list_del_init(&data->sched_node);
+    spin_unlock_irq(&sched->lock);
+    flush_work(&sched->work);
+
+    mutex_lock(&max30102_scheds_lock);
+    if (--sched->refs == 0) {
+        list_del(&sched->node);
+        cancel_work_sync(&sched->work);
+        debugfs_remove_recursive(sched->debug_dir);
+        kfree(sched);
+    }
+    mutex_unlock(&max30102_scheds_lock);
+    data->sched = NULL;
+}
+
+/**
+ * max30102_sched_kick - Queue a drain of the sensor
+ * @data: MAX30102 device data
+ *
+ * Safe from hard interrupt and hrtimer context. A sensor already pending is
+ * drained once.
+ */
+void max30102_sched_kick(struct max30102_data *data)
+{
+    struct max30102_sched *sched = data->sched;
+    unsigned long flags;
+
+    if (!sched) return;  // Detached, a late max30102_unlock() has nothing to drain
+    spin_lock_irqsave(&sched->lock, flags);
+    if (!data->sched_detached && list_empty(&data->sched_node))
+        list_add_tail(&data->sched_node, &sched->pending);
+    spin_unlock_irqrestore(&sched->lock, flags);
+    queue_work(system_highpri_wq, &sched->work);  // Drains are latency bound
+}
+
+/**
+ * max30102_sched_cancel - Drop a pending drain and wait for one in flight
+ * @data: MAX30102 device data
+ */
+void max30102_sched_cancel(struct max30102_data *data)
+{
+    struct max30102_sched *sched = data->sched;
+
+    spin_lock_irq(&sched->lock);
+    list_del_init(&data->sched_node);
+    spin_unlock_irq(&sched->lock);
+    flush_work(&sched->work);
+}
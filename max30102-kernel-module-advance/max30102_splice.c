@@ -0,0 +1,174 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "max30102.h"
+
+/*
+ * max30102_splice - record FIFO batches to a file, pipe or socket without
+ * copying them through user memory.
+ *
+ * The device's splice_read fills pipe pages straight from read_iter, and the
+ * pipe pages are then moved on to the output. Each batch is one
+ * struct max30102_fifo_data, as read() returns it. When the output is a pipe
+ * the batches go straight into it. Otherwise they are collected in a
+ * private pipe and flushed whenever the device has nothing more to hand
+ * out, so a file gets one write per burst of batches. Devices without
+ * splice support, such as the CUSE replay node, fall back to read() and
+ * write().
+ */
+
+#define PIPE_SIZE       (1024 * 1024)
+#define FLUSH_BYTES     (64 * sizeof(struct max30102_fifo_data))
+
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-d <device>] [-n <batches>] <output | ->\n", prog);
+}
+
+// Move everything the private pipe holds to the output
+static int flush_pipe(int pipe_rd, int out, size_t *pending) {
+    ssize_t n;
+
+    while (*pending > 0) {
+        n = splice(pipe_rd, NULL, out, NULL, *pending, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        *pending -= n;
+    }
+    return 0;
+}
+
+// read() and write() for devices that cannot splice
+static int copy_batch(int dev, int out) {
+    struct max30102_fifo_data fifo;
+    ssize_t n = read(dev, &fifo, sizeof(fifo));
+
+    if (n <= 0) return n;
+    return write(out, &fifo, n) == n ? 1 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *device = "/dev/max30102", *output = NULL;
+    unsigned long long limit = 0, bytes = 0, want;
+    struct sigaction sa = { .sa_handler = signal_handler };  // No SA_RESTART, a signal ends a waiting splice
+    struct pollfd pfd;
+    struct stat st;
+    size_t pending = 0;
+    int dev, out, pipefd[2] = { -1, -1 }, pipe_wr, copying = 0, ret = 0;
+    ssize_t n;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            device = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            limit = strtoull(argv[++i], NULL, 10);
+        } else if (!output && (argv[i][0] != '-' || strcmp(argv[i], "-") == 0)) {
+            output = argv[i];
+        } else {
+            output = NULL;
+            break;
+        }
+    }
+    if (!output) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    dev = open(device, O_RDONLY | O_NONBLOCK);
+    if (dev < 0) {
+        perror("Failed to open device");
+        return 1;
+    }
+    out = strcmp(output, "-") == 0 ? STDOUT_FILENO : open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        perror("Failed to open output");
+        close(dev);
+        return 1;
+    }
+
+    if (fstat(out, &st) == 0 && S_ISFIFO(st.st_mode)) {
+        pipe_wr = out;  // Already a pipe, nothing to flush
+    } else {
+        if (pipe(pipefd) < 0) {
+            perror("Failed to create pipe");
+            ret = 1;
+            goto out;
+        }
+        fcntl(pipefd[1], F_SETPIPE_SZ, PIPE_SIZE);  // More batches per flush, best effort
+        pipe_wr = pipefd[1];
+    }
+
+    pfd.fd = dev;
+    pfd.events = POLLIN;
+    while (running && (!limit || bytes < limit * sizeof(struct max30102_fifo_data))) {
+        if (copying) {
+            n = copy_batch(dev, out);
+            if (n > 0) {
+                bytes += sizeof(struct max30102_fifo_data);
+                continue;
+            }
+        } else {
+            want = limit ? limit * sizeof(struct max30102_fifo_data) - bytes : PIPE_SIZE;
+            // O_NONBLOCK on the device makes an empty FIFO return EAGAIN, a full output pipe still blocks
+            n = splice(dev, NULL, pipe_wr, NULL, want < PIPE_SIZE ? want : PIPE_SIZE, SPLICE_F_MORE);
+            if (n > 0) {
+                bytes += n;
+                if (pipe_wr != out && (pending += n) >= FLUSH_BYTES && flush_pipe(pipefd[0], out, &pending) < 0)
+                    break;
+                continue;
+            }
+            if (n < 0 && errno == EINVAL) {
+                fprintf(stderr, "%s cannot splice, copying through read() and write()\n", device);
+                copying = 1;
+                continue;
+            }
+        }
+        if (n == 0) break;  // End of a replayed recording
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN) {
+            perror("Failed to record");
+            ret = 1;
+            break;
+        }
+        // Nothing ready: write out what was collected, then sleep until the next drain
+        if (pipe_wr != out && flush_pipe(pipefd[0], out, &pending) < 0)
+            break;
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            perror("Failed to poll device");
+            ret = 1;
+            break;
+        }
+    }
+    if (pipe_wr != out && flush_pipe(pipefd[0], out, &pending) < 0) {
+        perror("Failed to write output");
+        ret = 1;
+    }
+    fprintf(stderr, "%llu batches, %llu bytes recorded\n",
+            bytes / sizeof(struct max30102_fifo_data), bytes);
+
+out:
+    if (pipefd[0] >= 0) close(pipefd[0]);
+    if (pipefd[1] >= 0) close(pipefd[1]);
+    if (out != STDOUT_FILENO) close(out);
+    close(dev);
+    return ret;
+}
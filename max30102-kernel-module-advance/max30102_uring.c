@@ -0,0 +1,318 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "max30102.h"
+
+/*
+ * max30102_uring - drain many sensors through one io_uring.
+ *
+ * Every sensor keeps one read in flight. The driver marks its files
+ * FMODE_NOWAIT, so io_uring tries each read inline and, while nothing has
+ * been drained, parks it on the device's poll queue instead of a worker
+ * thread. The loop waits until every sensor has completed a read, or the
+ * wait times out, and harvests all completions with one io_uring_enter()
+ * that also resubmits them.
+ *
+ * Sensors are read in history mode: the read asks for the samples from the
+ * next sequence number on and gets everything drained since, however many
+ * drains that was. A read that lands on evicted samples (-ERANGE) skips to
+ * the oldest held one and counts the gap. Devices without history, such as
+ * the CUSE replay node, are read one struct max30102_fifo_data at a time.
+ *
+ * No liburing, the ring is driven through the raw system calls.
+ */
+
+#define READ_SAMPLES    256  // History records asked for per read
+#define MAX_SENSORS     64
+
+struct ring {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned pending;  // Queued, not yet submitted
+    int ext_arg;       // io_uring_enter() takes a timeout
+};
+
+struct sensor {
+    const char *path;
+    int fd;
+    int history;
+    uint64_t seq;      // Next sample to read, history mode
+    void *buf;
+    size_t len;
+    unsigned long long samples, lost;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s <seconds>] [-w <ms>] [-o] [device...]\n", prog);
+    fprintf(stderr, "  -s  Stop after this many seconds\n");
+    fprintf(stderr, "  -w  Longest wait for a full round of completions, default 100 ms\n");
+    fprintf(stderr, "  -o  Start from the oldest sample held instead of the next one\n");
+}
+
+static int ring_init(struct ring *r, unsigned entries) {
+    struct io_uring_params p;
+    size_t sq_size, cq_size;
+    char *sq, *cq;
+
+    memset(&p, 0, sizeof(p));
+    r->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0) return -1;
+
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        sq_size = cq_size = sq_size > cq_size ? sq_size : cq_size;
+    sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) return -1;
+    cq = sq;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) return -1;
+    }
+    r->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) return -1;
+
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->pending = 0;
+    r->ext_arg = !!(p.features & IORING_FEAT_EXT_ARG);
+    return 0;
+}
+
+// Queue the next read of a sensor, submitted by the next ring_enter()
+static void queue_read(struct ring *r, struct sensor *s, unsigned idx) {
+    unsigned tail = *r->sq_tail, slot = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[slot];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = s->fd;
+    sqe->addr = (uint64_t)(uintptr_t)s->buf;
+    sqe->len = s->len;
+    sqe->off = s->history ? s->seq * sizeof(struct max30102_sample) : (uint64_t)-1;  // Batches ignore the offset
+    sqe->user_data = idx;
+    r->sq_array[slot] = slot;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->pending++;
+}
+
+// Submit what is queued and wait for min_complete completions or the timeout
+static int ring_enter(struct ring *r, unsigned min_complete, long timeout_ms) {
+    struct __kernel_timespec ts = { .tv_sec = timeout_ms / 1000, .tv_nsec = (timeout_ms % 1000) * 1000000L };
+    struct io_uring_getevents_arg arg = { .ts = (uint64_t)(uintptr_t)&ts };
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    int ret;
+
+    if (r->ext_arg) {
+        flags |= IORING_ENTER_EXT_ARG;
+        ret = syscall(__NR_io_uring_enter, r->fd, r->pending, min_complete, flags, &arg, sizeof(arg));
+    } else {
+        ret = syscall(__NR_io_uring_enter, r->fd, r->pending, 1, flags, NULL, 0);  // Old kernels, no bulk wait
+    }
+    if (ret >= 0) {
+        r->pending -= ret;
+    } else if (errno == ETIME) {
+        r->pending = 0;  // Submitted, the timeout only ended the wait
+        ret = 0;
+    }
+    return ret;
+}
+
+static int open_sensor(struct sensor *s, int from_oldest) {
+    struct max30102_history_info info;
+    uint8_t on = 1;
+
+    s->fd = open(s->path, O_RDONLY | O_NONBLOCK);
+    if (s->fd < 0) {
+        fprintf(stderr, "%s: %s\n", s->path, strerror(errno));
+        return -1;
+    }
+    s->history = ioctl(s->fd, MAX30102_IOC_SET_HISTORY, &on) == 0 &&
+                 ioctl(s->fd, MAX30102_IOC_GET_HISTORY, &info) == 0;
+    if (s->history) {
+        s->seq = from_oldest ? info.first : info.next;
+        s->len = READ_SAMPLES * sizeof(struct max30102_sample);
+    } else {
+        fprintf(stderr, "%s has no history, reading FIFO batches\n", s->path);
+        s->len = sizeof(struct max30102_fifo_data);
+    }
+    s->buf = malloc(s->len);
+    if (!s->buf) {
+        close(s->fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Account one completion, returns 1 to resubmit, 0 when the sensor is done
+static int complete_read(struct sensor *s, int res) {
+    struct max30102_history_info info;
+
+    if (res > 0) {
+        if (s->history) {
+            s->seq += res / sizeof(struct max30102_sample);
+            s->samples += res / sizeof(struct max30102_sample);
+        } else {
+            s->samples += ((struct max30102_fifo_data *)s->buf)->len;
+        }
+        return 1;
+    }
+    if (res == -ERANGE && s->history && ioctl(s->fd, MAX30102_IOC_GET_HISTORY, &info) == 0) {
+        s->lost += info.first - s->seq;  // Evicted before this read ran, carry on from the oldest held
+        s->seq = info.first;
+        return 1;
+    }
+    if (res == -EAGAIN || res == -EINTR) return 1;
+    if (res == 0) {
+        fprintf(stderr, "%s: end of data\n", s->path);  // Replay finished
+    } else {
+        fprintf(stderr, "%s: %s\n", s->path, strerror(-res));
+    }
+    return 0;
+}
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int main(int argc, char *argv[]) {
+    static struct sensor sensors[MAX_SENSORS];
+    struct sigaction sa = { .sa_handler = signal_handler };
+    unsigned long long enters = 0, completions = 0, samples = 0, lost = 0, last_enters = 0, last_completions = 0;
+    unsigned long long last_samples = 0;
+    uint64_t start, now, last;
+    long wait_ms = 100, seconds = 0;
+    int from_oldest = 0, n = 0, active = 0, i;
+    struct ring ring;
+    glob_t g = { 0 };
+    unsigned head, tail;
+    struct io_uring_cqe *cqe;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seconds = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            wait_ms = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            from_oldest = 1;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else if (n < MAX_SENSORS) {
+            sensors[n++].path = argv[i];
+        }
+    }
+    if (n == 0 && glob("/dev/max30102-*", 0, NULL, &g) == 0) {
+        for (i = 0; i < (int)g.gl_pathc && n < MAX_SENSORS; i++)
+            sensors[n++].path = g.gl_pathv[i];
+    }
+    if (n == 0) {
+        fprintf(stderr, "No sensors found\n");
+        return 1;
+    }
+
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (ring_init(&ring, MAX_SENSORS) < 0) {
+        perror("Failed to set up io_uring");
+        return 1;
+    }
+    if (!ring.ext_arg)
+        fprintf(stderr, "Kernel lacks IORING_FEAT_EXT_ARG, completions are harvested one wait at a time\n");
+    for (i = 0; i < n; i++) {
+        if (open_sensor(&sensors[i], from_oldest) < 0) {
+            sensors[i].fd = -1;
+            continue;
+        }
+        queue_read(&ring, &sensors[i], i);
+        active++;
+    }
+
+    start = last = monotonic_ms();
+    while (running && active > 0) {
+        // One call submits the resubmissions and waits for a full round
+        if (ring_enter(&ring, active, wait_ms) < 0) {
+            if (errno == EINTR) continue;
+            perror("io_uring_enter failed");
+            break;
+        }
+        enters++;
+
+        head = *ring.cq_head;
+        tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            cqe = &ring.cqes[head & *ring.cq_mask];
+            completions++;
+            i = cqe->user_data;
+            if (complete_read(&sensors[i], cqe->res)) {
+                queue_read(&ring, &sensors[i], i);
+            } else {
+                close(sensors[i].fd);
+                sensors[i].fd = -1;
+                active--;
+            }
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+        now = monotonic_ms();
+        if (now - last >= 1000) {
+            for (i = 0, samples = 0, lost = 0; i < n; i++) {
+                samples += sensors[i].samples;
+                lost += sensors[i].lost;
+            }
+            printf("%d sensors: %llu io_uring_enter, %llu completions, %llu samples per second, %llu lost\n",
+                   active, (enters - last_enters) * 1000 / (now - last),
+                   (completions - last_completions) * 1000 / (now - last),
+                   (samples - last_samples) * 1000 / (now - last), lost);
+            fflush(stdout);
+            last_enters = enters;
+            last_completions = completions;
+            last_samples = samples;
+            last = now;
+        }
+        if (seconds && now - start >= (uint64_t)seconds * 1000) break;
+    }
+
+    for (i = 0, samples = 0, lost = 0; i < n; i++) {
+        samples += sensors[i].samples;
+        lost += sensors[i].lost;
+        if (sensors[i].fd >= 0) close(sensors[i].fd);
+        free(sensors[i].buf);
+    }
+    fprintf(stderr, "%llu samples in %llu completions and %llu io_uring_enter calls, %llu lost\n",
+            samples, completions, enters, lost);
+    close(ring.fd);
+    globfree(&g);
+    return 0;
+}
@@ -5,27 +5,22 @@
 #include <sys/ioctl.h>
 #include <signal.h>
 #include <pthread.h>
-#include <mqueue.h>
 #include <sys/wait.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 #include <poll.h>  // Added for poll()
-#include <sys/mman.h>  // For shared memory
-#include <sys/stat.h>  // For FIFO
-#include <sys/types.h>  // For pipe
 #include "max30102.h"
-
-#define SHM_NAME "/max30102_shm"
-#define SHM_SIZE 1024
-#define FIFO_NAME "/tmp/max30102_fifo"
+#include "max30102_bus.h"
+#include "driver_max30102_rt.h"
 
 static int fd = -1;
 static volatile sig_atomic_t running = 1;
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
-mqd_t mq;  // Message queue for IPC
-int pipe_fd[2];  // Pipe for IPC
-int shm_fd;  // Shared memory FD
-void *shm_ptr;  // Shared memory pointer
+struct max30102_bus bus;  // Shared-memory sample bus (IPC), this process publishes
+static max30102_rt_config_t rt = { .priority = 0, .cpu = -1, .lock_memory = 0 };  // FIFO thread scheduling
+static int configure;  // Override the device tree boot profile with ioctls
+static struct max30102_qos qos;  // Latency and rate this process needs, all 0 makes no request
 
 // Signal handler with default/ignore demonstration
 static void signal_handler(int sig) {
@@ -37,28 +32,26 @@ static void signal_handler(int sig) {
     }
 }
 
-// Poll function
-static unsigned int max30102_poll(struct file *file, struct pollfd *pfd)
-{
-    struct max30102_data *data = file->private_data;
-    unsigned int revents = 0;
-
-    if (!data) return -EINVAL;
-
-    if (data->fifo_full)
-        revents |= POLLIN | POLLRDNORM;
-
-    return revents;
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
 // Thread function to read FIFO continuously (joinable thread)
 void *fifo_thread(void *arg) {
     struct max30102_fifo_data fifo_data;
-    char buf[256];
     struct pollfd pfd = { .fd = fd, .events = POLLIN };
     pthread_t tid = pthread_self();  // Thread ID
+    uint8_t applied = 0;
     printf("FIFO thread ID: %lu\n", (unsigned long)tid);
 
+    // Real-time: priority, pinning and locked pages before the first drain
+    if (max30102_rt_apply(&rt, &applied) != 0) {
+        fprintf(stderr, "FIFO thread real-time settings refused (applied 0x%x)\n", applied);
+    }
+    max30102_rt_prefault(&fifo_data, sizeof(fifo_data));
+
     while (running) {
         int poll_ret = poll(&pfd, 1, 1000);
         if (poll_ret < 0) {
@@ -76,21 +69,12 @@ void *fifo_thread(void *arg) {
                 pthread_mutex_unlock(&mutex);
                 break;
             }
-            sprintf(buf, "FIFO: %d samples", fifo_data.len);
-            // IPC: Send to message queue
-            ret = mq_send(mq, buf, strlen(buf) + 1, 0);
-            if (ret < 0) {
-                perror("mq_send failed");
-            }
-            // IPC: Write to pipe
-            ret = write(pipe_fd[1], buf, strlen(buf) + 1);
+            pthread_mutex_unlock(&mutex);
+            // IPC: Publish the samples themselves on the shared-memory bus
+            ret = max30102_bus_publish(&bus, fifo_data.red, fifo_data.ir, fifo_data.len, monotonic_ns());
             if (ret < 0) {
-                perror("Pipe write failed");
+                fprintf(stderr, "Bus publish failed: %s\n", strerror(-ret));
             }
-            // IPC: Write to shared memory
-            memcpy(shm_ptr, buf, strlen(buf) + 1);
-            pthread_cond_signal(&cond);
-            pthread_mutex_unlock(&mutex);
         }
         usleep(100000);  // Reduced sleep for better responsiveness
     }
@@ -126,7 +110,43 @@ void *temp_thread(void *arg) {
     return NULL;
 }
 
+// Consume the leading --rt-priority=N, --cpu=N, --mlock, --configure, --latency-us=N and --min-rate=N options
+static int parse_options(int *argc, char *argv[]) {
+    int i = 1;
+
+    while (i < *argc && strncmp(argv[i], "--", 2) == 0) {
+        if (strncmp(argv[i], "--rt-priority=", 14) == 0) {
+            rt.priority = atoi(argv[i] + 14);
+            if (rt.priority < 1 || rt.priority > 99) return -1;
+        } else if (strncmp(argv[i], "--cpu=", 6) == 0) {
+            rt.cpu = atoi(argv[i] + 6);
+            if (rt.cpu < 0) return -1;
+        } else if (strcmp(argv[i], "--mlock") == 0) {
+            rt.lock_memory = 1;
+        } else if (strcmp(argv[i], "--configure") == 0) {
+            configure = 1;
+        } else if (strncmp(argv[i], "--latency-us=", 13) == 0) {
+            qos.max_latency_us = strtoul(argv[i] + 13, NULL, 10);
+        } else if (strncmp(argv[i], "--min-rate=", 11) == 0) {
+            qos.min_rate_hz = strtoul(argv[i] + 11, NULL, 10);
+        } else {
+            return -1;
+        }
+        i++;
+    }
+    // Shift the remaining arguments down so argv[1] is the first positional one
+    memmove(&argv[1], &argv[i], (*argc - i + 1) * sizeof(char *));
+    *argc -= i - 1;
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
+    if (parse_options(&argc, argv) < 0) {
+        fprintf(stderr, "Usage: %s [--rt-priority=1..99] [--cpu=N] [--mlock] [--configure]\n"
+                        "          [--latency-us=N] [--min-rate=HZ] [arg]\n", argv[0]);
+        return 1;
+    }
+
     // Command line arguments (Process management)
     if (argc > 1) {
         printf("Command line arg: %s\n", argv[1]);
@@ -152,59 +172,52 @@ int main(int argc, char *argv[]) {
     // Ignore SIGPIPE
     signal(SIGPIPE, SIG_IGN);
 
-    // Message queue setup (IPC: POSIX Message Queue)
-    struct mq_attr attr = { .mq_maxmsg = 10, .mq_msgsize = 256 };
-    mq = mq_open("/max30102_mq", O_CREAT | O_RDWR, 0666, &attr);
-    if (mq == (mqd_t)-1) {
-        perror("mq_open");
-        close(fd);
-        return 1;
-    }
-
-    // Pipe setup (IPC: Pipes)
-    if (pipe(pipe_fd) < 0) {
-        perror("pipe");
-        mq_close(mq);
-        mq_unlink("/max30102_mq");
+    // Sample bus setup (IPC: POSIX shared memory ring, see max30102_bus.h)
+    int ret = max30102_bus_create(&bus, MAX30102_BUS_NAME, MAX30102_BUS_DEFAULT_SLOTS);
+    if (ret < 0) {
+        fprintf(stderr, "Bus create failed: %s\n", strerror(-ret));
         close(fd);
         return 1;
     }
 
-    // FIFO setup (IPC: FIFO)
-    mkfifo(FIFO_NAME, 0666);
-    int fifo_fd = open(FIFO_NAME, O_WRONLY | O_NONBLOCK);
-    if (fifo_fd < 0) {
-        perror("open FIFO");
-    }
-
-    // Shared memory setup (IPC: POSIX Shared Memory)
-    shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
-    if (shm_fd < 0) {
-        perror("shm_open");
-    } else {
-        if (ftruncate(shm_fd, SHM_SIZE) < 0) {
-            perror("ftruncate");
-        }
-        shm_ptr = mmap(0, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-        if (shm_ptr == MAP_FAILED) {
-            perror("mmap");
-            shm_ptr = NULL;
-        }
-    }
-
-    // Config with error check
+    // Config with error check. The driver already streams the device tree boot
+    // profile, so the ioctls are only needed to override it. With a QoS request
+    // the driver picks the averaging and watermark instead of the FIFO config
     uint8_t mode = MAX30102_MODE_SPO2;
     struct max30102_slot_config slot_config = { .slot = 1, .led = 2 };
     uint8_t fifo_config = MAX30102_FIFO_SMP_AVE_8;
     uint8_t spo2_config = MAX30102_SPO2_CONFIG_DEFAULT;
+    struct max30102_qos_info qos_info;
+    int want_qos = qos.max_latency_us || qos.min_rate_hz;
 
-    if (ioctl(fd, MAX30102_IOC_SET_FIFO_CONFIG, &fifo_config) < 0 ||
-        ioctl(fd, MAX30102_IOC_SET_SPO2_CONFIG, &spo2_config) < 0 ||
-        ioctl(fd, MAX30102_IOC_SET_MODE, &mode) < 0 ||
-        ioctl(fd, MAX30102_IOC_SET_SLOT, &slot_config) < 0) {
+    if (configure &&
+        ((!want_qos && ioctl(fd, MAX30102_IOC_SET_FIFO_CONFIG, &fifo_config) < 0) ||
+         ioctl(fd, MAX30102_IOC_SET_SPO2_CONFIG, &spo2_config) < 0 ||
+         ioctl(fd, MAX30102_IOC_SET_MODE, &mode) < 0 ||
+         ioctl(fd, MAX30102_IOC_SET_SLOT, &slot_config) < 0)) {
         perror("Config ioctl failed");
         goto cleanup;
     }
+    // Held until the device is closed, the driver re-evaluates all requests then
+    if (want_qos) {
+        if (ioctl(fd, MAX30102_IOC_SET_QOS, &qos) < 0 || ioctl(fd, MAX30102_IOC_GET_QOS, &qos_info) < 0) {
+            perror("QoS ioctl failed");  // ERANGE: not possible at the configured sample rate
+            goto cleanup;
+        }
+        printf("QoS: %u us latency, %u.%03u sps, %u.%03u wakeups/s (average %u, watermark %u%s)\n",
+               qos_info.latency_us, qos_info.rate_mhz / 1000, qos_info.rate_mhz % 1000, qos_info.wakeups_mhz / 1000,
+               qos_info.wakeups_mhz % 1000, qos_info.average, qos_info.watermark, qos_info.ppg_rdy ? ", PPG_RDY" : "");
+    }
+
+    // The FIFO thread may run SCHED_FIFO and shares the mutex with the temperature
+    // thread, so let the holder inherit its priority instead of being preempted
+    if (rt.priority > 0) {
+        pthread_mutexattr_t mattr;
+        pthread_mutexattr_init(&mattr);
+        pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+        pthread_mutex_init(&mutex, &mattr);
+        pthread_mutexattr_destroy(&mattr);
+    }
 
     // Threads (POSIX Threads: joinable and detachable)
     pthread_t fifo_tid, temp_tid;
@@ -212,7 +225,7 @@ int main(int argc, char *argv[]) {
     pthread_attr_init(&attr_detach);
     pthread_attr_setdetachstate(&attr_detach, PTHREAD_CREATE_DETACHED);
 
-    int ret = pthread_create(&fifo_tid, NULL, fifo_thread, NULL);
+    ret = pthread_create(&fifo_tid, NULL, fifo_thread, NULL);
     if (ret != 0) {
         perror("pthread_create fifo");
         goto cleanup;
@@ -247,54 +260,32 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    // Main loop: Receive from queue (IPC)
-    char buf[256];
+    // Main loop: consume the bus like any other local reader would (IPC)
+    struct max30102_bus_reader reader;
+    struct max30102_bus_record recs[64];
+    uint64_t lost = 0;
+    max30102_bus_reader_init(&reader, &bus, 0);
     while (running) {
-        int ret = pthread_mutex_lock(&mutex);
-        if (ret != 0) {
-            perror("Mutex lock failed");
-            break;
+        ret = max30102_bus_wait(&reader, 1000);
+        if (ret == -ETIMEDOUT || ret == -EINTR) {
+            continue;
         }
-        ret = pthread_cond_wait(&cond, &mutex);
-        if (ret != 0) {
-            perror("Cond wait failed");
-            pthread_mutex_unlock(&mutex);
-            break;
+        int n = max30102_bus_read(&reader, recs, 64);
+        if (n > 0) {
+            printf("Received from bus: %d samples, seq %llu, Red=%u, IR=%u\n", n,
+                   (unsigned long long)recs[n - 1].seq, recs[n - 1].red, recs[n - 1].ir);
         }
-        // Read from message queue
-        ssize_t mq_ret = mq_receive(mq, buf, 256, NULL);
-        if (mq_ret < 0) {
-            perror("mq_receive");
-        } else {
-            printf("Received from queue: %s\n", buf);
-        }
-        // Read from pipe
-        ssize_t pipe_ret = read(pipe_fd[0], buf, 256);
-        if (pipe_ret < 0) {
-            perror("pipe read");
-        } else {
-            printf("Received from pipe: %s\n", buf);
+        if (reader.lost != lost) {
+            printf("Bus reader lagged: %llu samples lost\n", (unsigned long long)(reader.lost - lost));
+            lost = reader.lost;
         }
-        // Read from shared memory
-        if (shm_ptr) {
-            printf("Received from shm: %s\n", (char *)shm_ptr);
-        }
-        pthread_mutex_unlock(&mutex);
     }
 
 cleanup:
     // Cleanup
     pthread_join(fifo_tid, NULL);  // Join joinable thread
     // Detached thread self-terminates
-    if (fifo_fd > 0) close(fifo_fd);
-    unlink(FIFO_NAME);
-    if (shm_ptr) munmap(shm_ptr, SHM_SIZE);
-    if (shm_fd > 0) close(shm_fd);
-    shm_unlink(SHM_NAME);
-    close(pipe_fd[0]);
-    close(pipe_fd[1]);
-    mq_close(mq);
-    mq_unlink("/max30102_mq");
+    max30102_bus_close(&bus);
     close(fd);
     return 0;
 }
\ No newline at end of file